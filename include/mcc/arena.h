@@ -5,20 +5,85 @@
 
 typedef unsigned char Byte;
 
+// A chunk of OS virtual memory that a growable arena allocates from. The
+// header sits at the start of the chunk, and the blocks of an arena form a
+// chain in the order they were mapped
+typedef struct ArenaBlock ArenaBlock;
+struct ArenaBlock {
+  // The memory of the block starts right after the header
+  alignas(max_align_t) ArenaBlock* previous;
+  // A block that stays after its arena (or a copy of the arena passed by
+  // value) moved past it, and gets reused when the arena needs to grow again
+  ArenaBlock* next;
+  size_t size; // Bytes of the whole chunk, including this header
+  // Bytes from the start of the chunk that count towards the memory limit. The
+  // rest is only address space until an arena moves into it
+  size_t committed_size;
+};
+
 // Arena memory allocator for bulk allocations
 typedef struct Arena {
-  void* begin;
+  void* begin; // Start of the current block
   Byte* previous;
   Byte* current;
-  size_t size_remain;
+  size_t size_remain; // Bytes left in the committed part of the current block
+  ArenaBlock* block;  // Current block of a growable arena, null for a buffer
 } Arena;
 
+// An arena over a fixed buffer. It does not grow, and running out of the
+// buffer is a fatal error
 Arena arena_init(void* buffer, size_t size);
 void arena_reset(Arena* arena);
 
-// Allocate an arena from a large chunk of OS virtual memory
+// Allocate a growable arena whose first block is `size` bytes of OS virtual
+// memory. Once a block is full, the arena chains a new one at least twice as
+// large
 Arena arena_from_virtual_mem(size_t size);
 
+// Gives the memory of an arena from arena_from_virtual_mem back to the OS
+void arena_release_virtual_mem(Arena* arena);
+
+// Makes the blocks of the growable arena `other` part of the growable arena
+// `arena`, so that what was allocated from `other` lives as long as `arena`
+// and is released with it. `other` is left empty
+void arena_adopt_blocks(Arena* arena, Arena* other);
+
+// Caps the memory that growable arenas and virtual ranges together commit, or
+// lifts the cap if `limit` is 0. Address space that is mapped but not used yet
+// does not count. Committing past the cap ends the compilation with a fatal
+// error
+void arena_set_memory_limit(size_t limit);
+
+// Backs the blocks that growable arenas map from now on with 2 MB huge pages,
+// and prefaults the start of each new arena. Fewer pages mean fewer page
+// faults and TLB misses while walking large inputs
+void arena_set_huge_pages(bool enabled);
+
+// A range of virtual address space that is reserved upfront and committed as
+// it fills up. Committing more never moves the range, unlike an arena
+typedef struct VirtualRange {
+  Byte* begin;
+  size_t committed_size;
+  size_t reserved_size;
+} VirtualRange;
+
+VirtualRange virtual_range_reserve(size_t size);
+
+// Commits at least the first `size` bytes of a range. Committed memory counts
+// towards the memory limit
+void virtual_range_commit(VirtualRange* range, size_t size);
+
+void virtual_range_release(VirtualRange* range);
+
+// Moves a growable arena to a block with room for `size` bytes at the
+// alignment, committing more of the current block first if that has room. The
+// allocation functions call it when the committed part of the block is full
+void arena_grow(Arena* arena, size_t alignment, size_t size);
+
+// Commits more of the current block of a growable arena so that `size` more
+// bytes fit past `current`. Returns false if the block is too small
+bool arena_commit_in_block(Arena* arena, size_t size);
+
 #if defined(__GNUC__) || defined(__clang__)
 __attribute((malloc))
 #endif
@@ -1,14 +1,14 @@
 #ifndef MCC_AST_H
 #define MCC_AST_H
 
-#include "hash_table.h"
+#include "interner.h"
 #include "source_location.h"
 #include "str.h"
 #include "type.h"
 
 #include <stdlib.h>
 
-typedef enum ExprType {
+typedef enum ExprType : uint8_t {
   EXPR_INVALID = 0,
   EXPR_CONST,
   EXPR_VARIABLE,
@@ -18,14 +18,14 @@ typedef enum ExprType {
   EXPR_CALL,
 } ExprTag;
 
-typedef enum UnaryOpType {
+typedef enum UnaryOpType : uint8_t {
   UNARY_OP_INVALID = 0,
   UNARY_OP_NEGATION,                // -
   UNARY_OP_BITWISE_TYPE_COMPLEMENT, // ~
   UNARY_OP_NOT,                     // !
 } UnaryOpType;
 
-typedef enum BinaryOpType {
+typedef enum BinaryOpType : uint8_t {
   BINARY_OP_INVALID = 0,
 
   BINARY_OP_PLUS,
@@ -63,51 +63,63 @@ typedef enum BinaryOpType {
   BINARY_OP_SHIFT_RIGHT_EQUAL,
 } BinaryOpType;
 
-typedef struct Expr Expr;
-typedef struct IdentifierInfo IdentifierInfo; // identifier
-typedef struct Scope Scope;
+/*
+ * The nodes of a translation unit live in pools, one per kind of node, and
+ * refer to each other by 32-bit indices. Expressions and statements, by far the
+ * most common nodes, are stored as structs of arrays: a walk over the tree
+ * reads the tags and the 8-byte payloads from dense arrays, while data that is
+ * only needed for diagnostics (source ranges) sits in separate side arrays.
+ *
+ * Index 0 of the expression and statement pools is a placeholder, so that 0
+ * can stand for a missing optional child.
+ */
 
-struct ConstExpr {
-  int32_t val;
-};
+typedef uint32_t ExprId;
+typedef uint32_t StmtId;
+typedef uint32_t VariableDeclId;
 
-struct UnaryOpExpr {
-  UnaryOpType unary_op_type;
-  Expr* inner_expr;
-};
+enum { NO_EXPR = 0, NO_STMT = 0 };
 
-struct BinaryOpExpr {
-  BinaryOpType binary_op_type;
-  Expr* lhs;
-  Expr* rhs;
-};
+typedef struct IdentifierInfo IdentifierInfo; // identifier
+typedef struct Scope Scope;
+
+// Payload of an expression. Children that do not fit in 8 bytes are stored in
+// a side pool that the payload indexes into
+typedef union ExprData {
+  int32_t const_value;            // EXPR_CONST
+  const IdentifierInfo* variable; // EXPR_VARIABLE
+  ExprId inner_expr;              // EXPR_UNARY
+  struct BinaryOpExpr {
+    ExprId lhs;
+    ExprId rhs;
+  } binary_op;      // EXPR_BINARY
+  uint32_t ternary; // EXPR_TERNARY: index into AstNodes::ternaries
+  uint32_t call;    // EXPR_CALL: index into AstNodes::calls
+} ExprData;
+static_assert(sizeof(ExprData) == 8);
+
+typedef struct ExprPool {
+  uint32_t length;
+  uint32_t capacity;
+  ExprTag* tags;
+  uint8_t* ops;   // a UnaryOpType or BinaryOpType, 0 for other expressions
+  ExprData* data;
+  const Type** types; // C type (e.g. void, int, int*), set by type checking
+  SourceRange* source_ranges;
+} ExprPool;
 
 struct TernaryExpr {
-  Expr* cond;
-  Expr* true_expr;
-  Expr* false_expr;
+  ExprId cond;
+  ExprId true_expr;
+  ExprId false_expr;
 };
 
 struct CallExpr {
-  Expr* function;
-  Expr** args;
+  ExprId function;
   uint32_t arg_count;
+  uint32_t first_arg; // index into AstNodes::call_args
 };
 
-typedef struct Expr {
-  SourceRange source_range;
-  ExprTag tag;
-  const Type* type; // C type (e.g. void, int, int*)
-  union {
-    struct ConstExpr const_expr;
-    struct UnaryOpExpr unary_op;
-    struct BinaryOpExpr binary_op;
-    const IdentifierInfo* variable;
-    struct TernaryExpr ternary;
-    struct CallExpr call;
-  };
-} Expr;
-
 typedef enum StorageClass {
   STORAGE_CLASS_NONE = 0,
   STORAGE_CLASS_EXTERN,
@@ -119,10 +131,10 @@ typedef struct VariableDecl {
   StorageClass storage_class;
   SourceRange source_range;
   IdentifierInfo* name;
-  Expr* initializer; // An optional initializer
+  ExprId initializer; // An optional initializer
 } VariableDecl;
 
-typedef enum StmtTag {
+typedef enum StmtTag : uint8_t {
   STMT_INVALID = 0,
   STMT_EMPTY,
   STMT_EXPR, // An expression statement
@@ -136,53 +148,56 @@ typedef enum StmtTag {
   STMT_CONTINUE,
 } StmtTag;
 
-typedef struct BlockItem BlockItem;
-
+// The items of a block are consecutive in AstNodes::block_items
 typedef struct Block {
-  size_t child_count;
-  BlockItem* children;
+  uint32_t first_child;
+  uint32_t child_count;
 } Block;
 
-typedef struct Stmt Stmt;
+typedef union StmtData {
+  ExprId expr;    // STMT_EXPR and STMT_RETURN
+  Block compound; // STMT_COMPOUND
+  uint32_t if_then; // STMT_IF: index into AstNodes::ifs
+
+  // while or do while loop
+  struct While {
+    ExprId cond;
+    StmtId body;
+  } while_loop;
+
+  uint32_t for_loop; // STMT_FOR: index into AstNodes::for_loops
+} StmtData;
+static_assert(sizeof(StmtData) == 8);
+
+typedef struct StmtPool {
+  uint32_t length;
+  uint32_t capacity;
+  StmtTag* tags;
+  StmtData* data;
+  SourceRange* source_ranges;
+} StmtPool;
+
+struct IfStmt {
+  ExprId cond;
+  StmtId then;
+  StmtId els; // optional, can be NO_STMT
+};
 
-enum ForInitTag { FOR_INIT_INVALID, FOR_INIT_DECL, FOR_INIT_EXPR };
+enum ForInitTag : uint8_t { FOR_INIT_INVALID, FOR_INIT_DECL, FOR_INIT_EXPR };
 
 typedef struct ForInit {
   enum ForInitTag tag;
   union {
-    VariableDecl* decl;
-    Expr* expr; // optional, can be nullptr
+    VariableDeclId decl;
+    ExprId expr; // optional, can be NO_EXPR
   };
 } ForInit;
 
-struct Stmt {
-  SourceRange source_range;
-  StmtTag tag;
-  union {
-    Block compound;
-    struct ReturnStmt {
-      Expr* expr;
-    } ret;
-    Expr* expr;
-    struct IfStmt {
-      Expr* cond;
-      Stmt* then;
-      Stmt* els; // optional, can be nullptr
-    } if_then;
-
-    // while or do while loop
-    struct While {
-      Expr* cond;
-      Stmt* body;
-    } while_loop;
-
-    struct For {
-      ForInit init;
-      Expr* cond; // optional, can be nullptr
-      Expr* post; // optional, can be nullptr
-      Stmt* body;
-    } for_loop;
-  };
+struct For {
+  ForInit init;
+  ExprId cond; // optional, can be NO_EXPR
+  ExprId post; // optional, can be NO_EXPR
+  StmtId body;
 };
 
 typedef struct Parameters {
@@ -208,7 +223,7 @@ typedef enum DeclTag {
 typedef struct Decl {
   DeclTag tag;
   union {
-    struct VariableDecl var;
+    VariableDeclId var;
     struct FunctionDecl* func;
   };
 } Decl;
@@ -221,20 +236,47 @@ enum BlockItemTag {
 typedef struct BlockItem {
   enum BlockItemTag tag;
   union {
-    Stmt stmt;
+    StmtId stmt;
     Decl decl;
   };
 } BlockItem;
 
+// Pools of nodes that are too large for the payload of an expression or a
+// statement, or that are variably sized
+#define AST_POOL(T)                                                            \
+  struct {                                                                     \
+    uint32_t length;                                                           \
+    uint32_t capacity;                                                         \
+    T* data;                                                                   \
+  }
+
+typedef struct AstNodes {
+  ExprPool exprs;
+  StmtPool stmts;
+  AST_POOL(struct TernaryExpr) ternaries;
+  AST_POOL(struct CallExpr) calls;
+  AST_POOL(ExprId) call_args;
+  AST_POOL(struct IfStmt) ifs;
+  AST_POOL(struct For) for_loops;
+  AST_POOL(VariableDecl) variable_decls;
+  AST_POOL(BlockItem) block_items;
+} AstNodes;
+
+#undef AST_POOL
+
 typedef struct TranslationUnit {
   uint32_t decl_count;
   Decl* decls;
   Scope* global_scope;
 
-  // Besides stored in the scopes, the identifiers of functions in a translation
-  // unit are also refered to in a separate hash table. This is useful because
-  // each named only map to one instance of a function no matter the scope
-  HashMap functions;
+  // Spellings of all the symbols in the translation unit. Later phases add
+  // fresh symbols for the names they generate
+  Interner* interner;
+
+  // Canonical types of the translation unit
+  TypeInterner* types;
+
+  AstNodes nodes;
 } TranslationUnit;
 
 StringView string_from_ast(const TranslationUnit* tu, Arena* permanent_arena);
@@ -1,6 +1,7 @@
 #ifndef MCC_CLI_ARGS_H
 #define MCC_CLI_ARGS_H
 #include <stdbool.h>
+#include <stddef.h>
 
 typedef struct CliArgs {
   const char* source_filename; // Filename of the source file (with extension)
@@ -12,6 +13,15 @@ typedef struct CliArgs {
   bool codegen_only;       // generate assembly; but does not save to a file
   bool compile_only;       // Compile only; do not assemble or link
   bool stop_before_linker; // Compile and assemble, do not run linker
+
+  bool stream_tokens; // Lex on demand while parsing
+  bool skim_bodies;   // Only parse the reachable function bodies
+  bool parallel_bodies; // Parse the function bodies on worker threads
+  bool stream_functions; // Compile each function as soon as it is parsed
+
+  size_t error_limit; // Stop after this many errors, 0 for no limit
+  size_t max_memory;  // Bytes the arenas may commit, 0 for no limit
+  bool huge_pages;    // Back the arenas with huge pages
 } CliArgs;
 
 CliArgs parse_cli_args(int argc, char** argv);
@@ -4,6 +4,8 @@
 #include "source_location.h"
 #include "str.h"
 
+#include <stdio.h>
+
 typedef struct Error {
   StringView msg;
   SourceRange range;
@@ -14,10 +16,15 @@ typedef struct ErrorsView {
   Error* data;
 } ErrorsView;
 
+/// @brief Everything needed to render diagnostics of a file
+///
+/// Line numbers are only needed when there is something to report, so the
+/// line number table is built on the first written diagnostic
 typedef struct DiagnosticsContext {
   const char* filename;
   StringView source;
-  const LineNumTable* line_num_table;
+  Arena* permanent_arena; // holds the line number table
+  Arena scratch_arena;
 } DiagnosticsContext;
 
 DiagnosticsContext create_diagnostic_context(const char* filename,
@@ -25,9 +32,33 @@ DiagnosticsContext create_diagnostic_context(const char* filename,
                                              Arena* permanent_arena,
                                              Arena scratch_arena);
 
-void print_diagnostics(ErrorsView errors, const DiagnosticsContext* context);
+/// @brief Renders diagnostics into a buffer that is written to a stream in
+/// large chunks
+///
+/// The buffer is allocated on the first written diagnostic, like the line
+/// number table. Lines that do not fit in it are written directly.
+typedef struct DiagnosticsSink {
+  const DiagnosticsContext* context;
+  FILE* stream;
+  size_t error_limit; // stop after this many errors, 0 for no limit
+  size_t error_count; // reported so far
+  LineCursor lines;   // diagnostics are mostly sorted by position
+  char* buffer;
+  size_t length; // of the output not written yet
+} DiagnosticsSink;
+
+DiagnosticsSink create_diagnostics_sink(const DiagnosticsContext* context,
+                                        FILE* stream, size_t error_limit);
 
-void write_diagnostics(StringBuffer* output, const Error* error,
-                       const DiagnosticsContext* context);
+/// @brief Writes the errors to the stream of the sink
+///
+/// Once the error limit is reached, the rest of the errors are dropped and a
+/// note is written instead. All output is written out before returning.
+/// @return false if the error limit is reached, in which case the caller should
+/// stop
+bool report_diagnostics(DiagnosticsSink* sink, ErrorsView errors);
+
+/// @brief Writes the errors to stderr, without an error limit
+void print_diagnostics(ErrorsView errors, const DiagnosticsContext* context);
 
 #endif // MCC_DIAGNOSTIC_H
@@ -23,4 +23,39 @@
     (arr)->data[(arr)->length++] = elem;                                       \
   } while (0)
 
+// A vector is a dynamically sized array in a virtual memory range of its own,
+// which is committed as the vector grows. Its elements never move, so growing
+// never copies and leaves no dead copy behind in an arena. A zero-initialized
+// vector is empty, and its owner releases it with VECTOR_RELEASE. It should be
+// a struct with the following members
+// T* data
+// uint32_t length
+// uint32_t capacity
+// VirtualRange range
+
+// Address space reserved by each vector. Only the part in use is committed
+#define VECTOR_RESERVE_SIZE ((size_t)1024 * 1024 * 1024)
+
+#define VECTOR_PUSH_BACK(vec, T, elem)                                         \
+  do {                                                                         \
+    if ((vec)->length == (vec)->capacity) {                                    \
+      if ((vec)->range.begin == nullptr) {                                     \
+        (vec)->range = virtual_range_reserve(VECTOR_RESERVE_SIZE);             \
+        (vec)->data = (T*)(vec)->range.begin;                                  \
+      }                                                                        \
+      virtual_range_commit(&(vec)->range,                                      \
+                           ((size_t)(vec)->length + 1) * sizeof(T));           \
+      (vec)->capacity = (uint32_t)((vec)->range.committed_size / sizeof(T));   \
+    }                                                                          \
+    (vec)->data[(vec)->length++] = elem;                                       \
+  } while (0)
+
+#define VECTOR_RELEASE(vec)                                                    \
+  do {                                                                         \
+    virtual_range_release(&(vec)->range);                                      \
+    (vec)->data = nullptr;                                                     \
+    (vec)->length = 0;                                                         \
+    (vec)->capacity = 0;                                                       \
+  } while (0)
+
 #endif // MCC_DYNARRAY_H
@@ -7,19 +7,114 @@
 #include "token.h"
 
 typedef struct TranslationUnit TranslationUnit;
+typedef struct Decl Decl;
+typedef struct AstNodes AstNodes;
 
 typedef struct ParseResult {
   TranslationUnit* ast;
   ErrorsView errors;
+  // Errors of the semantic analysis, if it was done while parsing. Only
+  // meaningful if parsing succeeded
+  ErrorsView type_errors;
 } ParseResult;
 
+/// @brief State of scanning a source file token by token
+typedef struct Lexer {
+  const char* start;
+  const char* end; // points to the null terminator of the source
+  const char* previous;
+  const char* current;
+} Lexer;
+
+Lexer lexer_create(const char* source);
+
+/// @brief Scan the next token. Keeps returning TOKEN_EOF at the end of source
+Token lexer_next_token(Lexer* lexer);
+
 /// @brief Scan the source file and generate a list of tokens
-Tokens lex(const char* source, Arena* permanent_arena, Arena scratch_arena);
+///
+/// Large sources are lexed in parallel on all available cores
+Tokens lex(const char* source, Arena* permanent_arena);
+
+/// @brief Same as lex, but interns the identifiers into an existing interner
+///
+/// The interner can live in a longer-lived arena than the token arrays, which
+/// are dead once the source is parsed.
+Tokens lex_with_interner(const char* source, Interner* interner,
+                         Arena* token_arena);
+
+/// @brief Scan the source file with the specified number of threads, no matter
+/// how large the source is
+Tokens lex_with_threads(const char* source, uint32_t thread_count,
+                        Arena* permanent_arena);
 
 /// @brief Parse tokens into AST
 ParseResult parse(const char* src, Tokens tokens, Arena* permanent_arena,
                   Arena scratch_arena);
 
+/// @brief Parse a source file into AST, scanning tokens on demand
+///
+/// Unlike parse, the tokens of the whole file never exist at once. Only a small
+/// window of the most recent tokens is kept.
+ParseResult parse_on_demand(const char* src, Arena* permanent_arena,
+                            Arena scratch_arena);
+
+/// @brief Same as parse, but also type checks each top-level declaration as
+/// soon as it is parsed
+///
+/// This saves walking the whole AST again in type_check, whose errors are the
+/// same as type_errors of the result
+ParseResult parse_and_type_check(const char* src, Tokens tokens,
+                                 Arena* permanent_arena, Arena scratch_arena);
+
+/// @brief Same as parse_and_type_check, but only parses the function bodies
+/// that are reachable from the functions with external linkage
+///
+/// The other bodies are skipped by matching their braces. Unreferenced static
+/// functions are left without a body, and errors in their bodies are not
+/// reported.
+ParseResult parse_reachable_and_type_check(const char* src, Tokens tokens,
+                                           Arena* permanent_arena,
+                                           Arena scratch_arena);
+
+/// @brief Same as parse_and_type_check, but parses and checks the function
+/// bodies on up to thread_count threads once the top level is done, or on one
+/// thread per core if thread_count is 0
+///
+/// The output does not depend on the number of threads. Errors are reported in
+/// the order of their positions.
+ParseResult parse_and_type_check_with_threads(const char* src, Tokens tokens,
+                                              uint32_t thread_count,
+                                              Arena* permanent_arena,
+                                              Arena scratch_arena);
+
+/// @brief Same as parse_on_demand, but also type checks each top-level
+/// declaration as soon as it is parsed
+///
+/// Identifiers are interned into the given interner, which can outlive the AST.
+ParseResult parse_on_demand_and_type_check(const char* src, Interner* interner,
+                                           Arena* permanent_arena,
+                                           Arena scratch_arena);
+
+/// @brief Receives the top-level declarations of a source file one at a time
+typedef struct DeclSink {
+  void (*consume)(void* context, const Decl* decl, const AstNodes* nodes);
+  void* context;
+} DeclSink;
+
+/// @brief Same as parse_on_demand_and_type_check, but hands each top-level
+/// declaration to the sink as soon as it is parsed and checked, instead of
+/// keeping it in the AST
+///
+/// The nodes are only valid during the call to the sink, since the next
+/// declaration reuses their memory. So the nodes never take more memory than
+/// the largest declaration needs. Once there is an error, the rest of the file
+/// is still parsed and checked for more errors, but nothing more is handed to
+/// the sink.
+ParseResult parse_on_demand_into_sink(const char* src, Interner* interner,
+                                      DeclSink sink, Arena* permanent_arena,
+                                      Arena scratch_arena);
+
 /// @brief Print Tokens
 void print_tokens(const char* src, const Tokens* tokens,
                   const LineNumTable* line_num_table);
@@ -1,13 +1,30 @@
 #ifndef MCC_HASH_TABLE_H
 #define MCC_HASH_TABLE_H
 
+#include "interner.h"
 #include "str.h"
 
+// Hashes 8 bytes at a time. The high bits are the best mixed ones
+uint64_t hash64(StringView s);
+
+/*
+ * Both maps are open-addressing tables whose storage comes from the arena
+ * passed to insert. A zero-initialized map is a valid empty map and allocates
+ * nothing until the first insertion. Growing abandons the old storage in the
+ * arena, so reserve up front when the final size is known.
+ *
+ * Copying a map by value shares the storage, so only one of the copies may be
+ * modified afterward.
+ */
+
 typedef struct HashMap HashMap;
 
 // maps StringView keys to void* values.
 struct HashMap {
-  struct HashNode* root;
+  uint8_t* control; // one byte per slot: a hash fingerprint, or empty
+  struct HashMapEntry* entries;
+  uint32_t capacity; // number of slots, 0 or a power of two
+  uint32_t size;
 };
 
 // Returns a pointer to value if the key if found, or nullptr otherwise
@@ -22,4 +39,32 @@ void* hashmap_lookup(const HashMap* hashMap, StringView key);
 bool hashmap_try_insert(HashMap* map, StringView key, void* value_ptr,
                         Arena* arena);
 
+// Same as hashmap_lookup and hashmap_try_insert, but take hash64(key) from the
+// caller, who can compute it once for a key that is looked up many times
+void* hashmap_lookup_hashed(const HashMap* map, StringView key, uint64_t hash);
+bool hashmap_try_insert_hashed(HashMap* map, StringView key, uint64_t hash,
+                               void* value_ptr, Arena* arena);
+
+// Makes room for count entries in total without further growth
+void hashmap_reserve(HashMap* map, uint32_t count, Arena* arena);
+
+typedef struct SymbolMap SymbolMap;
+
+// maps SymbolId keys to void* values.
+struct SymbolMap {
+  uint8_t* control;
+  struct SymbolMapEntry* entries;
+  uint32_t capacity;
+  uint32_t size;
+};
+
+// Returns a pointer to value if the symbol if found, or nullptr otherwise
+void* symbol_map_lookup(const SymbolMap* map, SymbolId symbol);
+
+// Same as hashmap_try_insert, but keyed by symbols
+bool symbol_map_try_insert(SymbolMap* map, SymbolId symbol, void* value_ptr,
+                           Arena* arena);
+
+void symbol_map_reserve(SymbolMap* map, uint32_t count, Arena* arena);
+
 #endif // MCC_HASH_TABLE_H
@@ -0,0 +1,45 @@
+#ifndef MCC_INTERNER_H
+#define MCC_INTERNER_H
+
+#include "arena.h"
+#include "str.h"
+
+/// @file interner.h
+/// Identifier interning
+///
+/// Each distinct identifier spelling is given a dense 32-bit id. Later phases
+/// carry and compare ids instead of strings, and can index arrays by them.
+
+typedef uint32_t SymbolId;
+
+typedef struct Interner Interner;
+
+Interner* new_interner(Arena* arena);
+
+/// @brief Returns the id of a spelling, adding it to the interner if it is new
+SymbolId intern(Interner* interner, StringView name);
+
+/// @brief Creates a symbol that is distinct from every other symbol, even if
+/// its name collides with an existing one. The name is only used for printing.
+///
+/// Used for compiler-generated names such as temporaries and renamed shadowing
+/// variables, which never need to be looked up by spelling. The name is copied,
+/// so it may be formatted into a scratch buffer.
+SymbolId intern_fresh(Interner* interner, StringView name);
+
+/// @brief Copies a string into the arena of the interner, so that it lives as
+/// long as the symbol names do
+///
+/// Used for compiler-generated names that are not symbols, such as labels,
+/// when they outlive the phase that made them.
+StringView interner_copy_string(Interner* interner, StringView string);
+
+StringView symbol_name(const Interner* interner, SymbolId symbol);
+
+/// @brief The hash of a symbol's spelling, computed once when it was interned
+uint32_t symbol_hash(const Interner* interner, SymbolId symbol);
+
+/// @brief The number of symbols so far. All ids are smaller than it
+uint32_t interner_symbol_count(const Interner* interner);
+
+#endif // MCC_INTERNER_H
@@ -3,6 +3,7 @@
 
 #include "arena.h"
 #include "diagnostic.h"
+#include "interner.h"
 #include "str.h"
 
 // A three-address code intermediate representation
@@ -19,22 +20,52 @@ IRGenerationResult ir_generate(const struct TranslationUnit* ast,
                                Arena* permanent_arena, Arena scratch_arena);
 void print_ir(const struct IRProgram* ir);
 
+struct Decl;
+struct AstNodes;
+struct IRTopLevel;
+
+/// @brief Generates IR one top-level declaration at a time, for compiling
+/// declarations while the rest of the file is still being parsed
+typedef struct IRGenerator IRGenerator;
+
+/// @brief Starts generating IR for the symbols of interner. The generator and
+/// the errors are kept in permanent_arena
+IRGenerator* new_ir_generator(Interner* interner, Arena* permanent_arena,
+                              Arena scratch_arena);
+
+/// @brief Generates the IR of a top-level declaration into arena
+///
+/// @return The IR, or nullptr if the declaration has none, such as a function
+/// prototype, or if it has errors
+struct IRTopLevel* ir_generate_top_level(IRGenerator* generator,
+                                         const struct Decl* decl,
+                                         const struct AstNodes* nodes,
+                                         Arena* arena);
+
+/// @brief Frees the memory of the generator outside its arenas
+/// @return The errors of all the declarations
+ErrorsView finish_ir_generator(IRGenerator* generator);
+
 typedef struct IRProgram {
   size_t top_level_count;
   struct IRTopLevel** top_levels;
+
+  // Spellings of the symbols, including the temporaries created during IR
+  // generation
+  Interner* interner;
 } IRProgram;
 
 typedef struct IRFunctionDef {
-  StringView name;
+  SymbolId name;
   uint32_t instruction_count;
   uint32_t param_count;
 
   struct IRInstruction* instructions;
-  StringView* params;
+  SymbolId* params;
 } IRFunctionDef;
 
 typedef struct IRGlobalVariable {
-  StringView name;
+  SymbolId name;
   int32_t value;
 } IRGlobalVariable;
 
@@ -61,7 +92,7 @@ typedef struct IRValue {
   IRValueType typ;
   union {
     int32_t constant;
-    StringView variable; // variable
+    SymbolId variable; // variable
   };
 } IRValue;
 
@@ -118,7 +149,7 @@ typedef struct IRInstruction {
     };
     // Call
     struct {
-      StringView func_name;
+      SymbolId func_name;
       IRValue dest;
       uint32_t arg_count;
       IRValue* args;
@@ -5,9 +5,40 @@
 
 #include "arena.h"
 #include "diagnostic.h"
+#include "hash_table.h"
+#include "interner.h"
+#include "type.h"
 
 typedef struct TranslationUnit TranslationUnit;
+typedef struct Decl Decl;
+typedef struct FunctionDecl FunctionDecl;
+typedef struct AstNodes AstNodes;
 
 ErrorsView type_check(TranslationUnit* ast, Arena* permanent_arena);
 
+// Type checks a translation unit one top-level declaration at a time, so that
+// the parser can check each declaration right after building it, while its
+// nodes are still in cache. Checking all top-level declarations in order
+// reports the same errors as type_check does.
+typedef struct TypeChecker TypeChecker;
+
+TypeChecker* new_type_checker(const Interner* interner, TypeInterner* types,
+                              AstNodes* nodes, Arena* permanent_arena);
+
+void type_check_top_level_decl(TypeChecker* checker, Decl* decl);
+
+// Checks a function definition apart from its body, e.g. before the body is
+// parsed. Returns false if the body must not be checked
+bool type_check_function_signature(TypeChecker* checker, FunctionDecl* decl);
+
+// Checks the body of a function definition whose signature was checked. The
+// bodies of different functions can be checked on different threads at once,
+// each with a checker of its own, unless they declare functions
+void type_check_function_body(TypeChecker* checker, const FunctionDecl* decl);
+
+ErrorsView type_checker_errors(const TypeChecker* checker);
+
+// Frees the memory of a checker outside its arena. Its errors stay valid
+void release_type_checker(TypeChecker* checker);
+
 #endif // MCC_SEMA_H
@@ -11,10 +11,22 @@ typedef struct SourceRange {
       end; // offset into the position after the last character in the range
 } SourceRange;
 
+/// @brief A line marker left by the preprocessor, e.g. `# 42 "foo.h" 1` or
+/// `#line 42 "foo.h"`, which names the file and line of the line after it
+typedef struct LineMarker {
+  uint32_t next_line;     // line number of the line after the marker
+  uint32_t presumed_line; // its line number in filename
+  const char* filename;
+} LineMarker;
+
 /// @brief A table used to compute line/column numbers
 typedef struct LineNumTable {
   uint32_t line_count;
   const uint32_t* line_starts;
+
+  const char* filename; // of the lines before the first marker
+  uint32_t marker_count;
+  const LineMarker* markers; // in the order of their lines
 } LineNumTable;
 
 typedef struct LineColumn {
@@ -22,9 +34,16 @@ typedef struct LineColumn {
   uint32_t column;
 } LineColumn;
 
+/// @brief The file and line a line of the source came from, according to the
+/// line markers before it
+typedef struct PresumedLine {
+  const char* filename;
+  uint32_t line;
+} PresumedLine;
+
 /**
- * Get the table for calculate line numbers of a file. If the table is already
- * initialized, just return it. Otherwise create the table.
+ * Get the table for calculate line numbers of a file. Each file has a table of
+ * its own, which is created on the first call and returned afterwards.
  */
 const LineNumTable* get_line_num_table(const char* filename, StringView source,
                                        Arena* permanent_arena,
@@ -33,4 +52,23 @@ const LineNumTable* get_line_num_table(const char* filename, StringView source,
 LineColumn calculate_line_and_column(const LineNumTable* table,
                                      uint32_t offset);
 
+PresumedLine calculate_presumed_line(const LineNumTable* table, uint32_t line);
+
+/// @brief Remembers where the last lookup in a table ended up
+///
+/// Lookups at increasing offsets, e.g. of sorted diagnostics, mostly move a few
+/// lines forward from there instead of searching the whole table. Lookups
+/// further away fall back to a binary search.
+typedef struct LineCursor {
+  const LineNumTable* table;
+  uint32_t line;         // of the last lookup, 0 before the first one
+  uint32_t marker_count; // of the markers before that line
+} LineCursor;
+
+LineCursor line_cursor(const LineNumTable* table);
+
+LineColumn cursor_line_and_column(LineCursor* cursor, uint32_t offset);
+
+PresumedLine cursor_presumed_line(LineCursor* cursor, uint32_t line);
+
 #endif // MCC_SOURCE_LOCATION_H
@@ -1,6 +1,7 @@
 #ifndef MCC_TOKEN_H
 #define MCC_TOKEN_H
 
+#include "interner.h"
 #include "source_location.h"
 #include "str.h"
 
@@ -79,26 +80,55 @@ typedef enum TokenTag : char {
   TOKEN_TYPES_COUNT,
 } TokenTag;
 
+/// @brief Why the lexer produced a TOKEN_ERROR
+typedef enum LexError {
+  LEX_ERROR_UNEXPECTED_CHARACTER = 0,
+  LEX_ERROR_INTEGER_TOO_LARGE, // does not fit in 32 bits
+} LexError;
+
 typedef struct Token {
   TokenTag tag;
   uint32_t start; // The offset of the starting character in a token
   uint32_t size;
+
+  // Decoded by the lexer, depending on the tag:
+  // - TOKEN_IDENTIFIER: the interned SymbolId
+  // - TOKEN_INTEGER: the value of the literal
+  // - TOKEN_ERROR: a LexError
+  // and 0 for any other token
+  uint32_t value;
 } Token;
 
 /// @brief An SOA view of tokens
+///
+/// Only the tag and the starting offset of each token are stored. The size of
+/// a token can always be recovered from the source text (see token_size)
+///
+/// The decoded value of each token (see Token::value) is kept in token_values,
+/// so later phases never rescan identifiers or digits
 typedef struct Tokens {
+  const char* source;
   TokenTag* token_types;
   uint32_t* token_starts;
-  uint32_t* token_sizes;
+  uint32_t* token_values;
   uint32_t token_count;
+  Interner* interner;
 } Tokens;
 
+/// @brief Gets the size of a token with tag that starts at offset start of the
+/// source
+uint32_t token_size(const char* source, TokenTag tag, uint32_t start);
+
 inline static Token get_token(const Tokens* tokens, uint32_t i)
 {
   MCC_ASSERT(i < tokens->token_count);
-  return MCC_COMPOUND_LITERAL(Token){.tag = tokens->token_types[i],
-                                     .start = tokens->token_starts[i],
-                                     .size = tokens->token_sizes[i]};
+  const TokenTag tag = tokens->token_types[i];
+  const uint32_t start = tokens->token_starts[i];
+  return MCC_COMPOUND_LITERAL(Token){
+      .tag = tag,
+      .start = start,
+      .size = token_size(tokens->source, tag, start),
+      .value = tokens->token_values[i]};
 }
 
 #endif // MCC_TOKEN_H
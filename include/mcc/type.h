@@ -34,8 +34,15 @@ typedef struct FunctionType {
 extern const Type* typ_void;
 extern const Type* typ_int;
 
-const Type* func_type(const Type* return_type, uint32_t param_count,
-                      Arena* arena);
+// Hash-conses types: structurally identical types share one canonical object,
+// so two types are the same if and only if their pointers are equal. The
+// builtin types above are canonical as well.
+typedef struct TypeInterner TypeInterner;
+
+TypeInterner* new_type_interner(Arena* arena);
+
+const Type* func_type(TypeInterner* types, const Type* return_type,
+                      uint32_t param_count);
 
 void format_type_to(StringBuffer* buffer, const Type* typ);
 
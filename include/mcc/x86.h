@@ -3,6 +3,7 @@
 
 #include "arena.h"
 #include "hash_table.h"
+#include "interner.h"
 #include "str.h"
 
 typedef struct X86Program X86Program;
@@ -15,6 +16,7 @@ typedef struct X86Operand X86Operand;
 struct X86Program {
   size_t top_level_count;
   X86TopLevel* top_levels;
+  const Interner* interner;
 };
 
 typedef enum X86TopLevelTag {
@@ -32,13 +34,13 @@ struct X86TopLevel {
 };
 
 struct X86FunctionDef {
-  StringView name;
+  SymbolId name;
   size_t instruction_count;
   X86Instruction* instructions;
 };
 
 struct X86GlobalVariable {
-  StringView name;
+  SymbolId name;
   int32_t value;
 };
 
@@ -83,9 +85,9 @@ struct X86Operand {
   union {
     int32_t imm;
     X86Register reg;
-    StringView pseudo;
+    SymbolId pseudo;
     struct X86StackOperand stack;
-    StringView data;
+    SymbolId data;
   };
 };
 
@@ -162,7 +164,40 @@ struct IRProgram;
 X86Program x86_generate_assembly(struct IRProgram* ir, Arena* permanent_arena,
                                  Arena scratch_arena);
 
+/// @brief Writes the assembly of a program to the file descriptor fd, buffered
+/// in scratch_arena
+/// @return false if writing failed
+bool x86_write_assembly(const X86Program* program, int fd,
+                        Arena scratch_arena);
+
+/// @brief Writes the assembly of a program to stream, through the same
+/// formatting as x86_write_assembly
 void x86_dump_assembly(const X86Program* program, FILE* stream);
-void x86_print_instruction(X86Instruction instruction, FILE* stream);
+
+struct IRTopLevel;
+
+/// @brief Generates and writes assembly one top-level declaration at a time,
+/// without keeping the program in memory
+typedef struct X86Emitter X86Emitter;
+
+/// @brief Starts writing the assembly of a translation unit to the file
+/// descriptor fd. The emitter, its output buffer, and the tables of its symbols
+/// are kept in permanent_arena
+X86Emitter* new_x86_emitter(const Interner* interner, int fd,
+                            Arena* permanent_arena, Arena scratch_arena);
+
+/// @brief Generates and writes the assembly of a top-level declaration
+///
+/// Symbols may have been interned since the last call, as the emitter grows its
+/// tables to the interner.
+void x86_emit_top_level(X86Emitter* emitter,
+                        const struct IRTopLevel* top_level);
+
+/// @brief Writes the end of the assembly, and frees the memory of the emitter
+/// outside its arenas
+/// @return false if writing failed
+bool finish_x86_emitter(X86Emitter* emitter);
+void x86_print_instruction(X86Instruction instruction,
+                           const Interner* interner, FILE* stream);
 
 #endif // MCC_X86_H
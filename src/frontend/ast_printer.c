@@ -10,6 +10,14 @@ static void format_source_range(StringBuffer* output, SourceRange range)
   string_buffer_printf(output, "<%d..%d>", range.begin, range.end);
 }
 
+// Prints a space followed by the spelling of the symbol
+static void format_symbol(StringBuffer* output, const Interner* interner,
+                          SymbolId symbol)
+{
+  const StringView name = symbol_name(interner, symbol);
+  string_buffer_printf(output, " %.*s", (int)name.size, name.start);
+}
+
 static const char* unary_op_name(UnaryOpType unary_op_type)
 {
   switch (unary_op_type) {
@@ -58,58 +66,65 @@ static const char* binary_op_name(BinaryOpType binary_op_type)
   MCC_ASSERT_MSG(false, "invalid enum");
 }
 
-static void format_expr(StringBuffer* output, const Expr* expr, int indent)
+static void format_expr(StringBuffer* output, const TranslationUnit* tu,
+                        ExprId expr, int indent)
 {
-  switch (expr->tag) {
+  const ExprPool* exprs = &tu->nodes.exprs;
+  const ExprData data = exprs->data[expr];
+  switch (exprs->tags[expr]) {
   case EXPR_INVALID: MCC_UNREACHABLE();
   case EXPR_CONST:
     string_buffer_printf(output, "%*sIntegerLiteral ", indent, "");
-    format_source_range(output, expr->source_range);
-    string_buffer_printf(output, " %i\n", expr->const_expr.val);
+    format_source_range(output, exprs->source_ranges[expr]);
+    string_buffer_printf(output, " %i\n", data.const_value);
     break;
   case EXPR_UNARY:
     string_buffer_printf(output, "%*sUnaryOPExpr ", indent, "");
-    format_source_range(output, expr->source_range);
+    format_source_range(output, exprs->source_ranges[expr]);
     string_buffer_printf(output, " operator: %s\n",
-                         unary_op_name(expr->unary_op.unary_op_type));
-    format_expr(output, expr->unary_op.inner_expr, indent + 2);
+                         unary_op_name((UnaryOpType)exprs->ops[expr]));
+    format_expr(output, tu, data.inner_expr, indent + 2);
     break;
   case EXPR_BINARY:
     string_buffer_printf(output, "%*sBinaryOPExpr ", indent, "");
-    format_source_range(output, expr->source_range);
+    format_source_range(output, exprs->source_ranges[expr]);
     string_buffer_printf(output, " operator: %s\n",
-                         binary_op_name(expr->binary_op.binary_op_type));
-    format_expr(output, expr->binary_op.lhs, indent + 2);
-    format_expr(output, expr->binary_op.rhs, indent + 2);
+                         binary_op_name((BinaryOpType)exprs->ops[expr]));
+    format_expr(output, tu, data.binary_op.lhs, indent + 2);
+    format_expr(output, tu, data.binary_op.rhs, indent + 2);
     break;
   case EXPR_VARIABLE:
     string_buffer_printf(output, "%*sVariableExpr ", indent, "");
-    format_source_range(output, expr->source_range);
-    string_buffer_printf(output, " %.*s\n", (int)expr->variable->name.size,
-                         expr->variable->name.start);
+    format_source_range(output, exprs->source_ranges[expr]);
+    format_symbol(output, tu->interner, data.variable->name);
+    string_buffer_printf(output, "\n");
     break;
-  case EXPR_TERNARY:
+  case EXPR_TERNARY: {
+    const struct TernaryExpr ternary = tu->nodes.ternaries.data[data.ternary];
     string_buffer_printf(output, "%*sTernaryExpr ", indent, "");
-    format_source_range(output, expr->source_range);
+    format_source_range(output, exprs->source_ranges[expr]);
     string_buffer_printf(output, "\n");
-    format_expr(output, expr->ternary.cond, indent + 2);
-    format_expr(output, expr->ternary.true_expr, indent + 2);
-    format_expr(output, expr->ternary.false_expr, indent + 2);
+    format_expr(output, tu, ternary.cond, indent + 2);
+    format_expr(output, tu, ternary.true_expr, indent + 2);
+    format_expr(output, tu, ternary.false_expr, indent + 2);
     string_buffer_printf(output, "\n");
-    break;
-  case EXPR_CALL:
+  } break;
+  case EXPR_CALL: {
+    const struct CallExpr call = tu->nodes.calls.data[data.call];
     string_buffer_printf(output, "%*sCallExpr ", indent, "");
-    format_source_range(output, expr->source_range);
+    format_source_range(output, exprs->source_ranges[expr]);
     string_buffer_printf(output, "\n");
-    format_expr(output, expr->call.function, indent + 2);
-    for (uint32_t i = 0; i < expr->call.arg_count; ++i) {
-      format_expr(output, expr->call.args[i], indent + 2);
+    format_expr(output, tu, call.function, indent + 2);
+    for (uint32_t i = 0; i < call.arg_count; ++i) {
+      format_expr(output, tu, tu->nodes.call_args.data[call.first_arg + i],
+                  indent + 2);
     }
-    break;
+  } break;
   }
 }
 
-static void format_blocks(StringBuffer* output, const Block* block, int indent);
+static void format_blocks(StringBuffer* output, const TranslationUnit* tu,
+                          Block block, int indent);
 
 static const char* string_from_stmt_tag(StmtTag stmt_tag)
 {
@@ -143,106 +158,124 @@ static void format_storage_class(StringBuffer* output,
   }
 }
 
-static void format_var_decl(StringBuffer* output, const VariableDecl* decl,
-                            int indent)
+static void format_var_decl(StringBuffer* output, const TranslationUnit* tu,
+                            VariableDeclId id, int indent)
 {
+  const VariableDecl* decl = &tu->nodes.variable_decls.data[id];
   string_buffer_printf(output, "%*sVariableDecl ", indent, "");
   format_source_range(output, decl->source_range);
-  string_buffer_printf(output, " %.*s: ", (int)decl->name->name.size,
-                       decl->name->name.start);
+  format_symbol(output, tu->interner, decl->name->name);
+  string_buffer_printf(output, ": ");
   format_storage_class(output, decl->storage_class);
   string_buffer_append(output, str("int\n"));
-  if (decl->initializer) { format_expr(output, decl->initializer, indent + 2); }
+  if (decl->initializer != NO_EXPR) {
+    format_expr(output, tu, decl->initializer, indent + 2);
+  }
 }
 
-static void format_function_decl(StringBuffer* output, const FunctionDecl* decl,
-                                 int indent);
+static void format_function_decl(StringBuffer* output,
+                                 const TranslationUnit* tu,
+                                 const FunctionDecl* decl, int indent);
 
-static void format_decl(StringBuffer* output, const Decl* decl, int indent)
+static void format_decl(StringBuffer* output, const TranslationUnit* tu,
+                        const Decl* decl, int indent)
 {
   switch (decl->tag) {
   case DECL_INVALID: MCC_UNREACHABLE(); break;
-  case DECL_VAR: format_var_decl(output, &decl->var, indent); break;
-  case DECL_FUNC: format_function_decl(output, decl->func, indent); break;
+  case DECL_VAR: format_var_decl(output, tu, decl->var, indent); break;
+  case DECL_FUNC: format_function_decl(output, tu, decl->func, indent); break;
   }
 }
 
-static void format_nullable_expr(StringBuffer* output, const Expr* expr,
+static void format_nullable_expr(StringBuffer* output,
+                                 const TranslationUnit* tu, ExprId expr,
                                  int indent)
 {
-  if (expr != nullptr) {
-    format_expr(output, expr, indent);
+  if (expr != NO_EXPR) {
+    format_expr(output, tu, expr, indent);
   } else {
     string_buffer_printf(output, "%*s<<null>>\n", indent, "");
   }
 }
 
-static void format_stmt(StringBuffer* output, const Stmt* stmt, int indent)
+static void format_stmt(StringBuffer* output, const TranslationUnit* tu,
+                        StmtId stmt, int indent)
 {
+  const StmtPool* stmts = &tu->nodes.stmts;
+  const StmtData data = stmts->data[stmt];
+
   string_buffer_printf(output, "%*s%s ", indent, "",
-                       string_from_stmt_tag(stmt->tag));
-  format_source_range(output, stmt->source_range);
+                       string_from_stmt_tag(stmts->tags[stmt]));
+  format_source_range(output, stmts->source_ranges[stmt]);
   string_buffer_append(output, str("\n"));
 
-  switch (stmt->tag) {
+  switch (stmts->tags[stmt]) {
   case STMT_INVALID: MCC_UNREACHABLE();
   case STMT_EMPTY: break;
-  case STMT_EXPR: format_expr(output, stmt->ret.expr, indent + 2); break;
-  case STMT_COMPOUND: format_blocks(output, &stmt->compound, indent + 2); break;
-  case STMT_RETURN: format_expr(output, stmt->ret.expr, indent + 2); break;
-  case STMT_IF:
-    format_expr(output, stmt->if_then.cond, indent + 2);
-    format_stmt(output, stmt->if_then.then, indent + 2);
-    if (stmt->if_then.els != nullptr) {
-      format_stmt(output, stmt->if_then.els, indent + 2);
-    }
+  case STMT_EXPR: format_expr(output, tu, data.expr, indent + 2); break;
+  case STMT_COMPOUND:
+    format_blocks(output, tu, data.compound, indent + 2);
     break;
+  case STMT_RETURN: format_expr(output, tu, data.expr, indent + 2); break;
+  case STMT_IF: {
+    const struct IfStmt if_then = tu->nodes.ifs.data[data.if_then];
+    format_expr(output, tu, if_then.cond, indent + 2);
+    format_stmt(output, tu, if_then.then, indent + 2);
+    if (if_then.els != NO_STMT) {
+      format_stmt(output, tu, if_then.els, indent + 2);
+    }
+  } break;
   case STMT_WHILE:
-    format_expr(output, stmt->while_loop.cond, indent + 2);
-    format_stmt(output, stmt->while_loop.body, indent + 2);
+    format_expr(output, tu, data.while_loop.cond, indent + 2);
+    format_stmt(output, tu, data.while_loop.body, indent + 2);
     break;
   case STMT_DO_WHILE:
-    format_stmt(output, stmt->while_loop.body, indent + 2);
-    format_expr(output, stmt->while_loop.cond, indent + 2);
+    format_stmt(output, tu, data.while_loop.body, indent + 2);
+    format_expr(output, tu, data.while_loop.cond, indent + 2);
     break;
-  case STMT_FOR:
-    switch (stmt->for_loop.init.tag) {
+  case STMT_FOR: {
+    const struct For for_loop = tu->nodes.for_loops.data[data.for_loop];
+    switch (for_loop.init.tag) {
     case FOR_INIT_INVALID: MCC_UNREACHABLE();
     case FOR_INIT_DECL:
-      format_var_decl(output, stmt->for_loop.init.decl, indent + 2);
+      format_var_decl(output, tu, for_loop.init.decl, indent + 2);
       break;
     case FOR_INIT_EXPR: {
-      format_nullable_expr(output, stmt->for_loop.init.expr, indent + 2);
+      format_nullable_expr(output, tu, for_loop.init.expr, indent + 2);
     } break;
     }
 
-    format_nullable_expr(output, stmt->for_loop.cond, indent + 2);
-    format_nullable_expr(output, stmt->for_loop.post, indent + 2);
-    format_stmt(output, stmt->for_loop.body, indent + 2);
-    break;
+    format_nullable_expr(output, tu, for_loop.cond, indent + 2);
+    format_nullable_expr(output, tu, for_loop.post, indent + 2);
+    format_stmt(output, tu, for_loop.body, indent + 2);
+  } break;
   case STMT_BREAK:
   case STMT_CONTINUE: break;
   }
 }
 
-static void format_block_item(StringBuffer* output, const BlockItem* item,
-                              int indent)
+static void format_block_item(StringBuffer* output, const TranslationUnit* tu,
+                              const BlockItem* item, int indent)
 {
   switch (item->tag) {
-  case BLOCK_ITEM_DECL: format_decl(output, &item->decl, indent); return;
-  case BLOCK_ITEM_STMT: format_stmt(output, &item->stmt, indent); return;
+  case BLOCK_ITEM_DECL: format_decl(output, tu, &item->decl, indent); return;
+  case BLOCK_ITEM_STMT: format_stmt(output, tu, item->stmt, indent); return;
   }
   MCC_UNREACHABLE();
 }
 
-static void format_blocks(StringBuffer* output, const Block* block, int indent)
+static void format_blocks(StringBuffer* output, const TranslationUnit* tu,
+                          Block block, int indent)
 {
-  for (size_t i = 0; i < block->child_count; ++i) {
-    format_block_item(output, &block->children[i], indent);
+  for (uint32_t i = 0; i < block.child_count; ++i) {
+    format_block_item(output, tu,
+                      &tu->nodes.block_items.data[block.first_child + i],
+                      indent);
   }
 }
 
-static void format_parameters(StringBuffer* output, Parameters parameters)
+static void format_parameters(StringBuffer* output, const Interner* interner,
+                              Parameters parameters)
 {
   if (parameters.length == 0) {
     string_buffer_printf(output, "(void)");
@@ -252,29 +285,29 @@ static void format_parameters(StringBuffer* output, Parameters parameters)
       if (i > 0) { string_buffer_printf(output, ", "); }
       const IdentifierInfo* param = parameters.data[i];
       string_buffer_printf(output, "int");
-      if (param->name.size != 0) {
-        string_buffer_printf(output, " %.*s", (int)param->name.size,
-                             param->name.start);
+      if (symbol_name(interner, param->name).size != 0) {
+        format_symbol(output, interner, param->name);
       }
     }
     string_buffer_printf(output, ")");
   }
 }
 
-static void format_function_decl(StringBuffer* output, const FunctionDecl* decl,
-                                 int indent)
+static void format_function_decl(StringBuffer* output,
+                                 const TranslationUnit* tu,
+                                 const FunctionDecl* decl, int indent)
 {
   string_buffer_printf(output, "%*sFunctionDecl ", indent, "");
   format_source_range(output, decl->source_range);
 
-  string_buffer_printf(output, " %.*s: ", (int)decl->name->name.size,
-                       decl->name->name.start);
+  format_symbol(output, tu->interner, decl->name->name);
+  string_buffer_printf(output, ": ");
   format_storage_class(output, decl->storage_class);
   string_buffer_printf(output, "int");
-  format_parameters(output, decl->params);
+  format_parameters(output, tu->interner, decl->params);
   string_buffer_printf(output, "\n");
 
-  if (decl->body) { format_blocks(output, decl->body, indent + 2); }
+  if (decl->body) { format_blocks(output, tu, *decl->body, indent + 2); }
 }
 
 StringView string_from_ast(const TranslationUnit* tu, Arena* permanent_arena)
@@ -282,7 +315,7 @@ StringView string_from_ast(const TranslationUnit* tu, Arena* permanent_arena)
   StringBuffer output = string_buffer_new(permanent_arena);
   string_buffer_append(&output, str("TranslationUnit\n"));
   for (size_t i = 0; i < tu->decl_count; ++i) {
-    format_decl(&output, tu->decls + i, 2);
+    format_decl(&output, tu, tu->decls + i, 2);
   }
 
   return str_from_buffer(&output);
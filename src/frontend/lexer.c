@@ -1,28 +1,26 @@
 #include <limits.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <string.h>
+#include <unistd.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
-#include <mcc/dynarray.h>
 #include <mcc/frontend.h>
 
 // The lexer consumes source code and produces tokens lazily
 
-typedef struct Lexer {
-  const char* start;
-  const char* previous;
-  const char* current;
-  uint32_t line;
-  uint32_t column;
-} Lexer;
-
-static Lexer lexer_create(const char* source)
+Lexer lexer_create(const char* source)
 {
   return (Lexer){
       .start = source,
+      .end = source + strlen(source),
       .previous = source,
       .current = source,
-      .line = 1,
-      .column = 1,
   };
 }
 
@@ -43,16 +41,293 @@ static Token make_token(const Lexer* lexer, TokenTag type)
 // consumes the current character and returns it
 static char advance(Lexer* lexer)
 {
-  if (*lexer->current == '\n') {
-    ++lexer->line;
-    lexer->column = 1;
-  } else {
-    lexer->column++;
+  return *lexer->current++;
+}
+
+#pragma region Character classes
+// Every byte is classified by a single table lookup, which decides what kind of
+// token (if any) starts at a character
+
+typedef enum CharClass : uint8_t {
+  CHAR_CLASS_OTHER = 0, // punctuators and invalid characters
+  CHAR_CLASS_BLANK,     // ' ', '\t', '\r', '\n'
+  CHAR_CLASS_DIGIT,     // [0-9]
+  CHAR_CLASS_LETTER,    // [A-Za-z_]
+} CharClass;
+
+#define DIGIT_CLASSES(c0, c1, c2, c3, c4, c5, c6, c7, c8, c9)                  \
+  [c0] = CHAR_CLASS_DIGIT, [c1] = CHAR_CLASS_DIGIT, [c2] = CHAR_CLASS_DIGIT,   \
+  [c3] = CHAR_CLASS_DIGIT, [c4] = CHAR_CLASS_DIGIT, [c5] = CHAR_CLASS_DIGIT,   \
+  [c6] = CHAR_CLASS_DIGIT, [c7] = CHAR_CLASS_DIGIT, [c8] = CHAR_CLASS_DIGIT,   \
+  [c9] = CHAR_CLASS_DIGIT
+
+// Both cases of a letter
+#define LETTER_CLASS(lower)                                                    \
+  [lower] = CHAR_CLASS_LETTER, [(lower) - 'a' + 'A'] = CHAR_CLASS_LETTER
+
+static const CharClass char_classes[256] = {
+    [' '] = CHAR_CLASS_BLANK,
+    ['\t'] = CHAR_CLASS_BLANK,
+    ['\r'] = CHAR_CLASS_BLANK,
+    ['\n'] = CHAR_CLASS_BLANK,
+    DIGIT_CLASSES('0', '1', '2', '3', '4', '5', '6', '7', '8', '9'),
+    LETTER_CLASS('a'),
+    LETTER_CLASS('b'),
+    LETTER_CLASS('c'),
+    LETTER_CLASS('d'),
+    LETTER_CLASS('e'),
+    LETTER_CLASS('f'),
+    LETTER_CLASS('g'),
+    LETTER_CLASS('h'),
+    LETTER_CLASS('i'),
+    LETTER_CLASS('j'),
+    LETTER_CLASS('k'),
+    LETTER_CLASS('l'),
+    LETTER_CLASS('m'),
+    LETTER_CLASS('n'),
+    LETTER_CLASS('o'),
+    LETTER_CLASS('p'),
+    LETTER_CLASS('q'),
+    LETTER_CLASS('r'),
+    LETTER_CLASS('s'),
+    LETTER_CLASS('t'),
+    LETTER_CLASS('u'),
+    LETTER_CLASS('v'),
+    LETTER_CLASS('w'),
+    LETTER_CLASS('x'),
+    LETTER_CLASS('y'),
+    LETTER_CLASS('z'),
+    ['_'] = CHAR_CLASS_LETTER,
+};
+
+#undef DIGIT_CLASSES
+#undef LETTER_CLASS
+
+static CharClass char_class(char c)
+{
+  return char_classes[(unsigned char)c];
+}
+
+static bool is_digit(char c)
+{
+  return char_class(c) == CHAR_CLASS_DIGIT;
+}
+
+// [0-9A-Za-z_]
+static bool is_identifier_char(char c)
+{
+  const CharClass class = char_class(c);
+  return class == CHAR_CLASS_DIGIT || class == CHAR_CLASS_LETTER;
+}
+
+#pragma endregion
+
+#pragma region SIMD scanning
+// Whitespace, comments, and identifiers make up most bytes of a typical source
+// file, so the loops that skip over them scan a whole chunk of characters at a
+// time when SIMD is available. Each scanner only touches whole chunks that lie
+// before the null terminator and leaves the remaining tail to the scalar code.
+
+#if defined(__AVX2__)
+#define MCC_LEXER_SIMD 1
+typedef __m256i SimdChunk;
+enum { SIMD_CHUNK_SIZE = 32 };
+
+static inline SimdChunk simd_load(const char* p)
+{
+  return _mm256_loadu_si256((const __m256i*)p);
+}
+static inline SimdChunk simd_splat(char c)
+{
+  return _mm256_set1_epi8(c);
+}
+static inline SimdChunk simd_eq(SimdChunk a, SimdChunk b)
+{
+  return _mm256_cmpeq_epi8(a, b);
+}
+static inline SimdChunk simd_gt(SimdChunk a, SimdChunk b)
+{
+  return _mm256_cmpgt_epi8(a, b);
+}
+static inline SimdChunk simd_and(SimdChunk a, SimdChunk b)
+{
+  return _mm256_and_si256(a, b);
+}
+static inline SimdChunk simd_or(SimdChunk a, SimdChunk b)
+{
+  return _mm256_or_si256(a, b);
+}
+// Gathers the most significant bit of each byte, i.e. bit i is set iff byte i
+// compared true
+static inline uint32_t simd_mask(SimdChunk v)
+{
+  return (uint32_t)_mm256_movemask_epi8(v);
+}
+#elif defined(__SSE2__)
+#define MCC_LEXER_SIMD 1
+typedef __m128i SimdChunk;
+enum { SIMD_CHUNK_SIZE = 16 };
+
+static inline SimdChunk simd_load(const char* p)
+{
+  return _mm_loadu_si128((const __m128i*)p);
+}
+static inline SimdChunk simd_splat(char c)
+{
+  return _mm_set1_epi8(c);
+}
+static inline SimdChunk simd_eq(SimdChunk a, SimdChunk b)
+{
+  return _mm_cmpeq_epi8(a, b);
+}
+static inline SimdChunk simd_gt(SimdChunk a, SimdChunk b)
+{
+  return _mm_cmpgt_epi8(a, b);
+}
+static inline SimdChunk simd_and(SimdChunk a, SimdChunk b)
+{
+  return _mm_and_si128(a, b);
+}
+static inline SimdChunk simd_or(SimdChunk a, SimdChunk b)
+{
+  return _mm_or_si128(a, b);
+}
+static inline uint32_t simd_mask(SimdChunk v)
+{
+  return (uint32_t)_mm_movemask_epi8(v);
+}
+#endif
+
+#ifdef MCC_LEXER_SIMD
+static_assert(SIMD_CHUNK_SIZE <= 32, "masks of a chunk must fit in uint32_t");
+
+// A mask with the lowest n bits set
+static inline uint32_t low_bits_mask(uint32_t n)
+{
+  return n >= 32 ? UINT32_MAX : (1u << n) - 1u;
+}
+
+// Number of consecutive set bits starting from the lowest bit of a chunk mask
+static inline uint32_t count_leading_matches(uint32_t mask)
+{
+  const uint32_t misses = ~mask & low_bits_mask(SIMD_CHUNK_SIZE);
+  return misses == 0 ? SIMD_CHUNK_SIZE : (uint32_t)__builtin_ctz(misses);
+}
+
+// Bytes with value in [lo, hi]. Only valid for ASCII bounds since bytes are
+// compared as signed numbers (non-ASCII bytes never match)
+static inline SimdChunk simd_in_range(SimdChunk chunk, char lo, char hi)
+{
+  return simd_and(simd_gt(chunk, simd_splat((char)(lo - 1))),
+                  simd_gt(simd_splat((char)(hi + 1)), chunk));
+}
+
+// [0-9A-Za-z_]
+static inline uint32_t identifier_chars_mask(SimdChunk chunk)
+{
+  const SimdChunk lower = simd_or(chunk, simd_splat(0x20));
+  return simd_mask(simd_or(simd_or(simd_in_range(lower, 'a', 'z'),
+                                   simd_in_range(chunk, '0', '9')),
+                           simd_eq(chunk, simd_splat('_'))));
+}
+
+static inline bool has_full_chunk(const Lexer* lexer, ptrdiff_t extra)
+{
+  return lexer->end - lexer->current >= SIMD_CHUNK_SIZE + extra;
+}
+
+// Consumes count characters at once
+static void advance_by(Lexer* lexer, uint32_t count)
+{
+  lexer->current += count;
+}
+#endif
+
+// Skips ' ', '\t', '\r', and '\n'
+static void skip_blanks(Lexer* lexer)
+{
+#ifdef MCC_LEXER_SIMD
+  while (has_full_chunk(lexer, 0)) {
+    const SimdChunk chunk = simd_load(lexer->current);
+    const uint32_t blanks = simd_mask(
+        simd_or(simd_or(simd_eq(chunk, simd_splat(' ')),
+                        simd_eq(chunk, simd_splat('\t'))),
+                simd_or(simd_eq(chunk, simd_splat('\r')),
+                        simd_eq(chunk, simd_splat('\n')))));
+    const uint32_t count = count_leading_matches(blanks);
+    advance_by(lexer, count);
+    if (count < SIMD_CHUNK_SIZE) { return; }
   }
+#endif
 
-  return *lexer->current++;
+  for (;;) {
+    switch (*lexer->current) {
+    case ' ':
+    case '\r':
+    case '\t':
+    case '\n': advance(lexer); break;
+    default: return;
+    }
+  }
 }
 
+// Moves to the next '\n' or the end of the source
+static void skip_to_line_end(Lexer* lexer)
+{
+#ifdef MCC_LEXER_SIMD
+  while (has_full_chunk(lexer, 0)) {
+    const uint32_t newlines =
+        simd_mask(simd_eq(simd_load(lexer->current), simd_splat('\n')));
+    if (newlines != 0) {
+      advance_by(lexer, (uint32_t)__builtin_ctz(newlines));
+      return;
+    }
+    advance_by(lexer, SIMD_CHUNK_SIZE);
+  }
+#endif
+
+  while (*lexer->current != '\n' && !lexer_is_at_end(lexer)) {
+    advance(lexer);
+  }
+}
+
+// Moves to the next "*/", or close to the end of the source if there is none
+static void skip_to_c_comment_end(Lexer* lexer)
+{
+#ifdef MCC_LEXER_SIMD
+  // Loading at current + 1 pairs every '*' with the character after it
+  while (has_full_chunk(lexer, 1)) {
+    const uint32_t comment_ends = simd_mask(
+        simd_and(simd_eq(simd_load(lexer->current), simd_splat('*')),
+                 simd_eq(simd_load(lexer->current + 1), simd_splat('/'))));
+    if (comment_ends != 0) {
+      advance_by(lexer, (uint32_t)__builtin_ctz(comment_ends));
+      return;
+    }
+    advance_by(lexer, SIMD_CHUNK_SIZE);
+  }
+#else
+  (void)lexer;
+#endif
+}
+
+// Skips [0-9A-Za-z_]*
+static void skip_identifier_chars(Lexer* lexer)
+{
+#ifdef MCC_LEXER_SIMD
+  while (has_full_chunk(lexer, 0)) {
+    const uint32_t count = count_leading_matches(
+        identifier_chars_mask(simd_load(lexer->current)));
+    advance_by(lexer, count);
+    if (count < SIMD_CHUNK_SIZE) { return; }
+  }
+#endif
+
+  while (is_identifier_char(*lexer->current)) { advance(lexer); }
+}
+
+#pragma endregion
+
 // Look at the next character
 static char peek_next(const Lexer* lexer)
 {
@@ -65,6 +340,7 @@ static void skip_c_style_comments(Lexer* lexer)
   advance(lexer);
   advance(lexer);
   while (true) {
+    skip_to_c_comment_end(lexer);
     if (*lexer->current == '*' && peek_next(lexer) == '/') {
       advance(lexer);
       advance(lexer);
@@ -81,213 +357,230 @@ static void skip_c_style_comments(Lexer* lexer)
 
 static void skip_cpp_style_comments(Lexer* lexer)
 {
-  while (*lexer->current != '\n' && !lexer_is_at_end(lexer)) {
-    advance(lexer);
-  }
+  skip_to_line_end(lexer);
+}
+
+// The preprocessor leaves line markers (e.g. `# 42 "foo.h"`) and pragmas on
+// lines of their own. They only matter to the line number table
+static bool is_at_directive(const Lexer* lexer)
+{
+  return *lexer->current == '#' &&
+         (lexer->current == lexer->start || lexer->current[-1] == '\n');
 }
 
 static void skip_whitespace(Lexer* lexer)
 {
   for (;;) {
-    char c = *lexer->current;
-    switch (c) {
-    case ' ':
-    case '\r':
-    case '\t':
-    case '\n': advance(lexer); break;
-    case '/': // Comments
-    {
-      const char next_char = peek_next(lexer);
-      if (next_char == '/') {
-        skip_cpp_style_comments(lexer);
-        break;
-      } else if (next_char == '*') {
-        skip_c_style_comments(lexer);
-        break;
-      } else {
-        return;
-      }
-    }
-    default: return;
+    const char c = *lexer->current;
+    if (char_class(c) == CHAR_CLASS_BLANK) {
+      skip_blanks(lexer);
+    } else if (c == '/' && peek_next(lexer) == '/') {
+      skip_cpp_style_comments(lexer);
+    } else if (is_at_directive(lexer)) {
+      skip_to_line_end(lexer);
+    } else if (c == '/' && peek_next(lexer) == '*') {
+      skip_c_style_comments(lexer);
+    } else {
+      return;
     }
   }
 }
 
-static bool is_digit(char c)
-{
-  return c >= '0' && c <= '9';
-}
-
-static bool can_start_identifier(char c)
+static Token make_error_token(const Lexer* lexer, LexError error)
 {
-  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+  Token token = make_token(lexer, TOKEN_ERROR);
+  token.value = error;
+  return token;
 }
 
+// A number spans all the identifier characters that follow its first digit,
+// and its value is decoded on the way. Only decimal literals without suffixes
+// are accepted for now. Hexadecimal and octal prefixes would select the radix
+// before the digit loop, and suffixes would be matched after it.
 static Token scan_number(Lexer* lexer)
 {
-  while (is_digit(*lexer->current) || can_start_identifier(*lexer->current))
-    advance(lexer);
+  skip_identifier_chars(lexer);
 
-  // Check integer pattern
+  uint64_t value = 0;
+  bool overflow = false;
   for (const char* cursor = lexer->previous; cursor != lexer->current;
        ++cursor) {
-    if (!is_digit(*cursor)) { return make_token(lexer, TOKEN_ERROR); }
+    if (!is_digit(*cursor)) {
+      return make_error_token(lexer, LEX_ERROR_UNEXPECTED_CHARACTER);
+    }
+    // Stop accumulating once too large, but keep validating the digits
+    if (!overflow) {
+      value = value * 10 + (uint64_t)(*cursor - '0');
+      overflow = value > UINT32_MAX;
+    }
   }
 
-  return make_token(lexer, TOKEN_INTEGER);
-}
+  if (overflow) { return make_error_token(lexer, LEX_ERROR_INTEGER_TOO_LARGE); }
 
-static bool eat_char_if_match(Lexer* lexer, const char expected)
-{
-  if (lexer_is_at_end(lexer)) { return false; }
-  if (*lexer->current != expected) { return false; }
-
-  advance(lexer);
-  return true;
+  Token token = make_token(lexer, TOKEN_INTEGER);
+  token.value = (uint32_t)value;
+  return token;
 }
 
-static TokenTag check_keyword(Lexer* lexer, int start_position, StringView rest,
-                              TokenTag type)
-{
-  if (lexer->current - lexer->previous == start_position + (int)rest.size &&
-      memcmp(lexer->previous + start_position, rest.start, rest.size) == 0) {
-    return type;
-  }
+#pragma region Keywords
+// Keywords are recognized with a perfect hash over the first two characters and
+// the length of an identifier. Every keyword gets its own slot, so a single
+// comparison with the slot's spelling decides whether an identifier is a
+// keyword. When adding a keyword, pick KEYWORD_HASH_MULTIPLIER such that no two
+// keywords collide; a collision shows up as a -Woverride-init warning below.
+
+enum {
+  MAX_KEYWORD_LENGTH = 8, // spellings are compared as a single 64-bit word
+  KEYWORD_TABLE_SIZE = 32,
+  KEYWORD_HASH_MULTIPLIER = 4,
+};
 
-  return TOKEN_IDENTIFIER;
-}
+// For identifiers of length 1, second is the character after the identifier
+#define KEYWORD_HASH(first, second, length)                                    \
+  (((unsigned)(first) + (unsigned)(second) * KEYWORD_HASH_MULTIPLIER +         \
+    (unsigned)(length)) &                                                      \
+   (KEYWORD_TABLE_SIZE - 1))
+
+typedef struct KeywordSlot {
+  char spelling[MAX_KEYWORD_LENGTH]; // zero padded
+  TokenTag tag;
+} KeywordSlot;
+
+// The first two characters are spelled out since indexing a string literal is
+// not a constant expression in C
+#define KEYWORD(spelling_, first, second, tag_)                                \
+  [KEYWORD_HASH(first, second, sizeof(spelling_) - 1)] = {                     \
+      .spelling = spelling_, .tag = tag_}
+
+static const KeywordSlot keyword_slots[KEYWORD_TABLE_SIZE] = {
+    KEYWORD("void", 'v', 'o', TOKEN_KEYWORD_VOID),
+    KEYWORD("int", 'i', 'n', TOKEN_KEYWORD_INT),
+    KEYWORD("return", 'r', 'e', TOKEN_KEYWORD_RETURN),
+    KEYWORD("typedef", 't', 'y', TOKEN_KEYWORD_TYPEDEF),
+    KEYWORD("if", 'i', 'f', TOKEN_KEYWORD_IF),
+    KEYWORD("else", 'e', 'l', TOKEN_KEYWORD_ELSE),
+    KEYWORD("while", 'w', 'h', TOKEN_KEYWORD_WHILE),
+    KEYWORD("do", 'd', 'o', TOKEN_KEYWORD_DO),
+    KEYWORD("for", 'f', 'o', TOKEN_KEYWORD_FOR),
+    KEYWORD("break", 'b', 'r', TOKEN_KEYWORD_BREAK),
+    KEYWORD("continue", 'c', 'o', TOKEN_KEYWORD_CONTINUE),
+    KEYWORD("static", 's', 't', TOKEN_KEYWORD_STATIC),
+    KEYWORD("extern", 'e', 'x', TOKEN_KEYWORD_EXTERN),
+};
+
+#undef KEYWORD
 
-static TokenTag get_identifier_type(Lexer* lexer)
+static TokenTag get_identifier_type(const Lexer* lexer)
 {
-  switch (lexer->previous[0]) {
-  case 'b': return check_keyword(lexer, 1, str("reak"), TOKEN_KEYWORD_BREAK);
-  case 'c':
-    return check_keyword(lexer, 1, str("ontinue"), TOKEN_KEYWORD_CONTINUE);
-  case 'd': return check_keyword(lexer, 1, str("o"), TOKEN_KEYWORD_DO);
-  case 'e': {
-    if (lexer->current - lexer->previous > 1) {
-      switch (lexer->previous[1]) {
-      case 'l': return check_keyword(lexer, 2, str("se"), TOKEN_KEYWORD_ELSE);
-      case 'x':
-        return check_keyword(lexer, 2, str("tern"), TOKEN_KEYWORD_EXTERN);
-      default: break;
-      }
-    }
-  } break;
-  case 'f': return check_keyword(lexer, 1, str("or"), TOKEN_KEYWORD_FOR);
-  case 'i': {
-    if (lexer->current - lexer->previous > 1) {
-      switch (lexer->previous[1]) {
-      case 'f': return check_keyword(lexer, 2, str(""), TOKEN_KEYWORD_IF);
-      case 'n': return check_keyword(lexer, 2, str("t"), TOKEN_KEYWORD_INT);
-      default: break;
-      }
-    }
-  } break;
-  case 'v': return check_keyword(lexer, 1, str("oid"), TOKEN_KEYWORD_VOID);
-  case 'r': return check_keyword(lexer, 1, str("eturn"), TOKEN_KEYWORD_RETURN);
-  case 's': return check_keyword(lexer, 1, str("tatic"), TOKEN_KEYWORD_STATIC);
-  case 't':
-    return check_keyword(lexer, 1, str("ypedef"), TOKEN_KEYWORD_TYPEDEF);
-  case 'w': return check_keyword(lexer, 1, str("hile"), TOKEN_KEYWORD_WHILE);
-  default: break;
-  }
-  return TOKEN_IDENTIFIER;
+  const size_t length = (size_t)(lexer->current - lexer->previous);
+  if (length > MAX_KEYWORD_LENGTH) { return TOKEN_IDENTIFIER; }
+
+  const KeywordSlot* slot = &keyword_slots[KEYWORD_HASH(
+      (unsigned char)lexer->previous[0], (unsigned char)lexer->previous[1],
+      length)];
+
+  uint64_t identifier_word = 0;
+  uint64_t keyword_word;
+  memcpy(&identifier_word, lexer->previous, length);
+  memcpy(&keyword_word, slot->spelling, sizeof(keyword_word));
+  return identifier_word == keyword_word ? slot->tag : TOKEN_IDENTIFIER;
 }
 
+#pragma endregion
+
 static Token scan_identifier(Lexer* lexer)
 {
-  while (is_digit(*lexer->current) || can_start_identifier(*lexer->current)) {
-    advance(lexer);
-  }
+  skip_identifier_chars(lexer);
   return make_token(lexer, get_identifier_type(lexer));
 }
 
-static Token scan_symbol(Lexer* lexer)
-{
-  switch (lexer->previous[0]) {
-  case '(': return make_token(lexer, TOKEN_LEFT_PAREN);
-  case ')': return make_token(lexer, TOKEN_RIGHT_PAREN);
-  case '{': return make_token(lexer, TOKEN_LEFT_BRACE);
-  case '}': return make_token(lexer, TOKEN_RIGHT_BRACE);
-  case ';': return make_token(lexer, TOKEN_SEMICOLON);
-  case '+': {
-    const TokenTag token_type = eat_char_if_match(lexer, '+') ? TOKEN_PLUS_PLUS
-                                : eat_char_if_match(lexer, '=')
-                                    ? TOKEN_PLUS_EQUAL
-                                    : TOKEN_PLUS;
-    return make_token(lexer, token_type);
-  }
-  case '-': {
-    const TokenTag token_type =
-        eat_char_if_match(lexer, '-')   ? TOKEN_MINUS_MINUS
-        : eat_char_if_match(lexer, '=') ? TOKEN_MINUS_EQUAL
-        : eat_char_if_match(lexer, '>') ? TOKEN_MINUS_GREATER
-                                        : TOKEN_MINUS;
-    return make_token(lexer, token_type);
-  }
-  case '*':
-    return make_token(lexer, eat_char_if_match(lexer, '=') ? TOKEN_STAR_EQUAL
-                                                           : TOKEN_STAR);
-  case '/':
-    return make_token(lexer, eat_char_if_match(lexer, '=') ? TOKEN_SLASH_EQUAL
-                                                           : TOKEN_SLASH);
-  case '%':
-    return make_token(lexer, eat_char_if_match(lexer, '=') ? TOKEN_PERCENT_EQUAL
-                                                           : TOKEN_PERCENT);
-  case '~': return make_token(lexer, TOKEN_TILDE);
-  case '&': {
-    const TokenTag token_type =
-        eat_char_if_match(lexer, '&')   ? TOKEN_AMPERSAND_AMPERSAND
-        : eat_char_if_match(lexer, '=') ? TOKEN_AMPERSAND_EQUAL
-                                        : TOKEN_AMPERSAND;
-    return make_token(lexer, token_type);
-  }
-  case '|': {
-    const TokenTag token_type = eat_char_if_match(lexer, '|') ? TOKEN_BAR_BAR
-                                : eat_char_if_match(lexer, '=')
-                                    ? TOKEN_BAR_EQUAL
-                                    : TOKEN_BAR;
-    return make_token(lexer, token_type);
-  }
-  case '^':
-    return make_token(lexer, eat_char_if_match(lexer, '=') ? TOKEN_CARET_EQUAL
-                                                           : TOKEN_CARET);
-  case '=':
-    return make_token(lexer, eat_char_if_match(lexer, '=') ? TOKEN_EQUAL_EQUAL
-                                                           : TOKEN_EQUAL);
-  case '!':
-    return make_token(lexer, eat_char_if_match(lexer, '=') ? TOKEN_NOT_EQUAL
-                                                           : TOKEN_NOT);
-  case '<': {
-    const TokenTag token_type =
-        eat_char_if_match(lexer, '<')
-            ? (eat_char_if_match(lexer, '=') ? TOKEN_LESS_LESS_EQUAL
-                                             : TOKEN_LESS_LESS)
-        : eat_char_if_match(lexer, '=') ? TOKEN_LESS_EQUAL
-                                        : TOKEN_LESS;
-    return make_token(lexer, token_type);
-  }
-  case '>': {
-    const TokenTag token_type =
-        eat_char_if_match(lexer, '>')
-            ? (eat_char_if_match(lexer, '=') ? TOKEN_GREATER_GREATER_EQUAL
-                                             : TOKEN_GREATER_GREATER)
-        : eat_char_if_match(lexer, '=') ? TOKEN_GREATER_EQUAL
-                                        : TOKEN_GREATER;
-    return make_token(lexer, token_type);
-  }
-  case ',': return make_token(lexer, TOKEN_COMMA);
-  case '.': return make_token(lexer, TOKEN_DOT);
-  case '?': return make_token(lexer, TOKEN_QUESTION);
-  case ':': return make_token(lexer, TOKEN_COLON);
-  default: break;
-  }
+#pragma region Punctuators
+// Punctuators are recognized by a DFA whose states are token tags. The first
+// character picks the initial state, and every following character that
+// extends the punctuator moves to a longer one (e.g. < -> << -> <<=)
+
+static const TokenTag punctuator_starts[256] = {
+    ['('] = TOKEN_LEFT_PAREN, [')'] = TOKEN_RIGHT_PAREN,
+    ['{'] = TOKEN_LEFT_BRACE, ['}'] = TOKEN_RIGHT_BRACE,
+    [';'] = TOKEN_SEMICOLON,  ['+'] = TOKEN_PLUS,
+    ['-'] = TOKEN_MINUS,      ['*'] = TOKEN_STAR,
+    ['/'] = TOKEN_SLASH,      ['%'] = TOKEN_PERCENT,
+    ['~'] = TOKEN_TILDE,      ['&'] = TOKEN_AMPERSAND,
+    ['|'] = TOKEN_BAR,        ['^'] = TOKEN_CARET,
+    ['='] = TOKEN_EQUAL,      ['!'] = TOKEN_NOT,
+    ['<'] = TOKEN_LESS,       ['>'] = TOKEN_GREATER,
+    [','] = TOKEN_COMMA,      ['.'] = TOKEN_DOT,
+    ['?'] = TOKEN_QUESTION,   [':'] = TOKEN_COLON,
+};
+
+// Characters that can continue a punctuator. They are the input alphabet of
+// the DFA, and any other character ends a punctuator
+typedef enum PunctuatorInput : uint8_t {
+  PUNCTUATOR_INPUT_NONE = 0,
+  PUNCTUATOR_INPUT_PLUS,
+  PUNCTUATOR_INPUT_MINUS,
+  PUNCTUATOR_INPUT_EQUAL,
+  PUNCTUATOR_INPUT_LESS,
+  PUNCTUATOR_INPUT_GREATER,
+  PUNCTUATOR_INPUT_AMPERSAND,
+  PUNCTUATOR_INPUT_BAR,
+  PUNCTUATOR_INPUT_COUNT,
+} PunctuatorInput;
+
+static const PunctuatorInput punctuator_inputs[256] = {
+    ['+'] = PUNCTUATOR_INPUT_PLUS,      ['-'] = PUNCTUATOR_INPUT_MINUS,
+    ['='] = PUNCTUATOR_INPUT_EQUAL,     ['<'] = PUNCTUATOR_INPUT_LESS,
+    ['>'] = PUNCTUATOR_INPUT_GREATER,   ['&'] = PUNCTUATOR_INPUT_AMPERSAND,
+    ['|'] = PUNCTUATOR_INPUT_BAR,
+};
+
+// TOKEN_INVALID marks the absence of a transition
+static const TokenTag punctuator_transitions[TOKEN_TYPES_COUNT]
+                                            [PUNCTUATOR_INPUT_COUNT] = {
+    [TOKEN_PLUS] = {[PUNCTUATOR_INPUT_PLUS] = TOKEN_PLUS_PLUS,
+                    [PUNCTUATOR_INPUT_EQUAL] = TOKEN_PLUS_EQUAL},
+    [TOKEN_MINUS] = {[PUNCTUATOR_INPUT_MINUS] = TOKEN_MINUS_MINUS,
+                     [PUNCTUATOR_INPUT_EQUAL] = TOKEN_MINUS_EQUAL,
+                     [PUNCTUATOR_INPUT_GREATER] = TOKEN_MINUS_GREATER},
+    [TOKEN_STAR] = {[PUNCTUATOR_INPUT_EQUAL] = TOKEN_STAR_EQUAL},
+    [TOKEN_SLASH] = {[PUNCTUATOR_INPUT_EQUAL] = TOKEN_SLASH_EQUAL},
+    [TOKEN_PERCENT] = {[PUNCTUATOR_INPUT_EQUAL] = TOKEN_PERCENT_EQUAL},
+    [TOKEN_AMPERSAND] = {[PUNCTUATOR_INPUT_AMPERSAND] =
+                             TOKEN_AMPERSAND_AMPERSAND,
+                         [PUNCTUATOR_INPUT_EQUAL] = TOKEN_AMPERSAND_EQUAL},
+    [TOKEN_BAR] = {[PUNCTUATOR_INPUT_BAR] = TOKEN_BAR_BAR,
+                   [PUNCTUATOR_INPUT_EQUAL] = TOKEN_BAR_EQUAL},
+    [TOKEN_CARET] = {[PUNCTUATOR_INPUT_EQUAL] = TOKEN_CARET_EQUAL},
+    [TOKEN_EQUAL] = {[PUNCTUATOR_INPUT_EQUAL] = TOKEN_EQUAL_EQUAL},
+    [TOKEN_NOT] = {[PUNCTUATOR_INPUT_EQUAL] = TOKEN_NOT_EQUAL},
+    [TOKEN_LESS] = {[PUNCTUATOR_INPUT_LESS] = TOKEN_LESS_LESS,
+                    [PUNCTUATOR_INPUT_EQUAL] = TOKEN_LESS_EQUAL},
+    [TOKEN_LESS_LESS] = {[PUNCTUATOR_INPUT_EQUAL] = TOKEN_LESS_LESS_EQUAL},
+    [TOKEN_GREATER] = {[PUNCTUATOR_INPUT_GREATER] = TOKEN_GREATER_GREATER,
+                       [PUNCTUATOR_INPUT_EQUAL] = TOKEN_GREATER_EQUAL},
+    [TOKEN_GREATER_GREATER] = {[PUNCTUATOR_INPUT_EQUAL] =
+                                   TOKEN_GREATER_GREATER_EQUAL},
+};
+
+static Token scan_punctuator(Lexer* lexer)
+{
+  TokenTag state = punctuator_starts[(unsigned char)lexer->previous[0]];
+  if (state == TOKEN_INVALID) { return make_token(lexer, TOKEN_ERROR); }
 
-  return make_token(lexer, TOKEN_ERROR);
+  for (;;) {
+    const PunctuatorInput input =
+        punctuator_inputs[(unsigned char)*lexer->current];
+    const TokenTag next_state = punctuator_transitions[(int)state][input];
+    if (next_state == TOKEN_INVALID) { break; }
+    state = next_state;
+    advance(lexer);
+  }
+  return make_token(lexer, state);
 }
 
-static Token scan_token(Lexer* lexer)
+#pragma endregion
+
+Token lexer_next_token(Lexer* lexer)
 {
   skip_whitespace(lexer);
 
@@ -295,64 +588,378 @@ static Token scan_token(Lexer* lexer)
 
   if (lexer_is_at_end(lexer)) return make_token(lexer, TOKEN_EOF);
 
-  const char c = advance(lexer);
-  if (is_digit(c)) return scan_number(lexer);
-  if (can_start_identifier(c)) return scan_identifier(lexer);
-  return scan_symbol(lexer);
+  switch (char_class(advance(lexer))) {
+  case CHAR_CLASS_DIGIT: return scan_number(lexer);
+  case CHAR_CLASS_LETTER: return scan_identifier(lexer);
+  default: return scan_punctuator(lexer);
+  }
 }
 
-struct TokenTypeDynArray {
-  size_t length;
-  size_t capacity;
-  TokenTag* data;
+#pragma region Token sizes
+// Token sizes are not stored since most tokens have a fixed spelling, and the
+// rest can be rescanned from their start when needed
+
+static const uint8_t fixed_token_sizes[TOKEN_TYPES_COUNT] = {
+    [TOKEN_LEFT_PAREN] = 1,
+    [TOKEN_RIGHT_PAREN] = 1,
+    [TOKEN_LEFT_BRACE] = 1,
+    [TOKEN_RIGHT_BRACE] = 1,
+    [TOKEN_LEFT_BRACKET] = 1,
+    [TOKEN_RIGHT_BRACKET] = 1,
+    [TOKEN_PLUS] = 1,
+    [TOKEN_PLUS_PLUS] = 2,
+    [TOKEN_PLUS_EQUAL] = 2,
+    [TOKEN_MINUS] = 1,
+    [TOKEN_MINUS_MINUS] = 2,
+    [TOKEN_MINUS_EQUAL] = 2,
+    [TOKEN_MINUS_GREATER] = 2,
+    [TOKEN_STAR] = 1,
+    [TOKEN_STAR_EQUAL] = 2,
+    [TOKEN_SLASH] = 1,
+    [TOKEN_SLASH_EQUAL] = 2,
+    [TOKEN_PERCENT] = 1,
+    [TOKEN_PERCENT_EQUAL] = 2,
+    [TOKEN_TILDE] = 1,
+    [TOKEN_AMPERSAND] = 1,
+    [TOKEN_AMPERSAND_AMPERSAND] = 2,
+    [TOKEN_AMPERSAND_EQUAL] = 2,
+    [TOKEN_BAR] = 1,
+    [TOKEN_BAR_BAR] = 2,
+    [TOKEN_BAR_EQUAL] = 2,
+    [TOKEN_CARET] = 1,
+    [TOKEN_CARET_EQUAL] = 2,
+    [TOKEN_EQUAL] = 1,
+    [TOKEN_EQUAL_EQUAL] = 2,
+    [TOKEN_NOT] = 1,
+    [TOKEN_NOT_EQUAL] = 2,
+    [TOKEN_LESS] = 1,
+    [TOKEN_LESS_LESS] = 2,
+    [TOKEN_LESS_LESS_EQUAL] = 3,
+    [TOKEN_LESS_EQUAL] = 2,
+    [TOKEN_GREATER] = 1,
+    [TOKEN_GREATER_GREATER] = 2,
+    [TOKEN_GREATER_GREATER_EQUAL] = 3,
+    [TOKEN_GREATER_EQUAL] = 2,
+    [TOKEN_COMMA] = 1,
+    [TOKEN_DOT] = 1,
+    [TOKEN_QUESTION] = 1,
+    [TOKEN_SEMICOLON] = 1,
+    [TOKEN_COLON] = 1,
+    [TOKEN_KEYWORD_VOID] = sizeof("void") - 1,
+    [TOKEN_KEYWORD_INT] = sizeof("int") - 1,
+    [TOKEN_KEYWORD_RETURN] = sizeof("return") - 1,
+    [TOKEN_KEYWORD_TYPEDEF] = sizeof("typedef") - 1,
+    [TOKEN_KEYWORD_IF] = sizeof("if") - 1,
+    [TOKEN_KEYWORD_ELSE] = sizeof("else") - 1,
+    [TOKEN_KEYWORD_WHILE] = sizeof("while") - 1,
+    [TOKEN_KEYWORD_DO] = sizeof("do") - 1,
+    [TOKEN_KEYWORD_FOR] = sizeof("for") - 1,
+    [TOKEN_KEYWORD_BREAK] = sizeof("break") - 1,
+    [TOKEN_KEYWORD_CONTINUE] = sizeof("continue") - 1,
+    [TOKEN_KEYWORD_STATIC] = sizeof("static") - 1,
+    [TOKEN_KEYWORD_EXTERN] = sizeof("extern") - 1,
 };
 
-struct U32DynArray {
-  size_t length;
-  size_t capacity;
-  uint32_t* data;
+uint32_t token_size(const char* source, TokenTag tag, uint32_t start)
+{
+  switch (tag) {
+  case TOKEN_EOF: return 0;
+  case TOKEN_IDENTIFIER:
+  case TOKEN_INTEGER: break;
+  case TOKEN_ERROR:
+    // Malformed numbers span all identifier characters, while any other
+    // invalid token is a single character
+    if (!is_digit(source[start])) { return 1; }
+    break;
+  default: {
+    const uint8_t size = fixed_token_sizes[(int)tag];
+    MCC_ASSERT(size != 0);
+    return size;
+  }
+  }
+
+  const char* end = source + start;
+  while (is_identifier_char(*end)) { ++end; }
+  return u32_from_isize(end - (source + start));
+}
+
+#pragma endregion
+
+#pragma region Parallel lexing
+// Large sources are split at line breaks into chunks that are lexed on their
+// own threads. No token spans lines, so a chunk can be lexed on its own unless
+// it starts in the middle of a /* */ comment. Every chunk assumes it does not,
+// and the results are stitched together afterwards: the lexer of a chunk tells
+// where the first token after its chunk starts, and the next chunk's tokens are
+// only kept from that position on. In the rare case that the next chunk never
+// produced a token there, it is lexed again from that position.
+
+enum {
+  PARALLEL_LEX_THRESHOLD = 1024 * 1024, // smaller sources are lexed serially
+  MIN_LEX_CHUNK_SIZE = 256 * 1024,
+  MAX_LEX_THREADS = 64,
 };
 
-Tokens lex(const char* source, Arena* permanent_arena, Arena scratch_arena)
+typedef struct LexChunk {
+  const char* source;
+  const char* source_end;
+  uint32_t begin;
+  uint32_t end;
+
+  // The chunk writes tokens to the slices of the final token arrays starting
+  // at index begin, which are large enough since a chunk of n characters has
+  // at most n tokens
+  TokenTag* token_types;
+  uint32_t* token_starts;
+  uint32_t* token_values;
+  uint32_t token_count;
+  uint32_t next_token_start; // start of the first token at or after end
+} LexChunk;
+
+// Lexes the tokens of a chunk that start at or after offset `from`
+static void lex_chunk_from(LexChunk* chunk, uint32_t from)
+{
+  Lexer lexer = (Lexer){.start = chunk->source,
+                        .end = chunk->source_end,
+                        .previous = chunk->source + from,
+                        .current = chunk->source + from};
+
+  uint32_t token_count = 0;
+  for (;;) {
+    const Token token = lexer_next_token(&lexer);
+    if (token.tag == TOKEN_EOF || token.start >= chunk->end) {
+      chunk->next_token_start = token.start;
+      break;
+    }
+    chunk->token_types[token_count] = token.tag;
+    chunk->token_starts[token_count] = token.start;
+    chunk->token_values[token_count] =
+        token.tag == TOKEN_IDENTIFIER ? token.size : token.value;
+    ++token_count;
+  }
+  chunk->token_count = token_count;
+}
+
+static void* lex_chunk_thread(void* chunk)
+{
+  LexChunk* lex_chunk = chunk;
+  lex_chunk_from(lex_chunk, lex_chunk->begin);
+  return nullptr;
+}
+
+// Splits the source into at most chunk_count chunks that end right after a line
+// break. Returns the actual number of chunks
+static uint32_t split_into_chunks(LexChunk* chunks, uint32_t chunk_count,
+                                  const char* source, uint32_t source_size)
+{
+  uint32_t actual_chunk_count = 0;
+  uint32_t begin = 0;
+  for (uint32_t i = 1; i <= chunk_count && begin < source_size; ++i) {
+    uint32_t end = source_size;
+    if (i != chunk_count) {
+      uint32_t target = (uint32_t)((uint64_t)source_size * i / chunk_count);
+      if (target < begin) { target = begin; }
+      const char* newline =
+          memchr(source + target, '\n', source_size - target);
+      if (newline != nullptr) { end = u32_from_isize(newline - source) + 1; }
+    }
+
+    chunks[actual_chunk_count++] = (LexChunk){.begin = begin, .end = end};
+    begin = end;
+  }
+  return actual_chunk_count;
+}
+
+static uint32_t lex_in_parallel(const char* source, uint32_t source_size,
+                                uint32_t thread_count, TokenTag* token_types,
+                                uint32_t* token_starts, uint32_t* token_values)
 {
-  Lexer lexer = lexer_create(source);
+  MCC_ASSERT(thread_count >= 1 && thread_count <= MAX_LEX_THREADS);
+
+  LexChunk chunks[MAX_LEX_THREADS];
+  pthread_t threads[MAX_LEX_THREADS];
+  const uint32_t chunk_count =
+      split_into_chunks(chunks, thread_count, source, source_size);
+
+  for (uint32_t i = 0; i < chunk_count; ++i) {
+    LexChunk* chunk = &chunks[i];
+    chunk->source = source;
+    chunk->source_end = source + source_size;
+    chunk->token_types = token_types + chunk->begin;
+    chunk->token_starts = token_starts + chunk->begin;
+    chunk->token_values = token_values + chunk->begin;
+    if (i != 0) {
+      if (pthread_create(&threads[i], nullptr, lex_chunk_thread, chunk) != 0) {
+        MCC_PANIC("failed to create a lexer thread");
+      }
+    }
+  }
+  if (chunk_count != 0) { lex_chunk_thread(&chunks[0]); }
+  for (uint32_t i = 1; i < chunk_count; ++i) {
+    pthread_join(threads[i], nullptr);
+  }
+
+  // Stitch the chunks together. Since every chunk has no more tokens than
+  // characters, the tokens kept so far never overlap the current chunk
+  uint32_t token_count = 0;
+  uint32_t resume = 0; // where the next token of the whole source starts
+  for (uint32_t i = 0; i < chunk_count; ++i) {
+    LexChunk* chunk = &chunks[i];
+    if (resume >= chunk->end) { continue; } // swallowed by a comment
+
+    uint32_t first = 0;
+    if (resume != chunk->begin) {
+      while (first < chunk->token_count &&
+             chunk->token_starts[first] < resume) {
+        ++first;
+      }
+      if (first == chunk->token_count ||
+          chunk->token_starts[first] != resume) {
+        // The chunk started inside a comment and lost track of the tokens
+        lex_chunk_from(chunk, resume);
+        first = 0;
+      }
+    }
 
-  struct TokenTypeDynArray token_types_dyn_array = {};
-  struct U32DynArray token_starts_dyn_array = {};
-  struct U32DynArray token_sizes_dyn_array = {};
+    const uint32_t kept_count = chunk->token_count - first;
+    memmove(token_types + token_count, chunk->token_types + first,
+            kept_count * sizeof(TokenTag));
+    memmove(token_starts + token_count, chunk->token_starts + first,
+            kept_count * sizeof(uint32_t));
+    memmove(token_values + token_count, chunk->token_values + first,
+            kept_count * sizeof(uint32_t));
+    token_count += kept_count;
+    resume = chunk->next_token_start;
+  }
 
+  token_types[token_count] = TOKEN_EOF;
+  token_starts[token_count] = source_size;
+  token_values[token_count] = 0;
+  return token_count + 1;
+}
+
+// Identifiers are interned after lexing: the parallel lexer needs a single
+// table, so all its threads have to join first, and the token arrays have to be
+// trimmed before the interner allocates. Until then, the value of an identifier
+// is its size. Values of other tokens are already decoded by the lexer
+static void intern_identifiers(const char* source, uint32_t token_count,
+                               const TokenTag* token_types,
+                               const uint32_t* token_starts,
+                               uint32_t* token_values, Interner* interner)
+{
+  for (uint32_t i = 0; i < token_count; ++i) {
+    if (token_types[i] != TOKEN_IDENTIFIER) { continue; }
+    const StringView name = {
+        .start = source + token_starts[i],
+        .size = token_values[i],
+    };
+    token_values[i] = intern(interner, name);
+  }
+}
+
+#pragma endregion
+
+static uint32_t lex_serially(const char* source, uint32_t source_size,
+                             TokenTag* token_types, uint32_t* token_starts,
+                             uint32_t* token_values)
+{
+  Lexer lexer = (Lexer){.start = source,
+                        .end = source + source_size,
+                        .previous = source,
+                        .current = source};
+
+  uint32_t token_count = 0;
   while (true) {
-    const Token token = scan_token(&lexer);
-    DYNARRAY_PUSH_BACK(&token_types_dyn_array, TokenTag, &scratch_arena,
-                       token.tag);
-    DYNARRAY_PUSH_BACK(&token_starts_dyn_array, uint32_t, &scratch_arena,
-                       token.start);
-    DYNARRAY_PUSH_BACK(&token_sizes_dyn_array, uint32_t, &scratch_arena,
-                       token.size);
+    const Token token = lexer_next_token(&lexer);
+    token_types[token_count] = token.tag;
+    token_starts[token_count] = token.start;
+    token_values[token_count] =
+        token.tag == TOKEN_IDENTIFIER ? token.size : token.value;
+    ++token_count;
     if (token.tag == TOKEN_EOF) { break; }
   }
+  return token_count;
+}
 
-  const uint32_t token_count = u32_from_usize(token_types_dyn_array.length);
-  MCC_ASSERT(token_starts_dyn_array.length == token_count);
-  MCC_ASSERT(token_sizes_dyn_array.length == token_count);
-
+static Tokens lex_source(const char* source, size_t source_size,
+                         uint32_t thread_count, Interner* interner,
+                         Arena* permanent_arena)
+{
+  MCC_ASSERT_MSG(source_size < UINT32_MAX, "source file is too large");
+  if (thread_count > MAX_LEX_THREADS) { thread_count = MAX_LEX_THREADS; }
+
+  // Every token except EOF consumes at least one character, so the source
+  // length bounds the token count. Tokens are written straight into arrays of
+  // that size, and the untouched tail of the arrays is never paged in. The
+  // starts array is allocated last so that its tail can be given back, which
+  // only works while nothing is allocated after it. So identifiers are
+  // interned once it is trimmed.
+  const size_t max_token_count = source_size + 1;
   TokenTag* token_types =
-      ARENA_ALLOC_ARRAY(permanent_arena, TokenTag, token_count);
-  memcpy(token_types, token_types_dyn_array.data,
-         token_count * sizeof(TokenTag));
-
+      ARENA_ALLOC_ARRAY(permanent_arena, TokenTag, max_token_count);
+  uint32_t* token_values =
+      ARENA_ALLOC_ARRAY(permanent_arena, uint32_t, max_token_count);
   uint32_t* token_starts =
-      ARENA_ALLOC_ARRAY(permanent_arena, uint32_t, token_count);
-  memcpy(token_starts, token_starts_dyn_array.data,
-         token_count * sizeof(uint32_t));
+      ARENA_ALLOC_ARRAY(permanent_arena, uint32_t, max_token_count);
 
-  uint32_t* token_sizes =
-      ARENA_ALLOC_ARRAY(permanent_arena, uint32_t, token_count);
-  memcpy(token_sizes, token_sizes_dyn_array.data,
-         token_count * sizeof(uint32_t));
+  uint32_t token_count = 0;
+  if (thread_count <= 1) {
+    token_count = lex_serially(source, (uint32_t)source_size, token_types,
+                               token_starts, token_values);
+  } else {
+    token_count = lex_in_parallel(source, (uint32_t)source_size, thread_count,
+                                  token_types, token_starts, token_values);
+  }
 
-  return (Tokens){.token_count = token_count,
+  token_starts = ARENA_REALLOC_ARRAY(permanent_arena, uint32_t, token_starts,
+                                     max_token_count, token_count);
+
+  intern_identifiers(source, token_count, token_types, token_starts,
+                     token_values, interner);
+
+  return (Tokens){.source = source,
+                  .token_count = token_count,
                   .token_types = token_types,
                   .token_starts = token_starts,
-                  .token_sizes = token_sizes};
+                  .token_values = token_values,
+                  .interner = interner};
+}
+
+Tokens lex_with_threads(const char* source, uint32_t thread_count,
+                        Arena* permanent_arena)
+{
+  return lex_source(source, strlen(source), thread_count,
+                    new_interner(permanent_arena), permanent_arena);
+}
+
+// Large sources are lexed on all cores, in chunks of at least
+// MIN_LEX_CHUNK_SIZE bytes
+static uint32_t lex_thread_count(size_t source_size)
+{
+  uint32_t thread_count = 1;
+  if (source_size >= PARALLEL_LEX_THRESHOLD) {
+    const long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+    const size_t max_chunk_count = source_size / MIN_LEX_CHUNK_SIZE;
+    thread_count = cpu_count > 1 ? (uint32_t)cpu_count : 1;
+    if (thread_count > max_chunk_count) {
+      thread_count = (uint32_t)max_chunk_count;
+    }
+    if (thread_count > MAX_LEX_THREADS) { thread_count = MAX_LEX_THREADS; }
+  }
+  return thread_count;
+}
+
+Tokens lex(const char* source, Arena* permanent_arena)
+{
+  const size_t source_size = strlen(source);
+  return lex_source(source, source_size, lex_thread_count(source_size),
+                    new_interner(permanent_arena), permanent_arena);
+}
+
+Tokens lex_with_interner(const char* source, Interner* interner,
+                         Arena* token_arena)
+{
+  const size_t source_size = strlen(source);
+  return lex_source(source, source_size, lex_thread_count(source_size),
+                    interner, token_arena);
 }
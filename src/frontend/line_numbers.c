@@ -2,17 +2,31 @@
 #include <mcc/frontend.h>
 #include <string.h>
 
-struct U32DynArray {
+struct LineMarkerVec {
   size_t length;
   size_t capacity;
-  uint32_t* data;
+  LineMarker* data;
 };
 
-static bool table_initialized = false;
-static const char* cached_file_name = nullptr;
-static LineNumTable cached_table = {};
+// Distinct file names of the markers
+struct FilenameVec {
+  size_t length;
+  size_t capacity;
+  const char** data;
+};
+
+// There are only a few files, so their tables are kept in a list
+typedef struct CachedTable CachedTable;
+struct CachedTable {
+  const char* filename;
+  StringView source;
+  LineNumTable table;
+  CachedTable* next;
+};
+
+static CachedTable* cached_tables = nullptr;
 
-static LineNumTable create_line_num_table(StringView src,
+static LineNumTable create_line_num_table(const char* filename, StringView src,
                                           Arena* permanent_arena,
                                           Arena scratch_arena);
 
@@ -20,55 +34,195 @@ const LineNumTable* get_line_num_table(const char* filename, StringView source,
                                        Arena* permanent_arena,
                                        Arena scratch_arena)
 {
-  if (cached_file_name == nullptr) {
-    cached_file_name = filename;
-  } else {
-    MCC_ASSERT_MSG(strcmp(filename, cached_file_name) == 0,
-                   "We currently only support one file");
+  for (CachedTable* cached = cached_tables; cached != nullptr;
+       cached = cached->next) {
+    if (strcmp(cached->filename, filename) == 0 &&
+        cached->source.start == source.start &&
+        cached->source.size == source.size) {
+      return &cached->table;
+    }
   }
 
-  if (!table_initialized) {
-    cached_table =
-        create_line_num_table(source, permanent_arena, scratch_arena);
-    table_initialized = true;
-  }
+  CachedTable* cached = ARENA_ALLOC_OBJECT(permanent_arena, CachedTable);
+  *cached = (CachedTable){
+      .filename = filename,
+      .source = source,
+      .table = create_line_num_table(filename, source, permanent_arena,
+                                     scratch_arena),
+      .next = cached_tables,
+  };
+  cached_tables = cached;
+  return &cached->table;
+}
 
-  return &cached_table;
+#pragma region line markers
+static const char* skip_spaces(const char* p, const char* end)
+{
+  while (p != end && (*p == ' ' || *p == '\t')) { ++p; }
+  return p;
 }
 
-static LineNumTable create_line_num_table(StringView src,
-                                          Arena* permanent_arena,
-                                          Arena scratch_arena)
+static bool is_digit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+// Unescapes the file name of a marker, which the preprocessor spells as a
+// string literal. Returns null if the literal is not closed on its line
+static const char* parse_marker_filename(const char* p, const char* end,
+                                         struct FilenameVec* filenames,
+                                         Arena* permanent_arena,
+                                         Arena* scratch_arena)
 {
-  struct U32DynArray line_starts_temp = {};
-  DYNARRAY_PUSH_BACK(&line_starts_temp, uint32_t, &scratch_arena, 0);
+  const char* closing = p;
+  while (closing != end && *closing != '"' && *closing != '\n') {
+    if (*closing == '\\' && closing + 1 != end) { ++closing; }
+    ++closing;
+  }
+  if (closing == end || *closing != '"') { return nullptr; }
+
+  char* filename =
+      ARENA_ALLOC_ARRAY(scratch_arena, char, (size_t)(closing - p) + 1);
+  size_t size = 0;
+  while (p != closing) {
+    char c = *p++;
+    if (c == '\\') {
+      if (is_digit(*p) && *p < '8') {
+        // An octal escape of up to three digits
+        unsigned value = 0;
+        for (int i = 0; i < 3 && p != closing && is_digit(*p) && *p < '8';
+             ++i) {
+          value = value * 8 + (unsigned)(*p++ - '0');
+        }
+        c = (char)value;
+      } else {
+        c = *p++;
+      }
+    }
+    filename[size++] = c;
+  }
+  filename[size] = '\0';
 
-  MCC_ASSERT(src.size <= UINT32_MAX);
-  for (uint32_t i = 0; i < src.size; ++i) {
-    if (src.start[i] == '\n') {
-      DYNARRAY_PUSH_BACK(&line_starts_temp, uint32_t, &scratch_arena, i + 1);
+  // Markers mostly return to a file named before, whose name is shared. There
+  // are only a few files, so they are searched one by one
+  for (size_t i = 0; i < filenames->length; ++i) {
+    if (strcmp(filename, filenames->data[i]) == 0) {
+      return filenames->data[i];
     }
   }
+  char* result = ARENA_ALLOC_ARRAY(permanent_arena, char, size + 1);
+  memcpy(result, filename, size + 1);
+  DYNARRAY_PUSH_BACK(filenames, const char*, scratch_arena, result);
+  return result;
+}
+
+// Parses a line marker, `# 42 "foo.h" flags` or `#line 42 "foo.h"`, at p. The
+// file name is optional, and defaults to the one of the previous marker
+static bool parse_line_marker(const char* p, const char* end,
+                              const char* previous_filename,
+                              struct FilenameVec* filenames,
+                              LineMarker* marker, Arena* permanent_arena,
+                              Arena* scratch_arena)
+{
+  p = skip_spaces(p + 1, end);
+  if (end - p >= 4 && memcmp(p, "line", 4) == 0) { p = skip_spaces(p + 4, end); }
+  if (p == end || !is_digit(*p)) { return false; }
 
-  const uint32_t line_count = u32_from_usize(line_starts_temp.length);
+  uint32_t line = 0;
+  for (; p != end && is_digit(*p); ++p) {
+    if (line > (UINT32_MAX - 9) / 10) { return false; }
+    line = line * 10 + (uint32_t)(*p - '0');
+  }
+
+  const char* filename = previous_filename;
+  p = skip_spaces(p, end);
+  if (p != end && *p == '"') {
+    filename = parse_marker_filename(p + 1, end, filenames, permanent_arena,
+                                     scratch_arena);
+    if (filename == nullptr) { return false; }
+  }
 
+  marker->presumed_line = line;
+  marker->filename = filename;
+  return true;
+}
+#pragma endregion
+
+static uint32_t count_newlines(StringView src)
+{
+  const char* end = src.start + src.size;
+  uint32_t count = 0;
+  for (const char* p = src.start;
+       (p = memchr(p, '\n', (size_t)(end - p))) != nullptr; ++p) {
+    ++count;
+  }
+  return count;
+}
+
+// The newlines are found with memchr, which scans a vector of characters at a
+// time, once to count them and once more to fill in the exactly sized table
+static LineNumTable create_line_num_table(const char* filename, StringView src,
+                                          Arena* permanent_arena,
+                                          Arena scratch_arena)
+{
+  MCC_ASSERT(src.size < UINT32_MAX);
+  const uint32_t line_count = count_newlines(src) + 1;
   uint32_t* line_starts =
       ARENA_ALLOC_ARRAY(permanent_arena, uint32_t, line_count);
-  memcpy(line_starts, line_starts_temp.data, line_count * sizeof(uint32_t));
+
+  struct LineMarkerVec markers = {};
+  struct FilenameVec filenames = {};
+  DYNARRAY_PUSH_BACK(&filenames, const char*, &scratch_arena, filename);
+  const char* end = src.start + src.size;
+  const char* line_start = src.start;
+  for (uint32_t line = 1;; ++line) {
+    line_starts[line - 1] = u32_from_isize(line_start - src.start);
+
+    // Lines that start with '#' are the directives the preprocessor leaves,
+    // i.e. line markers and pragmas
+    if (line_start != end && *line_start == '#') {
+      const char* previous_filename =
+          markers.length == 0 ? filename : markers.data[markers.length - 1].filename;
+      LineMarker marker = {.next_line = line + 1};
+      if (parse_line_marker(line_start, end, previous_filename, &filenames,
+                            &marker, permanent_arena, &scratch_arena)) {
+        DYNARRAY_PUSH_BACK(&markers, LineMarker, &scratch_arena, marker);
+      }
+    }
+
+    const char* newline = memchr(line_start, '\n', (size_t)(end - line_start));
+    if (newline == nullptr) {
+      MCC_ASSERT(line == line_count);
+      break;
+    }
+    line_start = newline + 1;
+  }
+
+  LineMarker* permanent_markers = nullptr;
+  if (markers.length != 0) {
+    permanent_markers =
+        ARENA_ALLOC_ARRAY(permanent_arena, LineMarker, markers.length);
+    memcpy(permanent_markers, markers.data, markers.length * sizeof(LineMarker));
+  }
 
   return (LineNumTable){
       .line_starts = line_starts,
       .line_count = line_count,
+      .filename = filename,
+      .marker_count = (uint32_t)markers.length,
+      .markers = permanent_markers,
   };
 }
 
-static uint32_t find_line_number(const LineNumTable* table, uint32_t offset)
+// Number of lines that start at or before the offset, which is also the line
+// number of the offset. The first `first` lines are known to start before it
+static uint32_t find_line_number(const LineNumTable* table, uint32_t first,
+                                 uint32_t offset)
 {
   // binary search the index of first element greater than the offset, which
   // will be the offset to the line_starts + 1 (and incidentally the line
   // number since the line number starts from 1)
-  uint32_t first = 0;
-  uint32_t count = table->line_count;
+  uint32_t count = table->line_count - first;
   uint32_t current;
   uint32_t step;
 
@@ -86,9 +240,9 @@ static uint32_t find_line_number(const LineNumTable* table, uint32_t offset)
   return first;
 }
 
-LineColumn calculate_line_and_column(const LineNumTable* table, uint32_t offset)
+static LineColumn line_and_column_in(const LineNumTable* table,
+                                     uint32_t line_number, uint32_t offset)
 {
-  const uint32_t line_number = find_line_number(table, offset);
   MCC_ASSERT(line_number > 0 && line_number <= table->line_count);
   const uint32_t column_number =
       (offset - table->line_starts[line_number - 1]) + 1;
@@ -97,3 +251,98 @@ LineColumn calculate_line_and_column(const LineNumTable* table, uint32_t offset)
       .column = column_number,
   };
 }
+
+LineColumn calculate_line_and_column(const LineNumTable* table, uint32_t offset)
+{
+  return line_and_column_in(table, find_line_number(table, 0, offset), offset);
+}
+
+// Number of markers before the line. The first `first` markers are known to be
+// before it
+static uint32_t count_markers_before(const LineNumTable* table, uint32_t first,
+                                     uint32_t line)
+{
+  uint32_t count = table->marker_count - first;
+  while (count > 0) {
+    const uint32_t step = count / 2;
+    const uint32_t current = first + step;
+    if (table->markers[current].next_line <= line) {
+      first = current + 1;
+      count -= step + 1;
+    } else {
+      count = step;
+    }
+  }
+  return first;
+}
+
+static PresumedLine presumed_line_after(const LineNumTable* table,
+                                        uint32_t marker_count, uint32_t line)
+{
+  if (marker_count == 0) {
+    return (PresumedLine){.filename = table->filename, .line = line};
+  }
+  const LineMarker* marker = &table->markers[marker_count - 1];
+  return (PresumedLine){
+      .filename = marker->filename,
+      .line = marker->presumed_line + (line - marker->next_line),
+  };
+}
+
+PresumedLine calculate_presumed_line(const LineNumTable* table, uint32_t line)
+{
+  return presumed_line_after(table, count_markers_before(table, 0, line), line);
+}
+
+#pragma region cursor
+// Beyond this many lines or markers, moving the cursor one at a time is slower
+// than searching for the target
+enum { MAX_CURSOR_STEPS = 8 };
+
+LineCursor line_cursor(const LineNumTable* table)
+{
+  return (LineCursor){.table = table};
+}
+
+LineColumn cursor_line_and_column(LineCursor* cursor, uint32_t offset)
+{
+  const LineNumTable* table = cursor->table;
+  uint32_t line = cursor->line;
+  if (line == 0 || table->line_starts[line - 1] > offset) {
+    line = find_line_number(table, 0, offset);
+  } else {
+    for (uint32_t steps = 0;
+         line < table->line_count && table->line_starts[line] <= offset;
+         ++steps) {
+      if (steps == MAX_CURSOR_STEPS) {
+        line = find_line_number(table, line, offset);
+        break;
+      }
+      ++line;
+    }
+  }
+  cursor->line = line;
+  return line_and_column_in(table, line, offset);
+}
+
+PresumedLine cursor_presumed_line(LineCursor* cursor, uint32_t line)
+{
+  const LineNumTable* table = cursor->table;
+  uint32_t marker_count = cursor->marker_count;
+  if (marker_count != 0 && table->markers[marker_count - 1].next_line > line) {
+    marker_count = count_markers_before(table, 0, line);
+  } else {
+    for (uint32_t steps = 0; marker_count < table->marker_count &&
+                             table->markers[marker_count].next_line <= line;
+         ++steps) {
+      if (steps == MAX_CURSOR_STEPS) {
+        marker_count = count_markers_before(table, marker_count, line);
+        break;
+      }
+      ++marker_count;
+    }
+  }
+  cursor->marker_count = marker_count;
+  return presumed_line_after(table, marker_count, line);
+}
+#pragma endregion
@@ -3,9 +3,13 @@
 #include <mcc/ast.h>
 #include <mcc/dynarray.h>
 #include <mcc/format.h>
+#include <mcc/sema.h>
 
+#include <pthread.h>
+#include <setjmp.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "symbol_table.h"
 
@@ -15,22 +19,121 @@ struct ErrorVec {
   Error* data;
 };
 
+struct ExprVec {
+  uint32_t length;
+  uint32_t capacity;
+  ExprId* data;
+  VirtualRange range;
+};
+
+struct ExprParseFrameVec {
+  uint32_t length;
+  uint32_t capacity;
+  struct ExprParseFrame* data;
+  VirtualRange range;
+};
+
+struct IfChainVec {
+  uint32_t length;
+  uint32_t capacity;
+  struct IfChainLink* data;
+  VirtualRange range;
+};
+
+struct SkimmedBodyVec {
+  uint32_t length;
+  uint32_t capacity;
+  struct SkimmedBody** data;
+};
+
+// When lexing on demand, the parser only keeps the most recent tokens in a ring
+// buffer. It never looks further back than the previous token.
+enum { TOKEN_WINDOW_SIZE = 4 };
+static_assert((TOKEN_WINDOW_SIZE & (TOKEN_WINDOW_SIZE - 1)) == 0,
+              "window size must be a power of two");
+
+typedef struct TokenWindow {
+  Token tokens[TOKEN_WINDOW_SIZE];
+  uint32_t fetched_count; // number of tokens scanned so far
+} TokenWindow;
+
+// The virtual memory ranges of the arrays of the node pools
+typedef struct NodeRanges {
+  VirtualRange expr_tags;
+  VirtualRange expr_ops;
+  VirtualRange expr_data;
+  VirtualRange expr_types;
+  VirtualRange expr_source_ranges;
+  VirtualRange stmt_tags;
+  VirtualRange stmt_data;
+  VirtualRange stmt_source_ranges;
+  VirtualRange ternaries;
+  VirtualRange calls;
+  VirtualRange call_args;
+  VirtualRange ifs;
+  VirtualRange for_loops;
+  VirtualRange variable_decls;
+  VirtualRange block_items;
+} NodeRanges;
+
+// Where the bodies of top-level functions are parsed
+typedef enum BodyParsing {
+  PARSE_BODIES_INLINE,      // where they are
+  PARSE_REACHABLE_BODIES,   // once the top level is done, if reachable
+  PARSE_BODIES_IN_PARALLEL, // once the top level is done, on worker threads
+} BodyParsing;
+
 typedef struct Parser {
   const char* src;
 
   Arena* permanent_arena;
   Arena scratch_arena;
+  NodeRanges node_ranges; // back the node pools until they are copied out
 
+  // Tokens come either from the fully lexed tokens, or from the lexer on demand
+  // if it is non-null
   Tokens tokens;
+  Lexer* lexer;
+  TokenWindow token_window;
   uint32_t current_token_index;
 
+  Interner* interner;
+
   bool has_error;
   bool in_panic_mode;
 
   struct ErrorVec errors;
 
   struct Scope* global_scope;
-  HashMap functions;
+  TypeInterner* types;
+
+  AstNodes nodes;
+
+  // Checks each top-level declaration once it is parsed, if non-null
+  TypeChecker* type_checker;
+  ErrorsView type_errors; // of type_checker, set once parsing is done
+
+  // Receives the top-level declarations instead of the AST, if consume is
+  // non-null
+  DeclSink decl_sink;
+
+  // Unless parsed inline, the bodies of top-level functions are skimmed
+  BodyParsing body_parsing;
+  uint32_t thread_count;    // when parsing bodies in parallel, 0 for per core
+  SymbolMap skimmed_bodies; // of the functions, by name
+  struct SkimmedBodyVec all_skimmed_bodies;
+  struct SkimmedBodyVec pending_bodies;
+
+  // Set on worker threads, which give up on a body instead of changing what
+  // the threads share
+  jmp_buf* bail;
+
+  // Explicit stacks of the expression parser, shared by all expressions
+  struct ExprParseFrameVec expr_frames;
+  struct ExprVec pending_args; // arguments of the calls being parsed
+  struct IfChainVec if_chain;  // `else if` ladders being parsed
+
+  uint32_t nesting_depth; // of the statements being parsed
 } Parser;
 
 #pragma region source range operations
@@ -50,11 +153,19 @@ static SourceRange source_range_union(SourceRange lhs, SourceRange rhs)
 #pragma endregion
 
 #pragma region source error handling
+// On a worker thread, leaves the body being parsed to the main thread. Errors
+// are also left to it, since recovering from them can run past the body
+static void bail_out_of_body(Parser* parser)
+{
+  if (parser->bail != nullptr) { longjmp(*parser->bail, 1); }
+}
+
 // A version of error that does not cause parser to enter panic mode
 static void parse_error_at(Parser* parser, StringView error_msg,
                            SourceRange range)
 {
   if (parser->in_panic_mode) return;
+  bail_out_of_body(parser);
 
   Error error = (Error){.msg = error_msg, .range = range};
   DYNARRAY_PUSH_BACK(&parser->errors, Error, parser->permanent_arena, error);
@@ -66,6 +177,7 @@ static void parse_panic_at(Parser* parser, StringView error_msg,
                            SourceRange range)
 {
   if (parser->in_panic_mode) return;
+  bail_out_of_body(parser);
 
   Error error = (Error){.msg = error_msg, .range = range};
   DYNARRAY_PUSH_BACK(&parser->errors, Error, parser->permanent_arena, error);
@@ -88,10 +200,44 @@ static StringView str_from_token(const char* src, Token token)
   return (StringView){.start = src + token.start, .size = token.size};
 }
 
+static Token parser_token_at(const Parser* parser, uint32_t index)
+{
+  if (parser->lexer == nullptr) { return get_token(&parser->tokens, index); }
+
+  const TokenWindow* window = &parser->token_window;
+  MCC_ASSERT(index < window->fetched_count &&
+             index + TOKEN_WINDOW_SIZE >= window->fetched_count);
+  return window->tokens[index & (TOKEN_WINDOW_SIZE - 1)];
+}
+
+// Scans a token into the window when lexing on demand. Identifiers are
+// interned here, since the lexer alone does not know about the interner
+static void parser_fetch_token(Parser* parser)
+{
+  TokenWindow* window = &parser->token_window;
+  Token token = lexer_next_token(parser->lexer);
+  if (token.tag == TOKEN_IDENTIFIER) {
+    token.value = intern(parser->interner, str_from_token(parser->src, token));
+  }
+  window->tokens[window->fetched_count & (TOKEN_WINDOW_SIZE - 1)] = token;
+  window->fetched_count++;
+}
+
+// Moves to the next token, scanning it first if lexing on demand
+static void parser_next_token_index(Parser* parser)
+{
+  parser->current_token_index++;
+  if (parser->lexer == nullptr) { return; }
+
+  while (parser->token_window.fetched_count <= parser->current_token_index) {
+    parser_fetch_token(parser);
+  }
+}
+
 // gets the current token
 static Token parser_current_token(const Parser* parser)
 {
-  return get_token(&parser->tokens, parser->current_token_index);
+  return parser_token_at(parser, parser->current_token_index);
 }
 
 // gets the current token
@@ -99,7 +245,7 @@ static Token parser_previous_token(Parser* parser)
 {
   MCC_ASSERT(parser->current_token_index > 0);
   const uint32_t previous_token_index = parser->current_token_index - 1;
-  return get_token(&parser->tokens, previous_token_index);
+  return parser_token_at(parser, previous_token_index);
 }
 
 static bool token_match_or_eof(const Parser* parser, TokenTag typ)
@@ -108,6 +254,17 @@ static bool token_match_or_eof(const Parser* parser, TokenTag typ)
   return current_token.tag == typ || current_token.tag == TOKEN_EOF;
 }
 
+static StringView lex_error_message(LexError error)
+{
+  switch (error) {
+  case LEX_ERROR_UNEXPECTED_CHARACTER: return str("unexpected character");
+  case LEX_ERROR_INTEGER_TOO_LARGE:
+    return str("integer literal is too large to be represented in any "
+               "integer type");
+  }
+  MCC_UNREACHABLE();
+}
+
 // Advance tokens by one
 // Also skip any error tokens
 static void parse_advance(Parser* parser)
@@ -115,10 +272,11 @@ static void parse_advance(Parser* parser)
   if (parser_current_token(parser).tag == TOKEN_EOF) { return; }
 
   for (;;) {
-    parser->current_token_index++;
+    parser_next_token_index(parser);
     Token current = parser_current_token(parser);
     if (current.tag != TOKEN_ERROR) break;
-    parse_panic_at_token(parser, str("unexpected character"), current);
+    parse_panic_at_token(parser, lex_error_message((LexError)current.value),
+                         current);
   }
 }
 
@@ -138,62 +296,276 @@ static void parse_consume(Parser* parser, TokenTag type, const char* error_msg)
 
 static Token parse_identifier(Parser* parser)
 {
-  const Token token = parser_current_token(parser);
+  Token token = parser_current_token(parser);
 
   if (token.tag != TOKEN_IDENTIFIER) {
     parse_panic_at_token(parser, str("Expect Identifier"), token);
+    // Keep going with whatever was written in place of the name
+    token.value = intern(parser->interner, str_from_token(parser->src, token));
   }
   parse_advance(parser);
   return token;
 }
 #pragma endregion
 
+#pragma region AST construction
+// Each array of the node pools lives in a virtual memory range of its own,
+// which is committed as the pool grows. The pools thus grow in place, without
+// copies, and only the pages of the nodes made so far count as used memory.
+// Once parsing is done, they are copied to the permanent arena at their exact
+// sizes and the ranges are released. Nodes are only ever referred to by index,
+// so growing the pools does not invalidate anything.
+
+// Grows a capacity by doubling until it holds `length` nodes
+static uint32_t grown_node_capacity(uint32_t capacity, uint32_t length)
+{
+  if (capacity == 0) { capacity = 1024; }
+  while (capacity < length) { capacity *= 2; }
+  return capacity;
+}
+
+// Commits room for `capacity` elements in the range of a node array, and
+// returns the start of the array
+static void* commit_node_array(VirtualRange* range, size_t element_size,
+                               uint32_t capacity)
+{
+  if (range->begin == nullptr) {
+    *range = virtual_range_reserve(VECTOR_RESERVE_SIZE);
+  }
+  virtual_range_commit(range, (size_t)capacity * element_size);
+  return range->begin;
+}
+
+#define COMMIT_NODE_ARRAY(range, array, capacity)                              \
+  ((array) = commit_node_array((range), sizeof(*(array)), (capacity)))
+
+// Makes room for `length` nodes in a pool of the AST_POOL kind
+#define RESERVE_NODES(range, pool, length)                                     \
+  do {                                                                         \
+    if ((pool)->capacity < (length)) {                                         \
+      (pool)->capacity = grown_node_capacity((pool)->capacity, (length));      \
+      COMMIT_NODE_ARRAY((range), (pool)->data, (pool)->capacity);              \
+    }                                                                          \
+  } while (0)
+
+#define PUSH_NODE(parser, pool, elem)                                          \
+  do {                                                                         \
+    RESERVE_NODES(&(parser)->node_ranges.pool, &(parser)->nodes.pool,          \
+                  (parser)->nodes.pool.length + 1);                            \
+    (parser)->nodes.pool.data[(parser)->nodes.pool.length++] = (elem);         \
+  } while (0)
+
+static void reserve_exprs(ExprPool* exprs, NodeRanges* ranges, uint32_t length)
+{
+  if (exprs->capacity >= length) { return; }
+  const uint32_t capacity = grown_node_capacity(exprs->capacity, length);
+  COMMIT_NODE_ARRAY(&ranges->expr_tags, exprs->tags, capacity);
+  COMMIT_NODE_ARRAY(&ranges->expr_ops, exprs->ops, capacity);
+  COMMIT_NODE_ARRAY(&ranges->expr_data, exprs->data, capacity);
+  COMMIT_NODE_ARRAY(&ranges->expr_types, exprs->types, capacity);
+  COMMIT_NODE_ARRAY(&ranges->expr_source_ranges, exprs->source_ranges,
+                    capacity);
+  exprs->capacity = capacity;
+}
+
+static void reserve_stmts(StmtPool* stmts, NodeRanges* ranges, uint32_t length)
+{
+  if (stmts->capacity >= length) { return; }
+  const uint32_t capacity = grown_node_capacity(stmts->capacity, length);
+  COMMIT_NODE_ARRAY(&ranges->stmt_tags, stmts->tags, capacity);
+  COMMIT_NODE_ARRAY(&ranges->stmt_data, stmts->data, capacity);
+  COMMIT_NODE_ARRAY(&ranges->stmt_source_ranges, stmts->source_ranges,
+                    capacity);
+  stmts->capacity = capacity;
+}
+
+static void release_node_ranges(NodeRanges* ranges)
+{
+  VirtualRange* all_ranges[] = {
+      &ranges->expr_tags,  &ranges->expr_ops,       &ranges->expr_data,
+      &ranges->expr_types, &ranges->expr_source_ranges,
+      &ranges->stmt_tags,  &ranges->stmt_data,      &ranges->stmt_source_ranges,
+      &ranges->ternaries,  &ranges->calls,          &ranges->call_args,
+      &ranges->ifs,        &ranges->for_loops,      &ranges->variable_decls,
+      &ranges->block_items,
+  };
+  for (size_t i = 0; i < sizeof(all_ranges) / sizeof(all_ranges[0]); ++i) {
+    virtual_range_release(all_ranges[i]);
+  }
+}
+
+static ExprId push_expr(Parser* parser, ExprTag tag, uint8_t op, ExprData data,
+                        SourceRange source_range)
+{
+  ExprPool* exprs = &parser->nodes.exprs;
+  reserve_exprs(exprs, &parser->node_ranges, exprs->length + 1);
+
+  const ExprId id = exprs->length++;
+  exprs->tags[id] = tag;
+  exprs->ops[id] = op;
+  exprs->data[id] = data;
+  exprs->types[id] = nullptr;
+  exprs->source_ranges[id] = source_range;
+  return id;
+}
+
+static SourceRange expr_source_range(const Parser* parser, ExprId expr)
+{
+  return parser->nodes.exprs.source_ranges[expr];
+}
+
+static StmtId push_stmt(Parser* parser, StmtTag tag, StmtData data,
+                        SourceRange source_range)
+{
+  StmtPool* stmts = &parser->nodes.stmts;
+  reserve_stmts(stmts, &parser->node_ranges, stmts->length + 1);
+
+  const StmtId id = stmts->length++;
+  stmts->tags[id] = tag;
+  stmts->data[id] = data;
+  stmts->source_ranges[id] = source_range;
+  return id;
+}
+
+// Reserves index 0 of the expression and statement pools for NO_EXPR and
+// NO_STMT
+static void init_ast_nodes(Parser* parser)
+{
+  push_expr(parser, EXPR_INVALID, 0, (ExprData){}, (SourceRange){});
+  push_stmt(parser, STMT_INVALID, (StmtData){}, (SourceRange){});
+}
+
+static void* copy_array(Arena* arena, const void* src, size_t alignment,
+                        size_t size)
+{
+  if (size == 0) { return nullptr; }
+  void* dst = arena_aligned_alloc(arena, alignment, size);
+  memcpy(dst, src, size);
+  return dst;
+}
+
+#define COPY_ARRAY(arena, array, n)                                            \
+  copy_array((arena), (array), alignof(typeof(*(array))),                      \
+             sizeof(*(array)) * (n))
+
+#define COPY_POOL(arena, dst, src)                                             \
+  do {                                                                         \
+    (dst)->data = COPY_ARRAY(arena, (src)->data, (src)->length);               \
+    (dst)->capacity = (src)->length;                                           \
+  } while (0)
+
+static AstNodes copy_ast_nodes(const AstNodes* nodes, Arena* arena)
+{
+  AstNodes result = *nodes;
+
+  const ExprPool* exprs = &nodes->exprs;
+  result.exprs = (ExprPool){
+      .length = exprs->length,
+      .capacity = exprs->length,
+      .tags = COPY_ARRAY(arena, exprs->tags, exprs->length),
+      .ops = COPY_ARRAY(arena, exprs->ops, exprs->length),
+      .data = COPY_ARRAY(arena, exprs->data, exprs->length),
+      .types = COPY_ARRAY(arena, exprs->types, exprs->length),
+      .source_ranges = COPY_ARRAY(arena, exprs->source_ranges, exprs->length),
+  };
+
+  const StmtPool* stmts = &nodes->stmts;
+  result.stmts = (StmtPool){
+      .length = stmts->length,
+      .capacity = stmts->length,
+      .tags = COPY_ARRAY(arena, stmts->tags, stmts->length),
+      .data = COPY_ARRAY(arena, stmts->data, stmts->length),
+      .source_ranges = COPY_ARRAY(arena, stmts->source_ranges, stmts->length),
+  };
+
+  COPY_POOL(arena, &result.ternaries, &nodes->ternaries);
+  COPY_POOL(arena, &result.calls, &nodes->calls);
+  COPY_POOL(arena, &result.call_args, &nodes->call_args);
+  COPY_POOL(arena, &result.ifs, &nodes->ifs);
+  COPY_POOL(arena, &result.for_loops, &nodes->for_loops);
+  COPY_POOL(arena, &result.variable_decls, &nodes->variable_decls);
+  COPY_POOL(arena, &result.block_items, &nodes->block_items);
+  return result;
+}
+
+#undef COPY_POOL
+#undef COPY_ARRAY
+#pragma endregion
+
+#pragma region function body skimming
+// When skimming, the body of a top-level function is skipped by matching its
+// braces, and only parsed once a reachable function refers to it. Bodies of
+// functions with external linkage are always reachable. Unreferenced static
+// functions are never parsed, so errors in their bodies go unreported.
+typedef struct SkimmedBody {
+  FunctionDecl* decl;
+  uint32_t begin_token; // the `{`
+  uint32_t end_token;   // after the `}`
+  uint32_t visible_file_scope_count;
+  bool is_internal; // declared static
+  bool is_queued;
+
+  // When parsing bodies in parallel
+  bool check_body; // false if the signature has errors
+  bool parse_on_main_thread;
+} SkimmedBody;
+
+static void queue_skimmed_body(Parser* parser, SkimmedBody* body)
+{
+  if (body->is_queued) { return; }
+  body->is_queued = true;
+  DYNARRAY_PUSH_BACK(&parser->pending_bodies, SkimmedBody*,
+                     &parser->scratch_arena, body);
+}
+
+// Functions are only referred to by name, so referring to any declaration of a
+// function reaches its body
+static void reach_function(Parser* parser, const IdentifierInfo* function)
+{
+  SkimmedBody* body = symbol_map_lookup(&parser->skimmed_bodies, function->name);
+  if (body != nullptr) { queue_skimmed_body(parser, body); }
+}
+#pragma endregion
+
 #pragma region Expression parsing
-static Expr* parse_number_literal(Parser* parser, Scope* scope)
+static ExprId parse_number_literal(Parser* parser, Scope* scope)
 {
   (void)scope;
 
   const Token token = parser_previous_token(parser);
 
-  char* end_ptr;
-  const int val = (int)strtol(parser->src + token.start, &end_ptr,
-                              10); // TODO(llai): replace strtol
-
-  MCC_ASSERT_MSG(end_ptr == parser->src + token.start + token.size,
-                 "Not used all characters for numbers");
+  // The lexer already decoded the literal. Values that do not fit in int wrap
+  // around, so that `-2147483648` is still INT_MIN
+  const int32_t val = (int32_t)token.value;
 
-  Expr* result = ARENA_ALLOC_OBJECT(parser->permanent_arena, Expr);
-  *result = (Expr){.tag = EXPR_CONST,
-                   .source_range = token_source_range(token),
-                   .const_expr = (struct ConstExpr){.val = val}};
-  return result;
+  return push_expr(parser, EXPR_CONST, 0, (ExprData){.const_value = val},
+                   token_source_range(token));
 }
 
-static Expr* parse_identifier_expr(Parser* parser, Scope* scope)
+static ExprId parse_identifier_expr(Parser* parser, Scope* scope)
 {
   const Token token = parser_previous_token(parser);
 
   MCC_ASSERT(token.tag == TOKEN_IDENTIFIER);
 
-  const StringView identifier = str_from_token(parser->src, token);
-
   // TODO: handle typedef
-  Expr* result = ARENA_ALLOC_OBJECT(parser->permanent_arena, Expr);
 
   // If local variable does not exist
-  const IdentifierInfo* variable = lookup_identifier(scope, identifier);
+  const IdentifierInfo* variable = lookup_identifier(scope, token.value);
   if (!variable) {
+    const StringView identifier = str_from_token(parser->src, token);
     const StringView error_msg = allocate_printf(
         parser->permanent_arena, "use of undeclared identifier '%.*s'",
         (int)identifier.size, identifier.start);
     parse_error_at(parser, error_msg, token_source_range(token));
+  } else if (parser->body_parsing == PARSE_REACHABLE_BODIES &&
+             variable->kind == IDENT_FUNCTION) {
+    reach_function(parser, variable);
   }
 
   // TODO: handle the case wher variable == nullptr
-  *result = (Expr){.tag = EXPR_VARIABLE,
-                   .source_range = token_source_range(token),
-                   .variable = variable};
-  return result;
+  return push_expr(parser, EXPR_VARIABLE, 0, (ExprData){.variable = variable},
+                   token_source_range(token));
 }
 
 typedef enum Precedence {
@@ -215,71 +587,74 @@ typedef enum Precedence {
   PREC_PRIMARY
 } Precedence;
 
-static Expr* parse_expr(Parser* parser, struct Scope* scope);
-static Expr* parse_group(Parser* parser, struct Scope* scope);
-static Expr* parse_unary_op(Parser* parser, struct Scope* scope);
-static Expr* parse_binop_left(Parser* parser, Expr* lhs_expr,
-                              struct Scope* scope); // left associative
-static Expr* parse_assignment(Parser* parser, Expr* lhs_expr,
-                              struct Scope* scope); // right associative
-static Expr* parse_ternary(Parser* parser, Expr* cond, struct Scope* scope);
-static Expr* parse_function_call(Parser* parser, Expr* function,
-                                 struct Scope* scope);
-
-typedef Expr* (*PrefixParseFn)(Parser*, struct Scope* scope);
-typedef Expr* (*InfixParseFn)(Parser*, Expr*, struct Scope* scope);
+typedef enum PrefixRule : uint8_t {
+  PREFIX_NONE,
+  PREFIX_NUMBER,
+  PREFIX_IDENTIFIER,
+  PREFIX_GROUP,
+  PREFIX_UNARY,
+} PrefixRule;
+
+typedef enum InfixRule : uint8_t {
+  INFIX_NONE,
+  INFIX_BINARY,     // left associative
+  INFIX_ASSIGNMENT, // right associative
+  INFIX_TERNARY,
+  INFIX_CALL,
+} InfixRule;
 
 typedef struct ParseRule {
-  PrefixParseFn prefix;
-  InfixParseFn infix;
+  PrefixRule prefix;
+  InfixRule infix;
   Precedence precedence;
 } ParseRule;
 
 static ParseRule rules[TOKEN_TYPES_COUNT] = {
-    [TOKEN_LEFT_PAREN] = {parse_group, parse_function_call, PREC_CALL},
-    [TOKEN_RIGHT_PAREN] = {NULL, NULL, PREC_NONE},
-    [TOKEN_LEFT_BRACE] = {NULL, NULL, PREC_NONE},
-    [TOKEN_RIGHT_BRACE] = {NULL, NULL, PREC_NONE},
-    [TOKEN_SEMICOLON] = {NULL, NULL, PREC_NONE},
-    [TOKEN_PLUS] = {NULL, parse_binop_left, PREC_TERM},
-    [TOKEN_PLUS_EQUAL] = {NULL, parse_assignment, PREC_ASSIGNMENT},
-    [TOKEN_MINUS] = {parse_unary_op, parse_binop_left, PREC_TERM},
-    [TOKEN_MINUS_EQUAL] = {NULL, parse_assignment, PREC_ASSIGNMENT},
-    [TOKEN_STAR] = {NULL, parse_binop_left, PREC_FACTOR},
-    [TOKEN_STAR_EQUAL] = {NULL, parse_assignment, PREC_ASSIGNMENT},
-    [TOKEN_SLASH] = {NULL, parse_binop_left, PREC_FACTOR},
-    [TOKEN_SLASH_EQUAL] = {NULL, parse_assignment, PREC_ASSIGNMENT},
-    [TOKEN_PERCENT] = {NULL, parse_binop_left, PREC_FACTOR},
-    [TOKEN_PERCENT_EQUAL] = {NULL, parse_assignment, PREC_ASSIGNMENT},
-    [TOKEN_AMPERSAND] = {NULL, parse_binop_left, PREC_BITWISE_AND},
-    [TOKEN_AMPERSAND_EQUAL] = {NULL, parse_assignment, PREC_ASSIGNMENT},
-    [TOKEN_AMPERSAND_AMPERSAND] = {NULL, parse_binop_left, PREC_AND},
-    [TOKEN_BAR] = {NULL, parse_binop_left, PREC_BITWISE_OR},
-    [TOKEN_BAR_EQUAL] = {NULL, parse_assignment, PREC_ASSIGNMENT},
-    [TOKEN_BAR_BAR] = {NULL, parse_binop_left, PREC_OR},
-    [TOKEN_CARET] = {NULL, parse_binop_left, PREC_BITWISE_XOR},
-    [TOKEN_CARET_EQUAL] = {NULL, parse_assignment, PREC_ASSIGNMENT},
-    [TOKEN_EQUAL] = {NULL, parse_assignment, PREC_ASSIGNMENT},
-    [TOKEN_EQUAL_EQUAL] = {NULL, parse_binop_left, PREC_EQUALITY},
-    [TOKEN_NOT] = {parse_unary_op, NULL, PREC_UNARY},
-    [TOKEN_NOT_EQUAL] = {NULL, parse_binop_left, PREC_EQUALITY},
-    [TOKEN_LESS] = {NULL, parse_binop_left, PREC_COMPARISON},
-    [TOKEN_LESS_EQUAL] = {NULL, parse_binop_left, PREC_COMPARISON},
-    [TOKEN_LESS_LESS] = {NULL, parse_binop_left, PREC_SHIFT},
-    [TOKEN_LESS_LESS_EQUAL] = {NULL, parse_assignment, PREC_ASSIGNMENT},
-    [TOKEN_GREATER] = {NULL, parse_binop_left, PREC_COMPARISON},
-    [TOKEN_GREATER_EQUAL] = {NULL, parse_binop_left, PREC_COMPARISON},
-    [TOKEN_GREATER_GREATER] = {NULL, parse_binop_left, PREC_SHIFT},
-    [TOKEN_GREATER_GREATER_EQUAL] = {NULL, parse_assignment, PREC_ASSIGNMENT},
-    [TOKEN_QUESTION] = {NULL, parse_ternary, PREC_TERNARY},
-    [TOKEN_TILDE] = {parse_unary_op, NULL, PREC_TERM},
-    [TOKEN_KEYWORD_VOID] = {NULL, NULL, PREC_NONE},
-    [TOKEN_KEYWORD_INT] = {NULL, NULL, PREC_NONE},
-    [TOKEN_KEYWORD_RETURN] = {NULL, NULL, PREC_NONE},
-    [TOKEN_IDENTIFIER] = {parse_identifier_expr, NULL, PREC_NONE},
-    [TOKEN_INTEGER] = {parse_number_literal, NULL, PREC_NONE},
-    [TOKEN_ERROR] = {NULL, NULL, PREC_NONE},
-    [TOKEN_EOF] = {NULL, NULL, PREC_NONE},
+    [TOKEN_LEFT_PAREN] = {PREFIX_GROUP, INFIX_CALL, PREC_CALL},
+    [TOKEN_RIGHT_PAREN] = {PREFIX_NONE, INFIX_NONE, PREC_NONE},
+    [TOKEN_LEFT_BRACE] = {PREFIX_NONE, INFIX_NONE, PREC_NONE},
+    [TOKEN_RIGHT_BRACE] = {PREFIX_NONE, INFIX_NONE, PREC_NONE},
+    [TOKEN_SEMICOLON] = {PREFIX_NONE, INFIX_NONE, PREC_NONE},
+    [TOKEN_PLUS] = {PREFIX_NONE, INFIX_BINARY, PREC_TERM},
+    [TOKEN_PLUS_EQUAL] = {PREFIX_NONE, INFIX_ASSIGNMENT, PREC_ASSIGNMENT},
+    [TOKEN_MINUS] = {PREFIX_UNARY, INFIX_BINARY, PREC_TERM},
+    [TOKEN_MINUS_EQUAL] = {PREFIX_NONE, INFIX_ASSIGNMENT, PREC_ASSIGNMENT},
+    [TOKEN_STAR] = {PREFIX_NONE, INFIX_BINARY, PREC_FACTOR},
+    [TOKEN_STAR_EQUAL] = {PREFIX_NONE, INFIX_ASSIGNMENT, PREC_ASSIGNMENT},
+    [TOKEN_SLASH] = {PREFIX_NONE, INFIX_BINARY, PREC_FACTOR},
+    [TOKEN_SLASH_EQUAL] = {PREFIX_NONE, INFIX_ASSIGNMENT, PREC_ASSIGNMENT},
+    [TOKEN_PERCENT] = {PREFIX_NONE, INFIX_BINARY, PREC_FACTOR},
+    [TOKEN_PERCENT_EQUAL] = {PREFIX_NONE, INFIX_ASSIGNMENT, PREC_ASSIGNMENT},
+    [TOKEN_AMPERSAND] = {PREFIX_NONE, INFIX_BINARY, PREC_BITWISE_AND},
+    [TOKEN_AMPERSAND_EQUAL] = {PREFIX_NONE, INFIX_ASSIGNMENT, PREC_ASSIGNMENT},
+    [TOKEN_AMPERSAND_AMPERSAND] = {PREFIX_NONE, INFIX_BINARY, PREC_AND},
+    [TOKEN_BAR] = {PREFIX_NONE, INFIX_BINARY, PREC_BITWISE_OR},
+    [TOKEN_BAR_EQUAL] = {PREFIX_NONE, INFIX_ASSIGNMENT, PREC_ASSIGNMENT},
+    [TOKEN_BAR_BAR] = {PREFIX_NONE, INFIX_BINARY, PREC_OR},
+    [TOKEN_CARET] = {PREFIX_NONE, INFIX_BINARY, PREC_BITWISE_XOR},
+    [TOKEN_CARET_EQUAL] = {PREFIX_NONE, INFIX_ASSIGNMENT, PREC_ASSIGNMENT},
+    [TOKEN_EQUAL] = {PREFIX_NONE, INFIX_ASSIGNMENT, PREC_ASSIGNMENT},
+    [TOKEN_EQUAL_EQUAL] = {PREFIX_NONE, INFIX_BINARY, PREC_EQUALITY},
+    [TOKEN_NOT] = {PREFIX_UNARY, INFIX_NONE, PREC_NONE},
+    [TOKEN_NOT_EQUAL] = {PREFIX_NONE, INFIX_BINARY, PREC_EQUALITY},
+    [TOKEN_LESS] = {PREFIX_NONE, INFIX_BINARY, PREC_COMPARISON},
+    [TOKEN_LESS_EQUAL] = {PREFIX_NONE, INFIX_BINARY, PREC_COMPARISON},
+    [TOKEN_LESS_LESS] = {PREFIX_NONE, INFIX_BINARY, PREC_SHIFT},
+    [TOKEN_LESS_LESS_EQUAL] = {PREFIX_NONE, INFIX_ASSIGNMENT, PREC_ASSIGNMENT},
+    [TOKEN_GREATER] = {PREFIX_NONE, INFIX_BINARY, PREC_COMPARISON},
+    [TOKEN_GREATER_EQUAL] = {PREFIX_NONE, INFIX_BINARY, PREC_COMPARISON},
+    [TOKEN_GREATER_GREATER] = {PREFIX_NONE, INFIX_BINARY, PREC_SHIFT},
+    [TOKEN_GREATER_GREATER_EQUAL] = {PREFIX_NONE, INFIX_ASSIGNMENT,
+                                     PREC_ASSIGNMENT},
+    [TOKEN_QUESTION] = {PREFIX_NONE, INFIX_TERNARY, PREC_TERNARY},
+    [TOKEN_TILDE] = {PREFIX_UNARY, INFIX_NONE, PREC_NONE},
+    [TOKEN_KEYWORD_VOID] = {PREFIX_NONE, INFIX_NONE, PREC_NONE},
+    [TOKEN_KEYWORD_INT] = {PREFIX_NONE, INFIX_NONE, PREC_NONE},
+    [TOKEN_KEYWORD_RETURN] = {PREFIX_NONE, INFIX_NONE, PREC_NONE},
+    [TOKEN_IDENTIFIER] = {PREFIX_IDENTIFIER, INFIX_NONE, PREC_NONE},
+    [TOKEN_INTEGER] = {PREFIX_NUMBER, INFIX_NONE, PREC_NONE},
+    [TOKEN_ERROR] = {PREFIX_NONE, INFIX_NONE, PREC_NONE},
+    [TOKEN_EOF] = {PREFIX_NONE, INFIX_NONE, PREC_NONE},
 };
 
 _Static_assert(sizeof(rules) / sizeof(ParseRule) == TOKEN_TYPES_COUNT,
@@ -290,48 +665,30 @@ static ParseRule* get_rule(TokenTag operator_type)
   return &rules[operator_type];
 }
 
-static Expr* parse_precedence(Parser* parser, Precedence precedence,
-                              struct Scope* scope)
-{
-  parse_advance(parser);
-
-  const Token previous_token = parser_previous_token(parser);
-
-  const PrefixParseFn prefix_rule = get_rule(previous_token.tag)->prefix;
-  if (prefix_rule == NULL) {
-    parse_panic_at_token(parser, str("Expect valid expression"),
-                         previous_token);
-    Expr* error_expr = ARENA_ALLOC_OBJECT(parser->permanent_arena, Expr);
-    *error_expr = (Expr){
-        .tag = EXPR_INVALID,
-        .source_range = token_source_range(previous_token),
-    };
-    return error_expr;
-  }
-
-  Expr* expr = prefix_rule(parser, scope);
-
-  while (precedence <= get_rule(parser_current_token(parser).tag)->precedence) {
-    parse_advance(parser);
-    InfixParseFn infix_rule =
-        get_rule(parser_previous_token(parser).tag)->infix;
-    expr = infix_rule(parser, expr, scope);
-  }
-
-  return expr;
-}
-
-static Expr* parse_group(Parser* parser, struct Scope* scope)
-{
-  Expr* result = parse_expr(parser, scope);
-  parse_consume(parser, TOKEN_RIGHT_PAREN, "Expect )");
-  return result;
-}
+// Where a frame of the expression parser continues once the expression it
+// waits for is parsed
+typedef enum ExprParseStep : uint8_t {
+  EXPR_PARSE_PREFIX,        // nothing parsed yet
+  EXPR_PARSE_INFIX,         // lhs is parsed, look for an infix operator
+  EXPR_PARSE_GROUP_END,     // `( expr`
+  EXPR_PARSE_UNARY_END,     // `op expr`
+  EXPR_PARSE_BINARY_END,    // `lhs op expr`
+  EXPR_PARSE_TERNARY_COLON, // `lhs ? expr`
+  EXPR_PARSE_TERNARY_END,   // `lhs ? true_expr : expr`
+  EXPR_PARSE_CALL_ARG,      // `lhs(args..., expr`
+} ExprParseStep;
+
+typedef struct ExprParseFrame {
+  ExprParseStep step;
+  Precedence precedence;
+  Token operator_token;
+  ExprId lhs;
+  ExprId true_expr;
+  uint32_t first_arg; // index of the first argument in pending_args
+} ExprParseFrame;
 
-static Expr* parse_unary_op(Parser* parser, Scope* scope)
+static ExprId make_unary_op(Parser* parser, Token operator_token, ExprId expr)
 {
-  Token operator_token = parser_previous_token(parser);
-
   UnaryOpType operator_type;
   switch (operator_token.tag) {
   case TOKEN_MINUS: operator_type = UNARY_OP_NEGATION; break;
@@ -340,25 +697,14 @@ static Expr* parse_unary_op(Parser* parser, Scope* scope)
   default: MCC_UNREACHABLE();
   }
 
-  // Inner expression
-  Expr* expr = parse_precedence(parser, PREC_UNARY, scope);
-
   // TODO: type check
 
   // build result
-  // TODO: better way to handle the case where expr == NULL
-  SourceRange result_source_range =
-      expr == NULL ? token_source_range(operator_token)
-                   : source_range_union(token_source_range(operator_token),
-                                        expr->source_range);
-
-  Expr* result = ARENA_ALLOC_OBJECT(parser->permanent_arena, Expr);
-  *result = (Expr){.tag = EXPR_UNARY,
-                   .source_range = result_source_range,
-                   .unary_op = (struct UnaryOpExpr){
-                       .unary_op_type = operator_type, .inner_expr = expr}};
+  const SourceRange result_source_range = source_range_union(
+      token_source_range(operator_token), expr_source_range(parser, expr));
 
-  return result;
+  return push_expr(parser, EXPR_UNARY, operator_type,
+                   (ExprData){.inner_expr = expr}, result_source_range);
 }
 
 static BinaryOpType binop_type_from_token_type(TokenTag token_type)
@@ -397,123 +743,205 @@ static BinaryOpType binop_type_from_token_type(TokenTag token_type)
   }
 }
 
-enum Associativity { ASSOCIATIVITY_LEFT, ASSOCIATIVITY_RIGHT };
-
-static Expr* parse_binary_op(Parser* parser, Expr* lhs_expr,
-                             enum Associativity associativity, Scope* scope)
+static ExprId make_binary_op(Parser* parser, ExprId lhs_expr,
+                             Token operator_token, ExprId rhs_expr)
 {
-  Token operator_token = parser_previous_token(parser);
-
-  const TokenTag operator_type = operator_token.tag;
-  const ParseRule* rule = get_rule(operator_type);
-  Expr* rhs_expr = parse_precedence(
-      parser,
-      (Precedence)(rule->precedence +
-                   ((associativity == ASSOCIATIVITY_LEFT) ? 1 : 0)),
-      scope);
-
-  BinaryOpType binary_op_type = binop_type_from_token_type(operator_type);
+  BinaryOpType binary_op_type = binop_type_from_token_type(operator_token.tag);
 
   // TODO: type check
 
   // build result
-  const SourceRange result_source_range =
-      source_range_union(source_range_union(token_source_range(operator_token),
-                                            lhs_expr->source_range),
-                         rhs_expr->source_range);
-
-  Expr* result = ARENA_ALLOC_OBJECT(parser->permanent_arena, Expr);
-  *result = (Expr){.tag = EXPR_BINARY,
-                   .source_range = result_source_range,
-                   .binary_op = (struct BinaryOpExpr){
-                       .binary_op_type = binary_op_type,
-                       .lhs = lhs_expr,
-                       .rhs = rhs_expr,
-                   }};
-  return result;
+  const SourceRange result_source_range = source_range_union(
+      source_range_union(token_source_range(operator_token),
+                         expr_source_range(parser, lhs_expr)),
+      expr_source_range(parser, rhs_expr));
+
+  return push_expr(
+      parser, EXPR_BINARY, binary_op_type,
+      (ExprData){.binary_op = {.lhs = lhs_expr, .rhs = rhs_expr}},
+      result_source_range);
 }
 
-static Expr* parse_binop_left(Parser* parser, Expr* lhs_expr, Scope* scope)
+static ExprId make_ternary(Parser* parser, ExprId cond, ExprId true_expr,
+                           ExprId false_expr)
 {
-  return parse_binary_op(parser, lhs_expr, ASSOCIATIVITY_LEFT, scope);
+  const uint32_t ternary = parser->nodes.ternaries.length;
+  const struct TernaryExpr node = {
+      .cond = cond, .true_expr = true_expr, .false_expr = false_expr};
+  PUSH_NODE(parser, ternaries, node);
+
+  return push_expr(parser, EXPR_TERNARY, 0, (ExprData){.ternary = ternary},
+                   source_range_union(expr_source_range(parser, cond),
+                                      expr_source_range(parser, false_expr)));
 }
 
-static Expr* parse_assignment(Parser* parser, Expr* lhs_expr, Scope* scope)
+// Builds a call from the arguments on top of the argument stack, starting at
+// first_arg, and pops them
+static ExprId make_function_call(Parser* parser, ExprId function,
+                                 uint32_t first_arg)
 {
-  // Check whether the left hand side is lvalue
-  if (lhs_expr->tag != EXPR_VARIABLE) {
-    parse_error_at(parser, str("expression is not assignable"),
-                   lhs_expr->source_range);
+  const struct ExprVec* pending_args = &parser->pending_args;
+  const uint32_t arg_count = pending_args->length - first_arg;
+
+  // Arguments of nested calls are already in place, so the arguments of this
+  // call end up consecutive
+  const uint32_t call = parser->nodes.calls.length;
+  const struct CallExpr node = {
+      .function = function,
+      .arg_count = arg_count,
+      .first_arg = parser->nodes.call_args.length,
+  };
+  PUSH_NODE(parser, calls, node);
+  for (uint32_t i = first_arg; i < pending_args->length; ++i) {
+    PUSH_NODE(parser, call_args, pending_args->data[i]);
   }
-  return parse_binary_op(parser, lhs_expr, ASSOCIATIVITY_RIGHT, scope);
+  parser->pending_args.length = first_arg;
+
+  return push_expr(parser, EXPR_CALL, 0, (ExprData){.call = call},
+                   source_range_union(
+                       expr_source_range(parser, function),
+                       token_source_range(parser_previous_token(parser))));
 }
 
-static Expr* parse_ternary(Parser* parser, Expr* cond, struct Scope* scope)
+static void push_expr_parse_frame(Parser* parser, Precedence precedence)
 {
-  Expr* true_expr = parse_expr(parser, scope);
-  parse_consume(parser, TOKEN_COLON, "expect ':'");
-  Expr* false_expr = parse_precedence(parser, PREC_TERNARY, scope);
-
-  Expr* result = ARENA_ALLOC_OBJECT(parser->permanent_arena, Expr);
-  *result = (Expr){.tag = EXPR_TERNARY,
-                   .source_range = source_range_union(cond->source_range,
-                                                      false_expr->source_range),
-                   .ternary = (struct TernaryExpr){.cond = cond,
-                                                   .true_expr = true_expr,
-                                                   .false_expr = false_expr}};
-  return result;
+  const ExprParseFrame frame = {.step = EXPR_PARSE_PREFIX,
+                                .precedence = precedence};
+  VECTOR_PUSH_BACK(&parser->expr_frames, ExprParseFrame, frame);
 }
 
-struct ExprVec {
-  size_t length;
-  size_t capacity;
-  Expr** data;
-};
-
-static struct ExprVec parse_arg_list(Parser* parser, Scope* scope)
+// Pratt parser. Instead of recursing for operands, it pushes a frame for them
+// onto an explicit stack, so arbitrarily deep expressions only cost heap
+// memory. Each frame continues where the recursive parser would have resumed
+// after parsing the operand, which is always the most recently completed
+// expression
+static ExprId parse_precedence(Parser* parser, Precedence precedence,
+                               struct Scope* scope)
 {
-  struct ExprVec args_vec = {};
-  if (!token_match_or_eof(parser, TOKEN_RIGHT_PAREN)) {
-    // first arg
-    DYNARRAY_PUSH_BACK(&args_vec, Expr*, &parser->scratch_arena,
-                       parse_expr(parser, scope));
+  struct ExprParseFrameVec* frames = &parser->expr_frames;
+  const uint32_t base = frames->length;
+  push_expr_parse_frame(parser, precedence);
 
-    while (!token_match_or_eof(parser, TOKEN_RIGHT_PAREN)) {
-      parse_consume(parser, TOKEN_COMMA, "expect ','");
-      DYNARRAY_PUSH_BACK(&args_vec, Expr*, &parser->scratch_arena,
-                         parse_expr(parser, scope));
-    }
-  }
-
-  parse_consume(parser, TOKEN_RIGHT_PAREN,
-                "expect ')' at the end of a function call");
-  return args_vec;
-}
+  ExprId operand = NO_EXPR;
+  while (true) {
+    ExprParseFrame* frame = &frames->data[frames->length - 1];
 
-static Expr* parse_function_call(Parser* parser, Expr* function, Scope* scope)
-{
-  struct ExprVec args_vec = parse_arg_list(parser, scope);
-  const uint32_t arg_count = u32_from_usize(args_vec.length);
+    switch (frame->step) {
+    case EXPR_PARSE_PREFIX: {
+      parse_advance(parser);
+      const Token previous_token = parser_previous_token(parser);
+
+      frame->step = EXPR_PARSE_INFIX;
+      switch (get_rule(previous_token.tag)->prefix) {
+      case PREFIX_NONE:
+        parse_panic_at_token(parser, str("Expect valid expression"),
+                             previous_token);
+        frame->lhs = push_expr(parser, EXPR_INVALID, 0, (ExprData){},
+                               token_source_range(previous_token));
+        break;
+      case PREFIX_NUMBER:
+        frame->lhs = parse_number_literal(parser, scope);
+        break;
+      case PREFIX_IDENTIFIER:
+        frame->lhs = parse_identifier_expr(parser, scope);
+        break;
+      case PREFIX_GROUP:
+        frame->step = EXPR_PARSE_GROUP_END;
+        push_expr_parse_frame(parser, PREC_ASSIGNMENT);
+        break;
+      case PREFIX_UNARY:
+        frame->step = EXPR_PARSE_UNARY_END;
+        frame->operator_token = previous_token;
+        push_expr_parse_frame(parser, PREC_UNARY);
+        break;
+      }
+    } break;
+    case EXPR_PARSE_INFIX: {
+      const ParseRule* rule = get_rule(parser_current_token(parser).tag);
+      if (frame->precedence > rule->precedence) {
+        operand = frame->lhs;
+        --frames->length;
+        if (frames->length == base) { return operand; }
+        break;
+      }
 
-  Expr** args = ARENA_ALLOC_ARRAY(parser->permanent_arena, Expr*, arg_count);
-  if (args_vec.length != 0) {
-    memcpy(args, args_vec.data, args_vec.length * sizeof(Expr*));
+      parse_advance(parser);
+      const Token operator_token = parser_previous_token(parser);
+      switch (rule->infix) {
+      case INFIX_NONE: MCC_UNREACHABLE();
+      case INFIX_BINARY:
+        frame->step = EXPR_PARSE_BINARY_END;
+        frame->operator_token = operator_token;
+        push_expr_parse_frame(parser, (Precedence)(rule->precedence + 1));
+        break;
+      case INFIX_ASSIGNMENT:
+        // Check whether the left hand side is lvalue
+        if (parser->nodes.exprs.tags[frame->lhs] != EXPR_VARIABLE) {
+          parse_error_at(parser, str("expression is not assignable"),
+                         expr_source_range(parser, frame->lhs));
+        }
+        frame->step = EXPR_PARSE_BINARY_END;
+        frame->operator_token = operator_token;
+        push_expr_parse_frame(parser, rule->precedence);
+        break;
+      case INFIX_TERNARY:
+        frame->step = EXPR_PARSE_TERNARY_COLON;
+        push_expr_parse_frame(parser, PREC_ASSIGNMENT);
+        break;
+      case INFIX_CALL:
+        frame->first_arg = parser->pending_args.length;
+        if (token_match_or_eof(parser, TOKEN_RIGHT_PAREN)) {
+          parse_consume(parser, TOKEN_RIGHT_PAREN,
+                        "expect ')' at the end of a function call");
+          frame->lhs = make_function_call(parser, frame->lhs, frame->first_arg);
+        } else {
+          frame->step = EXPR_PARSE_CALL_ARG;
+          push_expr_parse_frame(parser, PREC_ASSIGNMENT);
+        }
+        break;
+      }
+    } break;
+    case EXPR_PARSE_GROUP_END:
+      parse_consume(parser, TOKEN_RIGHT_PAREN, "Expect )");
+      frame->step = EXPR_PARSE_INFIX;
+      frame->lhs = operand;
+      break;
+    case EXPR_PARSE_UNARY_END:
+      frame->step = EXPR_PARSE_INFIX;
+      frame->lhs = make_unary_op(parser, frame->operator_token, operand);
+      break;
+    case EXPR_PARSE_BINARY_END:
+      frame->step = EXPR_PARSE_INFIX;
+      frame->lhs =
+          make_binary_op(parser, frame->lhs, frame->operator_token, operand);
+      break;
+    case EXPR_PARSE_TERNARY_COLON:
+      parse_consume(parser, TOKEN_COLON, "expect ':'");
+      frame->step = EXPR_PARSE_TERNARY_END;
+      frame->true_expr = operand;
+      push_expr_parse_frame(parser, PREC_TERNARY);
+      break;
+    case EXPR_PARSE_TERNARY_END:
+      frame->step = EXPR_PARSE_INFIX;
+      frame->lhs = make_ternary(parser, frame->lhs, frame->true_expr, operand);
+      break;
+    case EXPR_PARSE_CALL_ARG:
+      VECTOR_PUSH_BACK(&parser->pending_args, ExprId, operand);
+      if (!token_match_or_eof(parser, TOKEN_RIGHT_PAREN)) {
+        parse_consume(parser, TOKEN_COMMA, "expect ','");
+        push_expr_parse_frame(parser, PREC_ASSIGNMENT);
+      } else {
+        parse_consume(parser, TOKEN_RIGHT_PAREN,
+                      "expect ')' at the end of a function call");
+        frame->step = EXPR_PARSE_INFIX;
+        frame->lhs = make_function_call(parser, frame->lhs, frame->first_arg);
+      }
+      break;
+    }
   }
-
-  Expr* expr = ARENA_ALLOC_OBJECT(parser->permanent_arena, Expr);
-  *expr = (Expr){.tag = EXPR_CALL,
-                 .source_range = source_range_union(
-                     function->source_range,
-                     token_source_range(parser_previous_token(parser))),
-                 .call = {
-                     .function = function,
-                     .arg_count = arg_count,
-                     .args = args,
-                 }};
-  return expr;
 }
 
-static Expr* parse_expr(Parser* parser, Scope* scope)
+static ExprId parse_expr(Parser* parser, Scope* scope)
 {
   return parse_precedence(parser, PREC_ASSIGNMENT, scope);
 }
@@ -521,18 +949,34 @@ static Expr* parse_expr(Parser* parser, Scope* scope)
 
 #pragma region Statement/declaration parsing
 
-static Stmt parse_stmt(Parser* parser, struct Scope* scope);
+static StmtId parse_stmt(Parser* parser, struct Scope* scope);
+
+// Statements are parsed recursively, and so are they walked in the later
+// phases. Bounding how deeply they nest bounds the stack use of all of them
+enum { MAX_NESTING_DEPTH = 1024 };
+
+// Returns false and reports an error if one more level nests too deeply
+static bool parse_enter_nesting(Parser* parser)
+{
+  if (parser->nesting_depth >= MAX_NESTING_DEPTH) {
+    parse_panic_at_token(parser, str("statement nested too deeply"),
+                         parser_current_token(parser));
+    return false;
+  }
+  ++parser->nesting_depth;
+  return true;
+}
 
-static struct ReturnStmt parse_return_stmt(Parser* parser, Scope* scope)
+static ExprId parse_return_stmt(Parser* parser, Scope* scope)
 {
-  Expr* expr = parse_expr(parser, scope);
+  const ExprId expr = parse_expr(parser, scope);
   parse_consume(parser, TOKEN_SEMICOLON, "Expect ;");
-  return (struct ReturnStmt){.expr = expr};
+  return expr;
 }
 
 struct BlockItemVec {
-  size_t capacity;
-  size_t length;
+  uint32_t capacity;
+  uint32_t length;
   BlockItem* data;
 };
 
@@ -621,22 +1065,30 @@ static FunctionDecl* parse_function_decl(Parser* parser,
                                          DeclSpecifier decl_specifier,
                                          Token name_token, struct Scope* scope);
 
-static VariableDecl parse_variable_decl(Parser* parser,
-                                        DeclSpecifier decl_specifier,
-                                        Token name_token, struct Scope* scope)
+static VariableDeclId parse_variable_decl(Parser* parser,
+                                          DeclSpecifier decl_specifier,
+                                          Token name_token,
+                                          struct Scope* scope)
 {
-  const StringView name = str_from_token(parser->src, name_token);
+  // Shadowing interns a fresh name for the variable
+  if (parser->bail != nullptr &&
+      lookup_identifier(scope, name_token.value) != nullptr) {
+    bail_out_of_body(parser);
+  }
+
   // TODO: handle different linkages
-  IdentifierInfo* variable = add_identifier(
-      scope, name, IDENT_OBJECT, LINKAGE_NONE, parser->permanent_arena);
+  IdentifierInfo* variable =
+      add_identifier(scope, name_token.value, IDENT_OBJECT, LINKAGE_NONE,
+                     parser->interner, parser->permanent_arena);
   if (!variable) {
+    const StringView name = str_from_token(parser->src, name_token);
     const StringView error_msg =
         allocate_printf(parser->permanent_arena, "redefinition of '%.*s'",
                         (int)name.size, name.start);
     parse_error_at(parser, error_msg, token_source_range(name_token));
   }
 
-  Expr* initializer = nullptr;
+  ExprId initializer = NO_EXPR;
   if (parser_current_token(parser).tag == TOKEN_EQUAL) {
     parse_advance(parser);
     initializer = parse_expr(parser, scope);
@@ -644,10 +1096,13 @@ static VariableDecl parse_variable_decl(Parser* parser,
   parse_consume(parser, TOKEN_SEMICOLON, "expect ';'");
 
   // TODO: handle the case where variable == nullptr
-  return (VariableDecl){.type = decl_specifier.type,
-                        .storage_class = decl_specifier.storage_class,
-                        .name = variable,
-                        .initializer = initializer};
+  const VariableDeclId id = parser->nodes.variable_decls.length;
+  const VariableDecl decl = {.type = decl_specifier.type,
+                             .storage_class = decl_specifier.storage_class,
+                             .name = variable,
+                             .initializer = initializer};
+  PUSH_NODE(parser, variable_decls, decl);
+  return id;
 }
 
 static Decl parse_decl(Parser* parser, struct Scope* scope)
@@ -678,7 +1133,7 @@ static void parser_panic_synchronize(Parser* parser)
         current_token_type == TOKEN_EOF) {
       break;
     }
-    parser->current_token_index++;
+    parser_next_token_index(parser);
   }
 }
 
@@ -726,114 +1181,157 @@ static Block parse_block(Parser* parser, Scope* scope)
   }
   parse_consume(parser, TOKEN_RIGHT_BRACE, "Expect `}`");
 
-  BlockItem* block_items =
-      ARENA_ALLOC_ARRAY(parser->permanent_arena, BlockItem, items_vec.length);
-  if (items_vec.length != 0) {
-    memcpy(block_items, items_vec.data, items_vec.length * sizeof(BlockItem));
+  // Items of nested blocks are already in place, so the items of this block
+  // end up consecutive
+  const Block block = {
+      .first_child = parser->nodes.block_items.length,
+      .child_count = items_vec.length,
+  };
+  for (uint32_t i = 0; i < items_vec.length; ++i) {
+    PUSH_NODE(parser, block_items, items_vec.data[i]);
   }
-
-  return (Block){.children = block_items, .child_count = items_vec.length};
+  return block;
 }
 
-struct IfStmt parse_if_stmt(Parser* parser, Scope* scope)
+// An if statement of an `else if` ladder whose statement is created once the
+// rest of the ladder is parsed
+typedef struct IfChainLink {
+  Token start_token;
+  uint32_t if_then;
+} IfChainLink;
+
+// Ladders of `else if` can be arbitrarily long, so they are parsed in a loop
+// instead of recursively. Returns the first if of the ladder
+static uint32_t parse_if_stmt(Parser* parser, Scope* scope)
 {
-  parse_consume(parser, TOKEN_LEFT_PAREN, "expect '('");
-  Expr* cond = parse_expr(parser, scope);
-  parse_consume(parser, TOKEN_RIGHT_PAREN, "expect ')'");
+  struct IfChainVec* chain = &parser->if_chain;
+  const uint32_t base = chain->length;
 
-  Stmt* then = ARENA_ALLOC_OBJECT(parser->permanent_arena, Stmt);
-  *then = parse_stmt(parser, scope);
+  Token start_token = parser_previous_token(parser);
+  while (true) {
+    parse_consume(parser, TOKEN_LEFT_PAREN, "expect '('");
+    const ExprId cond = parse_expr(parser, scope);
+    parse_consume(parser, TOKEN_RIGHT_PAREN, "expect ')'");
 
-  Stmt* els = nullptr;
-  if (parser_current_token(parser).tag == TOKEN_KEYWORD_ELSE) {
+    const StmtId then = parse_stmt(parser, scope);
+
+    const uint32_t if_then = parser->nodes.ifs.length;
+    const struct IfStmt node = {
+        .cond = cond,
+        .then = then,
+        .els = NO_STMT,
+    };
+    PUSH_NODE(parser, ifs, node);
+    const IfChainLink link = {.start_token = start_token, .if_then = if_then};
+    VECTOR_PUSH_BACK(chain, IfChainLink, link);
+
+    if (parser_current_token(parser).tag != TOKEN_KEYWORD_ELSE) { break; }
     parse_advance(parser);
 
-    els = ARENA_ALLOC_OBJECT(parser->permanent_arena, Stmt);
-    *els = parse_stmt(parser, scope);
+    if (parser_current_token(parser).tag != TOKEN_KEYWORD_IF) {
+      const StmtId els = parse_stmt(parser, scope);
+      parser->nodes.ifs.data[if_then].els = els;
+      break;
+    }
+    start_token = parser_current_token(parser);
+    parse_advance(parser);
   }
 
-  return (struct IfStmt){
-      .cond = cond,
-      .then = then,
-      .els = els,
-  };
+  // Every if of the ladder ends where the ladder ends. The statements are
+  // created from the innermost outwards, the caller creates the outermost
+  const SourceRange end = token_source_range(parser_previous_token(parser));
+  for (uint32_t i = chain->length - 1; i > base; --i) {
+    const IfChainLink link = chain->data[i];
+    const StmtId stmt = push_stmt(
+        parser, STMT_IF, (StmtData){.if_then = link.if_then},
+        source_range_union(token_source_range(link.start_token), end));
+    parser->nodes.ifs.data[chain->data[i - 1].if_then].els = stmt;
+  }
+
+  const uint32_t first_if_then = chain->data[base].if_then;
+  chain->length = base;
+  return first_if_then;
 }
 
-static Stmt parse_stmt(Parser* parser, Scope* scope)
+static StmtId parse_stmt(Parser* parser, Scope* scope)
 {
   const Token start_token = parser_current_token(parser);
+  if (!parse_enter_nesting(parser)) {
+    return push_stmt(parser, STMT_EMPTY, (StmtData){},
+                     token_source_range(start_token));
+  }
 
-  Stmt result;
+  StmtTag tag;
+  StmtData data = {};
 
   switch (start_token.tag) {
   case TOKEN_SEMICOLON: {
     parse_advance(parser);
 
-    result = (Stmt){.tag = STMT_EMPTY};
+    tag = STMT_EMPTY;
     break;
   }
 
   case TOKEN_KEYWORD_RETURN: {
     parse_advance(parser);
 
-    struct ReturnStmt return_stmt = parse_return_stmt(parser, scope);
-    result = (Stmt){.tag = STMT_RETURN, .ret = return_stmt};
+    tag = STMT_RETURN;
+    data.expr = parse_return_stmt(parser, scope);
     break;
   }
   case TOKEN_KEYWORD_BREAK: {
     parse_advance(parser);
     parse_consume(parser, TOKEN_SEMICOLON, "expect ';'");
 
-    result = (Stmt){.tag = STMT_BREAK};
+    tag = STMT_BREAK;
     break;
   }
   case TOKEN_KEYWORD_CONTINUE: {
     parse_advance(parser);
     parse_consume(parser, TOKEN_SEMICOLON, "expect ';'");
 
-    result = (Stmt){.tag = STMT_CONTINUE};
+    tag = STMT_CONTINUE;
     break;
   }
   case TOKEN_LEFT_BRACE: {
     parse_advance(parser);
 
     Scope* block_scope = new_scope(scope, parser->permanent_arena);
-    const Block compound = parse_block(parser, block_scope);
-    result = (Stmt){.tag = STMT_COMPOUND, .compound = compound};
+    tag = STMT_COMPOUND;
+    data.compound = parse_block(parser, block_scope);
+    exit_scope(block_scope);
     break;
   }
   case TOKEN_KEYWORD_IF: {
     parse_advance(parser);
-    const struct IfStmt if_then = parse_if_stmt(parser, scope);
 
-    result = (Stmt){.tag = STMT_IF, .if_then = if_then};
+    tag = STMT_IF;
+    data.if_then = parse_if_stmt(parser, scope);
     break;
   }
   case TOKEN_KEYWORD_WHILE: {
     parse_advance(parser);
     parse_consume(parser, TOKEN_LEFT_PAREN, "expect '('");
-    Expr* cond = parse_expr(parser, scope);
+    const ExprId cond = parse_expr(parser, scope);
     parse_consume(parser, TOKEN_RIGHT_PAREN, "expect ')'");
 
-    Stmt* body = ARENA_ALLOC_OBJECT(parser->permanent_arena, Stmt);
-    *body = parse_stmt(parser, scope);
-    result =
-        (Stmt){.tag = STMT_WHILE, .while_loop = {.cond = cond, .body = body}};
+    const StmtId body = parse_stmt(parser, scope);
+    tag = STMT_WHILE;
+    data.while_loop = (struct While){.cond = cond, .body = body};
     break;
   }
   case TOKEN_KEYWORD_DO: {
     parse_advance(parser);
-    Stmt* body = ARENA_ALLOC_OBJECT(parser->permanent_arena, Stmt);
-    *body = parse_stmt(parser, scope);
+    const StmtId body = parse_stmt(parser, scope);
     parse_consume(parser, TOKEN_KEYWORD_WHILE, "expect \"while\"");
 
     parse_consume(parser, TOKEN_LEFT_PAREN, "expect '('");
-    Expr* cond = parse_expr(parser, scope);
+    const ExprId cond = parse_expr(parser, scope);
     parse_consume(parser, TOKEN_RIGHT_PAREN, "expect ')'");
     parse_consume(parser, TOKEN_SEMICOLON,
                   "expect ';' after do/while statement");
-    result = (Stmt){.tag = STMT_DO_WHILE,
-                    .while_loop = {.cond = cond, .body = body}};
+    tag = STMT_DO_WHILE;
+    data.while_loop = (struct While){.cond = cond, .body = body};
     break;
   }
   case TOKEN_KEYWORD_FOR: {
@@ -841,12 +1339,14 @@ static Stmt parse_stmt(Parser* parser, Scope* scope)
     parse_consume(parser, TOKEN_LEFT_PAREN, "expect '('");
 
     // init
+    Scope* for_scope = nullptr;
     ForInit init = {};
     switch (parser_current_token(parser).tag) {
       // TODO: handle cases other than int
     case TOKEN_KEYWORD_INT: {
       // for loop introduce a new scope
-      scope = new_scope(scope, parser->permanent_arena);
+      for_scope = new_scope(scope, parser->permanent_arena);
+      scope = for_scope;
 
       // TODO: fix this
       const DeclSpecifier specifier = {
@@ -855,15 +1355,14 @@ static Stmt parse_stmt(Parser* parser, Scope* scope)
       };
 
       parse_advance(parser);
-      VariableDecl* decl =
-          ARENA_ALLOC_OBJECT(parser->permanent_arena, VariableDecl);
 
       const Token name_token = parse_identifier(parser);
-      *decl = parse_variable_decl(parser, specifier, name_token, scope);
+      const VariableDeclId decl =
+          parse_variable_decl(parser, specifier, name_token, scope);
       init = (ForInit){.tag = FOR_INIT_DECL, .decl = decl};
     } break;
     case TOKEN_SEMICOLON: {
-      init = (ForInit){.tag = FOR_INIT_EXPR, .expr = nullptr};
+      init = (ForInit){.tag = FOR_INIT_EXPR, .expr = NO_EXPR};
       parse_consume(parser, TOKEN_SEMICOLON, "expect ';'");
     } break;
     default: {
@@ -873,41 +1372,44 @@ static Stmt parse_stmt(Parser* parser, Scope* scope)
     }
 
     // cond
-    Expr* cond = parser_current_token(parser).tag == TOKEN_SEMICOLON
-                     ? nullptr
-                     : parse_expr(parser, scope);
+    const ExprId cond = parser_current_token(parser).tag == TOKEN_SEMICOLON
+                            ? NO_EXPR
+                            : parse_expr(parser, scope);
     parse_consume(parser, TOKEN_SEMICOLON, "expect ';'");
 
     // post
-    Expr* post = parser_current_token(parser).tag == TOKEN_RIGHT_PAREN
-                     ? nullptr
-                     : parse_expr(parser, scope);
+    const ExprId post = parser_current_token(parser).tag == TOKEN_RIGHT_PAREN
+                            ? NO_EXPR
+                            : parse_expr(parser, scope);
     parse_consume(parser, TOKEN_RIGHT_PAREN, "expect ')'");
 
-    Stmt* body = ARENA_ALLOC_OBJECT(parser->permanent_arena, Stmt);
-    *body = parse_stmt(parser, scope);
-    result = (Stmt){.tag = STMT_FOR,
-                    .for_loop = {
-                        .init = init,
-                        .cond = cond,
-                        .post = post,
-                        .body = body,
-                    }};
+    const StmtId body = parse_stmt(parser, scope);
+    if (for_scope != nullptr) { exit_scope(for_scope); }
 
+    tag = STMT_FOR;
+    data.for_loop = parser->nodes.for_loops.length;
+    const struct For node = {
+        .init = init,
+        .cond = cond,
+        .post = post,
+        .body = body,
+    };
+    PUSH_NODE(parser, for_loops, node);
     break;
   }
   default: {
-    Expr* expr = parse_expr(parser, scope);
+    tag = STMT_EXPR;
+    data.expr = parse_expr(parser, scope);
     parse_consume(parser, TOKEN_SEMICOLON, "expect ';'");
-    result = (Stmt){.tag = STMT_EXPR, .expr = expr};
     break;
   }
   }
 
-  result.source_range =
+  --parser->nesting_depth;
+  return push_stmt(
+      parser, tag, data,
       source_range_union(token_source_range(start_token),
-                         token_source_range(parser_previous_token(parser)));
-  return result;
+                         token_source_range(parser_previous_token(parser))));
 }
 
 struct ParameterVec {
@@ -931,14 +1433,17 @@ static IdentifierInfo* parse_parameter(Parser* parser, Scope* scope)
     parse_advance(parser);
 
     const Token identifier_token = parser_current_token(parser);
-    StringView identifier = {};
+    SymbolId identifier = 0;
     if (identifier_token.tag == TOKEN_IDENTIFIER) {
-      identifier = str_from_token(parser->src, identifier_token);
+      identifier = identifier_token.value;
       parse_advance(parser);
+    } else {
+      identifier = intern(parser->interner, (StringView){});
     }
 
-    IdentifierInfo* name = add_identifier(
-        scope, identifier, IDENT_OBJECT, LINKAGE_NONE, parser->permanent_arena);
+    IdentifierInfo* name =
+        add_identifier(scope, identifier, IDENT_OBJECT, LINKAGE_NONE,
+                       parser->interner, parser->permanent_arena);
     // TODO: error handling
     MCC_ASSERT(name != nullptr);
     return name;
@@ -1001,42 +1506,98 @@ static Parameters parse_parameter_list(Parser* parser, Scope* scope)
   };
 }
 
+// Finds the token after the `}` that matches the `{` at the current token.
+// Returns false if the braces are unbalanced
+static bool find_body_end(const Parser* parser, uint32_t* end)
+{
+  const TokenTag* token_types = parser->tokens.token_types;
+  uint32_t depth = 0;
+  for (uint32_t i = parser->current_token_index;; ++i) {
+    switch (token_types[i]) {
+    case TOKEN_LEFT_BRACE: ++depth; break;
+    case TOKEN_RIGHT_BRACE:
+      if (--depth == 0) {
+        *end = i + 1;
+        return true;
+      }
+      break;
+    case TOKEN_EOF: return false;
+    default: break;
+    }
+  }
+}
+
+// Skips the body of a top-level function and records where it is. Unbalanced
+// bodies are not skipped, so that parsing them reports the error
+static SkimmedBody* skim_body(Parser* parser)
+{
+  uint32_t end = 0;
+  if (!find_body_end(parser, &end)) { return nullptr; }
+
+  SkimmedBody* body = ARENA_ALLOC_OBJECT(&parser->scratch_arena, SkimmedBody);
+  *body = (SkimmedBody){
+      .begin_token = parser->current_token_index,
+      .end_token = end,
+      .visible_file_scope_count =
+          file_scope_declaration_count(parser->global_scope),
+  };
+  DYNARRAY_PUSH_BACK(&parser->all_skimmed_bodies, SkimmedBody*,
+                     &parser->scratch_arena, body);
+
+  // Moves past the `}` as if it was parsed
+  parser->current_token_index = end - 1;
+  parse_advance(parser);
+  return body;
+}
+
 static FunctionDecl* parse_function_decl(Parser* parser,
                                          DeclSpecifier decl_specifier,
                                          Token name_token, Scope* scope)
 {
-  StringView name = str_from_token(parser->src, name_token);
-  IdentifierInfo* function_ident = add_identifier(
-      scope, name, IDENT_FUNCTION, LINKAGE_EXTERNAL, parser->permanent_arena);
+  // Functions are checked against their first declaration, which must be
+  // checked in source order
+  bail_out_of_body(parser);
+
+  const SymbolId name = name_token.value;
+  IdentifierInfo* function_ident =
+      add_identifier(scope, name, IDENT_FUNCTION, LINKAGE_EXTERNAL,
+                     parser->interner, parser->permanent_arena);
 
   if (!function_ident) {
     function_ident = lookup_identifier(scope, name);
     MCC_ASSERT(function_ident != nullptr);
     if (function_ident->kind != IDENT_FUNCTION) {
+      const StringView spelling = str_from_token(parser->src, name_token);
       const StringView error_msg =
           allocate_printf(parser->permanent_arena,
                           "redefinition of '%.*s' as different kind of symbol",
-                          (int)name.size, name.start);
+                          (int)spelling.size, spelling.start);
       parse_error_at(parser, error_msg, token_source_range(name_token));
     }
   }
 
-  hashmap_try_insert(&parser->functions, name, function_ident,
-                     parser->permanent_arena);
-
   Scope* function_scope =
       new_scope(parser->global_scope, parser->permanent_arena);
   const Parameters parameters = parse_parameter_list(parser, function_scope);
 
   Block* body = NULL;
+  SkimmedBody* skimmed_body = nullptr;
 
   if (parser_current_token(parser).tag == TOKEN_LEFT_BRACE) { // is definition
-    parse_advance(parser);
-    body = ARENA_ALLOC_OBJECT(parser->permanent_arena, Block);
-    *body = parse_block(parser, function_scope);
+    if (parser->body_parsing != PARSE_BODIES_INLINE &&
+        scope == parser->global_scope &&
+        (skimmed_body = skim_body(parser)) != nullptr) {
+      // Parsed later, if reachable
+    } else if (parse_enter_nesting(parser)) {
+      parse_advance(parser);
+      body = ARENA_ALLOC_OBJECT(parser->permanent_arena, Block);
+      *body = parse_block(parser, function_scope);
+      --parser->nesting_depth;
+    }
   } else {
     parse_consume(parser, TOKEN_SEMICOLON, "Expect ;");
   }
+  exit_scope(function_scope);
 
   FunctionDecl* decl =
       ARENA_ALLOC_OBJECT(parser->permanent_arena, FunctionDecl);
@@ -1050,23 +1611,743 @@ static FunctionDecl* parse_function_decl(Parser* parser,
       .params = parameters,
       .body = body,
   };
+
+  if (skimmed_body != nullptr) {
+    skimmed_body->decl = decl;
+    if (parser->body_parsing == PARSE_REACHABLE_BODIES) {
+      symbol_map_try_insert(&parser->skimmed_bodies, name, skimmed_body,
+                            parser->permanent_arena);
+    }
+  }
   return decl;
 }
+
+static void parse_skimmed_body(Parser* parser, SkimmedBody* skimmed_body)
+{
+  FunctionDecl* decl = skimmed_body->decl;
+
+  // The body only sees what was declared before it
+  limit_file_scope_view(parser->global_scope,
+                        skimmed_body->visible_file_scope_count);
+  Scope* function_scope =
+      new_scope(parser->global_scope, parser->permanent_arena);
+  for (uint32_t i = 0; i < decl->params.length; ++i) {
+    IdentifierInfo* param = decl->params.data[i];
+    if (param != nullptr) {
+      redeclare_identifier(function_scope, param);
+    }
+  }
+
+  parser->current_token_index = skimmed_body->begin_token;
+  parser->in_panic_mode = false;
+  if (parse_enter_nesting(parser)) {
+    parse_advance(parser);
+    Block* body = ARENA_ALLOC_OBJECT(parser->permanent_arena, Block);
+    *body = parse_block(parser, function_scope);
+    --parser->nesting_depth;
+    decl->body = body;
+  }
+  exit_scope(function_scope);
+  limit_file_scope_view(parser->global_scope, UINT32_MAX);
+}
+
+typedef struct IndexedError {
+  Error error;
+  size_t index; // keeps errors at the same position in their order
+} IndexedError;
+
+static int compare_error_positions(const void* lhs, const void* rhs)
+{
+  const IndexedError* lhs_error = lhs;
+  const IndexedError* rhs_error = rhs;
+  if (lhs_error->error.range.begin != rhs_error->error.range.begin) {
+    return lhs_error->error.range.begin < rhs_error->error.range.begin ? -1 : 1;
+  }
+  return lhs_error->index < rhs_error->index ? -1 : 1;
+}
+
+// Orders errors by their position, since skimmed bodies are parsed out of
+// order. The sort is stable
+static void sort_errors_by_position(struct ErrorVec* errors,
+                                    Arena scratch_arena)
+{
+  if (errors->length < 2) { return; }
+
+  IndexedError* indexed =
+      ARENA_ALLOC_ARRAY(&scratch_arena, IndexedError, errors->length);
+  for (size_t i = 0; i < errors->length; ++i) {
+    indexed[i] = (IndexedError){.error = errors->data[i], .index = i};
+  }
+  qsort(indexed, errors->length, sizeof(IndexedError), compare_error_positions);
+  for (size_t i = 0; i < errors->length; ++i) {
+    errors->data[i] = indexed[i].error;
+  }
+}
+
+// Parses the bodies reachable from the functions with external linkage
+static void parse_reachable_bodies(Parser* parser, const Decl* decls,
+                                   uint32_t decl_count)
+{
+  // A function declared static anywhere has internal linkage
+  for (uint32_t i = 0; i < decl_count; ++i) {
+    if (decls[i].tag != DECL_FUNC ||
+        decls[i].func->storage_class != STORAGE_CLASS_STATIC) {
+      continue;
+    }
+    SkimmedBody* body =
+        symbol_map_lookup(&parser->skimmed_bodies, decls[i].func->name->name);
+    if (body != nullptr) { body->is_internal = true; }
+  }
+
+  const struct SkimmedBodyVec* all = &parser->all_skimmed_bodies;
+  for (uint32_t i = all->length; i-- > 0;) {
+    const SkimmedBody* first = symbol_map_lookup(
+        &parser->skimmed_bodies, all->data[i]->decl->name->name);
+    if (!first->is_internal) { queue_skimmed_body(parser, all->data[i]); }
+  }
+
+  const uint32_t end_token_index = parser->current_token_index;
+  struct SkimmedBodyVec* pending = &parser->pending_bodies;
+  while (pending->length != 0) {
+    SkimmedBody* body = pending->data[--pending->length];
+    parse_skimmed_body(parser, body);
+  }
+  parser->current_token_index = end_token_index;
+
+  sort_errors_by_position(&parser->errors, parser->scratch_arena);
+}
+#pragma endregion
+
+#pragma region parallel body parsing
+// Once the top level is skimmed, the bodies are split into groups of about the
+// same number of tokens, and each group is parsed and type checked on a thread
+// of its own, like the chunks of the parallel lexer. Workers leave alone what
+// the threads share: the file scope is frozen, and each worker looks names up
+// in a view of its own. They allocate from arenas of their own, and build nodes
+// in pools of their own, which are relocated into the pools of the parser once
+// all workers are done.
+//
+// A worker gives up on a body as soon as it would change something shared,
+// i.e. intern a symbol or add a function, or report a parse error. It drops
+// what it built for the body, and the main thread parses the body again once
+// the workers are done. Parse errors and type errors are then sorted by their
+// position, so the output does not depend on the thread count.
+//
+// Type checking depends on the order of the declarations of a function, and a
+// body the workers gave up on can declare functions. So once the workers have
+// parsed the bodies, the main thread goes over the top level in source order,
+// checking the signatures and parsing and checking the bodies left to it right
+// where they are. Only then do the workers check the bodies they parsed.
+
+enum {
+  MAX_PARSE_THREADS = 64,
+
+  // The first block of the permanent arena of a worker. A worker only
+  // allocates an identifier for each declaration and a scope for each block,
+  // and these take more than a few characters each, but the arena grows if a
+  // body needs more
+  WORKER_BYTES_PER_SOURCE_BYTE = 16,
+  WORKER_BYTES_PER_BODY = 256,
+
+  // Workers also keep their type errors in their scratch arena
+  WORKER_SCRATCH_BYTES_PER_TOKEN = 64,
+  WORKER_SCRATCH_BASE_SIZE = 16 * 1024 * 1024,
+};
+
+// A node a worker made at index i of a pool is moved to index i + offset. The
+// placeholders at index 0 of the expression and statement pools are not moved
+typedef struct NodeOffsets {
+  uint32_t exprs;
+  uint32_t stmts;
+  uint32_t ternaries;
+  uint32_t calls;
+  uint32_t call_args;
+  uint32_t ifs;
+  uint32_t for_loops;
+  uint32_t variable_decls;
+  uint32_t block_items;
+} NodeOffsets;
+
+typedef struct BodyWorker {
+  Parser parser;
+  Arena permanent_arena; // its blocks go to the parser's permanent arena
+  jmp_buf bail;
+
+  SkimmedBody** bodies;
+  uint32_t body_count;
+  uint32_t token_count;  // of the bodies
+  uint32_t source_bytes; // of the bodies
+
+  AstNodes* destination; // pools the nodes are relocated into
+  NodeOffsets offsets;
+} BodyWorker;
+
+// Parses a body the workers gave up on, and checks it unless its signature or
+// anything before it has errors
+static void parse_body_on_main_thread(Parser* parser, SkimmedBody* body)
+{
+  parse_skimmed_body(parser, body);
+  if (parser->type_checker != nullptr && parser->errors.length == 0 &&
+      body->check_body && body->decl->body != nullptr) {
+    type_check_function_body(parser->type_checker, body->decl);
+  }
+}
+
+// Checks the top-level declarations in order, like the sequential parser does,
+// but only the signatures of the skimmed functions whose bodies the workers
+// parsed. The bodies left to the main thread are parsed and checked in place
+static void check_top_level(Parser* parser, Decl* decls, uint32_t decl_count)
+{
+  const struct SkimmedBodyVec* bodies = &parser->all_skimmed_bodies;
+  uint32_t next_body = 0;
+  for (uint32_t i = 0; i < decl_count; ++i) {
+    if (next_body < bodies->length && decls[i].tag == DECL_FUNC &&
+        decls[i].func == bodies->data[next_body]->decl) {
+      SkimmedBody* body = bodies->data[next_body++];
+      body->check_body =
+          type_check_function_signature(parser->type_checker, body->decl);
+      if (body->parse_on_main_thread) {
+        parse_body_on_main_thread(parser, body);
+      }
+    } else {
+      type_check_top_level_decl(parser->type_checker, &decls[i]);
+    }
+  }
+}
+
+// Splits the bodies into at most thread_count groups of consecutive bodies with
+// about the same number of tokens. Returns the number of groups
+static uint32_t split_bodies(const Parser* parser, uint32_t thread_count,
+                             BodyWorker* workers)
+{
+  const struct SkimmedBodyVec* bodies = &parser->all_skimmed_bodies;
+  const uint32_t* token_starts = parser->tokens.token_starts;
+
+  uint64_t total_token_count = 0;
+  for (uint32_t i = 0; i < bodies->length; ++i) {
+    total_token_count += bodies->data[i]->end_token - bodies->data[i]->begin_token;
+  }
+
+  uint32_t group_count = 0;
+  uint32_t first = 0;
+  uint64_t split_token_count = 0;
+  for (uint32_t i = 1; i <= thread_count && first < bodies->length; ++i) {
+    const uint64_t target = total_token_count * i / thread_count;
+    BodyWorker* worker = &workers[group_count++];
+    *worker = (BodyWorker){.bodies = bodies->data + first};
+    do {
+      const SkimmedBody* body = bodies->data[first++];
+      const uint32_t token_count = body->end_token - body->begin_token;
+      worker->body_count++;
+      worker->token_count += token_count;
+      worker->source_bytes +=
+          token_starts[body->end_token] - token_starts[body->begin_token];
+      split_token_count += token_count;
+    } while (first < bodies->length && split_token_count < target);
+  }
+  return group_count;
+}
+
+static void init_body_worker(BodyWorker* worker, const Parser* parser)
+{
+  worker->permanent_arena = arena_from_virtual_mem(
+      (size_t)worker->source_bytes * WORKER_BYTES_PER_SOURCE_BYTE +
+      (size_t)worker->body_count * WORKER_BYTES_PER_BODY);
+
+  const size_t scratch_size =
+      (size_t)worker->token_count * WORKER_SCRATCH_BYTES_PER_TOKEN +
+      WORKER_SCRATCH_BASE_SIZE;
+  worker->parser = (Parser){
+      .src = parser->src,
+      .permanent_arena = &worker->permanent_arena,
+      .scratch_arena = arena_from_virtual_mem(scratch_size),
+      .tokens = parser->tokens,
+      .interner = parser->interner,
+      .types = parser->types,
+      .bail = &worker->bail,
+  };
+  Parser* worker_parser = &worker->parser;
+  worker_parser->global_scope = new_file_scope_view(
+      parser->global_scope, &worker_parser->scratch_arena);
+  init_ast_nodes(worker_parser);
+
+  if (parser->type_checker != nullptr) {
+    worker_parser->type_checker =
+        new_type_checker(parser->interner, parser->types, &worker_parser->nodes,
+                         &worker_parser->scratch_arena);
+  }
+}
+
+// Drops the nodes made since the pools had the lengths in before
+static void drop_nodes_since(AstNodes* nodes, const AstNodes* before)
+{
+  nodes->exprs.length = before->exprs.length;
+  nodes->stmts.length = before->stmts.length;
+  nodes->ternaries.length = before->ternaries.length;
+  nodes->calls.length = before->calls.length;
+  nodes->call_args.length = before->call_args.length;
+  nodes->ifs.length = before->ifs.length;
+  nodes->for_loops.length = before->for_loops.length;
+  nodes->variable_decls.length = before->variable_decls.length;
+  nodes->block_items.length = before->block_items.length;
+}
+
+static void parse_body_on_worker(BodyWorker* worker, SkimmedBody* body)
+{
+  Parser* parser = &worker->parser;
+  const AstNodes nodes_before = parser->nodes;
+
+  if (setjmp(worker->bail) != 0) {
+    drop_nodes_since(&parser->nodes, &nodes_before);
+    exit_nested_scopes(parser->global_scope);
+    limit_file_scope_view(parser->global_scope, UINT32_MAX);
+    parser->in_panic_mode = false;
+    parser->nesting_depth = 0;
+    parser->expr_frames.length = 0;
+    parser->pending_args.length = 0;
+    parser->if_chain.length = 0;
+    body->parse_on_main_thread = true;
+    return;
+  }
+
+  parse_skimmed_body(parser, body);
+}
+
+static void* parse_bodies_thread(void* worker)
+{
+  BodyWorker* body_worker = worker;
+  for (uint32_t i = 0; i < body_worker->body_count; ++i) {
+    parse_body_on_worker(body_worker, body_worker->bodies[i]);
+  }
+  return nullptr;
+}
+
+static void* check_bodies_thread(void* worker)
+{
+  BodyWorker* body_worker = worker;
+  for (uint32_t i = 0; i < body_worker->body_count; ++i) {
+    const SkimmedBody* body = body_worker->bodies[i];
+    if (!body->parse_on_main_thread && body->check_body) {
+      type_check_function_body(body_worker->parser.type_checker, body->decl);
+    }
+  }
+  return nullptr;
+}
+
+static ExprId relocate_expr(ExprId expr, const NodeOffsets* offsets)
+{
+  return expr == NO_EXPR ? NO_EXPR : expr + offsets->exprs;
+}
+
+static StmtId relocate_stmt(StmtId stmt, const NodeOffsets* offsets)
+{
+  return stmt == NO_STMT ? NO_STMT : stmt + offsets->stmts;
+}
+
+static ExprData relocate_expr_data(ExprTag tag, ExprData data,
+                                   const NodeOffsets* offsets)
+{
+  switch (tag) {
+  case EXPR_INVALID:
+  case EXPR_CONST:
+  case EXPR_VARIABLE: break;
+  case EXPR_UNARY:
+    data.inner_expr = relocate_expr(data.inner_expr, offsets);
+    break;
+  case EXPR_BINARY:
+    data.binary_op.lhs = relocate_expr(data.binary_op.lhs, offsets);
+    data.binary_op.rhs = relocate_expr(data.binary_op.rhs, offsets);
+    break;
+  case EXPR_TERNARY: data.ternary += offsets->ternaries; break;
+  case EXPR_CALL: data.call += offsets->calls; break;
+  }
+  return data;
+}
+
+static StmtData relocate_stmt_data(StmtTag tag, StmtData data,
+                                   const NodeOffsets* offsets)
+{
+  switch (tag) {
+  case STMT_INVALID:
+  case STMT_EMPTY:
+  case STMT_BREAK:
+  case STMT_CONTINUE: break;
+  case STMT_EXPR:
+  case STMT_RETURN: data.expr = relocate_expr(data.expr, offsets); break;
+  case STMT_COMPOUND:
+    data.compound.first_child += offsets->block_items;
+    break;
+  case STMT_IF: data.if_then += offsets->ifs; break;
+  case STMT_WHILE:
+  case STMT_DO_WHILE:
+    data.while_loop.cond = relocate_expr(data.while_loop.cond, offsets);
+    data.while_loop.body = relocate_stmt(data.while_loop.body, offsets);
+    break;
+  case STMT_FOR: data.for_loop += offsets->for_loops; break;
+  }
+  return data;
+}
+
+static BlockItem relocate_block_item(BlockItem item,
+                                     const NodeOffsets* offsets)
+{
+  switch (item.tag) {
+  case BLOCK_ITEM_STMT: item.stmt = relocate_stmt(item.stmt, offsets); break;
+  case BLOCK_ITEM_DECL:
+    // Workers give up on bodies that declare functions
+    if (item.decl.tag == DECL_VAR) {
+      item.decl.var += offsets->variable_decls;
+    }
+    break;
+  }
+  return item;
+}
+
+// Moves the nodes of a worker to the pools of the parser, which have room
+static void* relocate_nodes_thread(void* worker)
+{
+  BodyWorker* body_worker = worker;
+  const NodeOffsets* offsets = &body_worker->offsets;
+  const AstNodes* src = &body_worker->parser.nodes;
+  AstNodes* dst = body_worker->destination;
+
+  const uint32_t expr_count = src->exprs.length - 1;
+  const uint32_t first_expr = 1 + offsets->exprs;
+  memcpy(dst->exprs.tags + first_expr, src->exprs.tags + 1,
+         expr_count * sizeof(ExprTag));
+  memcpy(dst->exprs.ops + first_expr, src->exprs.ops + 1,
+         expr_count * sizeof(uint8_t));
+  memcpy(dst->exprs.types + first_expr, src->exprs.types + 1,
+         expr_count * sizeof(const Type*));
+  memcpy(dst->exprs.source_ranges + first_expr, src->exprs.source_ranges + 1,
+         expr_count * sizeof(SourceRange));
+  for (uint32_t i = 1; i < src->exprs.length; ++i) {
+    dst->exprs.data[i + offsets->exprs] =
+        relocate_expr_data(src->exprs.tags[i], src->exprs.data[i], offsets);
+  }
+
+  const uint32_t stmt_count = src->stmts.length - 1;
+  const uint32_t first_stmt = 1 + offsets->stmts;
+  memcpy(dst->stmts.tags + first_stmt, src->stmts.tags + 1,
+         stmt_count * sizeof(StmtTag));
+  memcpy(dst->stmts.source_ranges + first_stmt, src->stmts.source_ranges + 1,
+         stmt_count * sizeof(SourceRange));
+  for (uint32_t i = 1; i < src->stmts.length; ++i) {
+    dst->stmts.data[i + offsets->stmts] =
+        relocate_stmt_data(src->stmts.tags[i], src->stmts.data[i], offsets);
+  }
+
+  for (uint32_t i = 0; i < src->ternaries.length; ++i) {
+    const struct TernaryExpr ternary = src->ternaries.data[i];
+    dst->ternaries.data[i + offsets->ternaries] = (struct TernaryExpr){
+        .cond = relocate_expr(ternary.cond, offsets),
+        .true_expr = relocate_expr(ternary.true_expr, offsets),
+        .false_expr = relocate_expr(ternary.false_expr, offsets),
+    };
+  }
+  for (uint32_t i = 0; i < src->calls.length; ++i) {
+    const struct CallExpr call = src->calls.data[i];
+    dst->calls.data[i + offsets->calls] = (struct CallExpr){
+        .function = relocate_expr(call.function, offsets),
+        .arg_count = call.arg_count,
+        .first_arg = call.first_arg + offsets->call_args,
+    };
+  }
+  for (uint32_t i = 0; i < src->call_args.length; ++i) {
+    dst->call_args.data[i + offsets->call_args] =
+        relocate_expr(src->call_args.data[i], offsets);
+  }
+  for (uint32_t i = 0; i < src->ifs.length; ++i) {
+    const struct IfStmt if_stmt = src->ifs.data[i];
+    dst->ifs.data[i + offsets->ifs] = (struct IfStmt){
+        .cond = relocate_expr(if_stmt.cond, offsets),
+        .then = relocate_stmt(if_stmt.then, offsets),
+        .els = relocate_stmt(if_stmt.els, offsets),
+    };
+  }
+  for (uint32_t i = 0; i < src->for_loops.length; ++i) {
+    struct For for_loop = src->for_loops.data[i];
+    switch (for_loop.init.tag) {
+    case FOR_INIT_INVALID: break;
+    case FOR_INIT_DECL:
+      for_loop.init.decl += offsets->variable_decls;
+      break;
+    case FOR_INIT_EXPR:
+      for_loop.init.expr = relocate_expr(for_loop.init.expr, offsets);
+      break;
+    }
+    for_loop.cond = relocate_expr(for_loop.cond, offsets);
+    for_loop.post = relocate_expr(for_loop.post, offsets);
+    for_loop.body = relocate_stmt(for_loop.body, offsets);
+    dst->for_loops.data[i + offsets->for_loops] = for_loop;
+  }
+  for (uint32_t i = 0; i < src->variable_decls.length; ++i) {
+    VariableDecl decl = src->variable_decls.data[i];
+    decl.initializer = relocate_expr(decl.initializer, offsets);
+    dst->variable_decls.data[i + offsets->variable_decls] = decl;
+  }
+  for (uint32_t i = 0; i < src->block_items.length; ++i) {
+    dst->block_items.data[i + offsets->block_items] =
+        relocate_block_item(src->block_items.data[i], offsets);
+  }
+
+  for (uint32_t i = 0; i < body_worker->body_count; ++i) {
+    const SkimmedBody* body = body_worker->bodies[i];
+    if (!body->parse_on_main_thread) {
+      body->decl->body->first_child += offsets->block_items;
+    }
+  }
+  return nullptr;
+}
+
+#define RESERVE_MORE(ranges, nodes, pool, more)                                \
+  RESERVE_NODES(&(ranges)->pool, &(nodes)->pool,                               \
+                (nodes)->pool.length + (more).pool.length)
+
+#define TAKE_OFFSET(worker, nodes, pool, placeholder_count)                    \
+  do {                                                                         \
+    (worker)->offsets.pool = (nodes)->pool.length - (placeholder_count);       \
+    (nodes)->pool.length +=                                                    \
+        (worker)->parser.nodes.pool.length - (placeholder_count);              \
+  } while (0)
+
+// Gives the nodes of each worker a place after the nodes of the parser
+static void place_worker_nodes(Parser* parser, BodyWorker* workers,
+                               uint32_t worker_count)
+{
+  AstNodes* nodes = &parser->nodes;
+  AstNodes more = {};
+  for (uint32_t i = 0; i < worker_count; ++i) {
+    const AstNodes* worker_nodes = &workers[i].parser.nodes;
+    more.exprs.length += worker_nodes->exprs.length - 1;
+    more.stmts.length += worker_nodes->stmts.length - 1;
+    more.ternaries.length += worker_nodes->ternaries.length;
+    more.calls.length += worker_nodes->calls.length;
+    more.call_args.length += worker_nodes->call_args.length;
+    more.ifs.length += worker_nodes->ifs.length;
+    more.for_loops.length += worker_nodes->for_loops.length;
+    more.variable_decls.length += worker_nodes->variable_decls.length;
+    more.block_items.length += worker_nodes->block_items.length;
+  }
+
+  NodeRanges* ranges = &parser->node_ranges;
+  reserve_exprs(&nodes->exprs, ranges, nodes->exprs.length + more.exprs.length);
+  reserve_stmts(&nodes->stmts, ranges, nodes->stmts.length + more.stmts.length);
+  RESERVE_MORE(ranges, nodes, ternaries, more);
+  RESERVE_MORE(ranges, nodes, calls, more);
+  RESERVE_MORE(ranges, nodes, call_args, more);
+  RESERVE_MORE(ranges, nodes, ifs, more);
+  RESERVE_MORE(ranges, nodes, for_loops, more);
+  RESERVE_MORE(ranges, nodes, variable_decls, more);
+  RESERVE_MORE(ranges, nodes, block_items, more);
+
+  for (uint32_t i = 0; i < worker_count; ++i) {
+    BodyWorker* worker = &workers[i];
+    worker->destination = nodes;
+    TAKE_OFFSET(worker, nodes, exprs, 1);
+    TAKE_OFFSET(worker, nodes, stmts, 1);
+    TAKE_OFFSET(worker, nodes, ternaries, 0);
+    TAKE_OFFSET(worker, nodes, calls, 0);
+    TAKE_OFFSET(worker, nodes, call_args, 0);
+    TAKE_OFFSET(worker, nodes, ifs, 0);
+    TAKE_OFFSET(worker, nodes, for_loops, 0);
+    TAKE_OFFSET(worker, nodes, variable_decls, 0);
+    TAKE_OFFSET(worker, nodes, block_items, 0);
+  }
+}
+
+#undef TAKE_OFFSET
+#undef RESERVE_MORE
+
+// Runs f for each worker, the first one on the calling thread
+static void run_body_workers(BodyWorker* workers, uint32_t worker_count,
+                             void* (*f)(void*))
+{
+  pthread_t threads[MAX_PARSE_THREADS];
+  for (uint32_t i = 1; i < worker_count; ++i) {
+    if (pthread_create(&threads[i], nullptr, f, &workers[i]) != 0) {
+      MCC_PANIC("failed to create a parser thread");
+    }
+  }
+  if (worker_count != 0) { f(&workers[0]); }
+  for (uint32_t i = 1; i < worker_count; ++i) {
+    pthread_join(threads[i], nullptr);
+  }
+}
+
+// Merges the type errors of the parser and of the workers, whose messages are
+// in the scratch arenas of the workers, in the order of their positions
+static ErrorsView merge_type_errors(const Parser* parser,
+                                    const BodyWorker* workers,
+                                    uint32_t worker_count)
+{
+  const ErrorsView errors = type_checker_errors(parser->type_checker);
+  size_t error_count = errors.length;
+  for (uint32_t i = 0; i < worker_count; ++i) {
+    error_count += type_checker_errors(workers[i].parser.type_checker).length;
+  }
+
+  struct ErrorVec merged = {
+      .length = 0,
+      .capacity = error_count,
+      .data = ARENA_ALLOC_ARRAY(parser->permanent_arena, Error, error_count),
+  };
+  for (size_t i = 0; i < errors.length; ++i) {
+    merged.data[merged.length++] = errors.data[i];
+  }
+  for (uint32_t i = 0; i < worker_count; ++i) {
+    const ErrorsView worker_errors =
+        type_checker_errors(workers[i].parser.type_checker);
+    for (size_t j = 0; j < worker_errors.length; ++j) {
+      const StringView msg = worker_errors.data[j].msg;
+      char* msg_copy = ARENA_ALLOC_ARRAY(parser->permanent_arena, char, msg.size);
+      memcpy(msg_copy, msg.start, msg.size);
+      merged.data[merged.length++] = (Error){
+          .msg = {.start = msg_copy, .size = msg.size},
+          .range = worker_errors.data[j].range,
+      };
+    }
+  }
+  sort_errors_by_position(&merged, parser->scratch_arena);
+  return (ErrorsView){.length = merged.length, .data = merged.data};
+}
+
+static void parse_bodies_in_parallel(Parser* parser, Decl* decls,
+                                     uint32_t decl_count)
+{
+  // Only well-formed declarations can be checked
+  if (parser->type_checker != nullptr && parser->errors.length != 0) {
+    parser->type_checker = nullptr;
+  }
+
+  uint32_t thread_count = parser->thread_count;
+  if (thread_count == 0) {
+    const long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+    thread_count = cpu_count > 0 ? (uint32_t)cpu_count : 1;
+  }
+  if (thread_count > MAX_PARSE_THREADS) { thread_count = MAX_PARSE_THREADS; }
+
+  BodyWorker* workers =
+      ARENA_ALLOC_ARRAY(&parser->scratch_arena, BodyWorker, thread_count);
+  uint32_t worker_count = 0;
+  if (parser->permanent_arena->block != nullptr) {
+    worker_count = split_bodies(parser, thread_count, workers);
+  } else {
+    // What the workers allocate can only outlive them in a growable arena, so
+    // the main thread parses all the bodies
+    const struct SkimmedBodyVec* bodies = &parser->all_skimmed_bodies;
+    for (uint32_t i = 0; i < bodies->length; ++i) {
+      bodies->data[i]->parse_on_main_thread = true;
+    }
+  }
+  for (uint32_t i = 0; i < worker_count; ++i) {
+    init_body_worker(&workers[i], parser);
+  }
+  run_body_workers(workers, worker_count, parse_bodies_thread);
+
+  const uint32_t end_token_index = parser->current_token_index;
+  if (parser->type_checker != nullptr) {
+    check_top_level(parser, decls, decl_count);
+  } else {
+    const struct SkimmedBodyVec* bodies = &parser->all_skimmed_bodies;
+    for (uint32_t i = 0; i < bodies->length; ++i) {
+      if (bodies->data[i]->parse_on_main_thread) {
+        parse_body_on_main_thread(parser, bodies->data[i]);
+      }
+    }
+  }
+  parser->current_token_index = end_token_index;
+  sort_errors_by_position(&parser->errors, parser->scratch_arena);
+
+  if (parser->type_checker != nullptr && parser->errors.length == 0) {
+    run_body_workers(workers, worker_count, check_bodies_thread);
+  }
+  place_worker_nodes(parser, workers, worker_count);
+  run_body_workers(workers, worker_count, relocate_nodes_thread);
+
+  if (parser->type_checker != nullptr && parser->errors.length == 0) {
+    parser->type_errors = merge_type_errors(parser, workers, worker_count);
+  }
+  if (parser->type_checker != nullptr) {
+    release_type_checker(parser->type_checker);
+  }
+  parser->type_checker = nullptr;
+
+  for (uint32_t i = 0; i < worker_count; ++i) {
+    if (workers[i].parser.type_checker != nullptr) {
+      release_type_checker(workers[i].parser.type_checker);
+    }
+    arena_adopt_blocks(parser->permanent_arena, &workers[i].permanent_arena);
+    release_node_ranges(&workers[i].parser.node_ranges);
+    arena_release_virtual_mem(&workers[i].parser.scratch_arena);
+    VECTOR_RELEASE(&workers[i].parser.expr_frames);
+    VECTOR_RELEASE(&workers[i].parser.pending_args);
+    VECTOR_RELEASE(&workers[i].parser.if_chain);
+  }
+}
 #pragma endregion
 
 struct DeclVec {
   uint32_t length;
   uint32_t capacity;
   Decl* data;
+  VirtualRange range;
 };
 
+// Hands a declaration to the sink if it and everything before it is well
+// formed, and then drops its nodes so that the next declaration reuses them
+static void sink_decl(Parser* parser, const Decl* decl,
+                      const AstNodes* nodes_before)
+{
+  if (parser->errors.length == 0 &&
+      (parser->type_checker == nullptr ||
+       type_checker_errors(parser->type_checker).length == 0)) {
+    parser->decl_sink.consume(parser->decl_sink.context, decl, &parser->nodes);
+  }
+  drop_nodes_since(&parser->nodes, nodes_before);
+}
+
 static TranslationUnit* parse_translation_unit(Parser* parser)
 {
   struct DeclVec decl_vec = {};
 
   while (parser_current_token(parser).tag != TOKEN_EOF) {
+    const AstNodes nodes_before = parser->nodes;
+    const Arena scratch_before = parser->scratch_arena;
     Decl decl = parse_decl(parser, parser->global_scope);
-    DYNARRAY_PUSH_BACK(&decl_vec, Decl, &parser->scratch_arena, decl);
+    // What a declaration left in the scratch arena is dead once it is parsed,
+    // unless its body was skimmed to be parsed later
+    if (parser->body_parsing == PARSE_BODIES_INLINE) {
+      parser->scratch_arena = scratch_before;
+    }
+    // Only well-formed declarations can be checked, and the checks are moot
+    // once parsing failed anyway
+    if (parser->type_checker != nullptr &&
+        parser->body_parsing == PARSE_BODIES_INLINE &&
+        parser->errors.length == 0) {
+      type_check_top_level_decl(parser->type_checker, &decl);
+    }
+    if (parser->decl_sink.consume != nullptr) {
+      sink_decl(parser, &decl, &nodes_before);
+      continue;
+    }
+    VECTOR_PUSH_BACK(&decl_vec, Decl, decl);
+  }
+
+  switch (parser->body_parsing) {
+  case PARSE_BODIES_INLINE: break;
+  case PARSE_REACHABLE_BODIES:
+    // Skimmed declarations can only be checked once their bodies are parsed
+    parse_reachable_bodies(parser, decl_vec.data, decl_vec.length);
+    if (parser->type_checker != nullptr && parser->errors.length == 0) {
+      for (uint32_t i = 0; i < decl_vec.length; ++i) {
+        type_check_top_level_decl(parser->type_checker, &decl_vec.data[i]);
+      }
+    }
+    break;
+  case PARSE_BODIES_IN_PARALLEL:
+    parse_bodies_in_parallel(parser, decl_vec.data, decl_vec.length);
+    break;
   }
 
   const uint32_t decl_count = decl_vec.length;
@@ -1074,6 +2355,7 @@ static TranslationUnit* parse_translation_unit(Parser* parser)
   if (decl_vec.length != 0) {
     memcpy(decls, decl_vec.data, decl_vec.length * sizeof(Decl));
   }
+  VECTOR_RELEASE(&decl_vec);
 
   TranslationUnit* tu =
       ARENA_ALLOC_OBJECT(parser->permanent_arena, TranslationUnit);
@@ -1081,29 +2363,130 @@ static TranslationUnit* parse_translation_unit(Parser* parser)
       .decl_count = decl_count,
       .decls = decls,
       .global_scope = parser->global_scope,
-      .functions = parser->functions,
+      .interner = parser->interner,
+      .types = parser->types,
+      .nodes = copy_ast_nodes(&parser->nodes, parser->permanent_arena),
   };
+  release_node_ranges(&parser->node_ranges);
   parse_consume(parser, TOKEN_EOF, "Expect end of the file");
 
   return tu;
 }
 
-ParseResult parse(const char* src, Tokens tokens, Arena* permanent_arena,
-                  Arena scratch_arena)
+static ParseResult parse_with(Parser parser, bool type_check_decls)
 {
-  Parser parser = {.src = src,
-                   .tokens = tokens,
-                   .permanent_arena = permanent_arena,
-                   .scratch_arena = scratch_arena,
-                   .global_scope = new_scope(nullptr, permanent_arena),
-                   .functions = (HashMap){}};
-
+  init_ast_nodes(&parser);
+  parser.types = new_type_interner(parser.permanent_arena);
+  if (type_check_decls) {
+    parser.type_checker =
+        new_type_checker(parser.interner, parser.types, &parser.nodes,
+                         parser.permanent_arena);
+  }
   TranslationUnit* tu = parse_translation_unit(&parser);
+  VECTOR_RELEASE(&parser.expr_frames);
+  VECTOR_RELEASE(&parser.pending_args);
+  VECTOR_RELEASE(&parser.if_chain);
+  if (parser.type_checker != nullptr) {
+    parser.type_errors = type_checker_errors(parser.type_checker);
+    release_type_checker(parser.type_checker);
+  }
 
   const bool has_error = parser.errors.data != NULL;
   const ErrorsView errors = (ErrorsView){
       .length = parser.errors.length,
       .data = parser.errors.data,
   };
-  return (ParseResult){.ast = has_error ? NULL : tu, .errors = errors};
+  return (ParseResult){.ast = has_error ? NULL : tu,
+                       .errors = errors,
+                       .type_errors = parser.type_errors};
+}
+
+static ParseResult parse_tokens(const char* src, Tokens tokens,
+                                Arena* permanent_arena, Arena scratch_arena,
+                                bool type_check_decls, BodyParsing body_parsing,
+                                uint32_t thread_count)
+{
+  return parse_with((Parser){.src = src,
+                             .tokens = tokens,
+                             .interner = tokens.interner,
+                             .permanent_arena = permanent_arena,
+                             .scratch_arena = scratch_arena,
+                             .global_scope =
+                                 new_scope(nullptr, permanent_arena),
+                             .body_parsing = body_parsing,
+                             .thread_count = thread_count},
+                    type_check_decls);
+}
+
+ParseResult parse(const char* src, Tokens tokens, Arena* permanent_arena,
+                  Arena scratch_arena)
+{
+  return parse_tokens(src, tokens, permanent_arena, scratch_arena, false,
+                      PARSE_BODIES_INLINE, 1);
+}
+
+ParseResult parse_and_type_check(const char* src, Tokens tokens,
+                                 Arena* permanent_arena, Arena scratch_arena)
+{
+  return parse_tokens(src, tokens, permanent_arena, scratch_arena, true,
+                      PARSE_BODIES_INLINE, 1);
+}
+
+ParseResult parse_reachable_and_type_check(const char* src, Tokens tokens,
+                                           Arena* permanent_arena,
+                                           Arena scratch_arena)
+{
+  return parse_tokens(src, tokens, permanent_arena, scratch_arena, true,
+                      PARSE_REACHABLE_BODIES, 1);
+}
+
+ParseResult parse_and_type_check_with_threads(const char* src, Tokens tokens,
+                                              uint32_t thread_count,
+                                              Arena* permanent_arena,
+                                              Arena scratch_arena)
+{
+  return parse_tokens(src, tokens, permanent_arena, scratch_arena, true,
+                      PARSE_BODIES_IN_PARALLEL, thread_count);
+}
+
+static ParseResult parse_lexing_on_demand(const char* src, Interner* interner,
+                                          DeclSink decl_sink,
+                                          Arena* permanent_arena,
+                                          Arena scratch_arena,
+                                          bool type_check_decls)
+{
+  Lexer lexer = lexer_create(src);
+  Parser parser = (Parser){.src = src,
+                           .lexer = &lexer,
+                           .interner = interner,
+                           .permanent_arena = permanent_arena,
+                           .scratch_arena = scratch_arena,
+                           .global_scope = new_scope(nullptr, permanent_arena),
+                           .decl_sink = decl_sink};
+  parser_fetch_token(&parser);
+  return parse_with(parser, type_check_decls);
+}
+
+ParseResult parse_on_demand(const char* src, Arena* permanent_arena,
+                            Arena scratch_arena)
+{
+  return parse_lexing_on_demand(src, new_interner(permanent_arena),
+                                (DeclSink){}, permanent_arena, scratch_arena,
+                                false);
+}
+
+ParseResult parse_on_demand_and_type_check(const char* src, Interner* interner,
+                                           Arena* permanent_arena,
+                                           Arena scratch_arena)
+{
+  return parse_lexing_on_demand(src, interner, (DeclSink){}, permanent_arena,
+                                scratch_arena, true);
+}
+
+ParseResult parse_on_demand_into_sink(const char* src, Interner* interner,
+                                      DeclSink sink, Arena* permanent_arena,
+                                      Arena scratch_arena)
+{
+  return parse_lexing_on_demand(src, interner, sink, permanent_arena,
+                                scratch_arena, true);
 }
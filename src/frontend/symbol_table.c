@@ -1,45 +1,201 @@
 #include "symbol_table.h"
 
 #include <mcc/format.h>
-#include <mcc/hash_table.h>
+
+#include <string.h>
+
+// All scopes share one table that maps each symbol to its innermost live
+// declaration. Declarations of the same symbol in nested scopes form a stack
+// through their `shadowed` links, so both resolving a name and detecting
+// shadowing take a single array access no matter how deep the nesting is.
+//
+// Each scope also chains the declarations it made, so that exiting it pops
+// exactly those.
+
+typedef struct Declaration Declaration;
+struct Declaration {
+  IdentifierInfo* identifier;
+  Declaration* shadowed;      // outer declaration of the same symbol
+  Declaration* next_in_scope; // earlier declaration in the same scope
+  const Scope* scope;         // the declaring scope
+  uint32_t file_scope_order;  // index among the file scope declarations
+};
+
+typedef struct IdentifierTable {
+  Declaration** innermost; // indexed by symbol id
+  uint32_t capacity;
+  Declaration* free_list; // popped declarations, reused by later scopes
+  Arena* arena;           // of the declarations
+  Scope* innermost_scope; // most recently entered scope that is still open
+
+  const Scope* file_scope;
+  uint32_t file_scope_declaration_count;
+  // File scope declarations from this one on are hidden
+  uint32_t visible_file_scope_count;
+} IdentifierTable;
 
 struct Scope {
-  HashMap identifiers;
-  struct Scope* parent;
+  IdentifierTable* table;
+  Declaration* declarations; // most recent first
+  Scope* enclosing;          // innermost open scope when this one was entered
 };
 
 Scope* new_scope(Scope* parent, Arena* arena)
 {
-  struct Scope* map = ARENA_ALLOC_OBJECT(arena, Scope);
-  *map = (struct Scope){
-      .identifiers = (HashMap){},
-      .parent = parent,
-  };
-  return map;
+  IdentifierTable* table = nullptr;
+  if (parent == nullptr) {
+    table = ARENA_ALLOC_OBJECT(arena, IdentifierTable);
+    *table = (IdentifierTable){
+        .arena = arena,
+        .visible_file_scope_count = UINT32_MAX,
+    };
+  } else {
+    table = parent->table;
+  }
+
+  Scope* scope = ARENA_ALLOC_OBJECT(arena, Scope);
+  *scope = (Scope){.table = table, .enclosing = table->innermost_scope};
+  if (parent == nullptr) { table->file_scope = scope; }
+  table->innermost_scope = scope;
+  return scope;
+}
+
+void exit_scope(Scope* scope)
+{
+  IdentifierTable* table = scope->table;
+  MCC_ASSERT_MSG(table->innermost_scope == scope,
+                 "scopes must be exited in the reverse order of creation");
+  table->innermost_scope = scope->enclosing;
+
+  Declaration* declaration = scope->declarations;
+  while (declaration != nullptr) {
+    Declaration* next = declaration->next_in_scope;
+
+    const SymbolId name = declaration->identifier->name;
+    MCC_ASSERT_MSG(table->innermost[name] == declaration,
+                   "scopes must be exited in the reverse order of creation");
+    table->innermost[name] = declaration->shadowed;
+
+    declaration->next_in_scope = table->free_list;
+    table->free_list = declaration;
+
+    declaration = next;
+  }
+  scope->declarations = nullptr;
+}
+
+void exit_nested_scopes(Scope* scope)
+{
+  IdentifierTable* table = scope->table;
+  while (table->innermost_scope != scope) {
+    MCC_ASSERT(table->innermost_scope != nullptr);
+    exit_scope(table->innermost_scope);
+  }
 }
 
-IdentifierInfo* lookup_identifier(const Scope* scope, StringView name)
+// The view starts with a copy of the innermost declarations. They are all file
+// scope declarations, which the view only reads, so the copy is shallow
+Scope* new_file_scope_view(const Scope* file_scope, Arena* arena)
 {
-  IdentifierInfo* identifier = hashmap_lookup(&scope->identifiers, name);
-  if (identifier != nullptr) return identifier;
-  if (scope->parent == nullptr) return nullptr;
+  const IdentifierTable* file_table = file_scope->table;
+  MCC_ASSERT(file_table->file_scope == file_scope);
+
+  IdentifierTable* table = ARENA_ALLOC_OBJECT(arena, IdentifierTable);
+  *table = *file_table;
+  table->innermost =
+      ARENA_ALLOC_ARRAY(arena, Declaration*, file_table->capacity);
+  if (file_table->capacity != 0) {
+    memcpy(table->innermost, file_table->innermost,
+           file_table->capacity * sizeof(Declaration*));
+  }
+  table->free_list = nullptr;
+  table->arena = arena;
 
-  return lookup_identifier(scope->parent, name);
+  Scope* view = ARENA_ALLOC_OBJECT(arena, Scope);
+  *view = (Scope){.table = table};
+  table->innermost_scope = view;
+  return view;
 }
 
-IdentifierInfo* add_identifier(Scope* scope, StringView name,
+static Declaration* innermost_declaration(const IdentifierTable* table,
+                                          SymbolId name)
+{
+  Declaration* declaration =
+      name < table->capacity ? table->innermost[name] : nullptr;
+  // Nothing is declared beneath a file scope declaration, so a hidden one hides
+  // the name entirely
+  if (declaration != nullptr && declaration->scope == table->file_scope &&
+      declaration->file_scope_order >= table->visible_file_scope_count) {
+    return nullptr;
+  }
+  return declaration;
+}
+
+IdentifierInfo* lookup_identifier(const Scope* scope, SymbolId name)
+{
+  const Declaration* declaration = innermost_declaration(scope->table, name);
+  return declaration == nullptr ? nullptr : declaration->identifier;
+}
+
+// Symbols are interned while parsing, so the table grows on demand
+static void reserve_symbol(IdentifierTable* table, SymbolId name)
+{
+  if (name < table->capacity) { return; }
+
+  uint32_t capacity = table->capacity ? table->capacity : 256;
+  while (capacity <= name) { capacity *= 2; }
+
+  table->innermost =
+      ARENA_REALLOC_ARRAY(table->arena, Declaration*, table->innermost,
+                          table->capacity, capacity);
+  memset(table->innermost + table->capacity, 0,
+         (capacity - table->capacity) * sizeof(Declaration*));
+  table->capacity = capacity;
+}
+
+static void push_declaration(Scope* scope, IdentifierInfo* identifier)
+{
+  IdentifierTable* table = scope->table;
+
+  Declaration* declaration = table->free_list;
+  if (declaration != nullptr) {
+    table->free_list = declaration->next_in_scope;
+  } else {
+    declaration = ARENA_ALLOC_OBJECT(table->arena, Declaration);
+  }
+
+  const SymbolId name = identifier->name;
+  reserve_symbol(table, name);
+  *declaration = (Declaration){
+      .identifier = identifier,
+      .shadowed = table->innermost[name],
+      .next_in_scope = scope->declarations,
+      .scope = scope,
+      .file_scope_order = scope == table->file_scope
+                              ? table->file_scope_declaration_count++
+                              : 0,
+  };
+  table->innermost[name] = declaration;
+  scope->declarations = declaration;
+}
+
+IdentifierInfo* add_identifier(Scope* scope, SymbolId name,
                                IdentifierKind kind, Linkage linkage,
-                               Arena* arena)
+                               Interner* interner, Arena* arena)
 {
-  // check variable in current scope
-  if (hashmap_lookup(&scope->identifiers, name) != nullptr) { return nullptr; }
+  const Declaration* innermost = innermost_declaration(scope->table, name);
 
-  // lookup variable in parent scopes
-  const IdentifierInfo* parent_variable = nullptr;
-  if (scope->parent) {
-    parent_variable = lookup_identifier(scope->parent, name);
+  // check variable in current scope. Scopes are compared by identity, since
+  // a prototype inside a function body has a scope of its own that is not
+  // nested in the body
+  if (innermost != nullptr && innermost->scope == scope) {
+    return nullptr;
   }
 
+  // Otherwise the innermost declaration, if any, is in a parent scope
+  const IdentifierInfo* parent_variable =
+      innermost == nullptr ? nullptr : innermost->identifier;
+
   IdentifierInfo* variable = ARENA_ALLOC_OBJECT(arena, IdentifierInfo);
   if (parent_variable == nullptr) {
     *variable = (IdentifierInfo){
@@ -51,18 +207,33 @@ IdentifierInfo* add_identifier(Scope* scope, StringView name,
     };
   } else {
     uint32_t shadow_counter = parent_variable->shadow_counter + 1;
+    const StringView spelling = symbol_name(interner, name);
     *variable = (IdentifierInfo){
         .name = name,
-        .rewrote_name = allocate_printf(arena, "%.*s.%i", (int)name.size,
-                                        name.start, shadow_counter),
+        .rewrote_name = intern_fresh(
+            interner, allocate_printf(arena, "%.*s.%i", (int)spelling.size,
+                                      spelling.start, shadow_counter)),
         .kind = kind,
         .linkage = linkage,
         .shadow_counter = shadow_counter + 1,
     };
   }
 
-  const bool insert_succeed =
-      hashmap_try_insert(&scope->identifiers, name, variable, arena);
-  MCC_ASSERT(insert_succeed);
+  push_declaration(scope, variable);
   return variable;
 }
+
+void redeclare_identifier(Scope* scope, IdentifierInfo* identifier)
+{
+  push_declaration(scope, identifier);
+}
+
+uint32_t file_scope_declaration_count(const Scope* scope)
+{
+  return scope->table->file_scope_declaration_count;
+}
+
+void limit_file_scope_view(Scope* scope, uint32_t count)
+{
+  scope->table->visible_file_scope_count = count;
+}
@@ -3,6 +3,7 @@
 
 #include <mcc/arena.h>
 #include <mcc/hash_table.h>
+#include <mcc/interner.h>
 #include <mcc/prelude.h>
 #include <mcc/str.h>
 #include <mcc/type.h>
@@ -30,9 +31,8 @@ typedef enum Linkage {
 } Linkage;
 
 typedef struct IdentifierInfo {
-  StringView
-      name; // name in the source. This is the name used for variable lookup
-  StringView rewrote_name; // name after alpha renaming
+  SymbolId name; // name in the source. This is the name used for variable lookup
+  SymbolId rewrote_name;   // name after alpha renaming
   uint32_t shadow_counter; // increase each time we have shadowing
 
   IdentifierKind kind;
@@ -45,14 +45,45 @@ typedef struct IdentifierInfo {
 // Represents a block scope
 typedef struct Scope Scope;
 
+// Enters a scope nested in parent, or the file scope if parent is nullptr
 Scope* new_scope(Scope* parent, Arena* arena);
 
-IdentifierInfo* lookup_identifier(const Scope* scope, StringView name);
+// Removes the identifiers declared in the scope from view. Scopes must be
+// exited in the reverse order they were created in
+void exit_scope(Scope* scope);
+
+// Exits the scopes entered after scope that are still open, e.g. once parsing
+// gave up in the middle of a function body
+void exit_nested_scopes(Scope* scope);
+
+// Creates a private view of the file scope for another thread, which sees the
+// file scope declarations made so far and can enter scopes of its own. The
+// file scope must not change while any of its views is in use, and nothing
+// may be declared in a view itself. The view allocates from arena
+Scope* new_file_scope_view(const Scope* file_scope, Arena* arena);
+
+// Finds the innermost declaration of name that is visible. Only valid for the
+// innermost scope that has not been exited
+IdentifierInfo* lookup_identifier(const Scope* scope, SymbolId name);
 
 // Return nullptr if a variable of the same name already exist in the same scope
 // Otherwise we add it to the current scope
-IdentifierInfo* add_identifier(Scope* scope, StringView name,
+//
+// A variable that shadows another one is given a fresh symbol as its rewrote
+// name
+IdentifierInfo* add_identifier(Scope* scope, SymbolId name,
                                IdentifierKind kind, Linkage linkage,
-                               Arena* arena);
+                               Interner* interner, Arena* arena);
+
+// Declares an existing identifier in scope once more, e.g. the parameters of a
+// function whose body is parsed long after its declaration
+void redeclare_identifier(Scope* scope, IdentifierInfo* identifier);
+
+// Number of declarations made in the file scope so far
+uint32_t file_scope_declaration_count(const Scope* scope);
+
+// Hides all but the first count declarations of the file scope, as if the later
+// ones were not made yet. UINT32_MAX shows all of them again
+void limit_file_scope_view(Scope* scope, uint32_t count);
 
 #endif // MCC_SYMBOL_TABLE_H
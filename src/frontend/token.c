@@ -78,11 +78,12 @@ void print_tokens(const char* src, const Tokens* tokens,
                   const LineNumTable* line_num_table)
 {
   // TODO: fix this
+  LineCursor lines = line_cursor(line_num_table);
   for (uint32_t i = 0; i < tokens->token_count; ++i) {
     const Token token = get_token(tokens, i);
 
-    const LineColumn line_column =
-        calculate_line_and_column(line_num_table, token.start);
+    LineColumn line_column = cursor_line_and_column(&lines, token.start);
+    line_column.line = cursor_presumed_line(&lines, line_column.line).line;
 
     int src_padding_size = 10 - (int)(token.size);
     if (src_padding_size < 0) src_padding_size = 0;
@@ -2,6 +2,8 @@
 #include <mcc/prelude.h>
 #include <mcc/type.h>
 
+#include <string.h>
+
 const Type* typ_void = &(const Type){
     .tag = TYPE_VOID,
 };
@@ -17,11 +19,125 @@ const Type* typ_int = (const Type*)&(const IntegerType){
     .name = "int",
 };
 
-const Type* func_type(const Type* return_type, uint32_t param_count,
-                      Arena* arena)
+#pragma region type interner
+// Canonical types live in an open-addressing table of pointers, where nullptr
+// marks an empty slot. A type is hashed from its tag and its components. The
+// components are canonical already, so comparing them by address compares
+// their structure, and a probe compares the fields of the stored type without
+// any separate key. New kinds of types only need a hash, a case in
+// same_structure, and a prototype to intern.
+
+struct TypeInterner {
+  const Type** slots;
+  uint32_t slot_mask;  // slot count - 1, slot count is a power of two
+  uint32_t used_slots;
+  Arena* arena;
+};
+
+enum { INITIAL_TYPE_SLOT_COUNT = 64 };
+
+TypeInterner* new_type_interner(Arena* arena)
+{
+  TypeInterner* types = ARENA_ALLOC_OBJECT(arena, TypeInterner);
+  const Type** slots =
+      ARENA_ALLOC_ARRAY(arena, const Type*, INITIAL_TYPE_SLOT_COUNT);
+  memset(slots, 0, INITIAL_TYPE_SLOT_COUNT * sizeof(const Type*));
+  *types = (TypeInterner){
+      .slots = slots,
+      .slot_mask = INITIAL_TYPE_SLOT_COUNT - 1,
+      .arena = arena,
+  };
+  return types;
+}
+
+// The components are pointers or small integers, so a multiply is enough to
+// spread them. The high bits are the best mixed ones
+static inline uint32_t hash_type_components(TypeTag tag, uint64_t first,
+                                            uint64_t second)
+{
+  const uint64_t h = (first ^ (second << 32 | tag)) * 0x9E3779B97F4A7C15u;
+  return (uint32_t)(h >> 32);
+}
+
+static uint32_t hash_type(const Type* type)
+{
+  switch (type->tag) {
+  case TYPE_VOID:
+  case TYPE_INTEGER: break;
+  case TYPE_FUNCTION: {
+    const FunctionType* function_type = (const FunctionType*)type;
+    return hash_type_components(TYPE_FUNCTION,
+                                (uintptr_t)function_type->return_type,
+                                function_type->param_count);
+  }
+  }
+  MCC_UNREACHABLE();
+}
+
+static bool same_structure(const Type* lhs, const Type* rhs)
+{
+  if (lhs->tag != rhs->tag) { return false; }
+  switch (lhs->tag) {
+  case TYPE_VOID:
+  case TYPE_INTEGER: return lhs == rhs;
+  case TYPE_FUNCTION: {
+    const FunctionType* lhs_function = (const FunctionType*)lhs;
+    const FunctionType* rhs_function = (const FunctionType*)rhs;
+    return lhs_function->return_type == rhs_function->return_type &&
+           lhs_function->param_count == rhs_function->param_count;
+  }
+  }
+  MCC_UNREACHABLE();
+}
+
+// Doubles the slot count. The hashes are cheap, so they are recomputed rather
+// than stored
+static void grow_type_slots(TypeInterner* types)
 {
-  FunctionType* result = ARENA_ALLOC_OBJECT(arena, FunctionType);
-  *result = (FunctionType){
+  const uint32_t old_slot_count = types->slot_mask + 1;
+  const uint32_t slot_count = old_slot_count * 2;
+  const Type** slots = ARENA_ALLOC_ARRAY(types->arena, const Type*, slot_count);
+  memset(slots, 0, slot_count * sizeof(const Type*));
+
+  const uint32_t slot_mask = slot_count - 1;
+  for (uint32_t i = 0; i < old_slot_count; ++i) {
+    const Type* type = types->slots[i];
+    if (type == nullptr) { continue; }
+    uint32_t slot = hash_type(type) & slot_mask;
+    while (slots[slot] != nullptr) { slot = (slot + 1) & slot_mask; }
+    slots[slot] = type;
+  }
+
+  types->slots = slots;
+  types->slot_mask = slot_mask;
+}
+
+static const Type* intern_type(TypeInterner* types, const Type* prototype,
+                               uint32_t hash, size_t type_size,
+                               size_t type_alignment)
+{
+  uint32_t slot = hash & types->slot_mask;
+  for (const Type* candidate = types->slots[slot]; candidate != nullptr;
+       candidate = types->slots[slot]) {
+    if (same_structure(candidate, prototype)) { return candidate; }
+    slot = (slot + 1) & types->slot_mask;
+  }
+
+  Type* result = arena_aligned_alloc(types->arena, type_alignment, type_size);
+  memcpy(result, prototype, type_size);
+  types->slots[slot] = result;
+
+  // Keeps the load factor at most 1/2
+  if (++types->used_slots * 2 > types->slot_mask + 1) {
+    grow_type_slots(types);
+  }
+  return result;
+}
+
+const Type* func_type(TypeInterner* types, const Type* return_type,
+                      uint32_t param_count)
+{
+  const FunctionType prototype = {
       .base =
           {
               .tag = TYPE_FUNCTION,
@@ -31,9 +147,10 @@ const Type* func_type(const Type* return_type, uint32_t param_count,
       .param_count = param_count,
       .return_type = return_type,
   };
-
-  return (const Type*)result;
+  return intern_type(types, &prototype.base, hash_type(&prototype.base),
+                     sizeof(prototype), alignof(FunctionType));
 }
+#pragma endregion
 
 void format_type_to(StringBuffer* buffer, const Type* typ)
 {
@@ -15,10 +15,31 @@ struct ErrorVec {
   Error* data;
 };
 
+// An expression whose children are being checked
+typedef struct ExprCheckFrame {
+  ExprId expr;
+  uint32_t checked_children;
+} ExprCheckFrame;
+
+struct ExprCheckFrameVec {
+  uint32_t length;
+  uint32_t capacity;
+  ExprCheckFrame* data;
+  VirtualRange range;
+};
+
 typedef struct Context {
   struct ErrorVec errors;
   Arena* permanent_arena;
-  HashMap functions;
+  // Of each function, by name, the first declaration checked. It holds the type
+  // of the function, so all declarations are checked against that one
+  SymbolMap functions;
+  const Interner* interner;
+  TypeInterner* types;
+  AstNodes* nodes;
+
+  // Explicit stack of type_check_expr, shared by all expressions
+  struct ExprCheckFrameVec expr_frames;
 } Context;
 
 #pragma region error reporter
@@ -28,230 +49,319 @@ static void error_at(StringView msg, SourceRange range, Context* context)
   DYNARRAY_PUSH_BACK(&context->errors, Error, context->permanent_arena, error);
 }
 
-static void report_invalid_unary_args(const Expr* expr, Context* context)
+static void report_invalid_unary_args(ExprId expr, Context* context)
 {
+  const ExprId inner_expr = context->nodes->exprs.data[expr].inner_expr;
   StringBuffer buffer = string_buffer_new(context->permanent_arena);
   string_buffer_append(&buffer, str("invalid argument type '"));
-  format_type_to(&buffer, expr->unary_op.inner_expr->type);
+  format_type_to(&buffer, context->nodes->exprs.types[inner_expr]);
   string_buffer_append(&buffer, str("' to unary expression"));
-  error_at(str_from_buffer(&buffer), expr->unary_op.inner_expr->source_range,
-           context);
+  error_at(str_from_buffer(&buffer),
+           context->nodes->exprs.source_ranges[inner_expr], context);
 }
 
-static void report_invalid_binary_args(const Expr* expr, Context* context)
+static void report_invalid_binary_args(ExprId expr, Context* context)
 {
+  const ExprPool* exprs = &context->nodes->exprs;
+  const struct BinaryOpExpr binary_op = exprs->data[expr].binary_op;
   StringBuffer buffer = string_buffer_new(context->permanent_arena);
   string_buffer_append(&buffer,
                        str("invalid operands to binary expression ('"));
-  format_type_to(&buffer, expr->binary_op.lhs->type);
+  format_type_to(&buffer, exprs->types[binary_op.lhs]);
   string_buffer_append(&buffer, str("' and '"));
-  format_type_to(&buffer, expr->binary_op.rhs->type);
+  format_type_to(&buffer, exprs->types[binary_op.rhs]);
   string_buffer_append(&buffer, str("')"));
-  error_at(str_from_buffer(&buffer), expr->source_range, context);
+  error_at(str_from_buffer(&buffer), exprs->source_ranges[expr], context);
 }
 
-static void report_incompatible_return(const Expr* expr, Context* context)
+static void report_incompatible_return(ExprId expr, Context* context)
 {
   StringBuffer buffer = string_buffer_new(context->permanent_arena);
   string_buffer_append(&buffer, str("returning '"));
-  format_type_to(&buffer, expr->type);
+  format_type_to(&buffer, context->nodes->exprs.types[expr]);
   string_buffer_append(
       &buffer, str("' from a function with incompatible result type 'int'"));
-  error_at(str_from_buffer(&buffer), expr->source_range, context);
+  error_at(str_from_buffer(&buffer), context->nodes->exprs.source_ranges[expr],
+           context);
 }
 
-static void report_calling_noncallable(const Expr* function, Context* context)
+static void report_calling_noncallable(ExprId function, Context* context)
 {
   StringBuffer buffer = string_buffer_new(context->permanent_arena);
   string_buffer_append(&buffer, str("called object with type '"));
-  format_type_to(&buffer, function->type);
+  format_type_to(&buffer, context->nodes->exprs.types[function]);
   string_buffer_append(&buffer, str("', which is not callable"));
-  error_at(str_from_buffer(&buffer), function->source_range, context);
+  error_at(str_from_buffer(&buffer),
+           context->nodes->exprs.source_ranges[function], context);
 }
 
-static void report_arg_count_mismatch(const Expr* function,
-                                      uint32_t param_count, uint32_t arg_count,
-                                      Context* context)
+static void report_arg_count_mismatch(ExprId function, uint32_t param_count,
+                                      uint32_t arg_count, Context* context)
 {
   const StringView msg = allocate_printf(
       context->permanent_arena,
       "too %s arguments to function call, expected %u, have %u",
       param_count > arg_count ? "few" : "many", param_count, arg_count);
-  error_at(msg, function->source_range, context);
+  error_at(msg, context->nodes->exprs.source_ranges[function], context);
 }
 
-static void report_wrong_arg_type(const Expr* arg, Context* context)
+static void report_wrong_arg_type(ExprId arg, Context* context)
 {
   StringBuffer buffer = string_buffer_new(context->permanent_arena);
   string_buffer_append(&buffer, str("passing '"));
-  format_type_to(&buffer, arg->type);
+  format_type_to(&buffer, context->nodes->exprs.types[arg]);
   string_buffer_append(&buffer, str("' to parameter of type 'int'"));
-  error_at(str_from_buffer(&buffer), arg->source_range, context);
+  error_at(str_from_buffer(&buffer), context->nodes->exprs.source_ranges[arg],
+           context);
 }
 
-static void report_incompatible_initialization(const Expr* initializer,
+static void report_incompatible_initialization(ExprId initializer,
                                                Context* context)
 {
   StringBuffer buffer = string_buffer_new(context->permanent_arena);
   string_buffer_append(&buffer, str("initialization of 'int' from '"));
-  format_type_to(&buffer, initializer->type);
+  format_type_to(&buffer, context->nodes->exprs.types[initializer]);
   string_buffer_append(&buffer, str("'"));
-  error_at(str_from_buffer(&buffer), initializer->source_range, context);
+  error_at(str_from_buffer(&buffer),
+           context->nodes->exprs.source_ranges[initializer], context);
 }
 
 static void report_conflicting_decl_type(FunctionDecl* decl, Context* context)
 {
+  const StringView name = symbol_name(context->interner, decl->name->name);
   StringView msg =
       allocate_printf(context->permanent_arena, "conflicting types for '%.*s'",
-                      (int)decl->name->name.size, decl->name->name.start);
+                      (int)name.size, name.start);
   error_at(msg, decl->source_range, context);
 }
 
 static void report_multiple_definition(FunctionDecl* decl, Context* context)
 {
+  const StringView name = symbol_name(context->interner, decl->name->name);
   StringView msg =
       allocate_printf(context->permanent_arena, "multiple definition of '%.*s'",
-                      (int)decl->name->name.size, decl->name->name.start);
+                      (int)name.size, name.start);
   error_at(msg, decl->source_range, context);
 }
 #pragma endregion
 
-[[nodiscard]]
-static bool type_check_expr(Expr* expr, Context* context);
-
-[[nodiscard]]
-static bool type_check_function_call(Expr* function_call, Context* context)
+// Children of an expression, in the order they are checked
+static uint32_t expr_child_count(const AstNodes* nodes, ExprId expr)
 {
-  MCC_ASSERT(function_call->tag == EXPR_CALL);
-
-  Expr* function_expr = function_call->call.function;
-  if (!type_check_expr(function_expr, context)) { return false; }
-
-  if (function_expr->type->tag != TYPE_FUNCTION) {
-    MCC_ASSERT(function_expr->type != nullptr);
-    report_calling_noncallable(function_expr, context);
-    return false;
+  switch (nodes->exprs.tags[expr]) {
+  case EXPR_INVALID: MCC_UNREACHABLE();
+  case EXPR_CONST: [[fallthrough]];
+  case EXPR_VARIABLE: return 0;
+  case EXPR_UNARY: return 1;
+  case EXPR_BINARY: return 2;
+  case EXPR_TERNARY: return 3;
+  case EXPR_CALL:
+    return 1 + nodes->calls.data[nodes->exprs.data[expr].call].arg_count;
   }
+  MCC_UNREACHABLE();
+}
 
-  const FunctionType* function_type = (const FunctionType*)function_expr->type;
-
-  const uint32_t arg_count = function_call->call.arg_count;
-  if (function_type->param_count != arg_count) {
-    report_arg_count_mismatch(function_expr, function_type->param_count,
-                              arg_count, context);
-    return false;
+static ExprId expr_child(const AstNodes* nodes, ExprId expr, uint32_t index)
+{
+  const ExprData data = nodes->exprs.data[expr];
+  switch (nodes->exprs.tags[expr]) {
+  case EXPR_INVALID: [[fallthrough]];
+  case EXPR_CONST: [[fallthrough]];
+  case EXPR_VARIABLE: MCC_UNREACHABLE();
+  case EXPR_UNARY: return data.inner_expr;
+  case EXPR_BINARY:
+    return index == 0 ? data.binary_op.lhs : data.binary_op.rhs;
+  case EXPR_TERNARY: {
+    const struct TernaryExpr ternary = nodes->ternaries.data[data.ternary];
+    switch (index) {
+    case 0: return ternary.cond;
+    case 1: return ternary.false_expr;
+    default: return ternary.true_expr;
+    }
+  }
+  case EXPR_CALL: {
+    const struct CallExpr call = nodes->calls.data[data.call];
+    return index == 0 ? call.function
+                      : nodes->call_args.data[call.first_arg + index - 1];
+  }
   }
+  MCC_UNREACHABLE();
+}
 
-  for (uint32_t i = 0; i < arg_count; ++i) {
-    Expr* arg = function_call->call.args[i];
-    if (!type_check_expr(arg, context)) { return false; }
+// Checks that can be done once the child `index` of `expr` is checked, before
+// checking the next child
+[[nodiscard]]
+static bool type_check_after_child(ExprId expr, uint32_t index,
+                                   Context* context)
+{
+  ExprPool* exprs = &context->nodes->exprs;
+  if (exprs->tags[expr] != EXPR_CALL) { return true; }
+
+  const struct CallExpr call =
+      context->nodes->calls.data[exprs->data[expr].call];
+  if (index == 0) {
+    const ExprId function_expr = call.function;
+    const Type* function_expr_type = exprs->types[function_expr];
+    if (function_expr_type->tag != TYPE_FUNCTION) {
+      MCC_ASSERT(function_expr_type != nullptr);
+      report_calling_noncallable(function_expr, context);
+      return false;
+    }
 
-    if (arg->type->tag != TYPE_INTEGER) {
-      report_wrong_arg_type(arg, context);
+    const FunctionType* function_type =
+        (const FunctionType*)function_expr_type;
+    if (function_type->param_count != call.arg_count) {
+      report_arg_count_mismatch(function_expr, function_type->param_count,
+                                call.arg_count, context);
       return false;
     }
+    return true;
   }
 
-  function_call->type = typ_int;
+  // Parameters are all int for now
+  const ExprId arg = context->nodes->call_args.data[call.first_arg + index - 1];
+  if (exprs->types[arg] != typ_int) {
+    report_wrong_arg_type(arg, context);
+    return false;
+  }
   return true;
 }
 
+// Checks an expression whose children are all checked
 [[nodiscard]]
-static bool type_check_expr(Expr* expr, Context* context)
+static bool type_check_expr_node(ExprId expr, Context* context)
 {
-  switch (expr->tag) {
+  ExprPool* exprs = &context->nodes->exprs;
+  const ExprData data = exprs->data[expr];
+  switch (exprs->tags[expr]) {
   case EXPR_INVALID: MCC_UNREACHABLE(); break;
-  case EXPR_CONST: expr->type = typ_int; return true;
+  case EXPR_CONST: exprs->types[expr] = typ_int; return true;
   case EXPR_VARIABLE:
-    MCC_ASSERT(expr->variable->type != nullptr);
-    expr->type = expr->variable->type;
+    MCC_ASSERT(data.variable->type != nullptr);
+    exprs->types[expr] = data.variable->type;
     return true;
   case EXPR_UNARY:
-    if (!type_check_expr(expr->unary_op.inner_expr, context)) { return false; }
-    if (expr->unary_op.inner_expr->type->tag != TYPE_INTEGER) {
+    if (exprs->types[data.inner_expr]->tag != TYPE_INTEGER) {
       report_invalid_unary_args(expr, context);
       return false;
     }
-    expr->type = expr->unary_op.inner_expr->type;
+    exprs->types[expr] = exprs->types[data.inner_expr];
     return true;
   case EXPR_BINARY:
-    if (!type_check_expr(expr->binary_op.lhs, context) ||
-        !type_check_expr(expr->binary_op.rhs, context)) {
-      return false;
-    }
-
-    if (expr->binary_op.lhs->type->tag != TYPE_INTEGER ||
-        expr->binary_op.rhs->type->tag != TYPE_INTEGER) {
+    if (exprs->types[data.binary_op.lhs]->tag != TYPE_INTEGER ||
+        exprs->types[data.binary_op.rhs]->tag != TYPE_INTEGER) {
       report_invalid_binary_args(expr, context);
       return false;
     }
 
-    expr->type = typ_int;
+    exprs->types[expr] = typ_int;
     return true;
-  case EXPR_TERNARY:
-    if (!type_check_expr(expr->ternary.cond, context) ||
-        !type_check_expr(expr->ternary.false_expr, context) ||
-        !type_check_expr(expr->ternary.true_expr, context)) {
-      MCC_ASSERT(expr->ternary.cond->type->tag == TYPE_INTEGER);
-      // TODO: check the two ternary branches has the same type
-      return false;
-    }
-
-    MCC_ASSERT(expr->ternary.cond->type->tag == TYPE_INTEGER);
+  case EXPR_TERNARY: {
+    const struct TernaryExpr ternary =
+        context->nodes->ternaries.data[data.ternary];
+    MCC_ASSERT(exprs->types[ternary.cond]->tag == TYPE_INTEGER);
     // TODO: check the two branches has the same type
-    expr->type = expr->ternary.true_expr->type;
+    exprs->types[expr] = exprs->types[ternary.true_expr];
     return true;
-  case EXPR_CALL: return type_check_function_call(expr, context);
+  }
+  case EXPR_CALL: exprs->types[expr] = typ_int; return true;
   }
   MCC_UNREACHABLE();
 }
 
-static bool type_check_block(Block* block, Context* context);
+// Walks the expression with an explicit stack rather than recursion, so that
+// deeply nested expressions cannot overflow the stack. The first error ends the
+// walk, since every enclosing expression would give up on it anyway
+[[nodiscard]]
+static bool type_check_expr(ExprId expr, Context* context)
+{
+  struct ExprCheckFrameVec* frames = &context->expr_frames;
+  MCC_ASSERT(frames->length == 0);
+
+  const ExprCheckFrame root = {.expr = expr};
+  VECTOR_PUSH_BACK(frames, ExprCheckFrame, root);
+  while (frames->length != 0) {
+    ExprCheckFrame* frame = &frames->data[frames->length - 1];
+    if (frame->checked_children <
+        expr_child_count(context->nodes, frame->expr)) {
+      const ExprCheckFrame child = {
+          .expr = expr_child(context->nodes, frame->expr,
+                             frame->checked_children++),
+      };
+      VECTOR_PUSH_BACK(frames, ExprCheckFrame, child);
+      continue;
+    }
+
+    bool ok = type_check_expr_node(frame->expr, context);
+    --frames->length;
+    if (ok && frames->length != 0) {
+      const ExprCheckFrame* parent = &frames->data[frames->length - 1];
+      ok = type_check_after_child(parent->expr, parent->checked_children - 1,
+                                  context);
+    }
+    if (!ok) {
+      frames->length = 0;
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool type_check_block(Block block, Context* context);
 
-[[nodiscard]] static bool type_check_variable_decl(VariableDecl* decl,
+[[nodiscard]] static bool type_check_variable_decl(VariableDeclId decl,
                                                    Context* context);
 
 [[nodiscard]]
-static bool type_check_stmt(Stmt* stmt, Context* context)
+static bool type_check_stmt(StmtId stmt, Context* context)
 {
-  switch (stmt->tag) {
+  const StmtData data = context->nodes->stmts.data[stmt];
+  switch (context->nodes->stmts.tags[stmt]) {
   case STMT_INVALID: MCC_UNREACHABLE();
   case STMT_EMPTY: return true;
-  case STMT_EXPR: return type_check_expr(stmt->expr, context);
-  case STMT_COMPOUND: return type_check_block(&stmt->compound, context);
+  case STMT_EXPR: return type_check_expr(data.expr, context);
+  case STMT_COMPOUND: return type_check_block(data.compound, context);
   case STMT_RETURN: {
     // TODO: check it return the expect function return type
-    Expr* expr = stmt->ret.expr;
+    const ExprId expr = data.expr;
     if (!type_check_expr(expr, context)) { return false; }
 
-    if (expr->type->tag != TYPE_INTEGER) {
+    if (context->nodes->exprs.types[expr] != typ_int) {
       report_incompatible_return(expr, context);
       return false;
     }
     return true;
   }
   case STMT_IF: {
-    Expr* cond = stmt->if_then.cond;
-    if (!type_check_expr(cond, context)) { return false; }
-    MCC_ASSERT(cond->type->tag == TYPE_INTEGER);
-    bool result = type_check_stmt(stmt->if_then.then, context);
-    if (stmt->if_then.els != nullptr) {
-      result &= type_check_stmt(stmt->if_then.els, context);
+    // Ladders of `else if` can be arbitrarily long, so walk them in a loop
+    bool result = true;
+    for (StmtId current = stmt;;) {
+      const struct IfStmt if_then =
+          context->nodes->ifs.data[context->nodes->stmts.data[current].if_then];
+      if (!type_check_expr(if_then.cond, context)) { return false; }
+      MCC_ASSERT(context->nodes->exprs.types[if_then.cond]->tag ==
+                 TYPE_INTEGER);
+      result &= type_check_stmt(if_then.then, context);
+
+      if (if_then.els == NO_STMT) { break; }
+      if (context->nodes->stmts.tags[if_then.els] != STMT_IF) {
+        result &= type_check_stmt(if_then.els, context);
+        break;
+      }
+      current = if_then.els;
     }
     return result;
   }
   case STMT_WHILE: [[fallthrough]];
   case STMT_DO_WHILE: {
-    Expr* cond = stmt->while_loop.cond;
+    const ExprId cond = data.while_loop.cond;
     if (!type_check_expr(cond, context)) { return false; }
-    MCC_ASSERT(cond->type->tag == TYPE_INTEGER);
-    return type_check_stmt(stmt->while_loop.body, context);
+    MCC_ASSERT(context->nodes->exprs.types[cond]->tag == TYPE_INTEGER);
+    return type_check_stmt(data.while_loop.body, context);
   }
   case STMT_FOR: {
-    ForInit init = stmt->for_loop.init;
-    Expr* cond = stmt->for_loop.cond;
-    Stmt* body = stmt->for_loop.body;
-    Expr* post = stmt->for_loop.post;
+    const struct For for_loop = context->nodes->for_loops.data[data.for_loop];
+    const ForInit init = for_loop.init;
 
     bool result = true;
     switch (init.tag) {
@@ -260,13 +370,19 @@ static bool type_check_stmt(Stmt* stmt, Context* context)
       if (!type_check_variable_decl(init.decl, context)) { return false; }
       break;
     case FOR_INIT_EXPR: {
-      if (init.expr) { result &= type_check_expr(init.expr, context); }
+      if (init.expr != NO_EXPR) {
+        result &= type_check_expr(init.expr, context);
+      }
     } break;
     }
 
-    if (cond) { result &= type_check_expr(cond, context); }
-    result &= type_check_stmt(body, context);
-    if (post) { result &= type_check_expr(post, context); }
+    if (for_loop.cond != NO_EXPR) {
+      result &= type_check_expr(for_loop.cond, context);
+    }
+    result &= type_check_stmt(for_loop.body, context);
+    if (for_loop.post != NO_EXPR) {
+      result &= type_check_expr(for_loop.post, context);
+    }
     if (!result) { return result; }
 
     return true;
@@ -277,12 +393,13 @@ static bool type_check_stmt(Stmt* stmt, Context* context)
   MCC_UNREACHABLE();
 }
 
-[[nodiscard]] static bool type_check_variable_decl(VariableDecl* decl,
+[[nodiscard]] static bool type_check_variable_decl(VariableDeclId id,
                                                    Context* context)
 {
+  const VariableDecl* decl = &context->nodes->variable_decls.data[id];
   decl->name->type = typ_int;
 
-  if (decl->initializer) {
+  if (decl->initializer != NO_EXPR) {
     // TODO: handle redefinition of static/global variables
     MCC_ASSERT(decl->name->has_definition == false);
 
@@ -290,7 +407,7 @@ static bool type_check_stmt(Stmt* stmt, Context* context)
 
     if (!type_check_expr(decl->initializer, context)) { return false; }
 
-    if (decl->initializer->type->tag != TYPE_INTEGER) {
+    if (context->nodes->exprs.types[decl->initializer] != typ_int) {
       report_incompatible_initialization(decl->initializer, context);
       return false;
     }
@@ -305,7 +422,7 @@ static bool type_check_decl(Decl* decl, Context* context)
   switch (decl->tag) {
   case DECL_INVALID: MCC_UNREACHABLE(); break;
   case DECL_VAR:
-    if (!type_check_variable_decl(&decl->var, context)) { return false; }
+    if (!type_check_variable_decl(decl->var, context)) { return false; }
     break;
   case DECL_FUNC:
     MCC_ASSERT(decl->func != nullptr);
@@ -315,14 +432,14 @@ static bool type_check_decl(Decl* decl, Context* context)
   return true;
 }
 
-static bool type_check_block(Block* block, Context* context)
+static bool type_check_block(Block block, Context* context)
 {
   bool result = true;
-  for (uint32_t i = 0; i < block->child_count; ++i) {
-    BlockItem* item = &block->children[i];
+  for (uint32_t i = 0; i < block.child_count; ++i) {
+    BlockItem* item = &context->nodes->block_items.data[block.first_child + i];
     switch (item->tag) {
     case BLOCK_ITEM_STMT:
-      result &= type_check_stmt(&item->stmt, context);
+      result &= type_check_stmt(item->stmt, context);
       break;
     case BLOCK_ITEM_DECL:
       result &= type_check_decl(&item->decl, context);
@@ -332,26 +449,34 @@ static bool type_check_block(Block* block, Context* context)
   return result;
 }
 
-static bool type_check_function_decl(FunctionDecl* decl, Context* context)
+// Checks everything but the body of a function declaration
+static bool type_check_function_signature_in(FunctionDecl* decl,
+                                             bool is_definition,
+                                             Context* context)
 {
-  StringView function_name = decl->name->name;
   IdentifierInfo* function_ident =
-      hashmap_lookup(&context->functions, function_name);
+      symbol_map_lookup(&context->functions, decl->name->name);
+  if (function_ident == nullptr) {
+    function_ident = decl->name;
+    symbol_map_try_insert(&context->functions, decl->name->name,
+                          function_ident, context->permanent_arena);
+  }
 
+  // Types are interned, so compatible declarations have the same type object
+  const Type* type = func_type(context->types, typ_int, decl->params.length);
   if (function_ident->type == nullptr) {
-    function_ident->type =
-        func_type(typ_int, decl->params.length, context->permanent_arena);
-  } else {
-    MCC_ASSERT(function_ident->type->tag == TYPE_FUNCTION);
-    const FunctionType* function_type = (FunctionType*)function_ident->type;
-    if (function_type->return_type != typ_int ||
-        function_type->param_count != decl->params.length) {
-      report_conflicting_decl_type(decl, context);
-      return false;
-    }
+    function_ident->type = type;
+  } else if (function_ident->type != type) {
+    report_conflicting_decl_type(decl, context);
+    // Uses of a conflicting block scope declaration can still be checked
+    if (decl->name != function_ident) { decl->name->type = type; }
+    return false;
   }
+  // A block scope declaration has an identifier of its own, which need not be
+  // the one the functions are looked up by
+  decl->name->type = type;
 
-  if (decl->body != nullptr) {
+  if (is_definition) {
     if (function_ident->has_definition) {
       report_multiple_definition(decl, context);
       return false;
@@ -362,22 +487,80 @@ static bool type_check_function_decl(FunctionDecl* decl, Context* context)
       IdentifierInfo* param = decl->params.data[i];
       param->type = typ_int;
     }
-    if (!type_check_block(decl->body, context)) { return false; }
   }
   return true;
 }
 
+static bool type_check_function_decl(FunctionDecl* decl, Context* context)
+{
+  if (!type_check_function_signature_in(decl, decl->body != nullptr, context)) {
+    return false;
+  }
+  return decl->body == nullptr || type_check_block(*decl->body, context);
+}
+
+static ErrorsView errors_view(const Context* context)
+{
+  return (ErrorsView){
+      .data = context->errors.data,
+      .length = context->errors.length,
+  };
+}
+
 ErrorsView type_check(TranslationUnit* ast, Arena* permanent_arena)
 {
   Context context = {.permanent_arena = permanent_arena,
-                     .functions = ast->functions};
+                     .interner = ast->interner,
+                     .types = ast->types,
+                     .nodes = &ast->nodes};
 
   for (uint32_t i = 0; i < ast->decl_count; ++i) {
     type_check_decl(&ast->decls[i], &context);
   }
+  VECTOR_RELEASE(&context.expr_frames);
 
-  return (ErrorsView){
-      .data = context.errors.data,
-      .length = context.errors.length,
+  return errors_view(&context);
+}
+
+struct TypeChecker {
+  Context context;
+};
+
+TypeChecker* new_type_checker(const Interner* interner, TypeInterner* types,
+                              AstNodes* nodes, Arena* permanent_arena)
+{
+  TypeChecker* checker = ARENA_ALLOC_OBJECT(permanent_arena, TypeChecker);
+  *checker = (TypeChecker){
+      .context = {.permanent_arena = permanent_arena,
+                  .interner = interner,
+                  .types = types,
+                  .nodes = nodes},
   };
+  return checker;
+}
+
+void type_check_top_level_decl(TypeChecker* checker, Decl* decl)
+{
+  type_check_decl(decl, &checker->context);
+}
+
+bool type_check_function_signature(TypeChecker* checker, FunctionDecl* decl)
+{
+  return type_check_function_signature_in(decl, true, &checker->context);
+}
+
+void type_check_function_body(TypeChecker* checker, const FunctionDecl* decl)
+{
+  MCC_ASSERT(decl->body != nullptr);
+  (void)type_check_block(*decl->body, &checker->context);
+}
+
+ErrorsView type_checker_errors(const TypeChecker* checker)
+{
+  return errors_view(&checker->context);
+}
+
+void release_type_checker(TypeChecker* checker)
+{
+  VECTOR_RELEASE(&checker->context.expr_frames);
 }
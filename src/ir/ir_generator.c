@@ -30,7 +30,7 @@ static IRValue ir_constant(int32_t constant)
   return (IRValue){.typ = IR_VALUE_TYPE_CONSTANT, .constant = constant};
 }
 
-static IRValue ir_variable(StringView name)
+static IRValue ir_variable(SymbolId name)
 {
   return (IRValue){.typ = IR_VALUE_TYPE_VARIABLE, .variable = name};
 }
@@ -110,6 +110,7 @@ typedef struct IRInstructions {
   IRInstruction* data;
   uint32_t length;
   uint32_t capacity;
+  VirtualRange range;
 } IRInstructions;
 
 struct ErrorVec {
@@ -118,18 +119,66 @@ struct ErrorVec {
   Error* data;
 };
 
+// An expression whose instructions are being emitted. The values of its
+// children that are already emitted are on top of the value stack
+typedef struct ExprEmitFrame {
+  ExprId expr;
+  uint32_t stage; // number of children emitted
+  IRValue result;
+  StringView labels[3];
+} ExprEmitFrame;
+
+struct ExprEmitFrameVec {
+  ExprEmitFrame* data;
+  uint32_t length;
+  uint32_t capacity;
+};
+
+struct IRValueVec {
+  IRValue* data;
+  uint32_t length;
+  uint32_t capacity;
+};
+
+struct StringViewVec {
+  StringView* data;
+  uint32_t length;
+  uint32_t capacity;
+};
+
+struct SymbolIdVec {
+  SymbolId* data;
+  uint32_t length;
+  uint32_t capacity;
+};
+
 // Context for the whole translation unit
 typedef struct IRGenTUContext {
-  Arena* permanent_arena;
+  Arena* permanent_arena; // of the errors
+  Arena* ir_arena;        // of the IR of the current top-level declaration
   Arena* scratch_arena;
+  Interner* interner;
+  const AstNodes* nodes;
 
   struct ErrorVec errors;
+
+  // Explicit stacks of the tree walks, shared by all functions
+  struct ExprEmitFrameVec expr_frames;
+  struct IRValueVec values;
+  struct StringViewVec if_end_labels; // of the `else if` ladders being emitted
+
+  // Temporaries only live within a function, so all functions share the
+  // symbols of their n-th temporaries rather than each interning its own
+  struct SymbolIdVec temporaries;
+
+  // Of the function being generated, which are copied out once it is done
+  IRInstructions instructions;
 } IRGenTUContext;
 
 // context only for the a single function
 typedef struct IRGenProceduralContext {
   IRGenTUContext* tu_context;
-  IRInstructions instructions;
+  IRInstructions* instructions;
   int fresh_variable_counter;
   int fresh_label_counter;
 } IRGenProceduralContext;
@@ -137,32 +186,40 @@ typedef struct IRGenProceduralContext {
 static void push_instruction(IRGenProceduralContext* context,
                              IRInstruction instruction)
 {
-  DYNARRAY_PUSH_BACK(&context->instructions, IRInstruction,
-                     context->tu_context->scratch_arena, instruction);
+  VECTOR_PUSH_BACK(context->instructions, IRInstruction, instruction);
 }
 
-static StringView create_fresh_variable_name(IRGenProceduralContext* context)
+// Generated names are formatted in scratch memory and then copied next to the
+// symbol names, since they outlive the IR in the assembly
+static SymbolId create_fresh_variable_name(IRGenProceduralContext* context)
 {
+  IRGenTUContext* tu_context = context->tu_context;
+  const uint32_t index = (uint32_t)context->fresh_variable_counter++;
+  if (index < tu_context->temporaries.length) {
+    return tu_context->temporaries.data[index];
+  }
+
+  Arena scratch_arena = *tu_context->scratch_arena;
   const StringView variable_name_buffer =
-      allocate_printf(context->tu_context->permanent_arena, "$%d",
-                      context->fresh_variable_counter);
-  ++context->fresh_variable_counter;
-  return variable_name_buffer;
+      allocate_printf(&scratch_arena, "$%u", index);
+  const SymbolId symbol =
+      intern_fresh(tu_context->interner, variable_name_buffer);
+  DYNARRAY_PUSH_BACK(&tu_context->temporaries, SymbolId,
+                     tu_context->scratch_arena, symbol);
+  return symbol;
 }
 
 static StringView create_fresh_label_name(IRGenProceduralContext* context,
                                           const char* name)
 {
-  const StringView variable_name_buffer =
-      allocate_printf(context->tu_context->permanent_arena, "%s_%d", name,
-                      context->fresh_label_counter);
+  Arena scratch_arena = *context->tu_context->scratch_arena;
+  const StringView variable_name_buffer = allocate_printf(
+      &scratch_arena, "%s_%d", name, context->fresh_label_counter);
   ++context->fresh_label_counter;
-  return variable_name_buffer;
+  return interner_copy_string(context->tu_context->interner,
+                              variable_name_buffer);
 }
 
-static IRValue emit_ir_instructions_from_expr(const Expr* expr,
-                                              IRGenProceduralContext* context);
-
 static bool is_assignment(BinaryOpType typ)
 {
   switch (typ) {
@@ -172,13 +229,41 @@ static bool is_assignment(BinaryOpType typ)
   }
 }
 
-static IRValue
-emit_ir_instructions_from_binary_expr(const Expr* expr,
-                                      IRGenProceduralContext* context)
+static void push_value(IRGenProceduralContext* context, IRValue value)
+{
+  DYNARRAY_PUSH_BACK(&context->tu_context->values, IRValue,
+                     context->tu_context->scratch_arena, value);
+}
+
+static IRValue pop_value(IRGenProceduralContext* context)
+{
+  struct IRValueVec* values = &context->tu_context->values;
+  MCC_ASSERT(values->length != 0);
+  return values->data[--values->length];
+}
+
+// The emit_*_step functions below emit the instructions of an expression up to
+// its next child and return that child. Once there are no children left, they
+// push the value of the expression and return NO_EXPR
+
+static ExprId emit_binary_expr_step(ExprEmitFrame* frame,
+                                    IRGenProceduralContext* context)
 {
-  if (is_assignment(expr->binary_op.binary_op_type)) {
+  const ExprPool* exprs = &context->tu_context->nodes->exprs;
+  const BinaryOpType binary_op_type = (BinaryOpType)exprs->ops[frame->expr];
+  const struct BinaryOpExpr binary_op = exprs->data[frame->expr].binary_op;
+
+  switch (frame->stage++) {
+  case 0: return binary_op.lhs;
+  case 1: return binary_op.rhs;
+  }
+
+  const IRValue rhs = pop_value(context);
+  const IRValue lhs = pop_value(context);
+
+  if (is_assignment(binary_op_type)) {
     IRInstructionType compound_op_type = IR_INVALID;
-    switch (expr->binary_op.binary_op_type) {
+    switch (binary_op_type) {
     case BINARY_OP_ASSIGNMENT: break;
     case BINARY_OP_PLUS_EQUAL: compound_op_type = IR_ADD; break;
     case BINARY_OP_MINUS_EQUAL: compound_op_type = IR_SUB; break;
@@ -195,12 +280,6 @@ emit_ir_instructions_from_binary_expr(const Expr* expr,
     default: MCC_UNREACHABLE();
     }
 
-    const IRValue lhs =
-        emit_ir_instructions_from_expr(expr->binary_op.lhs, context);
-
-    const IRValue rhs =
-        emit_ir_instructions_from_expr(expr->binary_op.rhs, context);
-
     if (compound_op_type != IR_INVALID) {
       push_instruction(context, (IRInstruction){
                                     .typ = compound_op_type,
@@ -214,19 +293,14 @@ emit_ir_instructions_from_binary_expr(const Expr* expr,
           (IRInstruction){.typ = IR_COPY, .operand1 = lhs, .operand2 = rhs});
     }
 
-    return lhs;
+    push_value(context, lhs);
+    return NO_EXPR;
   }
 
   const IRInstructionType instruction_type =
-      instruction_typ_from_binary_op(expr->binary_op.binary_op_type);
-
-  const IRValue lhs =
-      emit_ir_instructions_from_expr(expr->binary_op.lhs, context);
+      instruction_typ_from_binary_op(binary_op_type);
 
-  const IRValue rhs =
-      emit_ir_instructions_from_expr(expr->binary_op.rhs, context);
-
-  const StringView dst_name = create_fresh_variable_name(context);
+  const SymbolId dst_name = create_fresh_variable_name(context);
   const IRValue dst = ir_variable(dst_name);
 
   push_instruction(context, (IRInstruction){
@@ -236,191 +310,278 @@ emit_ir_instructions_from_binary_expr(const Expr* expr,
                                 .operand3 = rhs,
                             });
 
-  return dst;
+  push_value(context, dst);
+  return NO_EXPR;
 }
 
-static IRValue
-emit_ir_instructions_from_logical_and(const Expr* expr,
-                                      IRGenProceduralContext* context)
+static ExprId emit_logical_and_step(ExprEmitFrame* frame,
+                                    IRGenProceduralContext* context)
 {
-  const IRValue lhs =
-      emit_ir_instructions_from_expr(expr->binary_op.lhs, context);
-  const StringView lhs_true_label =
-      create_fresh_label_name(context, "and_lhs_true");
-  const StringView rhs_true_label =
-      create_fresh_label_name(context, "and_rhs_true");
-  const StringView false_label = create_fresh_label_name(context, "and_false");
-  const StringView end_label = create_fresh_label_name(context, "and_end");
-
-  const IRValue result = ir_variable(create_fresh_variable_name(context));
-
-  // br lhs .and_lhs_true .and_false
-  push_instruction(context, ir_br(lhs, lhs_true_label, false_label));
-  // .and_lhs_true:
-  push_instruction(context, ir_label(lhs_true_label));
+  const struct BinaryOpExpr binary_op =
+      context->tu_context->nodes->exprs.data[frame->expr].binary_op;
+  StringView* const rhs_true_label = &frame->labels[0];
+  StringView* const false_label = &frame->labels[1];
+  StringView* const end_label = &frame->labels[2];
+
+  switch (frame->stage++) {
+  case 0: return binary_op.lhs;
+  case 1: {
+    const IRValue lhs = pop_value(context);
+    const StringView lhs_true_label =
+        create_fresh_label_name(context, "and_lhs_true");
+    *rhs_true_label = create_fresh_label_name(context, "and_rhs_true");
+    *false_label = create_fresh_label_name(context, "and_false");
+    *end_label = create_fresh_label_name(context, "and_end");
+
+    frame->result = ir_variable(create_fresh_variable_name(context));
+
+    // br lhs .and_lhs_true .and_false
+    push_instruction(context, ir_br(lhs, lhs_true_label, *false_label));
+    // .and_lhs_true:
+    push_instruction(context, ir_label(lhs_true_label));
+
+    return binary_op.rhs;
+  }
+  }
 
-  const IRValue rhs =
-      emit_ir_instructions_from_expr(expr->binary_op.rhs, context);
+  const IRValue rhs = pop_value(context);
+  const IRValue result = frame->result;
 
   // br rhs .and_rhs_true .and_false
-  push_instruction(context, ir_br(rhs, rhs_true_label, false_label));
+  push_instruction(context, ir_br(rhs, *rhs_true_label, *false_label));
 
   // .and_rhs_true:
   // result = 1
   // jmp .and_end
-  push_instruction(context, ir_label(rhs_true_label));
+  push_instruction(context, ir_label(*rhs_true_label));
   push_instruction(context, ir_unary_instr(IR_COPY, result, ir_constant(1)));
-  push_instruction(context, ir_jmp(end_label));
+  push_instruction(context, ir_jmp(*end_label));
 
   // .and_false:
   // result = 0
-  push_instruction(context, ir_label(false_label));
+  push_instruction(context, ir_label(*false_label));
   push_instruction(context, ir_unary_instr(IR_COPY, result, ir_constant(0)));
 
   // .and_end
-  push_instruction(context, ir_label(end_label));
+  push_instruction(context, ir_label(*end_label));
 
-  return result;
+  push_value(context, result);
+  return NO_EXPR;
 }
 
-static IRValue
-emit_ir_instructions_from_logical_or(const Expr* expr,
-                                     IRGenProceduralContext* context)
+static ExprId emit_logical_or_step(ExprEmitFrame* frame,
+                                   IRGenProceduralContext* context)
 {
-  const IRValue lhs =
-      emit_ir_instructions_from_expr(expr->binary_op.lhs, context);
-  const StringView lhs_false_label =
-      create_fresh_label_name(context, "or_lhs_false");
-  const StringView rhs_false_label =
-      create_fresh_label_name(context, "or_rhs_false");
-  const StringView true_label = create_fresh_label_name(context, "or_true");
-  const StringView end_label = create_fresh_label_name(context, "or_end");
-
-  const IRValue result = ir_variable(create_fresh_variable_name(context));
-
-  // br lhs .or_true .or_lhs_false
-  push_instruction(context, ir_br(lhs, true_label, lhs_false_label));
-  // .or_lhs_false:
-  push_instruction(context, ir_label(lhs_false_label));
+  const struct BinaryOpExpr binary_op =
+      context->tu_context->nodes->exprs.data[frame->expr].binary_op;
+  StringView* const rhs_false_label = &frame->labels[0];
+  StringView* const true_label = &frame->labels[1];
+  StringView* const end_label = &frame->labels[2];
+
+  switch (frame->stage++) {
+  case 0: return binary_op.lhs;
+  case 1: {
+    const IRValue lhs = pop_value(context);
+    const StringView lhs_false_label =
+        create_fresh_label_name(context, "or_lhs_false");
+    *rhs_false_label = create_fresh_label_name(context, "or_rhs_false");
+    *true_label = create_fresh_label_name(context, "or_true");
+    *end_label = create_fresh_label_name(context, "or_end");
+
+    frame->result = ir_variable(create_fresh_variable_name(context));
+
+    // br lhs .or_true .or_lhs_false
+    push_instruction(context, ir_br(lhs, *true_label, lhs_false_label));
+    // .or_lhs_false:
+    push_instruction(context, ir_label(lhs_false_label));
+
+    return binary_op.rhs;
+  }
+  }
 
-  const IRValue rhs =
-      emit_ir_instructions_from_expr(expr->binary_op.rhs, context);
+  const IRValue rhs = pop_value(context);
+  const IRValue result = frame->result;
 
   // br rhs .or_true .or_rhs_false
-  push_instruction(context, ir_br(rhs, true_label, rhs_false_label));
+  push_instruction(context, ir_br(rhs, *true_label, *rhs_false_label));
 
   // .or_rhs_false:
   // result = 0
   // jmp .or_end
-  push_instruction(context, ir_label(rhs_false_label));
+  push_instruction(context, ir_label(*rhs_false_label));
   push_instruction(context, ir_unary_instr(IR_COPY, result, ir_constant(0)));
-  push_instruction(context, ir_jmp(end_label));
+  push_instruction(context, ir_jmp(*end_label));
 
   // .or_true:
   // result = 1
-  push_instruction(context, ir_label(true_label));
+  push_instruction(context, ir_label(*true_label));
   push_instruction(context, ir_unary_instr(IR_COPY, result, ir_constant(1)));
 
   // .or_end:
-  push_instruction(context, ir_label(end_label));
+  push_instruction(context, ir_label(*end_label));
 
-  return result;
+  push_value(context, result);
+  return NO_EXPR;
 }
 
-static IRValue emit_ir_instructions_from_expr(const Expr* expr,
-                                              IRGenProceduralContext* context)
+static ExprId emit_ternary_step(ExprEmitFrame* frame,
+                                IRGenProceduralContext* context)
 {
-  switch (expr->tag) {
+  const AstNodes* nodes = context->tu_context->nodes;
+  const struct TernaryExpr ternary =
+      nodes->ternaries.data[nodes->exprs.data[frame->expr].ternary];
+  StringView* const true_label = &frame->labels[0];
+  StringView* const false_label = &frame->labels[1];
+  StringView* const end_label = &frame->labels[2];
+
+  switch (frame->stage++) {
+  case 0:
+    *true_label = create_fresh_label_name(context, "ternary_true");
+    *false_label = create_fresh_label_name(context, "ternary_false");
+    *end_label = create_fresh_label_name(context, "ternary_end");
+
+    frame->result = ir_variable(create_fresh_variable_name(context));
+    return ternary.cond;
+  case 1: {
+    const IRValue cond = pop_value(context);
+
+    // br cond .ternary_true .ternary_false
+    push_instruction(context, ir_br(cond, *true_label, *false_label));
+
+    // .ternary_true
+    // result = {{ true branch }}
+    // jmp .ternary_end
+    push_instruction(context, ir_label(*true_label));
+    return ternary.true_expr;
+  }
+  case 2: {
+    const IRValue true_value = pop_value(context);
+    push_instruction(context,
+                     ir_unary_instr(IR_COPY, frame->result, true_value));
+    push_instruction(context, ir_jmp(*end_label));
+
+    // .ternary_false
+    // result = {{ false branch }}
+    push_instruction(context, ir_label(*false_label));
+    return ternary.false_expr;
+  }
+  }
+
+  const IRValue false_value = pop_value(context);
+  push_instruction(context,
+                   ir_unary_instr(IR_COPY, frame->result, false_value));
+
+  // .ternary_end
+  push_instruction(context, ir_label(*end_label));
+
+  push_value(context, frame->result);
+  return NO_EXPR;
+}
+
+static ExprId emit_call_step(ExprEmitFrame* frame,
+                             IRGenProceduralContext* context)
+{
+  const AstNodes* nodes = context->tu_context->nodes;
+  const struct CallExpr call =
+      nodes->calls.data[nodes->exprs.data[frame->expr].call];
+
+  if (frame->stage < call.arg_count) {
+    return nodes->call_args.data[call.first_arg + frame->stage++];
+  }
+
+  MCC_ASSERT(nodes->exprs.tags[call.function] == EXPR_VARIABLE);
+  const SymbolId function_name =
+      nodes->exprs.data[call.function].variable->name;
+
+  uint32_t arg_count = call.arg_count;
+  IRValue* args =
+      ARENA_ALLOC_ARRAY(context->tu_context->ir_arena, IRValue, arg_count);
+  for (uint32_t i = arg_count; i > 0; --i) {
+    args[i - 1] = pop_value(context);
+  }
+
+  const IRValue result = ir_variable(create_fresh_variable_name(context));
+  push_instruction(context, (IRInstruction){.typ = IR_CALL,
+                                            .call = {
+                                                .func_name = function_name,
+                                                .dest = result,
+                                                .arg_count = arg_count,
+                                                .args = args,
+                                            }});
+
+  push_value(context, result);
+  return NO_EXPR;
+}
+
+static ExprId emit_expr_step(ExprEmitFrame* frame,
+                             IRGenProceduralContext* context)
+{
+  const AstNodes* nodes = context->tu_context->nodes;
+  const ExprId expr = frame->expr;
+  const ExprData data = nodes->exprs.data[expr];
+  switch (nodes->exprs.tags[expr]) {
   case EXPR_INVALID: MCC_UNREACHABLE();
   case EXPR_CONST:
-    return (IRValue){.typ = IR_VALUE_TYPE_CONSTANT,
-                     .constant = expr->const_expr.val};
+    push_value(context, (IRValue){.typ = IR_VALUE_TYPE_CONSTANT,
+                                  .constant = data.const_value});
+    return NO_EXPR;
   case EXPR_UNARY: {
-    const IRValue src =
-        emit_ir_instructions_from_expr(expr->unary_op.inner_expr, context);
+    if (frame->stage++ == 0) { return data.inner_expr; }
+
+    const IRValue src = pop_value(context);
 
-    const StringView dst_name = create_fresh_variable_name(context);
+    const SymbolId dst_name = create_fresh_variable_name(context);
     const IRValue dst = ir_variable(dst_name);
 
     const IRInstructionType instruction_type =
-        instruction_typ_from_unary_op(expr->unary_op.unary_op_type);
+        instruction_typ_from_unary_op((UnaryOpType)nodes->exprs.ops[expr]);
 
     push_instruction(context, ir_unary_instr(instruction_type, dst, src));
 
-    return dst;
+    push_value(context, dst);
+    return NO_EXPR;
   }
   case EXPR_BINARY: {
-    switch (expr->binary_op.binary_op_type) {
-    case BINARY_OP_AND:
-      return emit_ir_instructions_from_logical_and(expr, context);
-    case BINARY_OP_OR:
-      return emit_ir_instructions_from_logical_or(expr, context);
-    default: return emit_ir_instructions_from_binary_expr(expr, context);
+    switch ((BinaryOpType)nodes->exprs.ops[expr]) {
+    case BINARY_OP_AND: return emit_logical_and_step(frame, context);
+    case BINARY_OP_OR: return emit_logical_or_step(frame, context);
+    default: return emit_binary_expr_step(frame, context);
     }
   }
-  case EXPR_VARIABLE: return ir_variable(expr->variable->rewrote_name);
-  case EXPR_TERNARY: {
-    const StringView true_label =
-        create_fresh_label_name(context, "ternary_true");
-    const StringView false_label =
-        create_fresh_label_name(context, "ternary_false");
-    const StringView end_label =
-        create_fresh_label_name(context, "ternary_end");
-
-    const IRValue result = ir_variable(create_fresh_variable_name(context));
-
-    const IRValue cond =
-        emit_ir_instructions_from_expr(expr->ternary.cond, context);
-
-    // br cond .ternary_true .ternary_false
-    push_instruction(context, ir_br(cond, true_label, false_label));
-
-    // .ternary_true
-    // result = {{ true branch }}
-    // jmp .ternary_end
-    push_instruction(context, ir_label(true_label));
-    const IRValue true_value =
-        emit_ir_instructions_from_expr(expr->ternary.true_expr, context);
-    push_instruction(context, ir_unary_instr(IR_COPY, result, true_value));
-    push_instruction(context, ir_jmp(end_label));
-
-    // .ternary_false
-    // result = {{ false branch }}
-    push_instruction(context, ir_label(false_label));
-    const IRValue false_value =
-        emit_ir_instructions_from_expr(expr->ternary.false_expr, context);
-    push_instruction(context, ir_unary_instr(IR_COPY, result, false_value));
-
-    // .ternary_end
-    push_instruction(context, ir_label(end_label));
-    return result;
+  case EXPR_VARIABLE:
+    push_value(context, ir_variable(data.variable->rewrote_name));
+    return NO_EXPR;
+  case EXPR_TERNARY: return emit_ternary_step(frame, context);
+  case EXPR_CALL: return emit_call_step(frame, context);
   }
-  case EXPR_CALL: {
-    Expr* function = expr->call.function;
-    MCC_ASSERT(function->tag == EXPR_VARIABLE);
-    const StringView function_name = function->variable->name;
-
-    uint32_t arg_count = expr->call.arg_count;
-    IRValue* args = ARENA_ALLOC_ARRAY(context->tu_context->permanent_arena,
-                                      IRValue, arg_count);
-    for (uint32_t i = 0; i < arg_count; ++i) {
-      args[i] = emit_ir_instructions_from_expr(expr->call.args[i], context);
-    }
 
-    const IRValue result = ir_variable(create_fresh_variable_name(context));
-    push_instruction(context, (IRInstruction){.typ = IR_CALL,
-                                              .call = {
-                                                  .func_name = function_name,
-                                                  .dest = result,
-                                                  .arg_count = arg_count,
-                                                  .args = args,
-                                              }});
+  MCC_UNREACHABLE();
+}
 
-    return result;
-  }
+// Walks the expression with an explicit stack rather than recursion, so that
+// deeply nested expressions cannot overflow the stack
+static IRValue emit_ir_instructions_from_expr(ExprId expr,
+                                              IRGenProceduralContext* context)
+{
+  IRGenTUContext* tu_context = context->tu_context;
+  struct ExprEmitFrameVec* frames = &tu_context->expr_frames;
+  MCC_ASSERT(frames->length == 0);
+
+  const ExprEmitFrame root = {.expr = expr};
+  DYNARRAY_PUSH_BACK(frames, ExprEmitFrame, tu_context->scratch_arena, root);
+  while (frames->length != 0) {
+    const ExprId child =
+        emit_expr_step(&frames->data[frames->length - 1], context);
+    if (child == NO_EXPR) {
+      --frames->length;
+    } else {
+      const ExprEmitFrame child_frame = {.expr = child};
+      DYNARRAY_PUSH_BACK(frames, ExprEmitFrame, tu_context->scratch_arena,
+                         child_frame);
+    }
   }
 
-  MCC_UNREACHABLE();
+  return pop_value(context);
 }
 
 typedef struct BreakContinueInfo {
@@ -428,14 +589,16 @@ typedef struct BreakContinueInfo {
   StringView continue_label;
 } BreakContinueInfo;
 
-static void emit_ir_instructions_from_stmt(const Stmt* stmt,
+static void emit_ir_instructions_from_stmt(StmtId stmt,
                                            IRGenProceduralContext* context,
                                            BreakContinueInfo* break_info);
 
-static void emit_ir_instructions_from_decl(const VariableDecl* decl,
+static void emit_ir_instructions_from_decl(VariableDeclId id,
                                            IRGenProceduralContext* context)
 {
-  if (decl->initializer != nullptr) {
+  const VariableDecl* decl =
+      &context->tu_context->nodes->variable_decls.data[id];
+  if (decl->initializer != NO_EXPR) {
     const IRValue value =
         emit_ir_instructions_from_expr(decl->initializer, context);
     push_instruction(
@@ -450,15 +613,14 @@ emit_ir_instructions_from_block_item(const BlockItem* item,
                                      BreakContinueInfo* break_info)
 {
   switch (item->tag) {
-  case BLOCK_ITEM_STMT: {
-    const Stmt stmt = item->stmt;
-    emit_ir_instructions_from_stmt(&stmt, context, break_info);
-  } break;
+  case BLOCK_ITEM_STMT:
+    emit_ir_instructions_from_stmt(item->stmt, context, break_info);
+    break;
   case BLOCK_ITEM_DECL:
     switch (item->decl.tag) {
     case DECL_INVALID: MCC_UNREACHABLE(); break;
     case DECL_VAR:
-      emit_ir_instructions_from_decl(&item->decl.var, context);
+      emit_ir_instructions_from_decl(item->decl.var, context);
       break;
     case DECL_FUNC:
       if (item->decl.func->body != nullptr) {
@@ -481,49 +643,75 @@ static void emit_ir_instructions_from_for_init(ForInit init,
   case FOR_INIT_INVALID: MCC_UNREACHABLE();
   case FOR_INIT_DECL: emit_ir_instructions_from_decl(init.decl, context); break;
   case FOR_INIT_EXPR:
-    if (init.expr) { emit_ir_instructions_from_expr(init.expr, context); }
+    if (init.expr != NO_EXPR) {
+      emit_ir_instructions_from_expr(init.expr, context);
+    }
     break;
   }
 }
 
-static void emit_ir_instructions_from_stmt(const Stmt* stmt,
+static void emit_ir_instructions_from_block(Block block,
+                                            IRGenProceduralContext* context,
+                                            BreakContinueInfo* break_info)
+{
+  const BlockItem* items =
+      &context->tu_context->nodes->block_items.data[block.first_child];
+  for (uint32_t i = 0; i < block.child_count; ++i) {
+    emit_ir_instructions_from_block_item(&items[i], context, break_info);
+  }
+}
+
+static void emit_ir_instructions_from_stmt(StmtId stmt,
                                            IRGenProceduralContext* context,
                                            BreakContinueInfo* break_info)
 {
-  switch (stmt->tag) {
+  const AstNodes* nodes = context->tu_context->nodes;
+  const StmtData data = nodes->stmts.data[stmt];
+  switch (nodes->stmts.tags[stmt]) {
   case STMT_INVALID: MCC_UNREACHABLE();
   case STMT_EMPTY: break;
   case STMT_EXPR: {
-    emit_ir_instructions_from_expr(stmt->expr, context);
+    emit_ir_instructions_from_expr(data.expr, context);
   } break;
   case STMT_RETURN: {
     const IRValue return_value =
-        emit_ir_instructions_from_expr(stmt->ret.expr, context);
+        emit_ir_instructions_from_expr(data.expr, context);
 
     push_instruction(context, ir_single_operand_instr(IR_RETURN, return_value));
   } break;
   case STMT_COMPOUND: {
-    for (size_t i = 0; i < stmt->compound.child_count; ++i) {
-      emit_ir_instructions_from_block_item(&stmt->compound.children[i], context,
-                                           break_info);
-    }
+    emit_ir_instructions_from_block(data.compound, context, break_info);
   } break;
   case STMT_IF: {
-    const StringView if_label = create_fresh_label_name(context, "if");
-    const StringView if_end_label = create_fresh_label_name(context, "if_end");
+    // Ladders of `else if` can be arbitrarily long, so walk them in a loop.
+    // Each if ends after its else branch, which is the rest of the ladder
+    struct StringViewVec* if_end_labels = &context->tu_context->if_end_labels;
+    const uint32_t base = if_end_labels->length;
 
-    const IRValue cond =
-        emit_ir_instructions_from_expr(stmt->if_then.cond, context);
+    for (StmtId current = stmt;;) {
+      const struct IfStmt if_then =
+          nodes->ifs.data[nodes->stmts.data[current].if_then];
 
-    if (stmt->if_then.els == nullptr) {
-      // br cond .if .if_end
-      push_instruction(context, ir_br(cond, if_label, if_end_label));
+      const StringView if_label = create_fresh_label_name(context, "if");
+      const StringView if_end_label =
+          create_fresh_label_name(context, "if_end");
+      DYNARRAY_PUSH_BACK(if_end_labels, StringView,
+                         context->tu_context->scratch_arena, if_end_label);
+
+      const IRValue cond =
+          emit_ir_instructions_from_expr(if_then.cond, context);
+
+      if (if_then.els == NO_STMT) {
+        // br cond .if .if_end
+        push_instruction(context, ir_br(cond, if_label, if_end_label));
+
+        // .if
+        // {{ then branch }}
+        push_instruction(context, ir_label(if_label));
+        emit_ir_instructions_from_stmt(if_then.then, context, break_info);
+        break;
+      }
 
-      // .if
-      // {{ then branch }}
-      push_instruction(context, ir_label(if_label));
-      emit_ir_instructions_from_stmt(stmt->if_then.then, context, break_info);
-    } else {
       const StringView else_label = create_fresh_label_name(context, "else");
 
       // br cond .if .else
@@ -533,17 +721,25 @@ static void emit_ir_instructions_from_stmt(const Stmt* stmt,
       // {{ then branch }}
       // jmp .end
       push_instruction(context, ir_label(if_label));
-      emit_ir_instructions_from_stmt(stmt->if_then.then, context, break_info);
+      emit_ir_instructions_from_stmt(if_then.then, context, break_info);
       push_instruction(context, ir_jmp(if_end_label));
 
       // .else
       // {{ else branch }}
       push_instruction(context, ir_label(else_label));
-      emit_ir_instructions_from_stmt(stmt->if_then.els, context, break_info);
+      if (nodes->stmts.tags[if_then.els] != STMT_IF) {
+        emit_ir_instructions_from_stmt(if_then.els, context, break_info);
+        break;
+      }
+      current = if_then.els;
     }
 
-    // .if_end
-    push_instruction(context, ir_label(if_end_label));
+    // .if_end, from the innermost if outwards
+    while (if_end_labels->length != base) {
+      push_instruction(
+          context,
+          ir_label(if_end_labels->data[--if_end_labels->length]));
+    }
   } break;
   case STMT_WHILE: {
     const StringView start_label =
@@ -557,7 +753,7 @@ static void emit_ir_instructions_from_stmt(const Stmt* stmt,
 
     // cond = {{ evaluate condition }}
     const IRValue cond =
-        emit_ir_instructions_from_expr(stmt->while_loop.cond, context);
+        emit_ir_instructions_from_expr(data.while_loop.cond, context);
 
     // br cond .body .end
     push_instruction(context, ir_br(cond, body_label, end_label));
@@ -569,7 +765,7 @@ static void emit_ir_instructions_from_stmt(const Stmt* stmt,
         .break_label = end_label,
         .continue_label = start_label,
     };
-    emit_ir_instructions_from_stmt(stmt->while_loop.body, context, &loop_info);
+    emit_ir_instructions_from_stmt(data.while_loop.body, context, &loop_info);
 
     // jmp .start
     push_instruction(context, ir_jmp(start_label));
@@ -592,13 +788,13 @@ static void emit_ir_instructions_from_stmt(const Stmt* stmt,
         .break_label = end_label,
         .continue_label = continue_label,
     };
-    emit_ir_instructions_from_stmt(stmt->while_loop.body, context, &loop_info);
+    emit_ir_instructions_from_stmt(data.while_loop.body, context, &loop_info);
 
     // .continue
     // cond = {{ evaluate condition }}
     push_instruction(context, ir_label(continue_label));
     const IRValue cond =
-        emit_ir_instructions_from_expr(stmt->while_loop.cond, context);
+        emit_ir_instructions_from_expr(data.while_loop.cond, context);
 
     // br cond .start .end
     push_instruction(context, ir_br(cond, start_label, end_label));
@@ -607,6 +803,8 @@ static void emit_ir_instructions_from_stmt(const Stmt* stmt,
     push_instruction(context, ir_label(end_label));
   } break;
   case STMT_FOR: {
+    const struct For for_loop = nodes->for_loops.data[data.for_loop];
+
     const StringView start_label =
         create_fresh_label_name(context, "for_start");
     const StringView body_label = create_fresh_label_name(context, "for_body");
@@ -615,16 +813,16 @@ static void emit_ir_instructions_from_stmt(const Stmt* stmt,
     const StringView end_label = create_fresh_label_name(context, "for_end");
 
     // {{ for init }}
-    emit_ir_instructions_from_for_init(stmt->for_loop.init, context);
+    emit_ir_instructions_from_for_init(for_loop.init, context);
 
     // .start
     push_instruction(context, ir_label(start_label));
 
-    if (stmt->for_loop.cond) {
+    if (for_loop.cond != NO_EXPR) {
 
       // cond = {{ evaluate condition }}
       const IRValue cond =
-          emit_ir_instructions_from_expr(stmt->for_loop.cond, context);
+          emit_ir_instructions_from_expr(for_loop.cond, context);
 
       // br cond .body .end
       push_instruction(context, ir_br(cond, body_label, end_label));
@@ -637,14 +835,14 @@ static void emit_ir_instructions_from_stmt(const Stmt* stmt,
         .break_label = end_label,
         .continue_label = continue_label,
     };
-    emit_ir_instructions_from_stmt(stmt->for_loop.body, context, &loop_info);
+    emit_ir_instructions_from_stmt(for_loop.body, context, &loop_info);
 
     // .continue
     push_instruction(context, ir_label(continue_label));
 
-    if (stmt->for_loop.post) {
+    if (for_loop.post != NO_EXPR) {
       // {{ execute post expression }}
-      emit_ir_instructions_from_expr(stmt->for_loop.post, context);
+      emit_ir_instructions_from_expr(for_loop.post, context);
     }
 
     // jmp .start
@@ -660,7 +858,7 @@ static void emit_ir_instructions_from_stmt(const Stmt* stmt,
     } else {
       Error error = (Error){
           .msg = str("'break' statement not in loop or switch statement"),
-          .range = stmt->source_range};
+          .range = nodes->stmts.source_ranges[stmt]};
       DYNARRAY_PUSH_BACK(&context->tu_context->errors, Error,
                          context->tu_context->permanent_arena, error);
     }
@@ -672,7 +870,7 @@ static void emit_ir_instructions_from_stmt(const Stmt* stmt,
     } else {
       Error error = (Error){
           .msg = str("'continue' statement not in loop or switch statement"),
-          .range = stmt->source_range};
+          .range = nodes->stmts.source_ranges[stmt]};
       DYNARRAY_PUSH_BACK(&context->tu_context->errors, Error,
                          context->tu_context->permanent_arena, error);
     }
@@ -684,37 +882,34 @@ static IRFunctionDef generate_ir_function_def(const FunctionDecl* decl,
                                               IRGenTUContext* tu_context)
 
 {
+  IRInstructions* function_instructions = &tu_context->instructions;
+  function_instructions->length = 0;
   IRGenProceduralContext context =
       (IRGenProceduralContext){.tu_context = tu_context,
-                               .instructions = {},
+                               .instructions = function_instructions,
                                .fresh_variable_counter = 0};
 
-  for (size_t i = 0; i < decl->body->child_count; ++i) {
-    emit_ir_instructions_from_block_item(&decl->body->children[i], &context,
-                                         nullptr);
-  }
+  emit_ir_instructions_from_block(*decl->body, &context, nullptr);
 
   // return 0 for main if there is no return statement at the end
   // TODO: should only do that for the main function
-  if (context.instructions.length == 0 ||
-      context.instructions.data[context.instructions.length - 1].typ !=
+  if (function_instructions->length == 0 ||
+      function_instructions->data[function_instructions->length - 1].typ !=
           IR_RETURN) {
     push_instruction(&context,
                      ir_single_operand_instr(IR_RETURN, ir_constant(0)));
   }
 
   // allocate and copy instructions to permanent arena
-  IRInstruction* instructions = nullptr;
-  if (context.instructions.data != nullptr) {
-    instructions = ARENA_ALLOC_ARRAY(tu_context->permanent_arena, IRInstruction,
-                                     context.instructions.length);
-    memcpy(instructions, context.instructions.data,
-           context.instructions.length * sizeof(IRInstruction));
-  }
+  const uint32_t instruction_count = function_instructions->length;
+  IRInstruction* instructions = ARENA_ALLOC_ARRAY(
+      tu_context->ir_arena, IRInstruction, instruction_count);
+  memcpy(instructions, function_instructions->data,
+         instruction_count * sizeof(IRInstruction));
 
   uint32_t param_count = decl->params.length;
-  StringView* parameters =
-      ARENA_ALLOC_ARRAY(tu_context->permanent_arena, StringView, param_count);
+  SymbolId* parameters =
+      ARENA_ALLOC_ARRAY(tu_context->ir_arena, SymbolId, param_count);
   for (uint32_t i = 0; i < param_count; ++i) {
     parameters[i] = decl->params.data[i]->rewrote_name;
   }
@@ -722,10 +917,49 @@ static IRFunctionDef generate_ir_function_def(const FunctionDecl* decl,
   return (IRFunctionDef){.name = decl->name->name,
                          .param_count = param_count,
                          .params = parameters,
-                         .instruction_count = context.instructions.length,
+                         .instruction_count = instruction_count,
                          .instructions = instructions};
 }
 
+// Generates the IR of a top-level declaration, or returns nullptr if it has
+// none
+static IRTopLevel* generate_ir_top_level(const Decl* decl,
+                                         IRGenTUContext* context)
+{
+  const AstNodes* nodes = context->nodes;
+  switch (decl->tag) {
+  case DECL_INVALID: MCC_UNREACHABLE(); break;
+  case DECL_VAR: {
+    IRTopLevel* top_level = ARENA_ALLOC_OBJECT(context->ir_arena, IRTopLevel);
+
+    const VariableDecl* var = &nodes->variable_decls.data[decl->var];
+    int32_t value = 0;
+    if (var->initializer != NO_EXPR) {
+      MCC_ASSERT(nodes->exprs.tags[var->initializer] == EXPR_CONST);
+      value = nodes->exprs.data[var->initializer].const_value;
+    }
+
+    *top_level = (IRTopLevel){
+        .tag = IR_TOP_LEVEL_VARIABLE,
+        .variable = (IRGlobalVariable){.name = var->name->name, .value = value},
+    };
+    return top_level;
+  }
+  case DECL_FUNC:
+    if (decl->func->body != nullptr) {
+      IRTopLevel* top_level =
+          ARENA_ALLOC_OBJECT(context->ir_arena, IRTopLevel);
+      *top_level = (IRTopLevel){
+          .tag = IR_TOP_LEVEL_FUNCTION,
+          .function = generate_ir_function_def(decl->func, context),
+      };
+      return top_level;
+    }
+    break;
+  }
+  return nullptr;
+}
+
 typedef struct IRTopLevelVec {
   IRTopLevel** data;
   uint32_t length;
@@ -738,42 +972,17 @@ IRGenerationResult ir_generate(const TranslationUnit* ast,
   IRTopLevelVec top_level_vec = {};
 
   IRGenTUContext context = (IRGenTUContext){.permanent_arena = permanent_arena,
+                                            .ir_arena = permanent_arena,
                                             .scratch_arena = &scratch_arena,
+                                            .interner = ast->interner,
+                                            .nodes = &ast->nodes,
                                             .errors = (struct ErrorVec){}};
 
   for (size_t i = 0; i < ast->decl_count; i++) {
-    Decl* decl = &ast->decls[i];
-    switch (decl->tag) {
-    case DECL_INVALID: MCC_UNREACHABLE(); break;
-    case DECL_VAR: {
-      IRTopLevel* top_level = ARENA_ALLOC_OBJECT(permanent_arena, IRTopLevel);
-
-      int32_t value = 0;
-      if (decl->var.initializer) {
-        MCC_ASSERT(decl->var.initializer->tag == EXPR_CONST);
-        value = decl->var.initializer->const_expr.val;
-      }
-
-      *top_level = (IRTopLevel){
-          .tag = IR_TOP_LEVEL_VARIABLE,
-          .variable =
-              (IRGlobalVariable){.name = decl->var.name->name, .value = value},
-      };
+    IRTopLevel* top_level = generate_ir_top_level(&ast->decls[i], &context);
+    if (top_level != nullptr) {
       DYNARRAY_PUSH_BACK(&top_level_vec, IRTopLevel*, &scratch_arena,
                          top_level);
-
-    } break;
-    case DECL_FUNC:
-      if (decl->func->body != nullptr) {
-        IRTopLevel* top_level = ARENA_ALLOC_OBJECT(permanent_arena, IRTopLevel);
-        *top_level = (IRTopLevel){
-            .tag = IR_TOP_LEVEL_FUNCTION,
-            .function = generate_ir_function_def(decl->func, &context),
-        };
-        DYNARRAY_PUSH_BACK(&top_level_vec, IRTopLevel*, &scratch_arena,
-                           top_level);
-      }
-      break;
     }
   }
 
@@ -782,12 +991,15 @@ IRGenerationResult ir_generate(const TranslationUnit* ast,
   memcpy(ir_top_levels, top_level_vec.data,
          top_level_vec.length * sizeof(IRTopLevel*));
 
+  VECTOR_RELEASE(&context.instructions);
+
   IRProgram* program = nullptr;
   if (context.errors.length == 0) {
     program = ARENA_ALLOC_OBJECT(permanent_arena, IRProgram);
     *program = (IRProgram){
         .top_level_count = top_level_vec.length,
         .top_levels = ir_top_levels,
+        .interner = ast->interner,
     };
   }
 
@@ -798,3 +1010,43 @@ IRGenerationResult ir_generate(const TranslationUnit* ast,
                                   },
                               .program = program};
 }
+
+struct IRGenerator {
+  IRGenTUContext context;
+  Arena scratch_arena;
+};
+
+IRGenerator* new_ir_generator(Interner* interner, Arena* permanent_arena,
+                              Arena scratch_arena)
+{
+  IRGenerator* generator = ARENA_ALLOC_OBJECT(permanent_arena, IRGenerator);
+  *generator = (IRGenerator){.scratch_arena = scratch_arena};
+  generator->context = (IRGenTUContext){
+      .permanent_arena = permanent_arena,
+      .scratch_arena = &generator->scratch_arena,
+      .interner = interner,
+  };
+  return generator;
+}
+
+IRTopLevel* ir_generate_top_level(IRGenerator* generator, const Decl* decl,
+                                  const AstNodes* nodes, Arena* arena)
+{
+  IRGenTUContext* context = &generator->context;
+  context->ir_arena = arena;
+  context->nodes = nodes;
+
+  const size_t error_count = context->errors.length;
+  IRTopLevel* top_level = generate_ir_top_level(decl, context);
+  return context->errors.length == error_count ? top_level : nullptr;
+}
+
+ErrorsView finish_ir_generator(IRGenerator* generator)
+{
+  IRGenTUContext* context = &generator->context;
+  VECTOR_RELEASE(&context->instructions);
+  return (ErrorsView){
+      .length = context->errors.length,
+      .data = context->errors.data,
+  };
+}
@@ -1,42 +1,50 @@
 #include <mcc/ir.h>
 
-static void print_ir_value(IRValue value)
+static void print_symbol(const Interner* interner, SymbolId symbol)
+{
+  const StringView name = symbol_name(interner, symbol);
+  printf("%.*s", (int)name.size, name.start);
+}
+
+static void print_ir_value(const Interner* interner, IRValue value)
 {
   switch (value.typ) {
   case IR_VALUE_TYPE_CONSTANT: printf("%i", value.constant); break;
-  case IR_VALUE_TYPE_VARIABLE:
-    printf("%.*s", (int)value.variable.size, value.variable.start);
-    break;
+  case IR_VALUE_TYPE_VARIABLE: print_symbol(interner, value.variable); break;
   }
 }
 
-static void print_unary_op(IRInstruction instruction, const char* op_name)
+static void print_unary_op(const Interner* interner, IRInstruction instruction,
+                           const char* op_name)
 {
   printf("  ");
-  print_ir_value(instruction.operand1); // dest
+  print_ir_value(interner, instruction.operand1); // dest
   printf(" = %s ", op_name);
-  print_ir_value(instruction.operand2); // src
+  print_ir_value(interner, instruction.operand2); // src
   printf("\n");
 }
 
-static void print_binary_op(IRInstruction instruction, const char* op_name)
+static void print_binary_op(const Interner* interner, IRInstruction instruction,
+                            const char* op_name)
 {
   printf("  ");
-  print_ir_value(instruction.operand1); // dest
+  print_ir_value(interner, instruction.operand1); // dest
   printf(" = %s ", op_name);
-  print_ir_value(instruction.operand2); // lhs
+  print_ir_value(interner, instruction.operand2); // lhs
   printf(" ");
-  print_ir_value(instruction.operand3); // rhs
+  print_ir_value(interner, instruction.operand3); // rhs
   printf("\n");
 }
 
-static void print_ir_function(const IRFunctionDef* function)
+static void print_ir_function(const Interner* interner,
+                              const IRFunctionDef* function)
 {
-  const StringView name = function->name;
-  printf("func %.*s(", (int)name.size, name.start);
+  printf("func ");
+  print_symbol(interner, function->name);
+  printf("(");
   for (uint32_t j = 0; j < function->param_count; ++j) {
     if (j != 0) { printf(", "); }
-    printf("%.*s", (int)function->params[j].size, function->params[j].start);
+    print_symbol(interner, function->params[j]);
   }
   printf("):\n");
 
@@ -46,37 +54,45 @@ static void print_ir_function(const IRFunctionDef* function)
     case IR_INVALID: MCC_UNREACHABLE(); break;
     case IR_RETURN: {
       printf("  return ");
-      print_ir_value(instruction.operand1);
+      print_ir_value(interner, instruction.operand1);
       printf("\n");
     } break;
-    case IR_COPY: print_unary_op(instruction, "copy"); break;
-    case IR_NEG: print_unary_op(instruction, "neg"); break;
-    case IR_COMPLEMENT: print_unary_op(instruction, "complement"); break;
-    case IR_NOT: print_unary_op(instruction, "not"); break;
-    case IR_ADD: print_binary_op(instruction, "add"); break;
-    case IR_SUB: print_binary_op(instruction, "sub"); break;
-    case IR_MUL: print_binary_op(instruction, "mul"); break;
-    case IR_DIV: print_binary_op(instruction, "div"); break;
-    case IR_MOD: print_binary_op(instruction, "mod"); break;
-    case IR_BITWISE_AND: print_binary_op(instruction, "bitand"); break;
-    case IR_BITWISE_OR: print_binary_op(instruction, "bitor"); break;
-    case IR_BITWISE_XOR: print_binary_op(instruction, "xor"); break;
-    case IR_SHIFT_LEFT: print_binary_op(instruction, "shl"); break;
-    case IR_SHIFT_RIGHT_ARITHMETIC: print_binary_op(instruction, "ashr"); break;
-    case IR_SHIFT_RIGHT_LOGICAL: print_binary_op(instruction, "lshr"); break;
-    case IR_EQUAL: print_binary_op(instruction, "eq"); break;
-    case IR_NOT_EQUAL: print_binary_op(instruction, "ne"); break;
-    case IR_LESS: print_binary_op(instruction, "lt"); break;
-    case IR_LESS_EQUAL: print_binary_op(instruction, "le"); break;
-    case IR_GREATER: print_binary_op(instruction, "gt"); break;
-    case IR_GREATER_EQUAL: print_binary_op(instruction, "ge"); break;
+    case IR_COPY: print_unary_op(interner, instruction, "copy"); break;
+    case IR_NEG: print_unary_op(interner, instruction, "neg"); break;
+    case IR_COMPLEMENT:
+      print_unary_op(interner, instruction, "complement");
+      break;
+    case IR_NOT: print_unary_op(interner, instruction, "not"); break;
+    case IR_ADD: print_binary_op(interner, instruction, "add"); break;
+    case IR_SUB: print_binary_op(interner, instruction, "sub"); break;
+    case IR_MUL: print_binary_op(interner, instruction, "mul"); break;
+    case IR_DIV: print_binary_op(interner, instruction, "div"); break;
+    case IR_MOD: print_binary_op(interner, instruction, "mod"); break;
+    case IR_BITWISE_AND:
+      print_binary_op(interner, instruction, "bitand");
+      break;
+    case IR_BITWISE_OR: print_binary_op(interner, instruction, "bitor"); break;
+    case IR_BITWISE_XOR: print_binary_op(interner, instruction, "xor"); break;
+    case IR_SHIFT_LEFT: print_binary_op(interner, instruction, "shl"); break;
+    case IR_SHIFT_RIGHT_ARITHMETIC:
+      print_binary_op(interner, instruction, "ashr");
+      break;
+    case IR_SHIFT_RIGHT_LOGICAL:
+      print_binary_op(interner, instruction, "lshr");
+      break;
+    case IR_EQUAL: print_binary_op(interner, instruction, "eq"); break;
+    case IR_NOT_EQUAL: print_binary_op(interner, instruction, "ne"); break;
+    case IR_LESS: print_binary_op(interner, instruction, "lt"); break;
+    case IR_LESS_EQUAL: print_binary_op(interner, instruction, "le"); break;
+    case IR_GREATER: print_binary_op(interner, instruction, "gt"); break;
+    case IR_GREATER_EQUAL: print_binary_op(interner, instruction, "ge"); break;
     case IR_JMP: {
       printf("  jmp ");
       printf(".%.*s\n", (int)instruction.label.size, instruction.label.start);
     } break;
     case IR_BR: {
       printf("  br ");
-      print_ir_value(instruction.cond);
+      print_ir_value(interner, instruction.cond);
       printf(" .%.*s .%.*s\n",                                           //
              (int)instruction.if_label.size, instruction.if_label.start, //
              (int)instruction.else_label.size, instruction.else_label.start);
@@ -86,12 +102,13 @@ static void print_ir_function(const IRFunctionDef* function)
     } break;
     case IR_CALL: {
       printf("  ");
-      print_ir_value(instruction.call.dest);
-      printf(" = call %.*s(", (int)instruction.call.func_name.size,
-             instruction.call.func_name.start);
+      print_ir_value(interner, instruction.call.dest);
+      printf(" = call ");
+      print_symbol(interner, instruction.call.func_name);
+      printf("(");
       for (uint32_t k = 0; k < instruction.call.arg_count; ++k) {
         if (k != 0) { printf(", "); }
-        print_ir_value(instruction.call.args[k]);
+        print_ir_value(interner, instruction.call.args[k]);
       }
       printf(")\n");
     } break;
@@ -99,9 +116,12 @@ static void print_ir_function(const IRFunctionDef* function)
   }
 }
 
-static void print_ir_global_var(const IRGlobalVariable* var)
+static void print_ir_global_var(const Interner* interner,
+                                const IRGlobalVariable* var)
 {
-  printf("global %.*s: i32\n", (int)var->name.size, var->name.start);
+  printf("global ");
+  print_symbol(interner, var->name);
+  printf(": i32\n");
 }
 
 void print_ir(const IRProgram* ir)
@@ -110,9 +130,11 @@ void print_ir(const IRProgram* ir)
     IRTopLevel* top_level = ir->top_levels[i];
     switch (top_level->tag) {
     case IR_TOP_LEVEL_INVALID: MCC_UNREACHABLE(); break;
-    case IR_TOP_LEVEL_FUNCTION: print_ir_function(&top_level->function); break;
+    case IR_TOP_LEVEL_FUNCTION:
+      print_ir_function(ir->interner, &top_level->function);
+      break;
     case IR_TOP_LEVEL_VARIABLE:
-      print_ir_global_var(&top_level->variable);
+      print_ir_global_var(ir->interner, &top_level->variable);
       break;
     }
   }
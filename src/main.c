@@ -6,9 +6,9 @@
 #include <mcc/cli_args.h>
 #include <mcc/diagnostic.h>
 #include <mcc/frontend.h>
+#include <mcc/interner.h>
 #include <mcc/ir.h>
 #include <mcc/prelude.h>
-#include <mcc/sema.h>
 #include <mcc/str.h>
 #include <mcc/type.h>
 #include <mcc/x86.h>
@@ -89,18 +89,161 @@ static StringBuffer replace_extension(const char* filename, const char* ext,
   return output;
 }
 
-static void save_x86_asm_file(const char* filename, const X86Program* program)
+static FILE* open_asm_file(const char* filename)
 {
   FILE* asm_file = fopen(filename, "w");
   if (!asm_file) {
-    fprintf(stderr, "Cannot open asm file %s", "a.asm");
+    (void)fprintf(stderr, "Cannot open asm file %s", filename);
     exit(1);
   }
+  return asm_file;
+}
+
+// Copies a file from its start to stdout. Returns false if either fails
+static bool copy_to_stdout(FILE* file)
+{
+  char buffer[16 * 1024];
+  rewind(file);
+  size_t size = 0;
+  while ((size = fread(buffer, 1, sizeof(buffer), file)) != 0) {
+    if (fwrite(buffer, 1, size, stdout) != size) { return false; }
+  }
+  return !ferror(file) && fflush(stdout) == 0;
+}
+
+// The assembly bypasses the buffer of the FILE, which is only used to open and
+// close the file
+static void save_x86_asm_file(const char* filename, const X86Program* program,
+                              Arena scratch_arena)
+{
+  FILE* asm_file = open_asm_file(filename);
   MCC_DEFER(fclose(asm_file))
   {
-    x86_dump_assembly(program, asm_file);
-    if (ferror(asm_file)) { perror("Failed to write asm_file"); }
+    if (!x86_write_assembly(program, fileno(asm_file), scratch_arena)) {
+      perror("Failed to write asm_file");
+    }
+  }
+}
+
+// Unless only the AST is asked for, each declaration is type checked as soon as
+// it is parsed, rather than in another walk over the whole AST. The tokens go
+// to token_arena, which is dead once this returns, and the AST to ast_arena
+static ParseResult parse_source(const char* src, const CliArgs* args,
+                                Interner* interner, Arena* token_arena,
+                                Arena* ast_arena, Arena scratch_arena)
+{
+  if (args->stop_after_parser) {
+    return args->stream_tokens
+               ? parse_on_demand(src, ast_arena, scratch_arena)
+               : parse(src, lex(src, token_arena), ast_arena, scratch_arena);
+  }
+  if (args->stream_tokens) {
+    return parse_on_demand_and_type_check(src, interner, ast_arena,
+                                          scratch_arena);
+  }
+  const Tokens tokens = lex_with_interner(src, interner, token_arena);
+  if (args->parallel_bodies) {
+    return parse_and_type_check_with_threads(src, tokens, 0, ast_arena,
+                                             scratch_arena);
+  }
+  return args->skim_bodies
+             ? parse_reachable_and_type_check(src, tokens, ast_arena,
+                                              scratch_arena)
+             : parse_and_type_check(src, tokens, ast_arena, scratch_arena);
+}
+
+// Compiles the top-level declarations one at a time, as the parser hands them
+// over
+typedef struct StreamingCompiler {
+  IRGenerator* ir_generator;
+  X86Emitter* emitter;
+  Arena ir_arena; // reused by each declaration
+} StreamingCompiler;
+
+static void compile_decl(void* context, const Decl* decl, const AstNodes* nodes)
+{
+  StreamingCompiler* compiler = context;
+  Arena ir_arena = compiler->ir_arena;
+  const IRTopLevel* ir = ir_generate_top_level(compiler->ir_generator, decl,
+                                               nodes, &ir_arena);
+  if (ir != nullptr) { x86_emit_top_level(compiler->emitter, ir); }
+}
+
+// Writes the assembly of each function as soon as it is parsed and checked,
+// so that only one function at a time is in memory past the parser. Returns
+// false if there are errors, which are reported in the same order as when the
+// phases run one after another, and no assembly file is left behind then
+static bool compile_streaming(const char* src, const CliArgs* args,
+                              Interner* interner, const char* asm_filename,
+                              DiagnosticsSink* diagnostics,
+                              Arena* permanent_arena, Arena* ast_arena,
+                              Arena scratch_arena)
+{
+  // With --codegen, the assembly waits in a temporary file until the whole file
+  // compiled, so that a later error leaves nothing on stdout
+  FILE* asm_file = args->codegen_only ? tmpfile() : open_asm_file(asm_filename);
+  if (!asm_file) {
+    perror("Cannot create a temporary file for the assembly");
+    exit(1);
+  }
+
+  // The generator and the emitter keep stacks in their scratch memory across
+  // declarations, so each has an arena of its own
+  Arena ir_scratch_arena = arena_from_virtual_mem(1024 * 1024);
+  Arena x86_scratch_arena = arena_from_virtual_mem(1024 * 1024);
+  StreamingCompiler compiler = {
+      .ir_generator =
+          new_ir_generator(interner, permanent_arena, ir_scratch_arena),
+      .emitter = new_x86_emitter(interner, fileno(asm_file), permanent_arena,
+                                 x86_scratch_arena),
+      .ir_arena = arena_from_virtual_mem(1024 * 1024),
+  };
+  const ParseResult parse_result = parse_on_demand_into_sink(
+      src, interner, (DeclSink){.consume = compile_decl, .context = &compiler},
+      ast_arena, scratch_arena);
+  const ErrorsView ir_errors = finish_ir_generator(compiler.ir_generator);
+  if (!finish_x86_emitter(compiler.emitter)) {
+    perror("Failed to write asm_file");
+  }
+  arena_release_virtual_mem(&compiler.ir_arena);
+  arena_release_virtual_mem(&ir_scratch_arena);
+  arena_release_virtual_mem(&x86_scratch_arena);
+
+  (void)report_diagnostics(diagnostics, parse_result.errors);
+  bool succeeded = parse_result.ast != NULL;
+  if (succeeded && parse_result.type_errors.length != 0) {
+    (void)report_diagnostics(diagnostics, parse_result.type_errors);
+    succeeded = false;
+  } else if (succeeded && ir_errors.length != 0) {
+    (void)report_diagnostics(diagnostics, ir_errors);
+    succeeded = false;
+  }
+
+  if (args->codegen_only && succeeded && !copy_to_stdout(asm_file)) {
+    perror("Failed to write assembly");
+    succeeded = false;
   }
+  fclose(asm_file);
+  if (!succeeded && !args->codegen_only) { (void)remove(asm_filename); }
+  return succeeded;
+}
+
+static void assemble_and_link(const char* src_filename, const CliArgs* args,
+                              const StringBuffer* asm_filename,
+                              Arena* permanent_arena)
+{
+  if (args->compile_only) { return; }
+
+  const StringBuffer obj_filename =
+      replace_extension(src_filename, ".o", permanent_arena);
+  assemble(str_from_buffer(asm_filename), str_from_buffer(&obj_filename));
+
+  if (args->stop_before_linker) { return; }
+
+  const StringBuffer executable_name =
+      replace_extension(src_filename, "", permanent_arena);
+  link(string_buffer_c_str(&obj_filename),
+       string_buffer_c_str(&executable_name));
 }
 
 static void preprocess(const char* src_filename,
@@ -109,7 +252,7 @@ static void preprocess(const char* src_filename,
   enum { buffer_size = 10000 };
   char buffer[buffer_size];
 
-  const int print_size = snprintf(buffer, buffer_size, "gcc -E -P %s -o %s",
+  const int print_size = snprintf(buffer, buffer_size, "gcc -E %s -o %s",
                                   src_filename, preprocessed_filename);
   MCC_ASSERT_MSG(print_size < buffer_size,
                  "Buffer too small to hold preprocessing command");
@@ -121,14 +264,20 @@ static void preprocess(const char* src_filename,
 
 int main(int argc, char* argv[])
 {
-  // 4 GB virtual memory
-  Arena permanent_arena = arena_from_virtual_mem(4000000000);
-
-  // 40 MB virtual memory
-  Arena scratch_arena = arena_from_virtual_mem(40000000);
-
   const CliArgs args = parse_cli_args(argc, argv);
 
+  // All arenas start small and grow with the input. The output of each phase
+  // has an arena of its own, which is given back to the OS as soon as the next
+  // phase is done with it. What outlives the phases, such as the source and the
+  // symbol names, is in the permanent arena
+  arena_set_memory_limit(args.max_memory);
+  arena_set_huge_pages(args.huge_pages);
+  Arena permanent_arena = arena_from_virtual_mem(16 * 1024 * 1024);
+  Arena scratch_arena = arena_from_virtual_mem(1024 * 1024);
+  Arena token_arena = arena_from_virtual_mem(1024 * 1024);
+  Arena ast_arena = arena_from_virtual_mem(1024 * 1024);
+  Arena ir_arena = arena_from_virtual_mem(1024 * 1024);
+
   const char* src_filename = args.source_filename;
 
   const StringBuffer preprocessed_filename =
@@ -148,8 +297,9 @@ int main(int argc, char* argv[])
   StringView source_str = str(src_start);
   fclose(preprocessed_file);
 
-  Tokens tokens = lex(src_start, &permanent_arena, scratch_arena);
   if (args.stop_after_lexer) {
+    const Tokens tokens = lex(src_start, &token_arena);
+
     const LineNumTable* line_num_table = get_line_num_table(
         src_filename, source_str, &permanent_arena, scratch_arena);
 
@@ -162,11 +312,32 @@ int main(int argc, char* argv[])
     exit(has_error ? 1 : 0);
   }
 
-  ParseResult parse_result =
-      parse(src_start, tokens, &permanent_arena, scratch_arena);
+  Interner* interner = new_interner(&permanent_arena);
   const DiagnosticsContext diagnostics_context = create_diagnostic_context(
       src_filename, source_str, &permanent_arena, scratch_arena);
-  print_diagnostics(parse_result.errors, &diagnostics_context);
+  DiagnosticsSink diagnostics =
+      create_diagnostics_sink(&diagnostics_context, stderr, args.error_limit);
+
+  // Only the assembly can be written before the whole file is parsed
+  if (args.stream_functions && !args.stop_after_parser &&
+      !args.stop_after_semantic_analysis && !args.gen_ir_only) {
+    const StringBuffer asm_filename =
+        replace_extension(src_filename, ".s", &permanent_arena);
+    if (!compile_streaming(src_start, &args, interner,
+                           string_buffer_c_str(&asm_filename), &diagnostics,
+                           &permanent_arena, &ast_arena, scratch_arena)) {
+      return 1;
+    }
+    if (!args.codegen_only) {
+      assemble_and_link(src_filename, &args, &asm_filename, &permanent_arena);
+    }
+    return 0;
+  }
+
+  ParseResult parse_result = parse_source(
+      src_start, &args, interner, &token_arena, &ast_arena, scratch_arena);
+  arena_release_virtual_mem(&token_arena);
+  (void)report_diagnostics(&diagnostics, parse_result.errors);
 
   if (parse_result.ast == NULL) {
     // Failed to parse program
@@ -174,26 +345,27 @@ int main(int argc, char* argv[])
   }
   TranslationUnit* tu = parse_result.ast;
   if (args.stop_after_parser) {
-    StringView ast_str = string_from_ast(tu, &permanent_arena);
+    StringView ast_str = string_from_ast(tu, &ast_arena);
     printf("%.*s\n", (int)ast_str.size, ast_str.start);
     return 0;
   }
 
-  ErrorsView type_errors = type_check(tu, &permanent_arena);
+  ErrorsView type_errors = parse_result.type_errors;
   if (type_errors.length != 0) {
-    print_diagnostics(type_errors, &diagnostics_context);
+    (void)report_diagnostics(&diagnostics, type_errors);
     return 1;
   }
   if (args.stop_after_semantic_analysis) { return 0; }
 
   IRGenerationResult ir_gen_result =
-      ir_generate(tu, &permanent_arena, scratch_arena);
+      ir_generate(tu, &ir_arena, scratch_arena);
 
   if (ir_gen_result.program == NULL) {
     // Failed to generate IR
-    print_diagnostics(ir_gen_result.errors, &diagnostics_context);
+    (void)report_diagnostics(&diagnostics, ir_gen_result.errors);
     return 1;
   }
+  arena_release_virtual_mem(&ast_arena);
 
   IRProgram* ir = ir_gen_result.program;
 
@@ -204,25 +376,18 @@ int main(int argc, char* argv[])
 
   const X86Program x86_program =
       x86_generate_assembly(ir, &permanent_arena, scratch_arena);
+  arena_release_virtual_mem(&ir_arena);
   if (args.codegen_only) {
-    x86_dump_assembly(&x86_program, stdout);
+    if (!x86_write_assembly(&x86_program, fileno(stdout), scratch_arena)) {
+      perror("Failed to write assembly");
+      return 1;
+    }
     return 0;
   }
 
   const StringBuffer asm_filename =
       replace_extension(src_filename, ".s", &permanent_arena);
-  save_x86_asm_file(string_buffer_c_str(&asm_filename), &x86_program);
-
-  if (args.compile_only) { return 0; }
-
-  const StringBuffer obj_filename =
-      replace_extension(src_filename, ".o", &permanent_arena);
-  assemble(str_from_buffer(&asm_filename), str_from_buffer(&obj_filename));
-
-  if (args.stop_before_linker) { return 0; }
-
-  const StringBuffer executable_name =
-      replace_extension(src_filename, "", &permanent_arena);
-  link(string_buffer_c_str(&obj_filename),
-       string_buffer_c_str(&executable_name));
+  save_x86_asm_file(string_buffer_c_str(&asm_filename), &x86_program,
+                    scratch_arena);
+  assemble_and_link(src_filename, &args, &asm_filename, &permanent_arena);
 }
@@ -18,15 +18,19 @@ static Byte* align_forward(Byte* ptr, size_t alignment)
 /**
   Allocate size bytes of uninitialized storage whose alignment is specified
   by alignment from the arena. The size parameter must be an integral multiple
-  of alignment. If the arena doesn't have enough memory, returns NULL
+  of alignment. If the current block doesn't have enough memory, a growable
+  arena moves on to another block
  */
 void* arena_aligned_alloc(Arena* arena, size_t alignment, size_t size)
 {
   Byte* aligned_ptr = align_forward(arena->current, alignment);
-  const size_t size_for_alignment = (size_t)(aligned_ptr - arena->current);
-  const size_t bump_size = size_for_alignment + size;
+  size_t bump_size = (size_t)(aligned_ptr - arena->current) + size;
 
-  MCC_ASSERT_MSG(arena->size_remain >= bump_size, "arena is too small");
+  if (arena->size_remain < bump_size) {
+    arena_grow(arena, alignment, size);
+    aligned_ptr = align_forward(arena->current, alignment);
+    bump_size = (size_t)(aligned_ptr - arena->current) + size;
+  }
 
   arena->previous = arena->current;
   arena->current = aligned_ptr + size;
@@ -37,8 +41,6 @@ void* arena_aligned_alloc(Arena* arena, size_t alignment, size_t size)
 /**
  * @brief Attempts to extends the memory block pointed by `old_p`, or allocate a
  * new memory block if `old_p` is null
- * @pre The old size is smaller than the new size
- * @pre The arena has enough memory to allocate
  *
  * @warning If the old size does not match the actual size of the allocation
  * pointed by `old_p`, the behavior is undefined. Similarly, if the specified
@@ -49,11 +51,16 @@ void* arena_aligned_alloc(Arena* arena, size_t alignment, size_t size)
  * old part of the area is unchanged, and the content of the new part of the
  * area is undefined.
  * - Allocating a new chunk of memory and copying memory area of the old
- * block to there.
+ * block to there. This is also the case when the latest allocation does not
+ * have room to grow at the end of the arena's current block.
  *
  * This function always perform reallocation if old_p does not satisfy the
  * alignment requirement of `alignment`.
  *
+ * If the new size is not larger than the old size, the block is shrunk in
+ * place. When `old_p` is the latest allocation, the freed tail is given back to
+ * the arena.
+ *
  * If successful, returns a pointer to the new allocated block. The memory
  * pointed by `old_p` should be considered inaccessible afterward.
  */
@@ -62,6 +69,15 @@ void* arena_aligned_realloc(Arena* arena, void* old_p, size_t alignment,
 {
   if (old_p == NULL) { return arena_aligned_alloc(arena, alignment, new_size); }
 
+  if (new_size <= old_size) {
+    if (old_p == align_forward(arena->previous, alignment) &&
+        (Byte*)old_p + old_size == arena->current) {
+      arena->current = (Byte*)old_p + new_size;
+      arena->size_remain += old_size - new_size;
+    }
+    return old_p;
+  }
+
   if (old_p != arena->previous) {
     // old_p does not point to the latest allocation of arena, reallocate
     void* new_p = arena_aligned_alloc(arena, alignment, new_size);
@@ -69,13 +85,14 @@ void* arena_aligned_realloc(Arena* arena, void* old_p, size_t alignment,
     return new_p;
   }
 
-  MCC_ASSERT_MSG(arena->size_remain >= new_size, "arena is too small");
-
   Byte* aligned_ptr = align_forward(arena->previous, alignment);
   MCC_ASSERT(old_size == (size_t)(arena->current - arena->previous));
   MCC_ASSERT_MSG(old_size < new_size, "Old size is too small");
 
-  if (old_p != aligned_ptr) {
+  if (old_p != aligned_ptr ||
+      (arena->size_remain < new_size - old_size &&
+       (arena->block == NULL ||
+        !arena_commit_in_block(arena, new_size - old_size)))) {
     // can't extend previous allocation, realloc
     void* new_p = arena_aligned_alloc(arena, alignment, new_size);
     memcpy(new_p, old_p, old_size);
@@ -94,12 +111,25 @@ Arena arena_init(void* buffer, size_t size)
       .previous = NULL,
       .current = (Byte*)buffer,
       .size_remain = size,
+      .block = NULL,
   };
 }
 
-// Reset the arena and the underlying buffer can be reused later
+// Reset the arena and the underlying buffer can be reused later. A growable
+// arena goes back to its first block and keeps the others for reuse
 void arena_reset(Arena* arena)
 {
+  if (arena->block != NULL) {
+    ArenaBlock* first = arena->block;
+    while (first->previous != NULL) { first = first->previous; }
+    arena->block = first;
+    arena->begin = first + 1;
+    arena->current = (Byte*)(first + 1);
+    arena->previous = NULL;
+    arena->size_remain = first->committed_size - sizeof(ArenaBlock);
+    return;
+  }
+
   Byte* begin = (Byte*)arena->begin;
   arena->size_remain += (size_t)(arena->current - begin);
   arena->current = begin;
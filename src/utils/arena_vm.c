@@ -1,14 +1,288 @@
 #include <mcc/arena.h>
 
+#include <stdatomic.h>
 #include <sys/mman.h>
 
+enum {
+  PAGE_SIZE = 4096,
+  HUGE_PAGE_SIZE = 2 * 1024 * 1024,
+  // The first block of an arena is prefaulted up to this size on huge pages
+  HUGE_PAGE_INITIAL_COMMIT = 8 * HUGE_PAGE_SIZE,
+  // An arena commits its blocks this much at a time
+  ARENA_COMMIT_SIZE = 64 * 1024,
+};
+
+// Bytes committed by all growable arenas and virtual ranges, which worker
+// threads update as their arenas grow
+static atomic_size_t committed_size = 0;
+static size_t memory_limit = 0;
+static bool use_huge_pages = false;
+
+void arena_set_memory_limit(size_t limit)
+{
+  memory_limit = limit;
+}
+
+void arena_set_huge_pages(bool enabled)
+{
+  use_huge_pages = enabled;
+}
+
+static size_t round_up_to(size_t size, size_t page_size)
+{
+  return (size + (page_size - 1)) & ~(page_size - 1);
+}
+
+static size_t round_up_to_page(size_t size)
+{
+  return round_up_to(size, use_huge_pages ? HUGE_PAGE_SIZE : PAGE_SIZE);
+}
+
+// Maps `size` bytes, a multiple of the huge page size, at a huge page boundary.
+// Explicit huge pages are used if the system reserved enough of them, and
+// otherwise the kernel is asked to back the range with transparent huge pages
+static void* map_huge_pages(size_t size)
+{
+#ifdef MAP_HUGETLB
+  void* hugetlb_buffer =
+      mmap(NULL, size, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (hugetlb_buffer != MAP_FAILED) { return hugetlb_buffer; }
+#endif
+
+  // Transparent huge pages only back whole aligned 2 MB ranges, so map one huge
+  // page more than needed and trim both ends to the boundary
+  Byte* buffer = mmap(NULL, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (buffer == MAP_FAILED) { return MAP_FAILED; }
+  const size_t head_size =
+      round_up_to((uintptr_t)buffer, HUGE_PAGE_SIZE) - (uintptr_t)buffer;
+  if (head_size != 0) { munmap(buffer, head_size); }
+  munmap(buffer + head_size + size, HUGE_PAGE_SIZE - head_size);
+#ifdef MADV_HUGEPAGE
+  (void)madvise(buffer + head_size, size, MADV_HUGEPAGE);
+#endif
+  return buffer + head_size;
+}
+
+// Faults in the pages of a range up front
+static void prefault(void* buffer, size_t size)
+{
+#ifdef MADV_POPULATE_WRITE
+  if (madvise(buffer, size, MADV_POPULATE_WRITE) == 0) { return; }
+#endif
+  for (size_t i = 0; i < size; i += PAGE_SIZE) {
+    ((volatile Byte*)buffer)[i] = 0;
+  }
+}
+
+// Counts `size` more bytes of memory as committed, which is fatal past the
+// limit
+static void add_committed_size(size_t size)
+{
+  const size_t total_size = atomic_fetch_add(&committed_size, size) + size;
+  if (memory_limit != 0 && total_size > memory_limit) {
+    (void)fprintf(stderr,
+                  "mcc: fatal error: out of memory: exceeded the memory limit "
+                  "of %zu bytes\n",
+                  memory_limit);
+    exit(1);
+  }
+}
+
+// Commits at least the first `size` bytes of a block. The pages are mapped
+// already and faulted in on first touch, so committing only counts them
+static void commit_block(ArenaBlock* block, size_t size)
+{
+  size_t new_size =
+      round_up_to(size, use_huge_pages ? HUGE_PAGE_SIZE : ARENA_COMMIT_SIZE);
+  if (new_size > block->size) { new_size = block->size; }
+  if (new_size <= block->committed_size) { return; }
+
+  add_committed_size(new_size - block->committed_size);
+  block->committed_size = new_size;
+}
+
+// Maps a block of `size` bytes from the OS, and commits its start
+static ArenaBlock* map_block(size_t size)
+{
+  void* buffer = use_huge_pages
+                     ? map_huge_pages(size)
+                     : mmap(NULL, size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1,
+                            0);
+  if (buffer == MAP_FAILED) {
+    perror("mcc: fatal error: failed to map arena memory");
+    exit(1);
+  }
+
+  ArenaBlock* block = buffer;
+  *block = (ArenaBlock){.size = size};
+  commit_block(block, sizeof(ArenaBlock));
+  return block;
+}
+
+static void unmap_block(ArenaBlock* block)
+{
+  atomic_fetch_sub(&committed_size, block->committed_size);
+  munmap(block, block->size);
+}
+
+// Unmaps a block and all the blocks after it
+static void unmap_blocks_from(ArenaBlock* block)
+{
+  while (block != NULL) {
+    ArenaBlock* next = block->next;
+    unmap_block(block);
+    block = next;
+  }
+}
+
+static void arena_move_to_block(Arena* arena, ArenaBlock* block)
+{
+  arena->block = block;
+  arena->begin = block + 1;
+  arena->current = (Byte*)(block + 1);
+  arena->previous = NULL;
+  arena->size_remain = block->committed_size - sizeof(ArenaBlock);
+}
+
 Arena arena_from_virtual_mem(size_t size)
 {
-  void* arena_buffer = mmap(NULL, size, PROT_READ | PROT_WRITE,
-                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-  if (arena_buffer == MAP_FAILED) {
-    perror("Failed to allocate scratch arena buffer");
+  ArenaBlock* block = map_block(round_up_to_page(sizeof(ArenaBlock) + size));
+  // An arena fills its first block from the start, so fault that in with a few
+  // huge pages instead of a page fault at a time
+  if (use_huge_pages) {
+    commit_block(block, HUGE_PAGE_INITIAL_COMMIT);
+    prefault(block, block->committed_size);
+  }
+
+  Arena arena = {};
+  arena_move_to_block(&arena, block);
+  return arena;
+}
+
+bool arena_commit_in_block(Arena* arena, size_t size)
+{
+  ArenaBlock* block = arena->block;
+  MCC_ASSERT(block != NULL);
+
+  const size_t used_size = (size_t)(arena->current - (Byte*)block);
+  if (block->size - used_size < size) { return false; }
+  commit_block(block, used_size + size);
+  arena->size_remain = block->committed_size - used_size;
+  return true;
+}
+
+void arena_grow(Arena* arena, size_t alignment, size_t size)
+{
+  ArenaBlock* block = arena->block;
+  if (block == NULL) { MCC_PANIC("arena is too small"); }
+
+  const size_t padding =
+      (size_t)(-(uintptr_t)arena->current & (uintptr_t)(alignment - 1));
+  if (arena_commit_in_block(arena, padding + size)) { return; }
+
+  // The memory of a block is aligned to max_align_t, so only larger alignments
+  // need padding
+  const size_t needed_size =
+      sizeof(ArenaBlock) + size +
+      (alignment > alignof(max_align_t) ? alignment : 0);
+
+  // Anything left in the later blocks belongs to copies of the arena that are
+  // gone, so the next block can be reused if it is large enough
+  ArenaBlock* next = block->next;
+  if (next != NULL && next->size >= needed_size) {
+    commit_block(next, needed_size);
+    arena_move_to_block(arena, next);
+    return;
+  }
+  unmap_blocks_from(next);
+
+  // Grow geometrically so that a large input maps only a few blocks. Only the
+  // part of a block that is used gets committed
+  const size_t doubled_size = 2 * block->size;
+  ArenaBlock* new_block = map_block(round_up_to_page(
+      doubled_size > needed_size ? doubled_size : needed_size));
+  commit_block(new_block, needed_size);
+  new_block->previous = block;
+  block->next = new_block;
+  arena_move_to_block(arena, new_block);
+}
+
+void arena_adopt_blocks(Arena* arena, Arena* other)
+{
+  MCC_ASSERT(arena->block != NULL && other->block != NULL);
+
+  // The blocks past the current one of `other` hold nothing
+  ArenaBlock* last = other->block;
+  unmap_blocks_from(last->next);
+  ArenaBlock* first = last;
+  while (first->previous != NULL) { first = first->previous; }
+
+  // The blocks go before the current block of `arena`, which keeps allocating
+  // where it was
+  ArenaBlock* current = arena->block;
+  first->previous = current->previous;
+  if (current->previous != NULL) { current->previous->next = first; }
+  last->next = current;
+  current->previous = last;
+  *other = (Arena){};
+}
+
+void arena_release_virtual_mem(Arena* arena)
+{
+  ArenaBlock* first = arena->block;
+  while (first->previous != NULL) { first = first->previous; }
+  unmap_blocks_from(first);
+  *arena = (Arena){};
+}
+
+#pragma region virtual range
+enum {
+  // A range commits at least this much at once
+  MIN_COMMIT_SIZE = 64 * 1024,
+};
+
+VirtualRange virtual_range_reserve(size_t size)
+{
+  size = round_up_to(size, PAGE_SIZE);
+  void* begin = mmap(NULL, size, PROT_NONE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (begin == MAP_FAILED) {
+    perror("mcc: fatal error: failed to reserve memory");
     exit(1);
   }
-  return arena_init(arena_buffer, size);
+  return (VirtualRange){.begin = begin, .reserved_size = size};
+}
+
+void virtual_range_commit(VirtualRange* range, size_t size)
+{
+  if (size <= range->committed_size) { return; }
+  if (size > range->reserved_size) { MCC_PANIC("virtual range is too small"); }
+
+  // Commit geometrically so that a growing range makes few system calls
+  size_t new_size = 2 * range->committed_size;
+  if (new_size < MIN_COMMIT_SIZE) { new_size = MIN_COMMIT_SIZE; }
+  if (new_size < size) { new_size = size; }
+  new_size = round_up_to(new_size, PAGE_SIZE);
+  if (new_size > range->reserved_size) { new_size = range->reserved_size; }
+
+  add_committed_size(new_size - range->committed_size);
+  if (mprotect(range->begin + range->committed_size,
+               new_size - range->committed_size,
+               PROT_READ | PROT_WRITE) != 0) {
+    perror("mcc: fatal error: failed to commit memory");
+    exit(1);
+  }
+  range->committed_size = new_size;
+}
+
+void virtual_range_release(VirtualRange* range)
+{
+  if (range->begin == NULL) { return; }
+  atomic_fetch_sub(&committed_size, range->committed_size);
+  munmap(range->begin, range->reserved_size);
+  *range = (VirtualRange){};
 }
+#pragma endregion
@@ -21,9 +21,51 @@ static const Option options[] = {
     {"--ir", "generate the IR, and then dump the result AST"},
     {"--codegen", "generate the assembly, and then dump the result rather than "
                   "saving to a file"},
+    {"--stream-tokens",
+     "scan tokens on demand while parsing instead of lexing the whole file "
+     "upfront"},
+    {"--skim-bodies",
+     "only parse the function bodies that functions with external linkage "
+     "can reach, and skip unreferenced static functions"},
+    {"--parallel-bodies",
+     "parse and check the function bodies on one thread per core once the "
+     "top-level declarations are known"},
+    {"--stream-functions",
+     "when generating assembly, compile each function as soon as it is "
+     "parsed, so that memory use is bounded by the largest function rather "
+     "than the whole file; implies --stream-tokens"},
+    {"-ferror-limit=N",
+     "stop after N errors have been reported, or never if N is 0 (default)"},
+    {"--max-memory=N",
+     "fail cleanly once the compiler needs more than N bytes of memory, with "
+     "an optional K, M or G suffix, or never if N is 0 (default)"},
+    {"--huge-pages",
+     "back the compiler's memory with 2 MB huge pages, which is also enabled "
+     "by setting MCC_HUGE_PAGES=1 in the environment"},
     {"-S", "Compile only; do not assemble or link."},
     {"-c", "Compile and assemble, but do not link."}};
 
+// Parses a byte count with an optional binary K, M or G suffix. Returns false
+// if the text is not one
+static bool parse_memory_size(const char* text, size_t* size)
+{
+  if (*text < '0' || *text > '9') { return false; }
+
+  char* end = nullptr;
+  unsigned long long count = strtoull(text, &end, 10);
+  int shift = 0;
+  switch (*end) {
+  case 'K': shift = 10, ++end; break;
+  case 'M': shift = 20, ++end; break;
+  case 'G': shift = 30, ++end; break;
+  default: break;
+  }
+  if (*end != '\0' || count > (SIZE_MAX >> shift)) { return false; }
+
+  *size = (size_t)count << shift;
+  return true;
+}
+
 void print_usage(FILE* stream)
 {
   (void)fputs("Usage: mcc [options] filename...\n", stream);
@@ -41,6 +83,10 @@ CliArgs parse_cli_args(int argc, char** argv)
 {
   CliArgs result = {0};
 
+  const char* huge_pages_env = getenv("MCC_HUGE_PAGES");
+  result.huge_pages = huge_pages_env != nullptr && *huge_pages_env != '\0' &&
+                      strcmp(huge_pages_env, "0") != 0;
+
   for (int i = 1; i < argc; ++i) {
     const StringView arg = str(argv[i]);
 
@@ -54,6 +100,33 @@ CliArgs parse_cli_args(int argc, char** argv)
       result.stop_after_parser = true;
     } else if (str_eq(arg, str("--validate"))) {
       result.stop_after_semantic_analysis = true;
+    } else if (str_eq(arg, str("--stream-tokens"))) {
+      result.stream_tokens = true;
+    } else if (str_eq(arg, str("--skim-bodies"))) {
+      result.skim_bodies = true;
+    } else if (str_eq(arg, str("--parallel-bodies"))) {
+      result.parallel_bodies = true;
+    } else if (str_eq(arg, str("--stream-functions"))) {
+      result.stream_functions = true;
+    } else if (str_start_with(arg, str("-ferror-limit="))) {
+      const char* limit = argv[i] + strlen("-ferror-limit=");
+      char* limit_end = nullptr;
+      const unsigned long long error_limit = strtoull(limit, &limit_end, 10);
+      if (*limit == '\0' || *limit_end != '\0' || *limit == '-') {
+        (void)fprintf(stderr,
+                      "mcc: fatal error: invalid error limit: '%s'\n", limit);
+        exit(1);
+      }
+      result.error_limit = (size_t)error_limit;
+    } else if (str_eq(arg, str("--huge-pages"))) {
+      result.huge_pages = true;
+    } else if (str_start_with(arg, str("--max-memory="))) {
+      const char* size = argv[i] + strlen("--max-memory=");
+      if (!parse_memory_size(size, &result.max_memory)) {
+        (void)fprintf(stderr,
+                      "mcc: fatal error: invalid memory limit: '%s'\n", size);
+        exit(1);
+      }
     } else if (str_eq(arg, str("-S"))) {
       result.compile_only = true;
     } else if (str_eq(arg, str("-c"))) {
@@ -81,5 +154,29 @@ CliArgs parse_cli_args(int argc, char** argv)
     exit(1);
   }
 
+  // Both need the whole file before compiling any function
+  if (result.stream_functions &&
+      (result.skim_bodies || result.parallel_bodies)) {
+    (void)fputs("mcc: fatal error: --stream-functions cannot be combined with "
+                "--skim-bodies or --parallel-bodies\n",
+                stderr);
+    exit(1);
+  }
+  if (result.stream_functions) { result.stream_tokens = true; }
+
+  // Bodies are skimmed by matching braces over the tokens of the whole file
+  if (result.skim_bodies && result.stream_tokens) {
+    (void)fputs("mcc: fatal error: --skim-bodies cannot be combined with "
+                "--stream-tokens\n",
+                stderr);
+    exit(1);
+  }
+  if (result.parallel_bodies && (result.skim_bodies || result.stream_tokens)) {
+    (void)fputs("mcc: fatal error: --parallel-bodies cannot be combined with "
+                "--skim-bodies or --stream-tokens\n",
+                stderr);
+    exit(1);
+  }
+
   return result;
 }
@@ -1,42 +1,118 @@
 #include <mcc/diagnostic.h>
 #include <mcc/frontend.h>
 
-#include <mcc/format.h>
-#include <stdio.h>
+#include <string.h>
+
+// Large enough that files with thousands of errors are written in a few calls
+enum { DIAGNOSTICS_BUFFER_SIZE = 64 * 1024 };
 
 DiagnosticsContext create_diagnostic_context(const char* filename,
                                              StringView source,
                                              Arena* permanent_arena,
                                              Arena scratch_arena)
 {
-  const LineNumTable* line_num_table =
-      get_line_num_table(filename, source, permanent_arena, scratch_arena);
-  return (DiagnosticsContext){
-      .filename = filename, .source = source, .line_num_table = line_num_table};
+  return (DiagnosticsContext){.filename = filename,
+                              .source = source,
+                              .permanent_arena = permanent_arena,
+                              .scratch_arena = scratch_arena};
+}
+
+DiagnosticsSink create_diagnostics_sink(const DiagnosticsContext* context,
+                                        FILE* stream, size_t error_limit)
+{
+  return (DiagnosticsSink){
+      .context = context,
+      .stream = stream,
+      .error_limit = error_limit,
+  };
+}
+
+static void flush_diagnostics(DiagnosticsSink* sink)
+{
+  if (sink->length == 0) { return; }
+  (void)fwrite(sink->buffer, 1, sink->length, sink->stream);
+  sink->length = 0;
+}
+
+static void sink_write(DiagnosticsSink* sink, const char* data, size_t size)
+{
+  if (sink->length + size > DIAGNOSTICS_BUFFER_SIZE) {
+    flush_diagnostics(sink);
+    if (size > DIAGNOSTICS_BUFFER_SIZE) {
+      (void)fwrite(data, 1, size, sink->stream);
+      return;
+    }
+  }
+  memcpy(sink->buffer + sink->length, data, size);
+  sink->length += size;
+}
+
+static void sink_write_str(DiagnosticsSink* sink, StringView s)
+{
+  sink_write(sink, s.start, s.size);
 }
 
-static void write_diagnostic_position_indicator(StringBuffer* output,
+// Writes count copies of c
+static void sink_write_run(DiagnosticsSink* sink, char c, size_t count)
+{
+  while (count != 0) {
+    if (sink->length == DIAGNOSTICS_BUFFER_SIZE) { flush_diagnostics(sink); }
+    size_t chunk_size = DIAGNOSTICS_BUFFER_SIZE - sink->length;
+    if (chunk_size > count) { chunk_size = count; }
+    memset(sink->buffer + sink->length, c, chunk_size);
+    sink->length += chunk_size;
+    count -= chunk_size;
+  }
+}
+
+static void sink_write_u32(DiagnosticsSink* sink, uint32_t value)
+{
+  char digits[10];
+  size_t first = sizeof(digits);
+  do {
+    digits[--first] = (char)('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  sink_write(sink, digits + first, sizeof(digits) - first);
+}
+
+static void write_diagnostic_position_indicator(DiagnosticsSink* sink,
                                                 SourceRange error_range,
-                                                uint32_t line_begin);
+                                                uint32_t line_begin)
+{
+  MCC_ASSERT(error_range.end > error_range.begin);
 
-void write_diagnostics(StringBuffer* output, const Error* error,
-                       const DiagnosticsContext* context)
+  sink_write_str(sink, str("  | "));
+  sink_write_run(sink, ' ', error_range.begin - line_begin);
+  sink_write(sink, "^", 1);
+  sink_write_run(sink, '~', error_range.end - error_range.begin - 1);
+  sink_write(sink, "\n", 1);
+}
+
+// Locations are written as the preprocessor's line markers name them, i.e. in
+// the files and at the lines the source was included from
+static void write_diagnostic(DiagnosticsSink* sink, const Error* error)
 {
-  const char* file_path = context->filename;
-  const StringView source = context->source;
-  const LineNumTable* line_num_table = context->line_num_table;
+  const StringView source = sink->context->source;
+  const LineNumTable* line_num_table = sink->lines.table;
 
-  const StringView msg = error->msg;
   const SourceRange error_range = error->range;
 
   const LineColumn begin_line_column =
-      calculate_line_and_column(line_num_table, error_range.begin);
+      cursor_line_and_column(&sink->lines, error_range.begin);
   const LineColumn end_line_column =
-      calculate_line_and_column(line_num_table, error_range.end);
-
-  string_buffer_printf(output, "%s:%u:%u: Error: %.*s\n", file_path,
-                       begin_line_column.line, begin_line_column.column,
-                       (int)msg.size, msg.start);
+      cursor_line_and_column(&sink->lines, error_range.end);
+  const PresumedLine begin_line =
+      cursor_presumed_line(&sink->lines, begin_line_column.line);
+
+  sink_write_str(sink, str(begin_line.filename));
+  sink_write(sink, ":", 1);
+  sink_write_u32(sink, begin_line.line);
+  sink_write(sink, ":", 1);
+  sink_write_u32(sink, begin_line_column.column);
+  sink_write_str(sink, str(": Error: "));
+  sink_write_str(sink, error->msg);
+  sink_write(sink, "\n", 1);
 
   MCC_ASSERT(end_line_column.column != 0);
 
@@ -48,47 +124,49 @@ void write_diagnostics(StringBuffer* output, const Error* error,
        ++line_num) {
     MCC_ASSERT(line_num != 0);
     const uint32_t line_begin = line_num_table->line_starts[line_num - 1];
-    const uint32_t line_end = line_num_table->line_starts[line_num];
+    const uint32_t line_end = line_num < line_num_table->line_count
+                                  ? line_num_table->line_starts[line_num]
+                                  : u32_from_usize(source.size);
 
-    const uint32_t line_length = line_end - line_begin;
-
-    string_buffer_printf(output, "%d | %.*s", line_num, (int)line_length,
-                         source.start + line_begin);
+    sink_write_u32(sink, cursor_presumed_line(&sink->lines, line_num).line);
+    sink_write_str(sink, str(" | "));
+    sink_write(sink, source.start + line_begin, line_end - line_begin);
     if (error_range.begin >= line_begin && error_range.end <= line_end) {
-      write_diagnostic_position_indicator(output, error_range, line_begin);
+      write_diagnostic_position_indicator(sink, error_range, line_begin);
     }
   }
+  sink_write(sink, "\n", 1);
 }
 
-static void write_diagnostic_position_indicator(StringBuffer* output,
-                                                SourceRange error_range,
-                                                uint32_t line_begin)
+bool report_diagnostics(DiagnosticsSink* sink, ErrorsView errors)
 {
-  string_buffer_printf(output, "  | ");
-  MCC_ASSERT(error_range.end > error_range.begin);
-
-  for (uint32_t i = line_begin; i < error_range.begin; ++i) {
-    string_buffer_printf(output, " ");
+  if (errors.length == 0) { return true; }
+  if (sink->buffer == nullptr) {
+    const DiagnosticsContext* context = sink->context;
+    sink->buffer = ARENA_ALLOC_ARRAY(context->permanent_arena, char,
+                                     DIAGNOSTICS_BUFFER_SIZE);
+    sink->lines = line_cursor(
+        get_line_num_table(context->filename, context->source,
+                           context->permanent_arena, context->scratch_arena));
   }
-  string_buffer_printf(output, "^");
-  for (uint32_t i = error_range.begin + 1; i < error_range.end; ++i) {
-    string_buffer_printf(output, "~");
+
+  bool reached_limit = false;
+  for (size_t i = 0; i < errors.length; ++i) {
+    if (sink->error_limit != 0 && sink->error_count == sink->error_limit) {
+      sink_write_str(sink, str("mcc: fatal error: too many errors emitted, "
+                               "stopping now [-ferror-limit=]\n"));
+      reached_limit = true;
+      break;
+    }
+    write_diagnostic(sink, &errors.data[i]);
+    ++sink->error_count;
   }
-  string_buffer_printf(output, "\n");
+  flush_diagnostics(sink);
+  return !reached_limit;
 }
 
 void print_diagnostics(ErrorsView errors, const DiagnosticsContext* context)
 {
-  enum { diagnostics_arena_size = 40000 }; // 40 Mb
-  uint8_t diagnostics_buffer[diagnostics_arena_size];
-  Arena diagnostics_arena =
-      arena_init(diagnostics_buffer, diagnostics_arena_size);
-
-  for (size_t i = 0; i < errors.length; ++i) {
-    StringBuffer output = string_buffer_new(&diagnostics_arena);
-    write_diagnostics(&output, &errors.data[i], context);
-    StringView output_view = str_from_buffer(&output);
-    (void)fprintf(stderr, "%.*s\n", (int)output_view.size, output_view.start);
-    arena_reset(&diagnostics_arena);
-  }
+  DiagnosticsSink sink = create_diagnostics_sink(context, stderr, 0);
+  (void)report_diagnostics(&sink, errors);
 }
@@ -1,53 +1,363 @@
 #include <mcc/hash_table.h>
 
-// Hash table implementation adapted from
-// https://nullprogram.com/blog/2025/01/19/
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#pragma region hash function
+// Reads 8 bytes per step and mixes them with a folded 64x64->128 bit multiply,
+// in the spirit of wyhash. Strings of at most 8 bytes, which are most
+// identifiers, take a single multiply plus the finaliser.
+
+static inline uint64_t load64(const char* p)
+{
+  uint64_t word;
+  memcpy(&word, p, sizeof(word));
+  return word;
+}
+
+static inline uint64_t load32(const char* p)
+{
+  uint32_t word;
+  memcpy(&word, p, sizeof(word));
+  return word;
+}
+
+__extension__ typedef unsigned __int128 uint128_t;
+
+static inline uint64_t fold_multiply(uint64_t a, uint64_t b)
+{
+  const uint128_t product = (uint128_t)a * b;
+  return (uint64_t)product ^ (uint64_t)(product >> 64);
+}
+
+// The finaliser of MurmurHash3. Spreads every input bit over the whole hash,
+// in particular into the high bits that the tables use
+static inline uint64_t finalize(uint64_t h)
+{
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdu;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53u;
+  h ^= h >> 33;
+  return h;
+}
 
 uint64_t hash64(StringView s)
 {
-  uint64_t h = 0x100;
-  for (size_t i = 0; i < s.size; i++) {
-    h ^= s.start[i] & 255;
-    h *= 1111111111111111111;
+  const uint64_t k0 = 0xa0761d6478bd642fu;
+  const uint64_t k1 = 0xe7037ed1a0b428dbu;
+
+  const char* p = s.start;
+  size_t n = s.size;
+  uint64_t h = k0;
+
+  for (; n > 8; p += 8, n -= 8) { h = fold_multiply(h ^ load64(p), k1); }
+
+  // The last 0 to 8 bytes. Overlapping loads cover every length without a
+  // loop
+  uint64_t tail = 0;
+  if (n >= 4) {
+    tail = load32(p) | load32(p + n - 4) << 32;
+  } else if (n > 0) {
+    tail = (uint64_t)(unsigned char)p[0] << 16 |
+           (uint64_t)(unsigned char)p[n / 2] << 8 | (unsigned char)p[n - 1];
   }
-  return h;
+  // The length goes into the (odd) multiplier rather than the state, where it
+  // could cancel out against the tail bytes of a string with another length
+  return finalize(fold_multiply(h ^ tail, k1 ^ (uint64_t)s.size << 1));
+}
+
+#pragma endregion
+
+#pragma region group probing
+// The tables follow the design of Abseil's "Swiss tables". Slots are split into
+// groups of 16. Besides the entries, each slot has a control byte that is
+// either CONTROL_EMPTY or the top 7 bits of the key's hash. A lookup compares
+// the fingerprint against a whole group of control bytes at once and only
+// looks at the entries that match, so most probes touch a single cache line
+// of control bytes and at most one entry.
+//
+// Nothing is ever erased, so a probe can stop at the first group with an empty
+// slot.
+
+enum {
+  GROUP_SIZE = 16,
+  CONTROL_EMPTY = 0x80, // the only control byte with the high bit set
+};
+
+// Bit i is set iff control byte i of the group matches
+typedef uint32_t GroupMask;
+
+#if defined(__SSE2__)
+static inline GroupMask group_match(const uint8_t* group, uint8_t fingerprint)
+{
+  const __m128i control = _mm_load_si128((const __m128i*)group);
+  const __m128i matches =
+      _mm_cmpeq_epi8(control, _mm_set1_epi8((char)fingerprint));
+  return (GroupMask)_mm_movemask_epi8(matches);
 }
 
-typedef struct HashNode HashNode;
+static inline GroupMask group_match_empty(const uint8_t* group)
+{
+  return (GroupMask)_mm_movemask_epi8(
+      _mm_load_si128((const __m128i*)group));
+}
+#else
+static inline GroupMask group_match(const uint8_t* group, uint8_t fingerprint)
+{
+  GroupMask mask = 0;
+  for (uint32_t i = 0; i < GROUP_SIZE; ++i) {
+    mask |= (GroupMask)(group[i] == fingerprint) << i;
+  }
+  return mask;
+}
+
+static inline GroupMask group_match_empty(const uint8_t* group)
+{
+  return group_match(group, CONTROL_EMPTY);
+}
+#endif
+
+static inline uint8_t fingerprint(uint64_t hash)
+{
+  return (uint8_t)(hash >> 57);
+}
+
+// Quadratic probing over whole groups. Visits every group exactly once when
+// the group count is a power of two.
+typedef struct ProbeSequence {
+  uint32_t offset; // index of the first slot of the current group
+  uint32_t stride;
+  uint32_t mask; // capacity - 1
+} ProbeSequence;
+
+static inline ProbeSequence probe_start(uint64_t hash, uint32_t capacity)
+{
+  // The high bits of our hashes are the well mixed ones
+  const uint32_t mask = capacity - 1;
+  return (ProbeSequence){
+      .offset = (uint32_t)(hash >> 32) & mask & ~(uint32_t)(GROUP_SIZE - 1),
+      .mask = mask,
+  };
+}
+
+static inline void probe_next(ProbeSequence* seq)
+{
+  seq->stride += GROUP_SIZE;
+  seq->offset = (seq->offset + seq->stride) & seq->mask;
+}
+
+// The first empty slot along the probe sequence of hash
+static uint32_t find_empty_slot(const uint8_t* control, uint32_t capacity,
+                                uint64_t hash)
+{
+  for (ProbeSequence seq = probe_start(hash, capacity);; probe_next(&seq)) {
+    const GroupMask empty = group_match_empty(&control[seq.offset]);
+    if (empty != 0) { return seq.offset + (uint32_t)__builtin_ctz(empty); }
+  }
+}
+
+// Keep the load factor at most 7/8
+static uint32_t max_size(uint32_t capacity)
+{
+  return capacity - capacity / 8;
+}
+
+static uint32_t capacity_for(uint32_t count)
+{
+  uint32_t capacity = GROUP_SIZE;
+  while (max_size(capacity) < count) {
+    MCC_ASSERT_MSG(capacity <= UINT32_MAX / 2, "hash table is too large");
+    capacity *= 2;
+  }
+  return capacity;
+}
 
-struct HashNode {
-  HashNode* child[4];
+static uint8_t* new_control_bytes(uint32_t capacity, Arena* arena)
+{
+  uint8_t* control = arena_aligned_alloc(arena, GROUP_SIZE, capacity);
+  memset(control, CONTROL_EMPTY, capacity);
+  return control;
+}
+
+#pragma endregion
+
+#pragma region string map
+struct HashMapEntry {
   StringView key;
   void* value_ptr;
+  uint64_t hash; // saves rehashing the key when the table grows
 };
 
-// Returns the Node that contains the value pointer, or nullptr otherwise
-static HashNode** hashmap_lookup_node(HashMap* map, StringView key)
+// Returns the slot that contains key, or UINT32_MAX if there is none
+static uint32_t hashmap_find(const HashMap* map, StringView key, uint64_t hash)
+{
+  if (map->capacity == 0) { return UINT32_MAX; }
+
+  for (ProbeSequence seq = probe_start(hash, map->capacity);;
+       probe_next(&seq)) {
+    const uint8_t* group = &map->control[seq.offset];
+    for (GroupMask matches = group_match(group, fingerprint(hash));
+         matches != 0; matches &= matches - 1) {
+      const uint32_t slot = seq.offset + (uint32_t)__builtin_ctz(matches);
+      const struct HashMapEntry* entry = &map->entries[slot];
+      if (entry->hash == hash && str_eq(entry->key, key)) { return slot; }
+    }
+    if (group_match_empty(group) != 0) { return UINT32_MAX; }
+  }
+}
+
+static void hashmap_rehash(HashMap* map, uint32_t capacity, Arena* arena)
 {
-  HashNode** node = &map->root;
+  uint8_t* control = new_control_bytes(capacity, arena);
+  struct HashMapEntry* entries =
+      ARENA_ALLOC_ARRAY(arena, struct HashMapEntry, capacity);
 
-  for (uint64_t h = hash64(key); *node != nullptr; h <<= 2) {
-    if (str_eq(key, (*node)->key)) { return node; }
-    node = &(*node)->child[h >> 62];
+  for (uint32_t i = 0; i < map->capacity; ++i) {
+    if (map->control[i] == CONTROL_EMPTY) { continue; }
+
+    const struct HashMapEntry entry = map->entries[i];
+    const uint32_t slot = find_empty_slot(control, capacity, entry.hash);
+    control[slot] = fingerprint(entry.hash);
+    entries[slot] = entry;
   }
-  return node;
+
+  map->control = control;
+  map->entries = entries;
+  map->capacity = capacity;
 }
 
 void* hashmap_lookup(const HashMap* map, StringView key)
 {
-  HashNode** node_ptr = hashmap_lookup_node((HashMap*)map, key);
-  if (*node_ptr == nullptr) { return nullptr; }
-  return (*node_ptr)->value_ptr;
+  return hashmap_lookup_hashed(map, key, hash64(key));
+}
+
+void* hashmap_lookup_hashed(const HashMap* map, StringView key, uint64_t hash)
+{
+  const uint32_t slot = hashmap_find(map, key, hash);
+  if (slot == UINT32_MAX) { return nullptr; }
+  return map->entries[slot].value_ptr;
 }
 
 bool hashmap_try_insert(HashMap* map, StringView key, void* value_ptr,
                         Arena* arena)
 {
-  HashNode** node_ptr = hashmap_lookup_node(map, key);
-  if (*node_ptr != nullptr) { return false; }
+  return hashmap_try_insert_hashed(map, key, hash64(key), value_ptr, arena);
+}
+
+bool hashmap_try_insert_hashed(HashMap* map, StringView key, uint64_t hash,
+                               void* value_ptr, Arena* arena)
+{
+  if (hashmap_find(map, key, hash) != UINT32_MAX) { return false; }
+
+  if (map->size >= max_size(map->capacity)) {
+    hashmap_rehash(map, capacity_for(map->size + 1), arena);
+  }
+
+  const uint32_t slot = find_empty_slot(map->control, map->capacity, hash);
+  map->control[slot] = fingerprint(hash);
+  map->entries[slot] = (struct HashMapEntry){
+      .key = key,
+      .value_ptr = value_ptr,
+      .hash = hash,
+  };
+  map->size++;
+
+  return true;
+}
+
+void hashmap_reserve(HashMap* map, uint32_t count, Arena* arena)
+{
+  if (count <= max_size(map->capacity)) { return; }
+  hashmap_rehash(map, capacity_for(count), arena);
+}
+
+#pragma endregion
+
+#pragma region symbol map
+struct SymbolMapEntry {
+  SymbolId key;
+  void* value_ptr;
+};
+
+// Symbol ids are dense, so they only need to be scrambled to spread over the
+// table. Nothing is hashed by spelling.
+static inline uint64_t hash_symbol(SymbolId symbol)
+{
+  return symbol * 0x9E3779B97F4A7C15u;
+}
+
+static uint32_t symbol_map_find(const SymbolMap* map, SymbolId symbol)
+{
+  if (map->capacity == 0) { return UINT32_MAX; }
+
+  const uint64_t hash = hash_symbol(symbol);
+  for (ProbeSequence seq = probe_start(hash, map->capacity);;
+       probe_next(&seq)) {
+    const uint8_t* group = &map->control[seq.offset];
+    for (GroupMask matches = group_match(group, fingerprint(hash));
+         matches != 0; matches &= matches - 1) {
+      const uint32_t slot = seq.offset + (uint32_t)__builtin_ctz(matches);
+      if (map->entries[slot].key == symbol) { return slot; }
+    }
+    if (group_match_empty(group) != 0) { return UINT32_MAX; }
+  }
+}
+
+static void symbol_map_rehash(SymbolMap* map, uint32_t capacity, Arena* arena)
+{
+  uint8_t* control = new_control_bytes(capacity, arena);
+  struct SymbolMapEntry* entries =
+      ARENA_ALLOC_ARRAY(arena, struct SymbolMapEntry, capacity);
+
+  for (uint32_t i = 0; i < map->capacity; ++i) {
+    if (map->control[i] == CONTROL_EMPTY) { continue; }
+
+    const struct SymbolMapEntry entry = map->entries[i];
+    const uint64_t hash = hash_symbol(entry.key);
+    const uint32_t slot = find_empty_slot(control, capacity, hash);
+    control[slot] = fingerprint(hash);
+    entries[slot] = entry;
+  }
+
+  map->control = control;
+  map->entries = entries;
+  map->capacity = capacity;
+}
+
+void* symbol_map_lookup(const SymbolMap* map, SymbolId symbol)
+{
+  const uint32_t slot = symbol_map_find(map, symbol);
+  if (slot == UINT32_MAX) { return nullptr; }
+  return map->entries[slot].value_ptr;
+}
+
+bool symbol_map_try_insert(SymbolMap* map, SymbolId symbol, void* value_ptr,
+                           Arena* arena)
+{
+  if (symbol_map_find(map, symbol) != UINT32_MAX) { return false; }
+
+  if (map->size >= max_size(map->capacity)) {
+    symbol_map_rehash(map, capacity_for(map->size + 1), arena);
+  }
 
-  *node_ptr = ARENA_ALLOC_OBJECT(arena, HashNode);
-  **node_ptr = (HashNode){.key = key, .value_ptr = value_ptr};
+  const uint64_t hash = hash_symbol(symbol);
+  const uint32_t slot = find_empty_slot(map->control, map->capacity, hash);
+  map->control[slot] = fingerprint(hash);
+  map->entries[slot] =
+      (struct SymbolMapEntry){.key = symbol, .value_ptr = value_ptr};
+  map->size++;
 
   return true;
 }
+
+void symbol_map_reserve(SymbolMap* map, uint32_t count, Arena* arena)
+{
+  if (count <= max_size(map->capacity)) { return; }
+  symbol_map_rehash(map, capacity_for(count), arena);
+}
+
+#pragma endregion
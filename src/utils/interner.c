@@ -0,0 +1,134 @@
+#include <mcc/hash_table.h>
+#include <mcc/interner.h>
+
+#include <string.h>
+
+// Symbols are stored in insertion order, so a symbol id is just an index into
+// the names and hashes arrays. The hash table is an open-addressing table of
+// `symbol id + 1`, where 0 marks an empty slot.
+struct Interner {
+  uint32_t length; // number of symbols
+  uint32_t capacity;
+  StringView* names;
+  uint32_t* hashes;
+
+  uint32_t* slots;
+  uint32_t slot_mask;  // slot count - 1, slot count is a power of two
+  uint32_t used_slots; // fresh symbols never occupy a slot
+
+  Arena* arena;
+};
+
+enum { INITIAL_SLOT_COUNT = 256 };
+
+Interner* new_interner(Arena* arena)
+{
+  Interner* interner = ARENA_ALLOC_OBJECT(arena, Interner);
+  uint32_t* slots = ARENA_ALLOC_ARRAY(arena, uint32_t, INITIAL_SLOT_COUNT);
+  memset(slots, 0, INITIAL_SLOT_COUNT * sizeof(uint32_t));
+  *interner = (Interner){
+      .slots = slots,
+      .slot_mask = INITIAL_SLOT_COUNT - 1,
+      .arena = arena,
+  };
+  return interner;
+}
+
+static SymbolId push_symbol(Interner* interner, StringView name, uint32_t hash)
+{
+  if (interner->length == interner->capacity) {
+    const uint32_t old_capacity = interner->capacity;
+    interner->capacity = old_capacity ? old_capacity * 2 : 64;
+    interner->names =
+        ARENA_REALLOC_ARRAY(interner->arena, StringView, interner->names,
+                            old_capacity, interner->capacity);
+    interner->hashes = ARENA_REALLOC_ARRAY(interner->arena, uint32_t,
+                                           interner->hashes, old_capacity,
+                                           interner->capacity);
+  }
+
+  const SymbolId symbol = interner->length++;
+  interner->names[symbol] = name;
+  interner->hashes[symbol] = hash;
+  return symbol;
+}
+
+// Doubles the slot count. Symbols are reinserted with their stored hashes, so
+// no spelling is hashed twice
+static void grow_slots(Interner* interner)
+{
+  const uint32_t old_slot_count = interner->slot_mask + 1;
+  const uint32_t slot_count = old_slot_count * 2;
+  const uint32_t slot_mask = slot_count - 1;
+
+  uint32_t* slots = ARENA_ALLOC_ARRAY(interner->arena, uint32_t, slot_count);
+  memset(slots, 0, slot_count * sizeof(uint32_t));
+
+  for (uint32_t i = 0; i < old_slot_count; ++i) {
+    const uint32_t entry = interner->slots[i];
+    if (entry == 0) { continue; }
+
+    uint32_t slot = interner->hashes[entry - 1] & slot_mask;
+    while (slots[slot] != 0) { slot = (slot + 1) & slot_mask; }
+    slots[slot] = entry;
+  }
+
+  interner->slots = slots;
+  interner->slot_mask = slot_mask;
+}
+
+SymbolId intern(Interner* interner, StringView name)
+{
+  // The high bits of hash64 are the well mixed ones
+  const uint32_t hash = (uint32_t)(hash64(name) >> 32);
+
+  uint32_t slot = hash & interner->slot_mask;
+  for (uint32_t entry; (entry = interner->slots[slot]) != 0;
+       slot = (slot + 1) & interner->slot_mask) {
+    const SymbolId symbol = entry - 1;
+    if (interner->hashes[symbol] == hash &&
+        str_eq(interner->names[symbol], name)) {
+      return symbol;
+    }
+  }
+
+  const SymbolId symbol = push_symbol(interner, name, hash);
+  interner->slots[slot] = symbol + 1;
+
+  // Keep the load factor at most 1/2
+  interner->used_slots++;
+  if (interner->used_slots * 2 > interner->slot_mask + 1) {
+    grow_slots(interner);
+  }
+
+  return symbol;
+}
+
+SymbolId intern_fresh(Interner* interner, StringView name)
+{
+  return push_symbol(interner, interner_copy_string(interner, name), 0);
+}
+
+StringView interner_copy_string(Interner* interner, StringView string)
+{
+  char* buffer = ARENA_ALLOC_ARRAY(interner->arena, char, string.size);
+  if (string.size != 0) { memcpy(buffer, string.start, string.size); }
+  return (StringView){.start = buffer, .size = string.size};
+}
+
+StringView symbol_name(const Interner* interner, SymbolId symbol)
+{
+  MCC_ASSERT(symbol < interner->length);
+  return interner->names[symbol];
+}
+
+uint32_t symbol_hash(const Interner* interner, SymbolId symbol)
+{
+  MCC_ASSERT(symbol < interner->length);
+  return interner->hashes[symbol];
+}
+
+uint32_t interner_symbol_count(const Interner* interner)
+{
+  return interner->length;
+}
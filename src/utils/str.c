@@ -17,7 +17,8 @@ StringView str(const char* source)
 bool str_eq(StringView lhs, StringView rhs)
 {
   if (lhs.size != rhs.size) return false;
-  return strncmp(lhs.start, rhs.start, lhs.size) == 0;
+  // Views may contain null characters, e.g. when they are binary keys
+  return lhs.size == 0 || memcmp(lhs.start, rhs.start, lhs.size) == 0;
 }
 
 bool str_start_with(StringView s, StringView start)
@@ -1,3 +1,4 @@
+#include <mcc/dynarray.h>
 #include <mcc/ir.h>
 #include <mcc/x86.h>
 
@@ -7,36 +8,48 @@
 #include "x86_passes.h"
 #include "x86_symbols.h"
 
+// Runs the passes on a function. The instructions stay valid until the next
+// function is generated
 static X86FunctionDef x86_generate_function(const IRFunctionDef* ir_function,
                                             X86CodegenContext* context)
 {
   const Arena old_scratch_arena = context->scratch_arena;
 
   // passes to generate an x86 assembly function
-  X86InstructionVector instructions =
+  X86InstructionVector* instructions =
       x86_from_ir_function(ir_function, context);
-  const uint32_t stack_size = replace_pseudo_registers(&instructions, context);
-  X86InstructionVector fixed_instructions =
-      fix_invalid_instructions(&instructions, stack_size, context);
-
-  // Copy the final instruction result to permanent buffer
-  X86Instruction* instruction_buffer = ARENA_ALLOC_ARRAY(
-      context->permanent_arena, X86Instruction, fixed_instructions.length);
-  if (fixed_instructions.length != 0) {
-    memcpy(instruction_buffer, fixed_instructions.data,
-           fixed_instructions.length * sizeof(X86Instruction));
-  }
+  const uint32_t stack_size = replace_pseudo_registers(instructions, context);
+  const X86InstructionVector* fixed_instructions =
+      fix_invalid_instructions(instructions, stack_size, context);
 
   // Free memory of the scratch arena across different functions
   context->scratch_arena = old_scratch_arena;
 
   return (X86FunctionDef){
       .name = ir_function->name,
-      .instructions = instruction_buffer,
-      .instruction_count = fixed_instructions.length,
+      .instructions = fixed_instructions->data,
+      .instruction_count = fixed_instructions->length,
   };
 }
 
+// Same as x86_generate_function, but the instructions are copied to the
+// permanent arena
+static X86FunctionDef x86_generate_permanent_function(
+    const IRFunctionDef* ir_function, X86CodegenContext* context)
+{
+  X86FunctionDef function = x86_generate_function(ir_function, context);
+
+  // Copy the final instruction result to permanent buffer
+  X86Instruction* instruction_buffer = ARENA_ALLOC_ARRAY(
+      context->permanent_arena, X86Instruction, function.instruction_count);
+  if (function.instruction_count != 0) {
+    memcpy(instruction_buffer, function.instructions,
+           function.instruction_count * sizeof(X86Instruction));
+  }
+  function.instructions = instruction_buffer;
+  return function;
+}
+
 X86Program x86_generate_assembly(IRProgram* ir, Arena* permanent_arena,
                                  Arena scratch_arena)
 {
@@ -46,11 +59,20 @@ X86Program x86_generate_assembly(IRProgram* ir, Arena* permanent_arena,
   X86TopLevel* top_levels =
       ARENA_ALLOC_ARRAY(permanent_arena, X86TopLevel, top_level_count);
 
+  const uint32_t symbol_count = interner_symbol_count(ir->interner);
   X86CodegenContext context = {
       .permanent_arena = permanent_arena,
       .scratch_arena = scratch_arena,
-      .symbols = new_symbol_table(permanent_arena),
+      .interner = ir->interner,
+      .symbols = new_symbol_table(symbol_count, permanent_arena),
   };
+  // Allocated before any function, so it survives the scratch arena being
+  // rewound between functions
+  context.stack_slots =
+      ARENA_ALLOC_ARRAY(&context.scratch_arena, uint32_t, symbol_count);
+  if (symbol_count != 0) {
+    memset(context.stack_slots, 0, symbol_count * sizeof(uint32_t));
+  }
 
   for (size_t i = 0; i < top_level_count; ++i) {
     switch (ir->top_levels[i]->tag) {
@@ -58,7 +80,8 @@ X86Program x86_generate_assembly(IRProgram* ir, Arena* permanent_arena,
     case IR_TOP_LEVEL_FUNCTION: {
       X86FunctionDef* function =
           ARENA_ALLOC_OBJECT(permanent_arena, X86FunctionDef);
-      *function = x86_generate_function(&ir->top_levels[i]->function, &context);
+      *function = x86_generate_permanent_function(
+          &ir->top_levels[i]->function, &context);
 
       top_levels[i] = (X86TopLevel){
           .tag = X86_TOPLEVEL_FUNCTION,
@@ -75,7 +98,7 @@ X86Program x86_generate_assembly(IRProgram* ir, Arena* permanent_arena,
           .value = ir_variable.value,
       };
 
-      add_symbol(context.symbols, variable->name, context.permanent_arena);
+      add_symbol(context.symbols, variable->name);
 
       top_levels[i] = (X86TopLevel){
           .tag = X86_TOPLEVEL_VARIABLE,
@@ -85,6 +108,93 @@ X86Program x86_generate_assembly(IRProgram* ir, Arena* permanent_arena,
     }
   }
 
+  VECTOR_RELEASE(&context.instructions);
+  VECTOR_RELEASE(&context.fixed_instructions);
+
   return (X86Program){.top_level_count = top_level_count,
-                      .top_levels = top_levels};
+                      .top_levels = top_levels,
+                      .interner = ir->interner};
+}
+
+struct X86Emitter {
+  X86CodegenContext context;
+  uint32_t symbol_capacity; // of the symbols and stack slots of the context
+  X86Writer writer;
+};
+
+X86Emitter* new_x86_emitter(const Interner* interner, int fd,
+                            Arena* permanent_arena, Arena scratch_arena)
+{
+  X86Emitter* emitter = ARENA_ALLOC_OBJECT(permanent_arena, X86Emitter);
+  *emitter = (X86Emitter){
+      .context =
+          (X86CodegenContext){
+              .permanent_arena = permanent_arena,
+              .scratch_arena = scratch_arena,
+              .interner = interner,
+              .symbols = new_symbol_table(0, permanent_arena),
+          },
+      .writer = x86_fd_writer(fd, permanent_arena),
+  };
+  x86_write_header(&emitter->writer);
+  return emitter;
+}
+
+// Grows the tables indexed by symbol id to all the symbols interned so far.
+// They grow geometrically, since the interner keeps growing while the rest of
+// the file is parsed
+static void reserve_emitter_symbols(X86Emitter* emitter)
+{
+  X86CodegenContext* context = &emitter->context;
+  const uint32_t symbol_count = interner_symbol_count(context->interner);
+  const uint32_t old_capacity = emitter->symbol_capacity;
+  if (symbol_count <= old_capacity) { return; }
+
+  uint32_t capacity = old_capacity * 2;
+  if (capacity < symbol_count) { capacity = symbol_count; }
+
+  reserve_symbols(context->symbols, capacity, context->permanent_arena);
+  // Each function clears the stack slots it used, so only the new slots need
+  // zeroing
+  context->stack_slots =
+      ARENA_REALLOC_ARRAY(context->permanent_arena, uint32_t,
+                          context->stack_slots, old_capacity, capacity);
+  memset(context->stack_slots + old_capacity, 0,
+         (capacity - old_capacity) * sizeof(uint32_t));
+  emitter->symbol_capacity = capacity;
+}
+
+void x86_emit_top_level(X86Emitter* emitter, const IRTopLevel* top_level)
+{
+  reserve_emitter_symbols(emitter);
+
+  X86CodegenContext* context = &emitter->context;
+  switch (top_level->tag) {
+  case IR_TOP_LEVEL_INVALID: MCC_UNREACHABLE(); break;
+  case IR_TOP_LEVEL_FUNCTION: {
+    X86FunctionDef function =
+        x86_generate_function(&top_level->function, context);
+    x86_write_top_level(
+        (X86TopLevel){.tag = X86_TOPLEVEL_FUNCTION, .function = &function},
+        context->interner, &emitter->writer);
+  } break;
+  case IR_TOP_LEVEL_VARIABLE: {
+    X86GlobalVariable variable = (X86GlobalVariable){
+        .name = top_level->variable.name,
+        .value = top_level->variable.value,
+    };
+    add_symbol(context->symbols, variable.name);
+    x86_write_top_level(
+        (X86TopLevel){.tag = X86_TOPLEVEL_VARIABLE, .variable = &variable},
+        context->interner, &emitter->writer);
+  } break;
+  }
+}
+
+bool finish_x86_emitter(X86Emitter* emitter)
+{
+  x86_write_footer(&emitter->writer);
+  VECTOR_RELEASE(&emitter->context.instructions);
+  VECTOR_RELEASE(&emitter->context.fixed_instructions);
+  return x86_flush_writer(&emitter->writer);
 }
@@ -103,14 +103,15 @@ static void fix_cmp_instruction(X86InstructionVector* new_instructions,
   }
 }
 
-X86InstructionVector
+X86InstructionVector*
 fix_invalid_instructions(X86InstructionVector* instructions,
                          uint32_t stack_size, X86CodegenContext* context)
 {
-  X86InstructionVector new_instructions = {.arena = &context->scratch_arena};
+  X86InstructionVector* new_instructions = &context->fixed_instructions;
+  new_instructions->length = 0;
 
   if (stack_size > 0) {
-    push_instruction(&new_instructions, allocate_stack(stack_size));
+    push_instruction(new_instructions, allocate_stack(stack_size));
   }
   for (size_t i = 0; i < instructions->length; ++i) {
     X86Instruction instruction = instructions->data[i];
@@ -122,24 +123,24 @@ fix_invalid_instructions(X86InstructionVector* instructions,
     case X86_INST_AND:
     case X86_INST_OR:
     case X86_INST_XOR:
-      fix_binary_instruction(&new_instructions, instruction);
+      fix_binary_instruction(new_instructions, instruction);
       break;
 
     case X86_INST_IMUL:
-      fix_imul_instruction(&new_instructions, instruction);
+      fix_imul_instruction(new_instructions, instruction);
       break;
 
     case X86_INST_IDIV:
-      fix_idiv_instruction(&new_instructions, instruction);
+      fix_idiv_instruction(new_instructions, instruction);
       break;
     case X86_INST_SHL:
     case X86_INST_SAR:
-      fix_shift_instruction(&new_instructions, instruction);
+      fix_shift_instruction(new_instructions, instruction);
       break;
     case X86_INST_CMP:
-      fix_cmp_instruction(&new_instructions, instruction);
+      fix_cmp_instruction(new_instructions, instruction);
       break;
-    default: push_instruction(&new_instructions, instruction);
+    default: push_instruction(new_instructions, instruction);
     }
   }
 
@@ -165,9 +165,10 @@ static void push_call_instruction(X86InstructionVector* instructions,
                      unary_instruction(X86_INST_PUSH, X86_SZ_8, arg));
   }
 
-  StringView function_name = ir_instruction->call.func_name;
+  const SymbolId function_symbol = ir_instruction->call.func_name;
+  StringView function_name = symbol_name(context->interner, function_symbol);
   // On Linux, external functions need to be postfixed with `@PLT`
-  if (!has_symbol(context->symbols, function_name)) {
+  if (!has_symbol(context->symbols, function_symbol)) {
     function_name =
         allocate_printf(context->permanent_arena, "%.*s@PLT",
                         (int)function_name.size, function_name.start);
@@ -190,14 +191,15 @@ static void push_call_instruction(X86InstructionVector* instructions,
 }
 
 // First pass to generate assembly. Still need fixing later
-X86InstructionVector x86_from_ir_function(const IRFunctionDef* ir_function,
-                                          X86CodegenContext* context)
+X86InstructionVector* x86_from_ir_function(const IRFunctionDef* ir_function,
+                                           X86CodegenContext* context)
 {
-  // We use scratch arena here because the instructions generated here will be
-  // rewritten
-  X86InstructionVector instructions = {.arena = &context->scratch_arena};
+  // The instructions generated here will be rewritten, so they go to a vector
+  // that is reused by every function
+  X86InstructionVector* instructions = &context->instructions;
+  instructions->length = 0;
 
-  add_symbol(context->symbols, ir_function->name, context->permanent_arena);
+  add_symbol(context->symbols, ir_function->name);
 
   struct SplitResult param_counts =
       count_register_stack_vars(ir_function->param_count);
@@ -206,7 +208,7 @@ X86InstructionVector x86_from_ir_function(const IRFunctionDef* ir_function,
 
   for (uint32_t i = 0; i < register_param_count; ++i) {
     // move <parameter>, <arg register>
-    push_instruction(&instructions,
+    push_instruction(instructions,
                      mov(X86_SZ_4, pseudo_operand(ir_function->params[i]),
                          register_operand(arg_registers[i])));
   }
@@ -220,7 +222,7 @@ X86InstructionVector x86_from_ir_function(const IRFunctionDef* ir_function,
 
     // move <parameter>, <arg stack location>
     push_instruction(
-        &instructions,
+        instructions,
         mov(X86_SZ_4, pseudo_operand(ir_function->params[param_index]),
             stack_operand(-(intptr_t)(stack_param_index * 8 + 16))));
   }
@@ -231,67 +233,67 @@ X86InstructionVector x86_from_ir_function(const IRFunctionDef* ir_function,
     case IR_INVALID: MCC_UNREACHABLE(); break;
     case IR_RETURN: {
       // move eax, <op>
-      push_instruction(&instructions,
+      push_instruction(instructions,
                        mov(X86_SZ_4, register_operand(X86_REG_AX),
                            x86_operand_from_ir(ir_instruction->operand1)));
 
-      push_instruction(&instructions, (X86Instruction){.typ = X86_INST_RET});
+      push_instruction(instructions, (X86Instruction){.typ = X86_INST_RET});
       break;
     }
     case IR_COPY: {
       X86Operand dest = x86_operand_from_ir(ir_instruction->operand1);
       X86Operand src = x86_operand_from_ir(ir_instruction->operand2);
       // mov dest src
-      push_instruction(&instructions, mov(X86_SZ_4, dest, src));
+      push_instruction(instructions, mov(X86_SZ_4, dest, src));
     } break;
     case IR_NEG:
-      push_unary_instruction(&instructions, X86_INST_NEG, ir_instruction);
+      push_unary_instruction(instructions, X86_INST_NEG, ir_instruction);
       break;
     case IR_COMPLEMENT:
-      push_unary_instruction(&instructions, X86_INST_NOT, ir_instruction);
+      push_unary_instruction(instructions, X86_INST_NOT, ir_instruction);
       break;
     case IR_NOT: {
       X86Operand dest = x86_operand_from_ir(ir_instruction->operand1);
       X86Operand src = x86_operand_from_ir(ir_instruction->operand2);
       X86Operand zero = immediate_operand(0);
       // mov dest 0
-      push_instruction(&instructions, mov(X86_SZ_4, dest, zero));
+      push_instruction(instructions, mov(X86_SZ_4, dest, zero));
 
       // cmp src, 0
-      push_instruction(&instructions, cmp(X86_SZ_4, src, zero));
+      push_instruction(instructions, cmp(X86_SZ_4, src, zero));
 
       // sete dest
       push_instruction(
-          &instructions,
+          instructions,
           (X86Instruction){.typ = X86_INST_SETCC,
                            .setcc = {.cond = X86_COND_E, .op = dest}});
     } break;
 
     case IR_ADD:
-      push_binary_instruction(&instructions, X86_INST_ADD, ir_instruction);
+      push_binary_instruction(instructions, X86_INST_ADD, ir_instruction);
       break;
     case IR_SUB:
-      push_binary_instruction(&instructions, X86_INST_SUB, ir_instruction);
+      push_binary_instruction(instructions, X86_INST_SUB, ir_instruction);
       break;
     case IR_MUL:
-      push_binary_instruction(&instructions, X86_INST_IMUL, ir_instruction);
+      push_binary_instruction(instructions, X86_INST_IMUL, ir_instruction);
       break;
     case IR_DIV:
-    case IR_MOD: push_div_mod_instruction(&instructions, ir_instruction); break;
+    case IR_MOD: push_div_mod_instruction(instructions, ir_instruction); break;
     case IR_BITWISE_AND:
-      push_binary_instruction(&instructions, X86_INST_AND, ir_instruction);
+      push_binary_instruction(instructions, X86_INST_AND, ir_instruction);
       break;
     case IR_BITWISE_OR:
-      push_binary_instruction(&instructions, X86_INST_OR, ir_instruction);
+      push_binary_instruction(instructions, X86_INST_OR, ir_instruction);
       break;
     case IR_BITWISE_XOR:
-      push_binary_instruction(&instructions, X86_INST_XOR, ir_instruction);
+      push_binary_instruction(instructions, X86_INST_XOR, ir_instruction);
       break;
     case IR_SHIFT_LEFT:
-      push_binary_instruction(&instructions, X86_INST_SHL, ir_instruction);
+      push_binary_instruction(instructions, X86_INST_SHL, ir_instruction);
       break;
     case IR_SHIFT_RIGHT_ARITHMETIC:
-      push_binary_instruction(&instructions, X86_INST_SAR, ir_instruction);
+      push_binary_instruction(instructions, X86_INST_SAR, ir_instruction);
       break;
     case IR_SHIFT_RIGHT_LOGICAL: MCC_UNIMPLEMENTED(); break;
     case IR_EQUAL:
@@ -300,10 +302,10 @@ X86InstructionVector x86_from_ir_function(const IRFunctionDef* ir_function,
     case IR_LESS_EQUAL:
     case IR_GREATER:
     case IR_GREATER_EQUAL:
-      push_comparison_instruction(&instructions, ir_instruction);
+      push_comparison_instruction(instructions, ir_instruction);
       break;
     case IR_JMP:
-      push_instruction(&instructions, (X86Instruction){
+      push_instruction(instructions, (X86Instruction){
                                           .typ = X86_INST_JMP,
                                           .label = ir_instruction->label,
                                       });
@@ -314,7 +316,7 @@ X86InstructionVector x86_from_ir_function(const IRFunctionDef* ir_function,
       const StringView else_label = ir_instruction->else_label;
 
       // cmp cond, 0
-      push_instruction(&instructions,
+      push_instruction(instructions,
                        cmp(X86_SZ_4, cond, immediate_operand(0)));
 
       const IRInstruction* next_instruction =
@@ -338,22 +340,22 @@ X86InstructionVector x86_from_ir_function(const IRFunctionDef* ir_function,
           "Need to at least generate jump instruction for one branch");
       if (!skip_if) {
         // jne .if_label
-        push_instruction(&instructions, jmpcc(X86_COND_NE, if_label));
+        push_instruction(instructions, jmpcc(X86_COND_NE, if_label));
       }
       if (!skip_else) {
         // je .else_label
-        push_instruction(&instructions, jmpcc(X86_COND_E, else_label));
+        push_instruction(instructions, jmpcc(X86_COND_E, else_label));
       }
 
     } break;
     case IR_LABEL:
-      push_instruction(&instructions, (X86Instruction){
+      push_instruction(instructions, (X86Instruction){
                                           .typ = X86_INST_LABEL,
                                           .label = ir_instruction->label,
                                       });
       break;
     case IR_CALL: {
-      push_call_instruction(&instructions, ir_instruction, context);
+      push_call_instruction(instructions, ir_instruction, context);
       break;
     }
     }
@@ -4,8 +4,7 @@
 void push_instruction(X86InstructionVector* instructions,
                       X86Instruction instruction)
 {
-  DYNARRAY_PUSH_BACK(instructions, X86Instruction, instructions->arena,
-                     instruction);
+  VECTOR_PUSH_BACK(instructions, X86Instruction, instruction);
 }
 
 static bool is_unary(X86InstructionType typ)
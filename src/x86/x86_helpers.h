@@ -11,13 +11,38 @@ struct X86InstructionVector {
   uint32_t length;
   uint32_t capacity;
   X86Instruction* data;
-  Arena* arena;
+  VirtualRange range;
 };
 
 typedef struct X86InstructionVector X86InstructionVector;
 void push_instruction(X86InstructionVector* instructions,
                       X86Instruction instruction);
 
+// Formats assembly into a buffer, which is written out with write(2) once it
+// is full. A writer of the FILE* interface writes to its stream instead
+typedef struct X86Writer {
+  char* buffer;
+  size_t length; // of the output not written yet
+  size_t capacity;
+  int fd;
+  FILE* stream;
+  bool failed; // a write to fd failed
+} X86Writer;
+
+enum { X86_WRITER_BUFFER_SIZE = 256 * 1024 };
+
+// Creates a writer to fd, with a buffer of X86_WRITER_BUFFER_SIZE in arena
+X86Writer x86_fd_writer(int fd, Arena* arena);
+
+// Writes out the buffered output. Returns false if any write failed
+bool x86_flush_writer(X86Writer* writer);
+
+// Parts of x86_write_assembly, for writing a program one top level at a time
+void x86_write_header(X86Writer* writer);
+void x86_write_top_level(X86TopLevel top_level, const Interner* interner,
+                         X86Writer* writer);
+void x86_write_footer(X86Writer* writer);
+
 #define X86_UNARY_INSTRUCTION_CASES                                            \
   case X86_INST_NEG: [[fallthrough]];                                          \
   case X86_INST_NOT: [[fallthrough]];                                          \
@@ -49,7 +74,7 @@ static inline X86Operand register_operand(X86Register reg)
   return (X86Operand){.typ = X86_OPERAND_REGISTER, .reg = reg};
 }
 
-static inline X86Operand pseudo_operand(StringView name)
+static inline X86Operand pseudo_operand(SymbolId name)
 {
   return (X86Operand){.typ = X86_OPERAND_PSEUDO, .pseudo = name};
 }
@@ -13,7 +13,16 @@ typedef struct Symbols Symbols;
 typedef struct X86CodegenContext {
   Arena* permanent_arena;
   Arena scratch_arena;
+  const Interner* interner;
   Symbols* symbols;
+
+  // Stack slot of each symbol in the current function, indexed by symbol id
+  uint32_t* stack_slots;
+
+  // Instructions of the current function before and after fixing, reused by
+  // all functions
+  X86InstructionVector instructions;
+  X86InstructionVector fixed_instructions;
 } X86CodegenContext;
 
 /// @brief Converts an IR function into an x86 function.
@@ -21,7 +30,9 @@ typedef struct X86CodegenContext {
 /// This is the first pass in the x86 generation process.
 /// @note At this stage, the generated x86 function may still contain invalid
 /// instructions, as these are resolved in subsequent passes.
-X86InstructionVector
+/// @return The instructions, which stay valid until the next function is
+/// converted
+X86InstructionVector*
 x86_from_ir_function(const struct IRFunctionDef* ir_function,
                      X86CodegenContext* context);
 
@@ -49,9 +60,10 @@ uint32_t replace_pseudo_registers(X86InstructionVector* instructions,
 /// @param stack_size The size of the stack allocated for the function.
 /// @param[inout] permanent_arena Permanent memory arena used for storing the
 /// final function definition.
-/// @return A new dynamic array of instructions
+/// @return The fixed instructions, which stay valid until the next function is
+/// fixed
 ///
-X86InstructionVector
+X86InstructionVector*
 fix_invalid_instructions(X86InstructionVector* instructions,
                          uint32_t stack_size, X86CodegenContext* context);
 
@@ -1,6 +1,109 @@
 #include <mcc/prelude.h>
 #include <mcc/x86.h>
 
+#include "x86_helpers.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+// The FILE* interface formats into a buffer on the stack
+enum { X86_STREAM_BUFFER_SIZE = 16 * 1024 };
+
+#pragma region writer
+X86Writer x86_fd_writer(int fd, Arena* arena)
+{
+  return (X86Writer){
+      .buffer = ARENA_ALLOC_ARRAY(arena, char, X86_WRITER_BUFFER_SIZE),
+      .capacity = X86_WRITER_BUFFER_SIZE,
+      .fd = fd,
+  };
+}
+
+static X86Writer stream_writer(FILE* stream, char* buffer, size_t capacity)
+{
+  return (X86Writer){
+      .buffer = buffer, .capacity = capacity, .fd = -1, .stream = stream};
+}
+
+static void write_out(X86Writer* writer, const char* data, size_t size)
+{
+  if (writer->stream != nullptr) {
+    (void)fwrite(data, 1, size, writer->stream);
+    return;
+  }
+  while (size != 0 && !writer->failed) {
+    const ssize_t written = write(writer->fd, data, size);
+    if (written < 0) {
+      if (errno != EINTR) { writer->failed = true; }
+      continue;
+    }
+    data += written;
+    size -= (size_t)written;
+  }
+}
+
+bool x86_flush_writer(X86Writer* writer)
+{
+  write_out(writer, writer->buffer, writer->length);
+  writer->length = 0;
+  return writer->stream != nullptr ? !ferror(writer->stream)
+                                   : !writer->failed;
+}
+
+static void writer_append(X86Writer* writer, const char* data, size_t size)
+{
+  if (writer->length + size > writer->capacity) {
+    (void)x86_flush_writer(writer);
+    if (size > writer->capacity) {
+      write_out(writer, data, size);
+      return;
+    }
+  }
+  memcpy(writer->buffer + writer->length, data, size);
+  writer->length += size;
+}
+
+// Appends a string literal, whose size is known at compile time
+#define WRITER_APPEND_LITERAL(writer, literal)                                 \
+  writer_append((writer), "" literal, sizeof(literal) - 1)
+
+static void writer_append_str(X86Writer* writer, StringView s)
+{
+  writer_append(writer, s.start, s.size);
+}
+
+static void writer_append_cstr(X86Writer* writer, const char* s)
+{
+  writer_append(writer, s, strlen(s));
+}
+
+static void writer_append_int(X86Writer* writer, int64_t value)
+{
+  char digits[20];
+  size_t first = sizeof(digits);
+  // Negated as unsigned, so that the minimum value does not overflow
+  uint64_t magnitude = value < 0 ? -(uint64_t)value : (uint64_t)value;
+  do {
+    digits[--first] = (char)('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude != 0);
+  if (value < 0) { digits[--first] = '-'; }
+  writer_append(writer, digits + first, sizeof(digits) - first);
+}
+
+// Writes an indented mnemonic padded to the width of the operand column
+static void writer_append_mnemonic(X86Writer* writer, const char* name)
+{
+  enum { MNEMONIC_WIDTH = 6 };
+  char column[2 + MNEMONIC_WIDTH + 1] = "         ";
+  const size_t size = strlen(name);
+  MCC_ASSERT(size <= MNEMONIC_WIDTH);
+  memcpy(column + 2, name, size);
+  writer_append(writer, column, sizeof(column));
+}
+#pragma endregion
+
 static const char* x86_register_name(X86Register reg, X86Size size)
 {
   switch (size) {
@@ -71,39 +174,45 @@ static const char* size_directive(X86Size size)
   MCC_UNREACHABLE();
 }
 
-static void print_x86_operand(X86Operand operand, X86Size size, FILE* stream)
+static void print_x86_operand(X86Operand operand, X86Size size,
+                              const Interner* interner, X86Writer* writer)
 {
   switch (operand.typ) {
   case X86_OPERAND_INVALID: MCC_UNREACHABLE(); break;
   case X86_OPERAND_IMMEDIATE: {
-    (void)fprintf(stream, "%i", operand.imm);
+    writer_append_int(writer, operand.imm);
   } break;
   case X86_OPERAND_REGISTER:
-    (void)fprintf(stream, "%s", x86_register_name(operand.reg, size));
-    break;
-  case X86_OPERAND_PSEUDO:
-    (void)fprintf(stream, "%.*s", (int)operand.pseudo.size,
-                  operand.pseudo.start);
+    writer_append_cstr(writer, x86_register_name(operand.reg, size));
     break;
+  case X86_OPERAND_PSEUDO: {
+    writer_append_str(writer, symbol_name(interner, operand.pseudo));
+  } break;
   case X86_OPERAND_STACK:
+    writer_append_cstr(writer, size_directive(size));
     if (operand.stack.offset > 0) {
-      (void)fprintf(stream, "%s [rbp-%li]", size_directive(size),
-                    operand.stack.offset);
+      WRITER_APPEND_LITERAL(writer, " [rbp-");
+      writer_append_int(writer, operand.stack.offset);
+      writer_append(writer, "]", 1);
     } else if (operand.stack.offset < 0) {
-      (void)fprintf(stream, "%s [rbp+%li]", size_directive(size),
-                    -operand.stack.offset);
+      WRITER_APPEND_LITERAL(writer, " [rbp+");
+      writer_append_int(writer, -operand.stack.offset);
+      writer_append(writer, "]", 1);
     } else {
-      (void)fprintf(stream, "%s rbp", size_directive(size));
+      WRITER_APPEND_LITERAL(writer, " rbp");
     }
     break;
-  case X86_OPERAND_DATA:
-    (void)fprintf(stream, "%s [rip + %.*s]", size_directive(size),
-                  (int)operand.data.size, operand.data.start);
-    break;
+  case X86_OPERAND_DATA: {
+    writer_append_cstr(writer, size_directive(size));
+    WRITER_APPEND_LITERAL(writer, " [rip + ");
+    writer_append_str(writer, symbol_name(interner, operand.data));
+    writer_append(writer, "]", 1);
+  } break;
   }
 }
 
-static void print_cond_jmp_instruction(X86Instruction instruction, FILE* stream)
+static void print_cond_jmp_instruction(X86Instruction instruction,
+                                       X86Writer* writer)
 {
   const char* name = nullptr;
   switch (instruction.jmpcc.cond) {
@@ -115,12 +224,14 @@ static void print_cond_jmp_instruction(X86Instruction instruction, FILE* stream)
   case X86_COND_L: name = "jl"; break;
   case X86_COND_LE: name = "jle"; break;
   }
-  (void)fprintf(stream, "  %-6s ", name);
-  (void)fprintf(stream, ".L%.*s", (int)instruction.jmpcc.label.size,
-                instruction.jmpcc.label.start);
+  writer_append_mnemonic(writer, name);
+  WRITER_APPEND_LITERAL(writer, ".L");
+  writer_append_str(writer, instruction.jmpcc.label);
 }
 
-static void print_cond_set_instruction(X86Instruction instruction, FILE* stream)
+static void print_cond_set_instruction(X86Instruction instruction,
+                                       const Interner* interner,
+                                       X86Writer* writer)
 {
   const char* name = nullptr;
   switch (instruction.setcc.cond) {
@@ -132,146 +243,204 @@ static void print_cond_set_instruction(X86Instruction instruction, FILE* stream)
   case X86_COND_L: name = "setl"; break;
   case X86_COND_LE: name = "setle"; break;
   }
-  (void)fprintf(stream, "  %-6s ", name);
-  print_x86_operand(instruction.setcc.op, X86_SZ_1, stream);
+  writer_append_mnemonic(writer, name);
+  print_x86_operand(instruction.setcc.op, X86_SZ_1, interner, writer);
 }
 
 static void print_unary_instruction(const char* name,
-                                    X86Instruction instruction, FILE* stream)
+                                    X86Instruction instruction,
+                                    const Interner* interner,
+                                    X86Writer* writer)
 {
-  (void)fprintf(stream, "  %-6s ", name);
-  print_x86_operand(instruction.unary.op, instruction.unary.size, stream);
+  writer_append_mnemonic(writer, name);
+  print_x86_operand(instruction.unary.op, instruction.unary.size, interner,
+                    writer);
 }
 
 static void print_binary_instruction(const char* name,
-                                     X86Instruction instruction, FILE* stream)
+                                     X86Instruction instruction,
+                                     const Interner* interner,
+                                     X86Writer* writer)
 {
-  (void)fprintf(stream, "  %-6s ", name);
-  print_x86_operand(instruction.binary.dest, instruction.binary.size, stream);
-  (void)fputs(", ", stream);
-  print_x86_operand(instruction.binary.src, instruction.binary.size, stream);
+  writer_append_mnemonic(writer, name);
+  print_x86_operand(instruction.binary.dest, instruction.binary.size, interner,
+                    writer);
+  WRITER_APPEND_LITERAL(writer, ", ");
+  print_x86_operand(instruction.binary.src, instruction.binary.size, interner,
+                    writer);
 }
 
-void x86_print_instruction(X86Instruction instruction, FILE* stream)
+static void write_instruction(X86Instruction instruction,
+                              const Interner* interner, X86Writer* writer)
 {
   switch (instruction.typ) {
   case x86_INST_INVALID: MCC_UNREACHABLE(); break;
   case X86_INST_NOP: MCC_UNIMPLEMENTED(); break;
   case X86_INST_MOV:
-    print_binary_instruction("mov", instruction, stream);
+    print_binary_instruction("mov", instruction, interner, writer);
     break;
   case X86_INST_RET: {
-    (void)fputs("  mov    rsp, rbp\n", stream);
-    (void)fputs("  pop    rbp\n", stream);
-    (void)fputs("  ret\n", stream);
+    WRITER_APPEND_LITERAL(writer, "  mov    rsp, rbp\n"
+                                  "  pop    rbp\n"
+                                  "  ret\n");
   } break;
-  case X86_INST_NEG: print_unary_instruction("neg", instruction, stream); break;
-  case X86_INST_NOT: print_unary_instruction("not", instruction, stream); break;
+  case X86_INST_NEG:
+    print_unary_instruction("neg", instruction, interner, writer);
+    break;
+  case X86_INST_NOT:
+    print_unary_instruction("not", instruction, interner, writer);
+    break;
   case X86_INST_PUSH:
-    print_unary_instruction("push", instruction, stream);
+    print_unary_instruction("push", instruction, interner, writer);
     break;
   case X86_INST_ADD:
-    print_binary_instruction("add", instruction, stream);
+    print_binary_instruction("add", instruction, interner, writer);
     break;
   case X86_INST_SUB:
-    print_binary_instruction("sub", instruction, stream);
+    print_binary_instruction("sub", instruction, interner, writer);
     break;
   case X86_INST_IMUL:
-    print_binary_instruction("imul", instruction, stream);
+    print_binary_instruction("imul", instruction, interner, writer);
     break;
   case X86_INST_IDIV:
-    print_unary_instruction("idiv", instruction, stream);
+    print_unary_instruction("idiv", instruction, interner, writer);
     break;
-  case X86_INST_CDQ: (void)fputs("  cdq", stream); break;
+  case X86_INST_CDQ: WRITER_APPEND_LITERAL(writer, "  cdq"); break;
   case X86_INST_AND:
-    print_binary_instruction("and", instruction, stream);
+    print_binary_instruction("and", instruction, interner, writer);
+    break;
+  case X86_INST_OR:
+    print_binary_instruction("or", instruction, interner, writer);
     break;
-  case X86_INST_OR: print_binary_instruction("or", instruction, stream); break;
   case X86_INST_XOR:
-    print_binary_instruction("xor", instruction, stream);
+    print_binary_instruction("xor", instruction, interner, writer);
     break;
   case X86_INST_SHL:
-    print_binary_instruction("shl", instruction, stream);
+    print_binary_instruction("shl", instruction, interner, writer);
     break;
   case X86_INST_SAR:
-    print_binary_instruction("sar", instruction, stream);
+    print_binary_instruction("sar", instruction, interner, writer);
     break;
   case X86_INST_CMP:
-    print_binary_instruction("cmp", instruction, stream);
+    print_binary_instruction("cmp", instruction, interner, writer);
     break;
   case X86_INST_JMP: {
-    (void)fprintf(stream, "  jmp .L%.*s", (int)instruction.label.size,
-                  instruction.label.start);
+    WRITER_APPEND_LITERAL(writer, "  jmp .L");
+    writer_append_str(writer, instruction.label);
     break;
   }
-  case X86_INST_JMPCC: print_cond_jmp_instruction(instruction, stream); break;
-  case X86_INST_SETCC: print_cond_set_instruction(instruction, stream); break;
+  case X86_INST_JMPCC: print_cond_jmp_instruction(instruction, writer); break;
+  case X86_INST_SETCC:
+    print_cond_set_instruction(instruction, interner, writer);
+    break;
   case X86_INST_LABEL: {
-    (void)fprintf(stream, ".L%.*s:", (int)instruction.label.size,
-                  instruction.label.start);
+    WRITER_APPEND_LITERAL(writer, ".L");
+    writer_append_str(writer, instruction.label);
+    writer_append(writer, ":", 1);
     break;
   }
   case X86_INST_CALL:
-    (void)fprintf(stream, "  call   %.*s", (int)instruction.label.size,
-                  instruction.label.start);
+    writer_append_mnemonic(writer, "call");
+    writer_append_str(writer, instruction.label);
     break;
   }
 }
 
-static void dump_x86_function(const X86FunctionDef* function, FILE* stream)
+void x86_print_instruction(X86Instruction instruction,
+                           const Interner* interner, FILE* stream)
+{
+  char buffer[X86_STREAM_BUFFER_SIZE];
+  X86Writer writer = stream_writer(stream, buffer, sizeof(buffer));
+  write_instruction(instruction, interner, &writer);
+  (void)x86_flush_writer(&writer);
+}
+
+static void write_function(const X86FunctionDef* function,
+                           const Interner* interner, X86Writer* writer)
 {
-  (void)fprintf(stream, "%.*s:\n", (int)function->name.size,
-                function->name.start);
+  writer_append_str(writer, symbol_name(interner, function->name));
   // function prolog
-  (void)fputs("  push   rbp\n", stream);
-  (void)fputs("  mov    rbp, rsp\n", stream);
+  WRITER_APPEND_LITERAL(writer, ":\n"
+                                "  push   rbp\n"
+                                "  mov    rbp, rsp\n");
 
   for (size_t i = 0; i < function->instruction_count; ++i) {
-    x86_print_instruction(function->instructions[i], stream);
-    (void)fprintf(stream, "\n");
+    write_instruction(function->instructions[i], interner, writer);
+    writer_append(writer, "\n", 1);
   }
 }
 
-void x86_dump_assembly(const X86Program* program, FILE* stream)
+void x86_write_header(X86Writer* writer)
 {
-  (void)fputs(".intel_syntax noprefix\n", stream);
+  WRITER_APPEND_LITERAL(writer, ".intel_syntax noprefix\n");
+}
 
-  for (size_t i = 0; i < program->top_level_count; ++i) {
-    const X86TopLevel top_level = program->top_levels[i];
-    switch (top_level.tag) {
-    case X86_TOPLEVEL_INVALID: MCC_UNREACHABLE(); break;
-    case X86_TOPLEVEL_VARIABLE: {
-      X86GlobalVariable* variable = top_level.variable;
-      (void)fprintf(stream, ".globl %.*s\n", (int)variable->name.size,
-                    variable->name.start);
-      if (variable->value == 0) {
-        (void)fprintf(stream, ".bss\n");
-        (void)fprintf(stream, ".align 4\n");
-        (void)fprintf(stream, "%.*s:\n", (int)variable->name.size,
-                      variable->name.start);
-        (void)fprintf(stream, "    .zero 4\n");
-      } else {
-        (void)fprintf(stream, ".data\n");
-        (void)fprintf(stream, ".align 4\n");
-        (void)fprintf(stream, "%.*s:\n", (int)variable->name.size,
-                      variable->name.start);
-        (void)fprintf(stream, "    .long %d\n", variable->value);
-      }
-    } break;
-    case X86_TOPLEVEL_FUNCTION: {
-      X86FunctionDef* function = top_level.function;
-      (void)fprintf(stream, ".globl %.*s\n", (int)function->name.size,
-                    function->name.start);
-      (void)fprintf(stream, ".type %.*s, @function\n", (int)function->name.size,
-                    function->name.start);
-      (void)fprintf(stream, ".text\n");
-      dump_x86_function(function, stream);
-    } break;
+void x86_write_top_level(X86TopLevel top_level, const Interner* interner,
+                         X86Writer* writer)
+{
+  switch (top_level.tag) {
+  case X86_TOPLEVEL_INVALID: MCC_UNREACHABLE(); break;
+  case X86_TOPLEVEL_VARIABLE: {
+    X86GlobalVariable* variable = top_level.variable;
+    const StringView name = symbol_name(interner, variable->name);
+    WRITER_APPEND_LITERAL(writer, ".globl ");
+    writer_append_str(writer, name);
+    if (variable->value == 0) {
+      WRITER_APPEND_LITERAL(writer, "\n.bss\n.align 4\n");
+      writer_append_str(writer, name);
+      WRITER_APPEND_LITERAL(writer, ":\n    .zero 4\n");
+    } else {
+      WRITER_APPEND_LITERAL(writer, "\n.data\n.align 4\n");
+      writer_append_str(writer, name);
+      WRITER_APPEND_LITERAL(writer, ":\n    .long ");
+      writer_append_int(writer, variable->value);
+      writer_append(writer, "\n", 1);
     }
+  } break;
+  case X86_TOPLEVEL_FUNCTION: {
+    X86FunctionDef* function = top_level.function;
+    const StringView name = symbol_name(interner, function->name);
+    WRITER_APPEND_LITERAL(writer, ".globl ");
+    writer_append_str(writer, name);
+    WRITER_APPEND_LITERAL(writer, "\n.type ");
+    writer_append_str(writer, name);
+    WRITER_APPEND_LITERAL(writer, ", @function\n.text\n");
+    write_function(function, interner, writer);
+  } break;
   }
+}
 
+void x86_write_footer(X86Writer* writer)
+{
 #ifdef __linux__
   // indicates that code does not need an execution stack
-  (void)fprintf(stream, ".section .note.GNU-stack,\"\",@progbits\n");
+  WRITER_APPEND_LITERAL(writer, ".section .note.GNU-stack,\"\",@progbits\n");
+#else
+  (void)writer;
 #endif
 }
+
+static void write_assembly(const X86Program* program, X86Writer* writer)
+{
+  x86_write_header(writer);
+  for (size_t i = 0; i < program->top_level_count; ++i) {
+    x86_write_top_level(program->top_levels[i], program->interner, writer);
+  }
+  x86_write_footer(writer);
+}
+
+bool x86_write_assembly(const X86Program* program, int fd,
+                        Arena scratch_arena)
+{
+  X86Writer writer = x86_fd_writer(fd, &scratch_arena);
+  write_assembly(program, &writer);
+  return x86_flush_writer(&writer);
+}
+
+void x86_dump_assembly(const X86Program* program, FILE* stream)
+{
+  char buffer[X86_STREAM_BUFFER_SIZE];
+  X86Writer writer = stream_writer(stream, buffer, sizeof(buffer));
+  write_assembly(program, &writer);
+  (void)x86_flush_writer(&writer);
+}
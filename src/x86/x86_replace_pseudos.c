@@ -3,43 +3,36 @@
 
 #include <mcc/dynarray.h>
 
-// TODO: implement a hash table
-struct UniqueNameMap {
-  size_t length;
-  size_t capacity;
-  StringView* data;
+// The pseudo-registers of a function, in the order they get their stack slots.
+// The slot of each symbol is found through context->stack_slots, which is
+// reset for these symbols once the function is done.
+struct UniqueNames {
+  uint32_t length;
+  uint32_t capacity;
+  SymbolId* data;
+  uint32_t* stack_slots; // 1-based slot index of each symbol, 0 if none
   Arena* arena;
 };
 
-// Find the unique name in the map, and returns an integer index
-// Returns -1 otherwise
-static intptr_t try_find_unique_name(const struct UniqueNameMap* map,
-                                     StringView name)
+static intptr_t find_name_stack_offset(const struct UniqueNames* unique_names,
+                                       SymbolId name)
 {
-  for (size_t i = 0; i < map->length; ++i) {
-    if (str_eq(map->data[i], name)) { return (intptr_t)i; }
-  }
-  return -1;
-}
-
-static intptr_t find_name_stack_offset(const struct UniqueNameMap* map,
-                                       StringView name)
-{
-  const intptr_t index = try_find_unique_name(map, name);
-  if (index < 0) { MCC_UNREACHABLE(); }
-  return (index + 1) * 4;
+  const uint32_t slot = unique_names->stack_slots[name];
+  if (slot == 0) { MCC_UNREACHABLE(); }
+  return (intptr_t)slot * 4;
 }
 
-static void add_unique_name(struct UniqueNameMap* unique_names, StringView name)
+static void add_unique_name(struct UniqueNames* unique_names, SymbolId name)
 {
-  // Find whether the name is already in the map
-  if (try_find_unique_name(unique_names, name) >= 0) { return; }
+  // Find whether the name already has a slot
+  if (unique_names->stack_slots[name] != 0) { return; }
 
-  DYNARRAY_PUSH_BACK(unique_names, StringView, unique_names->arena, name);
+  DYNARRAY_PUSH_BACK(unique_names, SymbolId, unique_names->arena, name);
+  unique_names->stack_slots[name] = unique_names->length;
 }
 
 // Add a unique name if the operand is a pseudo register
-static void add_unique_name_if_pseudo(struct UniqueNameMap* unique_names,
+static void add_unique_name_if_pseudo(struct UniqueNames* unique_names,
                                       X86Operand operand)
 {
   if (operand.typ == X86_OPERAND_PSEUDO) {
@@ -48,13 +41,13 @@ static void add_unique_name_if_pseudo(struct UniqueNameMap* unique_names,
 }
 
 // If operand is a pseudo register, replace it with a stack address
-static void replace_pseudo_register(struct UniqueNameMap* unique_names,
+static void replace_pseudo_register(struct UniqueNames* unique_names,
                                     X86Operand* operand,
                                     X86CodegenContext* context)
 {
   if (operand->typ == X86_OPERAND_PSEUDO) {
     if (has_symbol(context->symbols, operand->pseudo)) {
-      const StringView name = operand->pseudo;
+      const SymbolId name = operand->pseudo;
       *operand = (X86Operand){
           .typ = X86_OPERAND_DATA,
           .data = name,
@@ -71,7 +64,8 @@ static void replace_pseudo_register(struct UniqueNameMap* unique_names,
 uint32_t replace_pseudo_registers(X86InstructionVector* instructions,
                                   X86CodegenContext* context)
 {
-  struct UniqueNameMap unique_names = {.arena = context->permanent_arena};
+  struct UniqueNames unique_names = {.stack_slots = context->stack_slots,
+                                     .arena = &context->scratch_arena};
 
   for (size_t i = 0; i < instructions->length; ++i) {
     X86Instruction* instruction = &instructions->data[i];
@@ -125,7 +119,11 @@ uint32_t replace_pseudo_registers(X86InstructionVector* instructions,
     case X86_INST_CALL: break;
     }
   }
-  uint32_t stack_space = u32_from_usize(unique_names.length * 4);
+  for (uint32_t i = 0; i < unique_names.length; ++i) {
+    context->stack_slots[unique_names.data[i]] = 0;
+  }
+
+  uint32_t stack_space = unique_names.length * 4;
   stack_space =
       (stack_space + 15) & ~15u; // round the stack space to multiple of 16
   return stack_space;
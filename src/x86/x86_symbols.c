@@ -1,28 +1,42 @@
 #include "x86_symbols.h"
 
-#include <mcc/dynarray.h>
+#include <string.h>
 
+// Symbol ids are dense, so the table is just a flag per symbol
 struct Symbols {
-  uint32_t length;
-  uint32_t capacity;
-  StringView* data;
+  uint32_t symbol_count;
+  bool* defined;
 };
 
-Symbols* new_symbol_table(Arena* arena)
+Symbols* new_symbol_table(uint32_t symbol_count, Arena* arena)
 {
-  return ARENA_ALLOC_OBJECT(arena, Symbols);
+  Symbols* symbols = ARENA_ALLOC_OBJECT(arena, Symbols);
+  bool* defined = ARENA_ALLOC_ARRAY(arena, bool, symbol_count);
+  if (symbol_count != 0) { memset(defined, 0, symbol_count * sizeof(bool)); }
+  *symbols = (Symbols){.symbol_count = symbol_count, .defined = defined};
+  return symbols;
 }
 
-bool has_symbol(const Symbols* symbols, StringView name)
+void reserve_symbols(Symbols* symbols, uint32_t symbol_count, Arena* arena)
 {
-  for (uint32_t i = 0; i < symbols->length; ++i) {
-    if (str_eq(name, symbols->data[i])) return true;
-  }
-  return false;
+  const uint32_t old_count = symbols->symbol_count;
+  if (symbol_count <= old_count) { return; }
+
+  symbols->defined = ARENA_REALLOC_ARRAY(arena, bool, symbols->defined,
+                                         old_count, symbol_count);
+  memset(symbols->defined + old_count, 0,
+         (symbol_count - old_count) * sizeof(bool));
+  symbols->symbol_count = symbol_count;
+}
+
+bool has_symbol(const Symbols* symbols, SymbolId name)
+{
+  MCC_ASSERT(name < symbols->symbol_count);
+  return symbols->defined[name];
 }
 
-void add_symbol(Symbols* symbols, StringView name, Arena* arena)
+void add_symbol(Symbols* symbols, SymbolId name)
 {
   MCC_ASSERT(!has_symbol(symbols, name));
-  DYNARRAY_PUSH_BACK(symbols, StringView, arena, name);
+  symbols->defined[name] = true;
 }
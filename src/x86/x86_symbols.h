@@ -2,14 +2,19 @@
 #define MCC_X86_SYMBOLS_H
 
 #include <mcc/arena.h>
-#include <mcc/str.h>
+#include <mcc/interner.h>
 
 typedef struct Symbols Symbols;
 
-Symbols* new_symbol_table(Arena* arena);
+// Creates a table that can hold any of the first symbol_count symbols
+Symbols* new_symbol_table(uint32_t symbol_count, Arena* arena);
 
-bool has_symbol(const Symbols* symbols, StringView name);
+// Lets the table hold any of the first symbol_count symbols, for symbols that
+// were interned after it was created
+void reserve_symbols(Symbols* symbols, uint32_t symbol_count, Arena* arena);
 
-void add_symbol(Symbols* symbols, StringView name, Arena* arena);
+bool has_symbol(const Symbols* symbols, SymbolId name);
+
+void add_symbol(Symbols* symbols, SymbolId name);
 
 #endif // MCC_X86_SYMBOLS_H
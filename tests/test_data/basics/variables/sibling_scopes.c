@@ -0,0 +1,22 @@
+// RETURN: 1
+int main(void)
+{
+  int x = 1;
+  for (int x = 10; x < 12; x = x + 1) {
+    int y = x;
+  }
+  {
+    int x = 2;
+    int y = x * 3;
+    {
+      int x = y;
+      y = x + 1;
+    }
+    x = y;
+  }
+  {
+    int y = 4;
+    x = x + y;
+  }
+  return x == 5;
+}
@@ -0,0 +1,4 @@
+int f(void) { return 1 +; }
+int g(void) { return 2 *; }
+int h(void) { return 3 -; }
+int main(void) { return 0 /; }
@@ -0,0 +1,4 @@
+/* An integer literal that does not fit in 32 bits. */
+int main(void) {
+    return 4294967296;
+}
\ No newline at end of file
@@ -0,0 +1,4 @@
+int main(void)
+{
+  return 99999999999999999999999 + 1;
+}
@@ -0,0 +1,26 @@
+// RETURN: 42
+// Far below the limit in memory actually used, even though the compiler
+// reserves much more address space than that
+int gcd(int a, int b)
+{
+  while (b != 0) {
+    int t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+int sum_of_gcds(int n)
+{
+  int sum = 0;
+  for (int i = 1; i <= n; i = i + 1) {
+    sum = sum + gcd(i, 12);
+  }
+  return sum;
+}
+
+int main(void)
+{
+  return sum_of_gcds(12) + gcd(84, 36) / 6;
+}
@@ -0,0 +1,32 @@
+# 0 "/root/repo/tests/test_data/memory_limit/within_limit/small_program.c"
+# 0 "<built-in>"
+# 0 "<command-line>"
+# 1 "/usr/include/stdc-predef.h" 1 3 4
+# 0 "<command-line>" 2
+# 1 "/root/repo/tests/test_data/memory_limit/within_limit/small_program.c"
+
+
+
+int gcd(int a, int b)
+{
+  while (b != 0) {
+    int t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+int sum_of_gcds(int n)
+{
+  int sum = 0;
+  for (int i = 1; i <= n; i = i + 1) {
+    sum = sum + gcd(i, 12);
+  }
+  return sum;
+}
+
+int main(void)
+{
+  return sum_of_gcds(12) - gcd(84, 36) * 0;
+}
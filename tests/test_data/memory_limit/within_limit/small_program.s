@@ -0,0 +1,104 @@
+.intel_syntax noprefix
+.globl gcd
+.type gcd, @function
+.text
+gcd:
+  push   rbp
+  mov    rbp, rsp
+  sub    rsp, 32
+  mov    dword ptr [rbp-4], edi
+  mov    dword ptr [rbp-8], esi
+.Lwhile_start_0:
+  mov    dword ptr [rbp-12], 0
+  cmp    dword ptr [rbp-8], 0
+  setne  byte ptr [rbp-12]
+  cmp    dword ptr [rbp-12], 0
+  je     .Lwhile_end_2
+.Lwhile_body_1:
+  mov    eax, dword ptr [rbp-4]
+  cdq
+  idiv   dword ptr [rbp-8]
+  mov    dword ptr [rbp-16], edx
+  mov    r10d, dword ptr [rbp-16]
+  mov    dword ptr [rbp-20], r10d
+  mov    r10d, dword ptr [rbp-8]
+  mov    dword ptr [rbp-4], r10d
+  mov    r10d, dword ptr [rbp-20]
+  mov    dword ptr [rbp-8], r10d
+  jmp .Lwhile_start_0
+.Lwhile_end_2:
+  mov    eax, dword ptr [rbp-4]
+  mov    rsp, rbp
+  pop    rbp
+  ret
+
+.globl sum_of_gcds
+.type sum_of_gcds, @function
+.text
+sum_of_gcds:
+  push   rbp
+  mov    rbp, rsp
+  sub    rsp, 32
+  mov    dword ptr [rbp-4], edi
+  mov    dword ptr [rbp-8], 0
+  mov    dword ptr [rbp-12], 1
+.Lfor_start_0:
+  mov    dword ptr [rbp-16], 0
+  mov    r10d, dword ptr [rbp-12]
+  cmp    r10d, dword ptr [rbp-4]
+  setle  byte ptr [rbp-16]
+  cmp    dword ptr [rbp-16], 0
+  je     .Lfor_end_3
+.Lfor_body_1:
+  mov    edi, dword ptr [rbp-12]
+  mov    esi, 12
+  call   gcd
+  mov    dword ptr [rbp-20], eax
+  mov    r10d, dword ptr [rbp-8]
+  mov    dword ptr [rbp-24], r10d
+  mov    r10d, dword ptr [rbp-20]
+  add    dword ptr [rbp-24], r10d
+  mov    r10d, dword ptr [rbp-24]
+  mov    dword ptr [rbp-8], r10d
+.Lfor_continue_2:
+  mov    r10d, dword ptr [rbp-12]
+  mov    dword ptr [rbp-28], r10d
+  add    dword ptr [rbp-28], 1
+  mov    r10d, dword ptr [rbp-28]
+  mov    dword ptr [rbp-12], r10d
+  jmp .Lfor_start_0
+.Lfor_end_3:
+  mov    eax, dword ptr [rbp-8]
+  mov    rsp, rbp
+  pop    rbp
+  ret
+
+.globl main
+.type main, @function
+.text
+main:
+  push   rbp
+  mov    rbp, rsp
+  sub    rsp, 16
+  mov    edi, 12
+  call   sum_of_gcds
+  mov    dword ptr [rbp-4], eax
+  mov    edi, 84
+  mov    esi, 36
+  call   gcd
+  mov    dword ptr [rbp-8], eax
+  mov    r10d, dword ptr [rbp-8]
+  mov    dword ptr [rbp-12], r10d
+  mov    r11d, dword ptr [rbp-12]
+  imul   r11d, 0
+  mov    dword ptr [rbp-12], r11d
+  mov    r10d, dword ptr [rbp-4]
+  mov    dword ptr [rbp-16], r10d
+  mov    r10d, dword ptr [rbp-12]
+  sub    dword ptr [rbp-16], r10d
+  mov    eax, dword ptr [rbp-16]
+  mov    rsp, rbp
+  pop    rbp
+  ret
+
+.section .note.GNU-stack,"",@progbits
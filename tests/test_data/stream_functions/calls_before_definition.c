@@ -0,0 +1,14 @@
+// RETURN: 42
+int later(int a, int b);
+int total = 1;
+
+int main(void)
+{
+  total = later(4, 2);
+  return total;
+}
+
+int later(int a, int b)
+{
+  return a * 10 + b;
+}
@@ -0,0 +1,9 @@
+int f(void)
+{
+  return 1;
+}
+
+int g(void)
+{
+  return h();
+}
@@ -0,0 +1,26 @@
+// RETURN: 55
+int sum_to(int n)
+{
+  int sum = 0;
+  for (int i = 1; i <= n; i = i + 1) {
+    int n = i;
+    sum = sum + n;
+  }
+  return sum;
+}
+
+int collatz_steps(int n)
+{
+  int steps = 0;
+  while (n != 1) {
+    n = n % 2 == 0 ? n / 2 : 3 * n + 1;
+    steps = steps + 1;
+  }
+  return steps;
+}
+
+int main(void)
+{
+  // collatz_steps(6) is 8
+  return sum_to(10) + collatz_steps(6) - 8;
+}
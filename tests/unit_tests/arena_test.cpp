@@ -100,6 +100,22 @@ TEST_CASE("Arena realloc")
             buffer + total_old_alloc_size + 1 + new_alloc_size);
   }
 
+  SECTION("Inplace shrink of the last allocation")
+  {
+    auto* p2 = ARENA_REALLOC_ARRAY(&arena, uint8_t, p1, second_alloc_size, 1);
+    REQUIRE(p2 == p1);
+    REQUIRE(p2[0] == '4');
+    REQUIRE(arena.current == buffer + first_alloc_size + 1);
+    REQUIRE(arena.size_remain == size - first_alloc_size - 1);
+  }
+
+  SECTION("Shrink an allocation that is not the last one")
+  {
+    auto* p2 = ARENA_REALLOC_ARRAY(&arena, uint8_t, p0, first_alloc_size, 0);
+    REQUIRE(p2 == p0);
+    REQUIRE(arena.current == buffer + total_old_alloc_size);
+  }
+
   SECTION("pointer not point to the last allocation")
   {
     static constexpr std::size_t new_alloc_size = 8;
@@ -111,3 +127,77 @@ TEST_CASE("Arena realloc")
     REQUIRE(arena.current == buffer + total_old_alloc_size + new_alloc_size);
   }
 }
+
+TEST_CASE("Growable arena")
+{
+  Arena arena = arena_from_virtual_mem(1024);
+  ArenaBlock* first_block = arena.block;
+  REQUIRE(first_block != nullptr);
+  REQUIRE(first_block->previous == nullptr);
+
+  const std::size_t first_size = arena.size_remain;
+  auto* p0 = ARENA_ALLOC_ARRAY(&arena, std::uint8_t, first_size);
+  p0[0] = 'x';
+  REQUIRE(arena.block == first_block);
+
+  SECTION("chains a larger block once the current one is full")
+  {
+    auto* p1 = ARENA_ALLOC_OBJECT(&arena, std::uint32_t);
+    ArenaBlock* second_block = arena.block;
+    REQUIRE(second_block != first_block);
+    REQUIRE(second_block->previous == first_block);
+    REQUIRE(first_block->next == second_block);
+    REQUIRE(second_block->size >= 2 * first_block->size);
+    require_ptr_equal(p1, second_block + 1);
+    REQUIRE(p0[0] == 'x');
+  }
+
+  SECTION("grows the latest allocation in place within a block")
+  {
+    auto* p1 = ARENA_ALLOC_ARRAY(&arena, std::uint8_t, 2);
+    auto* p2 = ARENA_REALLOC_ARRAY(&arena, std::uint8_t, p1, 2, 64);
+    REQUIRE(p2 == p1);
+  }
+
+  SECTION("moves the latest allocation to a new block when it does not fit")
+  {
+    arena_reset(&arena);
+    auto* p1 = ARENA_ALLOC_ARRAY(&arena, std::uint8_t, 2);
+    p1[0] = '4';
+    p1[1] = '2';
+    auto* p2 =
+        ARENA_REALLOC_ARRAY(&arena, std::uint8_t, p1, 2, first_size + 1);
+    REQUIRE(p2 != p1);
+    REQUIRE(arena.block != first_block);
+    REQUIRE(p2[0] == '4');
+    REQUIRE(p2[1] == '2');
+  }
+
+  SECTION("reuses the blocks after a reset")
+  {
+    (void)ARENA_ALLOC_OBJECT(&arena, std::uint32_t);
+    ArenaBlock* second_block = arena.block;
+
+    arena_reset(&arena);
+    REQUIRE(arena.block == first_block);
+    REQUIRE(arena.size_remain == first_size);
+
+    (void)ARENA_ALLOC_ARRAY(&arena, std::uint8_t, first_size);
+    (void)ARENA_ALLOC_OBJECT(&arena, std::uint32_t);
+    REQUIRE(arena.block == second_block);
+  }
+
+  SECTION("reuses the blocks that a copy of the arena chained")
+  {
+    Arena copy = arena;
+    (void)ARENA_ALLOC_OBJECT(&copy, std::uint32_t);
+    ArenaBlock* second_block = copy.block;
+    REQUIRE(arena.block == first_block);
+
+    (void)ARENA_ALLOC_OBJECT(&arena, std::uint32_t);
+    REQUIRE(arena.block == second_block);
+  }
+
+  arena_release_virtual_mem(&arena);
+  REQUIRE(arena.block == nullptr);
+}
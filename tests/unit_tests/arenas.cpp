@@ -2,12 +2,12 @@
 
 Arena& get_permanent_arena()
 {
-  thread_local Arena arena = arena_from_virtual_mem(1024);
+  thread_local Arena arena = arena_from_virtual_mem(1024 * 1024);
   return arena;
 }
 
 Arena get_scratch_arena()
 {
-  thread_local Arena arena = arena_from_virtual_mem(1024);
+  thread_local Arena arena = arena_from_virtual_mem(1024 * 1024);
   return arena;
 }
\ No newline at end of file
@@ -0,0 +1,141 @@
+#ifndef MCC_TEST_BENCHMARK_UTILS_HPP
+#define MCC_TEST_BENCHMARK_UTILS_HPP
+
+// Helpers shared by the micro benchmarks
+
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <string_view>
+
+#include <fmt/format.h>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define MCC_BENCHMARK_HAS_TSC 1
+#endif
+
+extern "C" {
+#include <mcc/arena.h>
+}
+
+// Runs f several times and returns the fastest run in seconds
+template <typename F> double best_seconds_of(int runs, F&& f)
+{
+  double best = std::numeric_limits<double>::max();
+  for (int i = 0; i < runs; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const auto end = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double>(end - start).count());
+  }
+  return best;
+}
+
+#ifdef MCC_BENCHMARK_HAS_TSC
+// Runs f several times and returns the fewest time-stamp counter ticks a run
+// took
+template <typename F> unsigned long long best_cycles_of(int runs, F&& f)
+{
+  unsigned long long best = std::numeric_limits<unsigned long long>::max();
+  for (int i = 0; i < runs; ++i) {
+    const unsigned long long start = __rdtsc();
+    f();
+    best = std::min(best, __rdtsc() - start);
+  }
+  return best;
+}
+#endif
+
+inline void report_throughput(std::string_view name, size_t bytes,
+                              double seconds)
+{
+  fmt::print("{:<40} {:>10.1f} MB/s\n", name,
+             static_cast<double>(bytes) / seconds / 1e6);
+}
+
+// Reports how many items (e.g. tokens) are processed per second
+inline void report_rate(std::string_view name, size_t count,
+                        std::string_view unit, double seconds)
+{
+  fmt::print("{:<40} {:>10.1f} M{}/s\n", name,
+             static_cast<double>(count) / seconds / 1e6, unit);
+}
+
+inline void report_cycles_per_byte(std::string_view name, size_t bytes,
+                                   unsigned long long cycles)
+{
+  fmt::print("{:<40} {:>10.2f} cycles/byte\n", name,
+             static_cast<double>(cycles) / static_cast<double>(bytes));
+}
+
+inline void report_bytes_per_item(std::string_view name, size_t bytes,
+                                  size_t count, std::string_view unit)
+{
+  fmt::print("{:<40} {:>10.2f} bytes/{}\n", name,
+             static_cast<double>(bytes) / static_cast<double>(count), unit);
+}
+
+// Physical memory currently used by the process
+inline size_t resident_bytes()
+{
+  std::ifstream statm("/proc/self/statm");
+  size_t total_pages = 0;
+  size_t resident_pages = 0;
+  statm >> total_pages >> resident_pages;
+  return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+// Page faults the process has taken so far, which did not need to read a file
+inline size_t minor_page_faults()
+{
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return static_cast<size_t>(usage.ru_minflt);
+}
+
+// Appends the i-th function of the generated sources, in the style of ordinary
+// code: indented function bodies with comments and descriptive names
+inline void append_c_function(std::string& source, size_t i)
+{
+  source += fmt::format(
+      "/* Computes a weighted sum of the two parameters.\n"
+      " * The weights are chosen arbitrarily. */\n"
+      "static int compute_weighted_sum_{0}(int first_parameter, "
+      "int second_parameter)\n"
+      "{{\n"
+      "    // combine both inputs into a single value\n"
+      "    int accumulated_value = first_parameter * {0} + "
+      "second_parameter;\n"
+      "    if (accumulated_value >= 1024) {{\n"
+      "        accumulated_value -= second_parameter << 2;\n"
+      "    }}\n"
+      "    return accumulated_value;\n"
+      "}}\n\n",
+      i);
+}
+
+// Generates roughly target_size bytes of C source
+inline std::string generate_c_source(size_t target_size)
+{
+  std::string source;
+  source.reserve(target_size + 512);
+  for (size_t i = 0; source.size() < target_size; ++i) {
+    append_c_function(source, i);
+  }
+  return source;
+}
+
+// Generates C source with the given number of functions
+inline std::string generate_c_functions(size_t function_count)
+{
+  std::string source;
+  for (size_t i = 0; i < function_count; ++i) { append_c_function(source, i); }
+  return source;
+}
+
+#endif // MCC_TEST_BENCHMARK_UTILS_HPP
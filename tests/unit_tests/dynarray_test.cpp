@@ -70,3 +70,37 @@ TEST_CASE("Multiple DynArray", "[dynarray]")
   REQUIRE(vector2.data[0] == 2);
   REQUIRE(vector2.data[1] == 4);
 }
+
+template <typename T> struct ReservedVector {
+  T* data = nullptr;
+  uint32_t length = 0;
+  uint32_t capacity = 0;
+  VirtualRange range = {};
+
+  void push_back(T x) { VECTOR_PUSH_BACK(this, T, x); }
+};
+
+TEST_CASE("Vector in a reserved range", "[dynarray]")
+{
+  ReservedVector<int> vector;
+  vector.push_back(101);
+  REQUIRE(vector.length == 1);
+  REQUIRE(vector.capacity >= 1);
+  REQUIRE(vector.data[0] == 101);
+
+  int* const data = vector.data;
+  for (int i = 0; i < 100'000; ++i) { vector.push_back(i); }
+
+  // Growing commits more of the range instead of moving the elements
+  REQUIRE(vector.data == data);
+  REQUIRE(vector.length == 100'001);
+  REQUIRE(vector.capacity >= vector.length);
+  REQUIRE(vector.range.committed_size >= vector.length * sizeof(int));
+  REQUIRE(vector.data[0] == 101);
+  for (int i = 0; i < 100'000; ++i) { REQUIRE(vector.data[i + 1] == i); }
+
+  VECTOR_RELEASE(&vector);
+  REQUIRE(vector.data == nullptr);
+  REQUIRE(vector.length == 0);
+  REQUIRE(vector.range.begin == nullptr);
+}
@@ -0,0 +1,143 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <mcc/hash_table.h>
+}
+
+#include "benchmark_utils.hpp"
+
+namespace {
+
+// The 4-ary hash trie that HashMap used to be, kept as a baseline
+struct TrieNode {
+  TrieNode* child[4];
+  StringView key;
+  void* value_ptr;
+};
+
+TrieNode** trie_lookup_node(TrieNode** root, StringView key)
+{
+  TrieNode** node = root;
+  for (uint64_t h = hash64(key); *node != nullptr; h <<= 2) {
+    if (str_eq(key, (*node)->key)) { return node; }
+    node = &(*node)->child[h >> 62];
+  }
+  return node;
+}
+
+bool trie_try_insert(TrieNode** root, StringView key, void* value_ptr,
+                     Arena* arena)
+{
+  TrieNode** node = trie_lookup_node(root, key);
+  if (*node != nullptr) { return false; }
+  *node = ARENA_ALLOC_OBJECT(arena, TrieNode);
+  **node = TrieNode{.child = {}, .key = key, .value_ptr = value_ptr};
+  return true;
+}
+
+void* trie_lookup(TrieNode** root, StringView key)
+{
+  TrieNode** node = trie_lookup_node(root, key);
+  return *node == nullptr ? nullptr : (*node)->value_ptr;
+}
+
+// The byte-at-a-time FNV-style hash that hash64 used to be
+uint64_t bytewise_hash64(StringView s)
+{
+  uint64_t h = 0x100;
+  for (size_t i = 0; i < s.size; i++) {
+    h ^= s.start[i] & 255;
+    h *= 1111111111111111111;
+  }
+  return h;
+}
+
+// Identifier-like keys. The second half is never inserted and is used for
+// missed lookups
+std::vector<std::string> generate_keys(size_t count)
+{
+  std::vector<std::string> keys;
+  keys.reserve(count * 2);
+  for (size_t i = 0; i < count * 2; ++i) {
+    keys.push_back(fmt::format("local_variable_{}", i));
+  }
+  return keys;
+}
+
+} // namespace
+
+TEST_CASE("Hash map against hash trie", "[hash_map][benchmark]")
+{
+  Arena arena = arena_from_virtual_mem(1024 * 1024 * 1024);
+
+  for (const size_t key_count :
+       {size_t{1'000}, size_t{100'000}, size_t{1'000'000}}) {
+    const std::vector<std::string> keys = generate_keys(key_count);
+    std::vector<StringView> views;
+    for (const std::string& key : keys) { views.push_back(str(key.c_str())); }
+
+    // Each run inserts every key, then looks up every key once and misses as
+    // many times
+    size_t found = 0;
+    const double trie_seconds = best_seconds_of(5, [&] {
+      arena_reset(&arena);
+      TrieNode* root = nullptr;
+      for (size_t i = 0; i < key_count; ++i) {
+        trie_try_insert(&root, views[i], &found, &arena);
+      }
+      found = 0;
+      for (const StringView key : views) {
+        found += trie_lookup(&root, key) != nullptr;
+      }
+    });
+    REQUIRE(found == key_count);
+
+    const double map_seconds = best_seconds_of(5, [&] {
+      arena_reset(&arena);
+      HashMap map = {};
+      for (size_t i = 0; i < key_count; ++i) {
+        hashmap_try_insert(&map, views[i], &found, &arena);
+      }
+      found = 0;
+      for (const StringView key : views) {
+        found += hashmap_lookup(&map, key) != nullptr;
+      }
+    });
+    REQUIRE(found == key_count);
+
+    const size_t operations = key_count * 3;
+    report_rate(fmt::format("hash trie with {} keys", key_count), operations,
+                "ops", trie_seconds);
+    report_rate(fmt::format("hash map with {} keys", key_count), operations,
+                "ops", map_seconds);
+  }
+}
+
+TEST_CASE("Hash function throughput", "[hash_map][benchmark]")
+{
+  const std::vector<std::string> keys = generate_keys(1'000'000);
+  std::vector<StringView> views;
+  size_t bytes = 0;
+  for (const std::string& key : keys) {
+    views.push_back(str(key.c_str()));
+    bytes += key.size();
+  }
+
+  // Summed so that the calls cannot be optimized away
+  uint64_t sum = 0;
+  const double bytewise_seconds = best_seconds_of(5, [&] {
+    for (const StringView key : views) { sum += bytewise_hash64(key); }
+  });
+  const double seconds = best_seconds_of(5, [&] {
+    for (const StringView key : views) { sum += hash64(key); }
+  });
+  REQUIRE(sum != 0);
+
+  report_rate("bytewise hash", views.size(), "hashes", bytewise_seconds);
+  report_throughput("bytewise hash", bytes, bytewise_seconds);
+  report_rate("hash64", views.size(), "hashes", seconds);
+  report_throughput("hash64", bytes, seconds);
+}
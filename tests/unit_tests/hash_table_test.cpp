@@ -1,5 +1,11 @@
 #include <catch2/catch_test_macros.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <string>
+#include <vector>
+
 extern "C" {
 #include <mcc/arena.h>
 #include <mcc/hash_table.h>
@@ -11,7 +17,7 @@ TEST_CASE("Hash Map", "[hash_map]")
 {
   Arena arena = get_scratch_arena();
 
-  HashMap map = HashMap{.root = nullptr};
+  HashMap map = HashMap{};
 
   int* value_ptr = ARENA_ALLOC_OBJECT(&arena, int);
   *value_ptr = 42;
@@ -38,3 +44,188 @@ TEST_CASE("Hash Map", "[hash_map]")
   REQUIRE(result != nullptr);
   REQUIRE(*result == 42);
 }
+
+TEST_CASE("Symbol Map", "[hash_map]")
+{
+  Arena arena = get_scratch_arena();
+
+  SymbolMap map = SymbolMap{};
+
+  int values[100];
+  for (SymbolId i = 0; i < 100; ++i) {
+    values[i] = static_cast<int>(i);
+    REQUIRE(symbol_map_try_insert(&map, i, &values[i], &arena) == true);
+  }
+  REQUIRE(symbol_map_lookup(&map, 100) == nullptr);
+
+  for (SymbolId i = 0; i < 100; ++i) {
+    int* result = static_cast<int*>(symbol_map_lookup(&map, i));
+    REQUIRE(result != nullptr);
+    REQUIRE(*result == static_cast<int>(i));
+  }
+
+  // try insert will not overwrite the entry
+  REQUIRE(symbol_map_try_insert(&map, 42, &values[0], &arena) == false);
+  REQUIRE(*static_cast<int*>(symbol_map_lookup(&map, 42)) == 42);
+}
+
+TEST_CASE("Hash Map grows past many keys", "[hash_map]")
+{
+  Arena arena = get_scratch_arena();
+
+  HashMap map = HashMap{};
+
+  // Enough keys to go through several resizes
+  constexpr size_t key_count = 2000;
+  std::vector<std::string> keys;
+  keys.reserve(key_count);
+  std::vector<int> values(key_count);
+  for (size_t i = 0; i < key_count; ++i) {
+    keys.push_back("key_" + std::to_string(i));
+    values[i] = static_cast<int>(i);
+    REQUIRE(hashmap_try_insert(&map, str(keys[i].c_str()), &values[i],
+                               &arena) == true);
+  }
+  REQUIRE(map.size == key_count);
+
+  for (size_t i = 0; i < key_count; ++i) {
+    int* result = static_cast<int*>(hashmap_lookup(&map, str(keys[i].c_str())));
+    REQUIRE(result != nullptr);
+    REQUIRE(*result == static_cast<int>(i));
+  }
+  REQUIRE(hashmap_lookup(&map, str("key_2000")) == nullptr);
+  REQUIRE(hashmap_lookup(&map, str("")) == nullptr);
+  REQUIRE(hashmap_try_insert(&map, str("key_0"), &values[1], &arena) == false);
+}
+
+TEST_CASE("Reserved maps do not grow", "[hash_map]")
+{
+  Arena arena = get_scratch_arena();
+
+  SymbolMap map = SymbolMap{};
+  symbol_map_reserve(&map, 1000, &arena);
+  const uint8_t* control = map.control;
+  const uint32_t capacity = map.capacity;
+  REQUIRE(capacity >= 1000);
+
+  int value = 0;
+  for (SymbolId i = 0; i < 1000; ++i) {
+    REQUIRE(symbol_map_try_insert(&map, i * 7919, &value, &arena) == true);
+  }
+  REQUIRE(map.control == control);
+  REQUIRE(map.capacity == capacity);
+
+  for (SymbolId i = 0; i < 1000; ++i) {
+    REQUIRE(symbol_map_lookup(&map, i * 7919) == &value);
+  }
+  REQUIRE(symbol_map_lookup(&map, 1) == nullptr);
+
+  // Reserving less than the current capacity is a no-op
+  symbol_map_reserve(&map, 10, &arena);
+  REQUIRE(map.control == control);
+}
+
+TEST_CASE("Hash Map with precomputed hashes", "[hash_map]")
+{
+  Arena arena = get_scratch_arena();
+
+  HashMap map = HashMap{};
+
+  // Same spelling at different addresses
+  const char source[] = "count = count + 1";
+  const StringView first{.start = source, .size = 5};
+  const StringView second{.start = source + 8, .size = 5};
+  const uint64_t hash = hash64(first);
+  REQUIRE(hash64(second) == hash);
+
+  int value = 1;
+  REQUIRE(hashmap_try_insert_hashed(&map, first, hash, &value, &arena));
+  REQUIRE(hashmap_lookup_hashed(&map, second, hash) == &value);
+  REQUIRE(hashmap_lookup(&map, str("count")) == &value);
+  REQUIRE(!hashmap_try_insert_hashed(&map, second, hash, nullptr, &arena));
+}
+
+namespace {
+
+// Identifiers in the shapes that show up in real programs: keywords and
+// library names, every short name, and long names that differ only in a
+// numeric suffix
+std::vector<std::string> identifier_set()
+{
+  std::set<std::string> names = {
+      "auto",     "break",    "case",     "char",    "const",   "continue",
+      "default",  "do",       "double",   "else",    "enum",    "extern",
+      "float",    "for",      "goto",     "if",      "inline",  "int",
+      "long",     "register", "restrict", "return",  "short",   "signed",
+      "sizeof",   "static",   "struct",   "switch",  "typedef", "union",
+      "unsigned", "void",     "volatile", "while",   "main",    "printf",
+      "malloc",   "free",     "memcpy",   "memset",  "strlen",  "size_t",
+      "uint8_t",  "uint32_t", "uint64_t", "int32_t", "FILE",    "stderr",
+  };
+
+  const std::string alphabet = "abcdefghijklmnopqrstuvwxyz_";
+  for (const char a : alphabet) {
+    names.insert(std::string{a});
+    for (const char b : alphabet) {
+      names.insert(std::string{a, b});
+      for (const char c : alphabet) { names.insert(std::string{a, b, c}); }
+    }
+  }
+
+  for (int i = 0; i < 50000; ++i) {
+    const std::string n = std::to_string(i);
+    names.insert("x" + n);
+    names.insert("local_variable_" + n);
+    names.insert("compute_weighted_sum_" + n + "_impl");
+  }
+
+  return {names.begin(), names.end()};
+}
+
+} // namespace
+
+TEST_CASE("hash64 spreads identifiers", "[hash_map]")
+{
+  const std::vector<std::string> names = identifier_set();
+  const auto name_count = static_cast<double>(names.size());
+
+  std::vector<uint64_t> hashes;
+  hashes.reserve(names.size());
+  for (const std::string& name : names) {
+    hashes.push_back(hash64(str(name.c_str())));
+  }
+
+  // No two identifiers share a full hash
+  std::vector<uint64_t> sorted = hashes;
+  std::ranges::sort(sorted);
+  REQUIRE(std::ranges::adjacent_find(sorted) == sorted.end());
+
+  // The tables only use the high 32 bits. Collisions there should be about
+  // as rare as for random numbers: n^2 / 2^33, about 3.7 pairs here
+  std::vector<uint32_t> high_bits;
+  for (const uint64_t hash : hashes) {
+    high_bits.push_back(static_cast<uint32_t>(hash >> 32));
+  }
+  std::ranges::sort(high_bits);
+  size_t high_collisions = 0;
+  for (size_t i = 1; i < high_bits.size(); ++i) {
+    high_collisions += high_bits[i] == high_bits[i - 1];
+  }
+  const double expected_collisions = name_count * name_count / 0x1p33;
+  CHECK(static_cast<double>(high_collisions) < expected_collisions * 4 + 8);
+
+  // Bucket loads, as seen by a table of 4096 groups, are spread like random
+  // numbers would be. The chi-squared statistic of a uniform distribution is
+  // about the bucket count, with a standard deviation of sqrt(2 * buckets)
+  constexpr size_t bucket_count = 4096;
+  std::vector<uint32_t> buckets(bucket_count);
+  for (const uint64_t hash : hashes) {
+    buckets[(hash >> 32) % bucket_count]++;
+  }
+  const double mean = name_count / bucket_count;
+  double chi_squared = 0;
+  for (const uint32_t load : buckets) {
+    chi_squared += (load - mean) * (load - mean) / mean;
+  }
+  CHECK(chi_squared < bucket_count + 6 * std::sqrt(2.0 * bucket_count));
+}
@@ -0,0 +1,87 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <mcc/interner.h>
+}
+
+#include "arenas.hpp"
+
+TEST_CASE("Interner gives each spelling one id", "[interner]")
+{
+  Arena arena = get_scratch_arena();
+  Interner* interner = new_interner(&arena);
+
+  const SymbolId x = intern(interner, str("x"));
+  const SymbolId y = intern(interner, str("y"));
+  REQUIRE(x != y);
+  REQUIRE(intern(interner, str("x")) == x);
+  REQUIRE(intern(interner, str("y")) == y);
+  REQUIRE(interner_symbol_count(interner) == 2);
+
+  REQUIRE(str_eq(symbol_name(interner, x), str("x")));
+  REQUIRE(str_eq(symbol_name(interner, y), str("y")));
+
+  // Spellings are compared by content, not by address
+  const char source[] = "x + x";
+  const StringView second_x{.start = source + 4, .size = 1};
+  REQUIRE(intern(interner, second_x) == x);
+}
+
+TEST_CASE("Interner fresh symbols", "[interner]")
+{
+  Arena arena = get_scratch_arena();
+  Interner* interner = new_interner(&arena);
+
+  const SymbolId x = intern(interner, str("x"));
+  const SymbolId fresh = intern_fresh(interner, str("x"));
+  REQUIRE(fresh != x);
+  REQUIRE(str_eq(symbol_name(interner, fresh), str("x")));
+
+  // A fresh symbol is never found by spelling
+  REQUIRE(intern(interner, str("x")) == x);
+}
+
+TEST_CASE("Interner owns the names of fresh symbols", "[interner]")
+{
+  Arena arena = get_scratch_arena();
+  Interner* interner = new_interner(&arena);
+
+  std::string buffer = "$0";
+  const SymbolId fresh =
+      intern_fresh(interner, StringView{.start = buffer.data(), .size = 2});
+  const StringView label = interner_copy_string(
+      interner, StringView{.start = buffer.data(), .size = 2});
+
+  // The names stay valid after the buffer they were formatted in is reused
+  buffer = "$1";
+  REQUIRE(str_eq(symbol_name(interner, fresh), str("$0")));
+  REQUIRE(str_eq(label, str("$0")));
+}
+
+TEST_CASE("Interner ids stay stable as the table grows", "[interner]")
+{
+  Arena arena = get_scratch_arena();
+  Interner* interner = new_interner(&arena);
+
+  constexpr uint32_t count = 10000;
+  std::vector<std::string> names;
+  names.reserve(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    names.push_back("name_" + std::to_string(i));
+  }
+
+  for (uint32_t i = 0; i < count; ++i) {
+    const StringView name{.start = names[i].data(), .size = names[i].size()};
+    REQUIRE(intern(interner, name) == i);
+  }
+  REQUIRE(interner_symbol_count(interner) == count);
+
+  for (uint32_t i = 0; i < count; ++i) {
+    const StringView name{.start = names[i].data(), .size = names[i].size()};
+    REQUIRE(intern(interner, name) == i);
+    REQUIRE(str_eq(symbol_name(interner, i), name));
+  }
+}
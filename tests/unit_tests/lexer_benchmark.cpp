@@ -0,0 +1,82 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+
+extern "C" {
+#include <mcc/frontend.h>
+}
+
+#include "benchmark_utils.hpp"
+
+TEST_CASE("Lexer throughput", "[lexer][benchmark]")
+{
+  const std::string source = generate_c_source(16 * 1024 * 1024);
+
+  Arena permanent_arena = arena_from_virtual_mem(1024 * 1024 * 1024);
+
+  uint32_t token_count = 0;
+  const double seconds = best_seconds_of(5, [&] {
+    arena_reset(&permanent_arena);
+    token_count = lex(source.c_str(), &permanent_arena).token_count;
+  });
+
+  REQUIRE(token_count > 0);
+  report_throughput("lex", source.size(), seconds);
+  report_rate("lex", token_count, "tokens", seconds);
+}
+
+#ifdef MCC_BENCHMARK_HAS_TSC
+TEST_CASE("Lexer cycles per byte", "[lexer][benchmark]")
+{
+  const std::string source = generate_c_source(16 * 1024 * 1024);
+
+  Arena permanent_arena = arena_from_virtual_mem(1024 * 1024 * 1024);
+
+  const unsigned long long cycles = best_cycles_of(5, [&] {
+    arena_reset(&permanent_arena);
+    (void)lex(source.c_str(), &permanent_arena);
+  });
+  report_cycles_per_byte("lex", source.size(), cycles);
+}
+#endif
+
+TEST_CASE("Lexer token memory", "[lexer][benchmark]")
+{
+  // About one million tokens
+  const std::string source = generate_c_source(11 * 1024 * 1024);
+
+  Arena permanent_arena = arena_from_virtual_mem(1024 * 1024 * 1024);
+
+  const size_t resident_before = resident_bytes();
+  const uint32_t token_count =
+      lex(source.c_str(), &permanent_arena).token_count;
+  const size_t resident = resident_bytes() - resident_before;
+  const auto arena_bytes = static_cast<size_t>(
+      permanent_arena.current - static_cast<Byte*>(permanent_arena.begin));
+
+  fmt::print("{:<40} {:>10} tokens\n", "lex", token_count);
+  report_bytes_per_item("lex resident memory", resident, token_count,
+                        "token");
+  report_bytes_per_item("lex arena footprint", arena_bytes, source.size(),
+                        "source byte");
+}
+
+TEST_CASE("Parallel lexer scaling", "[lexer][benchmark]")
+{
+  const std::string source = generate_c_source(64 * 1024 * 1024);
+
+  Arena permanent_arena = arena_from_virtual_mem(2048ull * 1024 * 1024);
+
+  // Goes beyond the core count on small machines to show the overhead
+  const uint32_t max_thread_count = std::max(
+      4u, static_cast<uint32_t>(sysconf(_SC_NPROCESSORS_ONLN)));
+  for (uint32_t thread_count = 1; thread_count <= max_thread_count;
+       thread_count *= 2) {
+    const double seconds = best_seconds_of(5, [&] {
+      arena_reset(&permanent_arena);
+      (void)lex_with_threads(source.c_str(), thread_count, &permanent_arena);
+    });
+    report_throughput(fmt::format("lex with {} threads", thread_count),
+                      source.size(), seconds);
+  }
+}
@@ -2,6 +2,8 @@
 #include <catch2/matchers/catch_matchers_range_equals.hpp>
 
 #include <span>
+#include <string>
+#include <vector>
 
 extern "C" {
 #include <mcc/frontend.h>
@@ -14,7 +16,6 @@ using Catch::Matchers::RangeEquals;
 TEST_CASE("Lexer lex symbols", "[lexer]")
 {
   Arena& permanent_arena = get_permanent_arena();
-  const Arena scratch_arena = get_scratch_arena();
 
   static constexpr const char* input = R"(= == != < << <= > >> >=
 & && &= | || |= ! ^ ^= <<= >>=
@@ -61,7 +62,7 @@ TEST_CASE("Lexer lex symbols", "[lexer]")
                                           TOKEN_SEMICOLON,
                                           TOKEN_EOF};
 
-  const auto tokens = lex(input, &permanent_arena, scratch_arena);
+  const auto tokens = lex(input, &permanent_arena);
   const std::span token_types(tokens.token_types, tokens.token_count);
   REQUIRE_THAT(expected, RangeEquals(token_types));
 }
@@ -69,7 +70,6 @@ TEST_CASE("Lexer lex symbols", "[lexer]")
 TEST_CASE("Lexer lex keywords", "[lexer]")
 {
   Arena& permanent_arena = get_permanent_arena();
-  const Arena scratch_arena = get_scratch_arena();
 
   static constexpr const char* input = R"(int void return typedef
  if else
@@ -87,7 +87,188 @@ TEST_CASE("Lexer lex keywords", "[lexer]")
       TOKEN_KEYWORD_STATIC,   TOKEN_KEYWORD_EXTERN,
       TOKEN_IDENTIFIER,       TOKEN_EOF};
 
-  const auto tokens = lex(input, &permanent_arena, scratch_arena);
+  const auto tokens = lex(input, &permanent_arena);
   const std::span token_types(tokens.token_types, tokens.token_count);
   REQUIRE_THAT(expected, RangeEquals(token_types));
 }
+
+TEST_CASE("Lexer lex long runs of whitespace, comments, and identifiers",
+          "[lexer]")
+{
+  Arena& permanent_arena = get_permanent_arena();
+
+  // Long enough that each run spans several SIMD chunks
+  static constexpr const char* input =
+      "  \t\t  \r\n          \n\n                                   int\n"
+      "/* a comment that is longer than a SIMD chunk * / with * and /\n"
+      "   and a line break */ a_really_long_identifier_name_over_32_chars "
+      "// a line comment that is also longer than a chunk\n"
+      "1234567890123456789012345678901234567890abc/**/x";
+
+  static constexpr TokenTag expected[] = {
+      TOKEN_KEYWORD_INT, TOKEN_IDENTIFIER, TOKEN_ERROR, TOKEN_IDENTIFIER,
+      TOKEN_EOF};
+  static constexpr uint32_t expected_starts[] = {55, 145, 240, 287, 288};
+  static constexpr uint32_t expected_sizes[] = {3, 43, 43, 1, 0};
+
+  const auto tokens = lex(input, &permanent_arena);
+  REQUIRE_THAT(expected,
+               RangeEquals(std::span(tokens.token_types, tokens.token_count)));
+  REQUIRE_THAT(expected_starts, RangeEquals(std::span(tokens.token_starts,
+                                                      tokens.token_count)));
+  std::vector<uint32_t> sizes;
+  for (uint32_t i = 0; i < tokens.token_count; ++i) {
+    sizes.push_back(get_token(&tokens, i).size);
+  }
+  REQUIRE_THAT(expected_sizes, RangeEquals(sizes));
+}
+
+TEST_CASE("Lexer lex identifiers that resemble keywords", "[lexer]")
+{
+  Arena& permanent_arena = get_permanent_arena();
+
+  static constexpr const char* input =
+      "i in intx iff els elses do_ doo continue_ continu static1 _int Int v";
+
+  const auto tokens = lex(input, &permanent_arena);
+  REQUIRE(tokens.token_count == 15);
+  for (uint32_t i = 0; i + 1 < tokens.token_count; ++i) {
+    REQUIRE(tokens.token_types[i] == TOKEN_IDENTIFIER);
+  }
+  REQUIRE(tokens.token_types[14] == TOKEN_EOF);
+}
+
+TEST_CASE("Lexer skips the directives left by the preprocessor", "[lexer]")
+{
+  Arena& permanent_arena = get_permanent_arena();
+
+  static constexpr const char* input = R"(# 1 "main.c"
+int x;
+#pragma once
+# 7 "foo.h" 1
+int y = x # 1;)";
+
+  static constexpr TokenTag expected[] = {
+      TOKEN_KEYWORD_INT, TOKEN_IDENTIFIER, TOKEN_SEMICOLON,
+      TOKEN_KEYWORD_INT, TOKEN_IDENTIFIER, TOKEN_EQUAL,
+      TOKEN_IDENTIFIER,  TOKEN_ERROR,      TOKEN_INTEGER,
+      TOKEN_SEMICOLON,   TOKEN_EOF};
+
+  const auto tokens = lex(input, &permanent_arena);
+  const std::span token_types(tokens.token_types, tokens.token_count);
+  REQUIRE_THAT(expected, RangeEquals(token_types));
+}
+
+TEST_CASE("Lexer interns identifiers", "[lexer]")
+{
+  Arena& permanent_arena = get_permanent_arena();
+
+  static constexpr const char* input = "foo = bar + foo * foo_;";
+
+  const auto tokens = lex(input, &permanent_arena);
+  REQUIRE(tokens.token_count == 9);
+  const uint32_t foo = tokens.token_values[0];
+  const uint32_t bar = tokens.token_values[2];
+  REQUIRE(tokens.token_values[4] == foo);
+  REQUIRE(tokens.token_values[6] != foo);
+  REQUIRE(bar != foo);
+  REQUIRE(get_token(&tokens, 4).value == foo);
+
+  REQUIRE(str_eq(symbol_name(tokens.interner, foo), str("foo")));
+  REQUIRE(str_eq(symbol_name(tokens.interner, bar), str("bar")));
+  REQUIRE(str_eq(symbol_name(tokens.interner, tokens.token_values[6]),
+                 str("foo_")));
+}
+
+TEST_CASE("Lexer decodes integer literals", "[lexer]")
+{
+  Arena& permanent_arena = get_permanent_arena();
+
+  static constexpr const char* input =
+      "0 7 42 007 2147483647 2147483648 4294967295 4294967296 "
+      "99999999999999999999999 12ab";
+  static constexpr TokenTag expected_types[] = {
+      TOKEN_INTEGER, TOKEN_INTEGER, TOKEN_INTEGER, TOKEN_INTEGER,
+      TOKEN_INTEGER, TOKEN_INTEGER, TOKEN_INTEGER, TOKEN_ERROR,
+      TOKEN_ERROR,   TOKEN_ERROR,   TOKEN_EOF};
+  static constexpr uint32_t expected_values[] = {
+      0,
+      7,
+      42,
+      7,
+      2147483647,
+      2147483648,
+      4294967295,
+      LEX_ERROR_INTEGER_TOO_LARGE,
+      LEX_ERROR_INTEGER_TOO_LARGE,
+      LEX_ERROR_UNEXPECTED_CHARACTER,
+      0};
+
+  const auto tokens = lex(input, &permanent_arena);
+  REQUIRE_THAT(expected_types,
+               RangeEquals(std::span(tokens.token_types, tokens.token_count)));
+  REQUIRE_THAT(expected_values,
+               RangeEquals(std::span(tokens.token_values, tokens.token_count)));
+
+  Lexer lexer = lexer_create(input);
+  for (const uint32_t expected_value : expected_values) {
+    REQUIRE(lexer_next_token(&lexer).value == expected_value);
+  }
+}
+
+TEST_CASE("Lexer derives token sizes", "[lexer]")
+{
+  Arena& permanent_arena = get_permanent_arena();
+
+  static constexpr const char* input =
+      "continue x1 >>= -> 42 12ab @ = while_ ;";
+  static constexpr uint32_t expected_sizes[] = {8, 2, 3, 2, 2, 4, 1, 1, 6, 1,
+                                                0};
+
+  const auto tokens = lex(input, &permanent_arena);
+  REQUIRE(tokens.token_count == std::size(expected_sizes));
+  for (uint32_t i = 0; i < tokens.token_count; ++i) {
+    REQUIRE(get_token(&tokens, i).size == expected_sizes[i]);
+  }
+}
+
+TEST_CASE("Lexer lex in parallel", "[lexer]")
+{
+  Arena& permanent_arena = get_permanent_arena();
+
+  // Comments that span lines look like code from the inside, so a chunk that
+  // starts within one sees bogus tokens
+  std::string input;
+  for (int i = 0; i < 20; ++i) {
+    input += "int x = 1 + 2; /* a comment\n"
+             "int not_code = 3; // still a comment\n"
+             "  /* nested-looking */ int also_not_code;\n"
+             "*/ return x; /*\n"
+             "a line comment inside a block comment // */ int real;\n"
+             "// line comment /* not a block comment\n"
+             "   \n"
+             "/*\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n*/x >>= 2;\n";
+  }
+  input += "/* a long comment\n";
+  for (int i = 0; i < 100; ++i) { input += "int y = 42;\n"; }
+  input += "*/ int z;";
+
+  const Tokens expected = lex_with_threads(input.c_str(), 1, &permanent_arena);
+  const std::span expected_types(expected.token_types, expected.token_count);
+  const std::span expected_starts(expected.token_starts,
+                                  expected.token_count);
+  const std::span expected_values(expected.token_values,
+                                  expected.token_count);
+
+  for (uint32_t thread_count = 2; thread_count <= 16; ++thread_count) {
+    const Tokens tokens =
+        lex_with_threads(input.c_str(), thread_count, &permanent_arena);
+    REQUIRE_THAT(expected_types, RangeEquals(std::span(tokens.token_types,
+                                                       tokens.token_count)));
+    REQUIRE_THAT(expected_starts, RangeEquals(std::span(tokens.token_starts,
+                                                        tokens.token_count)));
+    // Identifiers are interned in token order either way
+    REQUIRE_THAT(expected_values, RangeEquals(std::span(tokens.token_values,
+                                                        tokens.token_count)));
+  }
+}
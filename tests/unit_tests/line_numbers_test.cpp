@@ -2,6 +2,9 @@
 #include <catch2/matchers/catch_matchers_range_equals.hpp>
 
 #include <span>
+#include <string>
+#include <utility>
+#include <vector>
 
 extern "C" {
 #include <mcc/arena.h>
@@ -45,4 +48,91 @@ TEST_CASE("Line numbers calculation", "[lexer]")
     REQUIRE(line_column.line == 3);
     REQUIRE(line_column.column == 3);
   }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Line markers map lines back to the files they came from",
+          "[lexer]")
+{
+  const StringView src = str(R"(# 1 "main.c"
+int x;
+# 1 "foo.h" 1
+int y;
+
+int z;
+# 3 "main.c" 2
+#line 10
+int w;)");
+
+  const auto* table = get_line_num_table(
+      "main.i", src, &get_permanent_arena(), get_scratch_arena());
+  REQUIRE(table->line_count == 9);
+  REQUIRE(table->marker_count == 4);
+
+  const auto presumed = [&](uint32_t line) {
+    const PresumedLine result = calculate_presumed_line(table, line);
+    return std::pair(std::string(result.filename), result.line);
+  };
+  REQUIRE(presumed(2) == std::pair(std::string("main.c"), 1u));
+  REQUIRE(presumed(4) == std::pair(std::string("foo.h"), 1u));
+  REQUIRE(presumed(6) == std::pair(std::string("foo.h"), 3u));
+  REQUIRE(presumed(9) == std::pair(std::string("main.c"), 10u));
+
+  // Markers that return to a file share its name
+  REQUIRE(table->markers[0].filename == table->markers[2].filename);
+}
+
+TEST_CASE("Each file has a line number table of its own", "[lexer]")
+{
+  const StringView first = str("int x;\nint y;\n");
+  const StringView second = str("int z;\n");
+
+  const auto* first_table = get_line_num_table(
+      "first.c", first, &get_permanent_arena(), get_scratch_arena());
+  const auto* second_table = get_line_num_table(
+      "second.c", second, &get_permanent_arena(), get_scratch_arena());
+  REQUIRE(first_table != second_table);
+  REQUIRE(first_table->line_count == 3);
+  REQUIRE(second_table->line_count == 2);
+  REQUIRE(get_line_num_table("first.c", first, &get_permanent_arena(),
+                             get_scratch_arena()) == first_table);
+}
+
+TEST_CASE("Line cursor finds the same lines as a search", "[lexer]")
+{
+  std::string source;
+  for (int i = 0; i < 200; ++i) {
+    source += (i % 50 == 0) ? "# " + std::to_string(i * 2) + " \"f.c\"\n"
+                            : std::string(static_cast<size_t>(i % 7), 'x') +
+                                  "\n";
+  }
+  const StringView src = {source.data(), source.size()};
+  const auto* table = get_line_num_table(
+      "cursor.c", src, &get_permanent_arena(), get_scratch_arena());
+
+  // Forward in small and large steps, then backward
+  std::vector<uint32_t> offsets;
+  for (uint32_t offset = 0; offset < src.size; offset += 3) {
+    offsets.push_back(offset);
+  }
+  for (uint32_t offset = 0; offset < src.size; offset += 97) {
+    offsets.push_back(offset);
+  }
+  for (uint32_t offset = static_cast<uint32_t>(src.size); offset-- > 0;) {
+    offsets.push_back(offset);
+  }
+
+  LineCursor cursor = line_cursor(table);
+  for (const uint32_t offset : offsets) {
+    const LineColumn expected = calculate_line_and_column(table, offset);
+    const LineColumn actual = cursor_line_and_column(&cursor, offset);
+    REQUIRE(expected.line == actual.line);
+    REQUIRE(expected.column == actual.column);
+
+    const PresumedLine expected_presumed =
+        calculate_presumed_line(table, expected.line);
+    const PresumedLine actual_presumed =
+        cursor_presumed_line(&cursor, actual.line);
+    REQUIRE(expected_presumed.filename == actual_presumed.filename);
+    REQUIRE(expected_presumed.line == actual_presumed.line);
+  }
+}
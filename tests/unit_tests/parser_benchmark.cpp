@@ -0,0 +1,397 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+extern "C" {
+#include <mcc/frontend.h>
+#include <mcc/sema.h>
+
+// From ast.h, which does not compile as C++
+StringView string_from_ast(const TranslationUnit* tu, Arena* permanent_arena);
+
+// From ir.h, whose anonymous structs are not valid C++
+typedef struct IRGenerationResult {
+  struct IRProgram* program;
+  ErrorsView errors;
+} IRGenerationResult;
+IRGenerationResult ir_generate(const TranslationUnit* ast,
+                               Arena* permanent_arena, Arena scratch_arena);
+}
+
+#include "benchmark_utils.hpp"
+
+namespace {
+
+// Functions whose bodies nest `depth` blocks, each declaring one variable.
+// The innermost block uses the outermost variable `use_count` times, which is
+// the worst case for resolving names scope by scope
+std::string generate_nested_source(uint32_t depth, uint32_t use_count)
+{
+  std::string source;
+  for (int function = 0; function < 10; ++function) {
+    source += fmt::format("int nested_{}(void) {{\n  int v0 = 0;\n", function);
+    for (uint32_t i = 1; i < depth; ++i) {
+      source += fmt::format("{{ int v{} = v{};\n", i, i - 1);
+    }
+    for (uint32_t i = 0; i < use_count; ++i) { source += "v0 = v0 + 1;\n"; }
+    for (uint32_t i = 1; i < depth; ++i) { source += "}\n"; }
+    source += "  return v0;\n}\n";
+  }
+  return source;
+}
+
+// Functions with a few different signatures, each declared redeclaration_count
+// times before its definition and then called once
+std::string generate_redeclarations(uint32_t function_count,
+                                    uint32_t redeclaration_count)
+{
+  constexpr const char* params[] = {"void", "int a", "int a, int b"};
+  constexpr const char* args[] = {"", "1", "1, 2"};
+
+  std::string source;
+  for (uint32_t i = 0; i < function_count; ++i) {
+    const char* param_list = params[i % 3];
+    for (uint32_t j = 0; j < redeclaration_count; ++j) {
+      source += fmt::format("int function_{}({});\n", i, param_list);
+    }
+    source +=
+        fmt::format("int function_{}({}) {{ return 0; }}\n", i, param_list);
+    source += fmt::format("int caller_{}(void) {{ return function_{}({}); }}\n",
+                          i, i, args[i % 3]);
+  }
+  return source;
+}
+
+// A function returning an expression that nests `depth` levels deep
+std::string generate_deep_expression(std::string_view kind, uint32_t depth)
+{
+  std::string expr;
+  if (kind == "left associative operators") {
+    expr = "x";
+    for (uint32_t i = 0; i < depth; ++i) { expr += " + x"; }
+  } else if (kind == "assignments") {
+    for (uint32_t i = 0; i < depth; ++i) { expr += "x = "; }
+    expr += "1";
+  } else if (kind == "parentheses") {
+    expr = std::string(depth, '(') + "x" + std::string(depth, ')');
+  } else if (kind == "unary operators") {
+    expr = std::string(depth, '!') + "x";
+  } else if (kind == "ternaries") {
+    for (uint32_t i = 0; i < depth; ++i) {
+      expr += fmt::format("x ? {} : ", i);
+    }
+    expr += "0";
+  } else if (kind == "calls") {
+    for (uint32_t i = 0; i < depth; ++i) { expr += "f("; }
+    expr += "x" + std::string(depth, ')');
+  }
+  return fmt::format("int f(int a);\n"
+                     "int main(void) {{\n  int x = 1;\n  return {};\n}}\n",
+                     expr);
+}
+
+// A function with an `else if` ladder of `depth` ifs
+std::string generate_else_if_ladder(uint32_t depth)
+{
+  std::string source = "int main(void) {\n  int x = 1;\n  ";
+  for (uint32_t i = 0; i < depth; ++i) {
+    source += fmt::format("if (x == {}) x = {};\n  else ", i, i + 1);
+  }
+  source += "x = 0;\n  return x;\n}\n";
+  return source;
+}
+
+} // namespace
+
+TEST_CASE("Identifier resolution in nested scopes", "[parser][benchmark]")
+{
+  constexpr uint32_t use_count = 10'000;
+
+  for (const uint32_t depth : {10u, 100u, 1000u}) {
+    const std::string source = generate_nested_source(depth, use_count);
+
+    Arena token_arena = arena_from_virtual_mem(256 * 1024 * 1024);
+    Arena ast_arena = arena_from_virtual_mem(256 * 1024 * 1024);
+    Arena scratch_arena = arena_from_virtual_mem(256 * 1024 * 1024);
+    const Tokens tokens = lex(source.c_str(), &token_arena);
+
+    bool has_error = true;
+    const double seconds = best_seconds_of(5, [&] {
+      arena_reset(&ast_arena);
+      const ParseResult result =
+          parse(source.c_str(), tokens, &ast_arena, scratch_arena);
+      has_error = result.ast == nullptr;
+    });
+    REQUIRE(!has_error);
+
+    // Every use statement references v0 twice
+    const size_t identifier_uses = 10 * (use_count * 2 + depth);
+    report_rate(fmt::format("resolve identifiers at depth {}", depth),
+                identifier_uses, "identifiers", seconds);
+  }
+}
+
+TEST_CASE("AST size and tree walks", "[parser][benchmark]")
+{
+  const std::string source = generate_c_functions(100'000);
+  const auto line_count =
+      static_cast<size_t>(std::ranges::count(source, '\n'));
+
+  Arena token_arena = arena_from_virtual_mem(1024 * 1024 * 1024);
+  Arena ast_arena = arena_from_virtual_mem(2048ull * 1024 * 1024);
+  Arena scratch_arena = arena_from_virtual_mem(1024 * 1024 * 1024);
+  const Tokens tokens = lex(source.c_str(), &token_arena);
+
+  // Times f once and keeps the best time in best
+  const auto time = [](double& best, auto&& f) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const auto end = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double>(end - start).count());
+  };
+
+  // The walks fill in the tree, so each run starts from a fresh parse
+  constexpr double max = std::numeric_limits<double>::max();
+  double type_check_seconds = max;
+  double ir_generate_seconds = max;
+  double print_seconds = max;
+  size_t ast_bytes = 0;
+  for (int run = 0; run < 5; ++run) {
+    arena_reset(&ast_arena);
+    TranslationUnit* ast =
+        parse(source.c_str(), tokens, &ast_arena, scratch_arena).ast;
+    REQUIRE(ast != nullptr);
+    ast_bytes = static_cast<size_t>(ast_arena.current -
+                                    static_cast<Byte*>(ast_arena.begin));
+
+    time(type_check_seconds, [&] {
+      REQUIRE(type_check(ast, &ast_arena).length == 0);
+    });
+    time(ir_generate_seconds, [&] {
+      REQUIRE(ir_generate(ast, &ast_arena, scratch_arena).program != nullptr);
+    });
+    time(print_seconds, [&] { (void)string_from_ast(ast, &ast_arena); });
+  }
+
+  report_bytes_per_item("AST", ast_bytes, line_count, "line");
+  report_throughput("type_check", source.size(), type_check_seconds);
+  report_throughput("ir_generate", source.size(), ir_generate_seconds);
+  report_throughput("string_from_ast", source.size(), print_seconds);
+}
+
+// Type checking right after parsing each declaration saves walking the whole
+// AST again once it has left the cache
+TEST_CASE("Front end with fused type checking", "[parser][sema][benchmark]")
+{
+  const std::string source = generate_c_functions(100'000);
+
+  Arena token_arena = arena_from_virtual_mem(1024 * 1024 * 1024);
+  Arena ast_arena = arena_from_virtual_mem(2048ull * 1024 * 1024);
+  Arena scratch_arena = arena_from_virtual_mem(1024 * 1024 * 1024);
+  const Tokens tokens = lex(source.c_str(), &token_arena);
+
+  bool ok = true;
+  const double separate_seconds = best_seconds_of(5, [&] {
+    arena_reset(&ast_arena);
+    TranslationUnit* ast =
+        parse(source.c_str(), tokens, &ast_arena, scratch_arena).ast;
+    ok &= ast != nullptr && type_check(ast, &ast_arena).length == 0;
+  });
+  const double fused_seconds = best_seconds_of(5, [&] {
+    arena_reset(&ast_arena);
+    const ParseResult result =
+        parse_and_type_check(source.c_str(), tokens, &ast_arena, scratch_arena);
+    ok &= result.ast != nullptr && result.type_errors.length == 0;
+  });
+  REQUIRE(ok);
+
+  report_throughput("parse, then type_check", source.size(), separate_seconds);
+  report_throughput("parse_and_type_check", source.size(), fused_seconds);
+}
+
+// The generated functions are static, and main only calls one in a hundred of
+// them, like a program that includes a large header
+TEST_CASE("Front end skimming mostly dead functions",
+          "[parser][sema][ir][benchmark]")
+{
+  constexpr size_t function_count = 100'000;
+  std::string source = generate_c_functions(function_count);
+  source += "int main(void)\n{\n    int sum = 0;\n";
+  for (size_t i = 0; i < function_count; i += 100) {
+    source += fmt::format("    sum += compute_weighted_sum_{}(sum, 1);\n", i);
+  }
+  source += "    return sum;\n}\n";
+
+  Arena token_arena = arena_from_virtual_mem(1024 * 1024 * 1024);
+  Arena ast_arena = arena_from_virtual_mem(2048ull * 1024 * 1024);
+  Arena scratch_arena = arena_from_virtual_mem(1024 * 1024 * 1024);
+  const Tokens tokens = lex(source.c_str(), &token_arena);
+
+  // Parses, checks and lowers the source
+  const auto compile = [&](auto&& parse_function) {
+    arena_reset(&ast_arena);
+    const ParseResult result =
+        parse_function(source.c_str(), tokens, &ast_arena, scratch_arena);
+    return result.ast != nullptr && result.type_errors.length == 0 &&
+           ir_generate(result.ast, &ast_arena, scratch_arena).program !=
+               nullptr;
+  };
+
+  bool ok = true;
+  const double eager_seconds =
+      best_seconds_of(5, [&] { ok &= compile(parse_and_type_check); });
+  const double skim_seconds = best_seconds_of(
+      5, [&] { ok &= compile(parse_reachable_and_type_check); });
+  REQUIRE(ok);
+
+  report_throughput("parse all, check and lower", source.size(),
+                    eager_seconds);
+  report_throughput("skim, check and lower", source.size(), skim_seconds);
+}
+
+// Bodies are parsed and checked on up to thread_count threads once the top
+// level is known. The speedup is bounded by the cores of the machine
+TEST_CASE("Front end parsing bodies on threads", "[parser][sema][benchmark]")
+{
+  const std::string source = generate_c_functions(10'000);
+
+  Arena token_arena = arena_from_virtual_mem(256 * 1024 * 1024);
+  Arena ast_arena = arena_from_virtual_mem(1024 * 1024 * 1024);
+  Arena scratch_arena = arena_from_virtual_mem(256 * 1024 * 1024);
+  const Tokens tokens = lex(source.c_str(), &token_arena);
+
+  bool ok = true;
+  const double sequential_seconds = best_seconds_of(5, [&] {
+    arena_reset(&ast_arena);
+    const ParseResult result =
+        parse_and_type_check(source.c_str(), tokens, &ast_arena, scratch_arena);
+    ok &= result.ast != nullptr && result.type_errors.length == 0;
+  });
+  report_throughput("parse_and_type_check", source.size(), sequential_seconds);
+
+  for (const uint32_t thread_count : {1u, 2u, 4u, 8u}) {
+    const double seconds = best_seconds_of(5, [&] {
+      arena_reset(&ast_arena);
+      const ParseResult result = parse_and_type_check_with_threads(
+          source.c_str(), tokens, thread_count, &ast_arena, scratch_arena);
+      ok &= result.ast != nullptr && result.type_errors.length == 0;
+    });
+    report_throughput(fmt::format("bodies on {} threads", thread_count),
+                      source.size(), seconds);
+  }
+  REQUIRE(ok);
+}
+
+TEST_CASE("Type checking redeclarations", "[sema][benchmark]")
+{
+  const std::string source = generate_redeclarations(10'000, 20);
+
+  Arena token_arena = arena_from_virtual_mem(1024 * 1024 * 1024);
+  Arena ast_arena = arena_from_virtual_mem(1024 * 1024 * 1024);
+  Arena scratch_arena = arena_from_virtual_mem(1024 * 1024 * 1024);
+  const Tokens tokens = lex(source.c_str(), &token_arena);
+
+  // Type checking marks definitions, so each run starts from a fresh parse
+  double seconds = std::numeric_limits<double>::max();
+  size_t type_check_bytes = 0;
+  for (int run = 0; run < 5; ++run) {
+    arena_reset(&ast_arena);
+    TranslationUnit* ast =
+        parse(source.c_str(), tokens, &ast_arena, scratch_arena).ast;
+    REQUIRE(ast != nullptr);
+
+    const Byte* begin = ast_arena.current;
+    const auto start = std::chrono::steady_clock::now();
+    REQUIRE(type_check(ast, &ast_arena).length == 0);
+    const auto end = std::chrono::steady_clock::now();
+    seconds =
+        std::min(seconds, std::chrono::duration<double>(end - start).count());
+    type_check_bytes = static_cast<size_t>(ast_arena.current - begin);
+  }
+
+  report_throughput("type_check with redeclarations", source.size(), seconds);
+  report_bytes_per_item("type_check allocation", type_check_bytes, 10'000,
+                        "function");
+}
+
+// The arenas start as small as in the compiler driver and grow through the
+// front end, so the page faults of first touching the memory are part of the
+// time
+TEST_CASE("Front end on huge pages", "[parser][arena][benchmark]")
+{
+  const std::string source = generate_c_functions(100'000);
+
+  for (const bool huge_pages : {false, true}) {
+    arena_set_huge_pages(huge_pages);
+
+    size_t fewest_page_faults = std::numeric_limits<size_t>::max();
+    const double seconds = best_seconds_of(3, [&] {
+      const size_t page_faults_before = minor_page_faults();
+      Arena permanent_arena = arena_from_virtual_mem(16 * 1024 * 1024);
+      Arena scratch_arena = arena_from_virtual_mem(1024 * 1024);
+
+      const Tokens tokens = lex(source.c_str(), &permanent_arena);
+      TranslationUnit* ast =
+          parse(source.c_str(), tokens, &permanent_arena, scratch_arena).ast;
+      REQUIRE(ast != nullptr);
+      REQUIRE(type_check(ast, &permanent_arena).length == 0);
+      REQUIRE(ir_generate(ast, &permanent_arena, scratch_arena).program !=
+              nullptr);
+
+      arena_release_virtual_mem(&scratch_arena);
+      arena_release_virtual_mem(&permanent_arena);
+      fewest_page_faults = std::min(fewest_page_faults,
+                                    minor_page_faults() - page_faults_before);
+    });
+
+    const char* pages = huge_pages ? "huge pages" : "4 KB pages";
+    report_throughput(fmt::format("front end on {}", pages), source.size(),
+                      seconds);
+    fmt::print("{:<40} {:>10} page faults\n",
+               fmt::format("front end on {}", pages), fewest_page_faults);
+  }
+  arena_set_huge_pages(false);
+}
+
+// Every phase has to handle nesting 100k levels deep without overflowing the
+// stack
+TEST_CASE("Deeply nested input", "[parser][sema][ir][benchmark]")
+{
+  constexpr uint32_t depth = 100'000;
+
+  std::vector<std::pair<std::string, std::string>> sources;
+  for (const char* kind :
+       {"left associative operators", "assignments", "parentheses",
+        "unary operators", "ternaries", "calls"}) {
+    sources.emplace_back(kind, generate_deep_expression(kind, depth));
+  }
+  sources.emplace_back("else if ladder", generate_else_if_ladder(depth));
+
+  for (const auto& [name, source] : sources) {
+    Arena token_arena = arena_from_virtual_mem(256 * 1024 * 1024);
+    Arena ast_arena = arena_from_virtual_mem(256 * 1024 * 1024);
+    Arena scratch_arena = arena_from_virtual_mem(256 * 1024 * 1024);
+
+    // Type checking marks definitions, so each run starts from a fresh parse
+    bool ok = false;
+    const double seconds = best_seconds_of(3, [&] {
+      arena_reset(&token_arena);
+      arena_reset(&ast_arena);
+      const Tokens tokens = lex(source.c_str(), &token_arena);
+      TranslationUnit* ast =
+          parse(source.c_str(), tokens, &ast_arena, scratch_arena).ast;
+      ok = ast != nullptr && type_check(ast, &ast_arena).length == 0 &&
+           ir_generate(ast, &ast_arena, scratch_arena).program != nullptr;
+    });
+    REQUIRE(ok);
+
+    report_throughput(fmt::format("compile nested {}", name), source.size(),
+                      seconds);
+  }
+}
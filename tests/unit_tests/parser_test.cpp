@@ -0,0 +1,352 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <string_view>
+
+extern "C" {
+#include <mcc/frontend.h>
+#include <mcc/sema.h>
+
+// From ast.h, which does not compile as C++
+StringView string_from_ast(const TranslationUnit* tu, Arena* permanent_arena);
+}
+
+#include "arenas.hpp"
+
+static std::string_view to_string_view(StringView s)
+{
+  return {s.start, s.size};
+}
+
+TEST_CASE("Parser produces the same AST when lexing on demand", "[parser]")
+{
+  Arena& permanent_arena = get_permanent_arena();
+  const Arena scratch_arena = get_scratch_arena();
+
+  static constexpr const char* input = R"(int add(int a, int b);
+static int counter = 0;
+int main(void)
+{
+  int x = 1;
+  for (int i = 0; i < 10; i += 1) {
+    if (i % 2 == 0) continue;
+    x = add(x, i) ? x << 1 : -~x;
+  }
+  do { x = x - 1; } while (x > 100);
+  return x;
+})";
+
+  const ParseResult from_tokens = parse(
+      input, lex(input, &permanent_arena), &permanent_arena, scratch_arena);
+  const ParseResult on_demand =
+      parse_on_demand(input, &permanent_arena, scratch_arena);
+
+  REQUIRE(from_tokens.ast != nullptr);
+  REQUIRE(on_demand.ast != nullptr);
+  REQUIRE(to_string_view(string_from_ast(from_tokens.ast, &permanent_arena)) ==
+          to_string_view(string_from_ast(on_demand.ast, &permanent_arena)));
+}
+
+TEST_CASE("Parser reports the same errors when lexing on demand", "[parser]")
+{
+  Arena& permanent_arena = get_permanent_arena();
+  const Arena scratch_arena = get_scratch_arena();
+
+  static constexpr const char* input = R"(int main(void)
+{
+  int x = 1 @ 2;
+  return x +;
+})";
+
+  const ParseResult from_tokens = parse(
+      input, lex(input, &permanent_arena), &permanent_arena, scratch_arena);
+  const ParseResult on_demand =
+      parse_on_demand(input, &permanent_arena, scratch_arena);
+
+  REQUIRE(from_tokens.errors.length != 0);
+  REQUIRE(from_tokens.errors.length == on_demand.errors.length);
+  for (size_t i = 0; i < from_tokens.errors.length; ++i) {
+    const Error& expected = from_tokens.errors.data[i];
+    const Error& actual = on_demand.errors.data[i];
+    REQUIRE(to_string_view(expected.msg) == to_string_view(actual.msg));
+    REQUIRE(expected.range.begin == actual.range.begin);
+    REQUIRE(expected.range.end == actual.range.end);
+  }
+}
+
+TEST_CASE("Type checking while parsing reports the same errors",
+          "[parser][sema]")
+{
+  Arena& permanent_arena = get_permanent_arena();
+  const Arena scratch_arena = get_scratch_arena();
+
+  static constexpr const char* input = R"(int f(int a);
+int f(int a, int b);
+int g(void) { return 1; }
+int g(void) { return 2; }
+int h(void) { int x = 1; return x(2); }
+int main(void)
+{
+  int x = f(1, 2, 3);
+  return h() + g();
+})";
+
+  const Tokens tokens = lex(input, &permanent_arena);
+  const ParseResult parsed =
+      parse(input, tokens, &permanent_arena, scratch_arena);
+  REQUIRE(parsed.ast != nullptr);
+  const ErrorsView expected = type_check(parsed.ast, &permanent_arena);
+
+  const ParseResult fused =
+      parse_and_type_check(input, tokens, &permanent_arena, scratch_arena);
+  REQUIRE(fused.ast != nullptr);
+  const ErrorsView actual = fused.type_errors;
+
+  REQUIRE(expected.length == 4);
+  REQUIRE(expected.length == actual.length);
+  for (size_t i = 0; i < expected.length; ++i) {
+    REQUIRE(to_string_view(expected.data[i].msg) ==
+            to_string_view(actual.data[i].msg));
+    REQUIRE(expected.data[i].range.begin == actual.data[i].range.begin);
+    REQUIRE(expected.data[i].range.end == actual.data[i].range.end);
+  }
+}
+
+TEST_CASE("Skimming only parses the reachable function bodies", "[parser]")
+{
+  Arena& permanent_arena = get_permanent_arena();
+  const Arena scratch_arena = get_scratch_arena();
+
+  // The body of unused is never parsed, so its error is not reported
+  static constexpr const char* input = R"(static int unused(void) { return 1 +; }
+static int leaf(int a) { return a; }
+static int helper(int a) { return leaf(a) + 1; }
+int main(void) { return helper(41); })";
+
+  const ParseResult result = parse_reachable_and_type_check(
+      input, lex(input, &permanent_arena), &permanent_arena, scratch_arena);
+  REQUIRE(result.errors.length == 0);
+  REQUIRE(result.type_errors.length == 0);
+  REQUIRE(result.ast != nullptr);
+
+  const std::string_view ast =
+      to_string_view(string_from_ast(result.ast, &permanent_arena));
+  REQUIRE(ast.find("ReturnStmt") != std::string_view::npos);
+}
+
+TEST_CASE("Skimmed bodies only see what was declared before them",
+          "[parser]")
+{
+  Arena& permanent_arena = get_permanent_arena();
+  const Arena scratch_arena = get_scratch_arena();
+
+  static constexpr const char* input = R"(int f(int a) { return g + a; }
+int g = 1;
+int main(void) { return f(g) + 1 +; })";
+
+  const Tokens tokens = lex(input, &permanent_arena);
+  const ParseResult expected =
+      parse(input, tokens, &permanent_arena, scratch_arena);
+  const ParseResult actual = parse_reachable_and_type_check(
+      input, tokens, &permanent_arena, scratch_arena);
+
+  REQUIRE(expected.errors.length == 2);
+  REQUIRE(expected.errors.length == actual.errors.length);
+  for (size_t i = 0; i < expected.errors.length; ++i) {
+    REQUIRE(to_string_view(expected.errors.data[i].msg) ==
+            to_string_view(actual.errors.data[i].msg));
+    REQUIRE(expected.errors.data[i].range.begin ==
+            actual.errors.data[i].range.begin);
+  }
+}
+
+TEST_CASE("Parser rejects statements nested too deeply", "[parser]")
+{
+  // Every block has its own scope, more than the shared arena can hold
+  Arena permanent_arena = arena_from_virtual_mem(64 * 1024 * 1024);
+  const Arena scratch_arena = get_scratch_arena();
+
+  const std::string input = "int main(void) {" + std::string(2000, '{') +
+                            std::string(2000, '}') + "}";
+
+  const ParseResult result =
+      parse_on_demand(input.c_str(), &permanent_arena, scratch_arena);
+  REQUIRE(result.ast == nullptr);
+  REQUIRE(result.errors.length != 0);
+  REQUIRE(to_string_view(result.errors.data[0].msg) ==
+          "statement nested too deeply");
+}
+
+TEST_CASE("Parameters of a local prototype may shadow local variables",
+          "[parser]")
+{
+  Arena& permanent_arena = get_permanent_arena();
+  const Arena scratch_arena = get_scratch_arena();
+
+  static constexpr const char* input =
+      "int main(void) { int a = 1; int f(int a); return a; }";
+
+  const ParseResult result =
+      parse_on_demand(input, &permanent_arena, scratch_arena);
+  REQUIRE(result.ast != nullptr);
+  REQUIRE(result.errors.length == 0);
+}
+
+TEST_CASE("Streaming parser hands over declarations until the first error",
+          "[parser][sema]")
+{
+  Arena& permanent_arena = get_permanent_arena();
+  const Arena scratch_arena = get_scratch_arena();
+
+  static constexpr const char* input = R"(int counter = 0;
+int f(int a);
+int g(int a) { return f(a) + counter; }
+int h(void) { int x = 1; return x(2); }
+int main(void) { return g(1) + h(); }
+)";
+
+  uint32_t decl_count = 0;
+  const DeclSink sink = {
+      .consume = [](void* context, const Decl*,
+                    const AstNodes*) { ++*static_cast<uint32_t*>(context); },
+      .context = &decl_count,
+  };
+  const ParseResult streamed =
+      parse_on_demand_into_sink(input, new_interner(&permanent_arena), sink,
+                                &permanent_arena, scratch_arena);
+  const ParseResult expected = parse_on_demand_and_type_check(
+      input, new_interner(&permanent_arena), &permanent_arena, scratch_arena);
+
+  // Everything before h, which calls an int
+  REQUIRE(decl_count == 3);
+  REQUIRE(streamed.ast != nullptr);
+  REQUIRE(streamed.type_errors.length != 0);
+  REQUIRE(streamed.type_errors.length == expected.type_errors.length);
+  for (size_t i = 0; i < expected.type_errors.length; ++i) {
+    REQUIRE(to_string_view(streamed.type_errors.data[i].msg) ==
+            to_string_view(expected.type_errors.data[i].msg));
+  }
+}
+
+TEST_CASE("Parsing bodies on threads produces the same AST", "[parser]")
+{
+  Arena& permanent_arena = get_permanent_arena();
+  const Arena scratch_arena = get_scratch_arena();
+
+  // Shadowing and local prototypes make workers leave bodies to the main thread
+  static constexpr const char* input = R"(int add(int a, int b) { return a + b; }
+int counter = 0;
+int twice(int x) { return add(x, x); }
+int shadow(int x) { { int x = 2; return x; } }
+int local_prototype(void) { int helper(int a); return helper(1); }
+int helper(int a) { return a ? a : -1; }
+int main(void)
+{
+  int x = 1;
+  for (int i = 0; i < 10; i += 1) {
+    if (i % 2 == 0) continue;
+    x = twice(x) + shadow(i) + local_prototype();
+  }
+  do { x = x - 1; } while (x > 100);
+  return x + counter;
+})";
+
+  const Tokens tokens = lex(input, &permanent_arena);
+  const ParseResult expected =
+      parse_and_type_check(input, tokens, &permanent_arena, scratch_arena);
+  REQUIRE(expected.ast != nullptr);
+  REQUIRE(expected.type_errors.length == 0);
+  const std::string_view expected_ast =
+      to_string_view(string_from_ast(expected.ast, &permanent_arena));
+
+  for (const uint32_t thread_count : {1u, 2u, 3u, 4u}) {
+    const ParseResult actual = parse_and_type_check_with_threads(
+        input, tokens, thread_count, &permanent_arena, scratch_arena);
+    REQUIRE(actual.ast != nullptr);
+    REQUIRE(actual.type_errors.length == 0);
+    REQUIRE(to_string_view(string_from_ast(actual.ast, &permanent_arena)) ==
+            expected_ast);
+  }
+}
+
+TEST_CASE("Parsing bodies on threads reports the same errors", "[parser][sema]")
+{
+  Arena& permanent_arena = get_permanent_arena();
+  const Arena scratch_arena = get_scratch_arena();
+
+  // Skimming parses all of these bodies, since none of them is static
+  static constexpr const char* parse_error_input = R"(int f(int a) { return a +; }
+int g(void) { return 1; }
+int h(int a) { int b = a @ 2; return b; }
+int main(void) { return f(1) + h(2) }
+)";
+
+  static constexpr const char* type_error_input = R"(int f(int a);
+int f(int a, int b);
+int g(void) { return 1; }
+int g(void) { return 2; }
+int h(void) { int x = 1; return x(2); }
+int main(void)
+{
+  int x = f(1, 2, 3);
+  return h() + g();
+})";
+
+  // The local prototype comes first in the file, so it is the declaration the
+  // definition conflicts with, even though the definition is parsed first when
+  // bodies are parsed on threads
+  static constexpr const char* local_prototype_input = R"(int main(void)
+{
+  int foo(void);
+  return foo();
+}
+int foo(int x) { return x + 42; }
+int call_foo(void) { return foo(1); }
+)";
+
+  const auto require_same_errors = [](ErrorsView expected, ErrorsView actual) {
+    REQUIRE(expected.length != 0);
+    REQUIRE(expected.length == actual.length);
+    for (size_t i = 0; i < expected.length; ++i) {
+      REQUIRE(to_string_view(expected.data[i].msg) ==
+              to_string_view(actual.data[i].msg));
+      REQUIRE(expected.data[i].range.begin == actual.data[i].range.begin);
+      REQUIRE(expected.data[i].range.end == actual.data[i].range.end);
+    }
+  };
+
+  const Tokens parse_error_tokens = lex(parse_error_input, &permanent_arena);
+  const ParseResult skimmed = parse_reachable_and_type_check(
+      parse_error_input, parse_error_tokens, &permanent_arena, scratch_arena);
+
+  const Tokens type_error_tokens = lex(type_error_input, &permanent_arena);
+  const ParseResult sequential = parse_and_type_check(
+      type_error_input, type_error_tokens, &permanent_arena, scratch_arena);
+
+  const Tokens local_prototype_tokens =
+      lex(local_prototype_input, &permanent_arena);
+  const ParseResult sequential_local_prototype =
+      parse_and_type_check(local_prototype_input, local_prototype_tokens,
+                           &permanent_arena, scratch_arena);
+
+  for (const uint32_t thread_count : {1u, 2u, 4u}) {
+    const ParseResult parsed = parse_and_type_check_with_threads(
+        parse_error_input, parse_error_tokens, thread_count, &permanent_arena,
+        scratch_arena);
+    REQUIRE(parsed.ast == nullptr);
+    require_same_errors(skimmed.errors, parsed.errors);
+
+    const ParseResult checked = parse_and_type_check_with_threads(
+        type_error_input, type_error_tokens, thread_count, &permanent_arena,
+        scratch_arena);
+    REQUIRE(checked.ast != nullptr);
+    require_same_errors(sequential.type_errors, checked.type_errors);
+
+    const ParseResult local_prototype = parse_and_type_check_with_threads(
+        local_prototype_input, local_prototype_tokens, thread_count,
+        &permanent_arena, scratch_arena);
+    REQUIRE(local_prototype.ast != nullptr);
+    require_same_errors(sequential_local_prototype.type_errors,
+                        local_prototype.type_errors);
+  }
+}
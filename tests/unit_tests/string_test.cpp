@@ -16,6 +16,11 @@ TEST_CASE("String View")
     REQUIRE(not str_eq(str("0"), str("012")));
     REQUIRE(str_eq(str("123"), str("123")));
     REQUIRE(not str_eq(str("123"), str("124")));
+
+    // Views are compared by their size, not up to a null character
+    const char with_nulls[] = "a\0b\0a\0c";
+    REQUIRE(not str_eq(StringView{.start = with_nulls, .size = 3},
+                       StringView{.start = with_nulls + 4, .size = 3}));
   }
 
   SECTION("str_start_with")
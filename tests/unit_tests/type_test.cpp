@@ -0,0 +1,30 @@
+#include <catch2/catch_test_macros.hpp>
+
+extern "C" {
+#include <mcc/type.h>
+}
+
+#include "arenas.hpp"
+
+TEST_CASE("Identical types are interned to one object", "[type]")
+{
+  Arena arena = get_scratch_arena();
+  TypeInterner* types = new_type_interner(&arena);
+
+  const Type* binary = func_type(types, typ_int, 2);
+  REQUIRE(binary->tag == TYPE_FUNCTION);
+  REQUIRE(func_type(types, typ_int, 2) == binary);
+
+  // Types that differ in any component are distinct
+  REQUIRE(func_type(types, typ_int, 1) != binary);
+  REQUIRE(func_type(types, typ_void, 2) != binary);
+  REQUIRE(func_type(types, typ_void, 2) == func_type(types, typ_void, 2));
+
+  // Types interned later are equal to the ones interned earlier
+  for (uint32_t i = 0; i < 100; ++i) { func_type(types, typ_int, i); }
+  REQUIRE(func_type(types, typ_int, 2) == binary);
+
+  const auto* function_type = reinterpret_cast<const FunctionType*>(binary);
+  REQUIRE(function_type->return_type == typ_int);
+  REQUIRE(function_type->param_count == 2);
+}
@@ -0,0 +1,60 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdio>
+#include <string>
+
+extern "C" {
+#include <mcc/frontend.h>
+
+// C++ takes the anonymous structs of the IR only as an extension
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+#include <mcc/ir.h>
+#include <mcc/x86.h>
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+}
+
+#include "benchmark_utils.hpp"
+
+TEST_CASE("Assembly output throughput", "[x86][benchmark]")
+{
+  const std::string source = generate_c_functions(100'000);
+
+  Arena permanent_arena = arena_from_virtual_mem(2048ull * 1024 * 1024);
+  Arena scratch_arena = arena_from_virtual_mem(1024 * 1024 * 1024);
+  const Tokens tokens = lex(source.c_str(), &permanent_arena);
+  const ParseResult parse_result = parse_and_type_check(
+      source.c_str(), tokens, &permanent_arena, scratch_arena);
+  REQUIRE(parse_result.ast != nullptr);
+  IRGenerationResult ir_result =
+      ir_generate(parse_result.ast, &permanent_arena, scratch_arena);
+  REQUIRE(ir_result.program != nullptr);
+  const X86Program program = x86_generate_assembly(
+      ir_result.program, &permanent_arena, scratch_arena);
+
+  // The size of the output, from writing it to a file once
+  FILE* file = tmpfile();
+  REQUIRE(file != nullptr);
+  REQUIRE(x86_write_assembly(&program, fileno(file), scratch_arena));
+  REQUIRE(fseek(file, 0, SEEK_END) == 0);
+  const auto output_size = static_cast<size_t>(ftell(file));
+  (void)fclose(file);
+
+  // Writing to /dev/null leaves only the cost of formatting and system calls
+  FILE* null_file = fopen("/dev/null", "w");
+  REQUIRE(null_file != nullptr);
+  bool ok = true;
+  const double write_seconds = best_seconds_of(5, [&] {
+    ok &= x86_write_assembly(&program, fileno(null_file), scratch_arena);
+  });
+  (void)fclose(null_file);
+  REQUIRE(ok);
+
+  fmt::print("{:<40} {:>10.1f} MB\n", ".s output",
+             static_cast<double>(output_size) / 1e6);
+  report_throughput("x86_write_assembly", output_size, write_seconds);
+}